@@ -0,0 +1,545 @@
+#include "FakeData/VboBenchmark.h"
+#include "FakeData/FakeDataBase.h"
+#include "DataManager/PolylinesVboManager.h"
+#include "DataManager/TriangleVboManager.h"
+#include "Common/ThreadPool.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QDebug>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+using namespace GLRhi;
+
+namespace
+{
+    constexpr size_t GROW_TARGET_VERTS = 1'490'000; // 单块上限 150 万，留出余量避免切到新块
+    constexpr size_t TOGGLE_BATCH_LINES = 10'000;    // 构造显隐切换场景时每批添加的折线数
+}
+
+void VboBenchmark::runGrowBenchmark(QOpenGLContext* context, size_t nPointsPerLine, size_t nLinesPerBatch)
+{
+    if (!context || nPointsPerLine < 2 || nLinesPerBatch == 0)
+        return;
+
+    QOpenGLFunctions_3_3_Core* gl = context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+    if (!gl)
+        return;
+
+    PolylinesVboManager manager;
+    if (!manager.initialize(context))
+        return;
+
+    // 所有折线同色，保证落在同一个块里
+    const Color color(0.2f, 0.4f, 0.8f, 1.0f);
+    const size_t nFloatsPerLine = nPointsPerLine * 3;
+
+    std::vector<float> vVerts(nLinesPerBatch * nFloatsPerLine);
+    std::vector<std::tuple<long long, float*, size_t, Color>> vBatch(nLinesPerBatch);
+
+    long long nNextId = 1;
+    size_t nTotalVerts = 0;
+    size_t nBatchCount = 0;
+    size_t nGrowBatchCount = 0;
+    double dGrowBatchMs = 0.0;  // 触发扩容的批次耗时（含 glFinish）
+    double dTotalMs = 0.0;
+
+    gl->glFinish();
+    while (nTotalVerts + nLinesPerBatch * nPointsPerLine <= GROW_TARGET_VERTS)
+    {
+        for (size_t i = 0; i < nLinesPerBatch; ++i)
+        {
+            float* pLine = vVerts.data() + i * nFloatsPerLine;
+            for (size_t j = 0; j < nPointsPerLine; ++j)
+            {
+                pLine[j * 3 + 0] = FakeDataBase::getRandomFloat(-1.0f, 1.0f);
+                pLine[j * 3 + 1] = FakeDataBase::getRandomFloat(-1.0f, 1.0f);
+                pLine[j * 3 + 2] = 0.0f;
+            }
+            vBatch[i] = std::make_tuple(nNextId++, pLine, nFloatsPerLine, color);
+        }
+
+        size_t nGrowBefore = manager.getGrowStats().nGrowCount;
+
+        auto tStart = std::chrono::steady_clock::now();
+        manager.addPolylines(vBatch);
+        gl->glFinish();
+        std::chrono::duration<double, std::milli> dElapsed = std::chrono::steady_clock::now() - tStart;
+
+        dTotalMs += dElapsed.count();
+        if (manager.getGrowStats().nGrowCount != nGrowBefore)
+        {
+            nGrowBatchCount++;
+            dGrowBatchMs += dElapsed.count();
+        }
+
+        nTotalVerts += nLinesPerBatch * nPointsPerLine;
+        nBatchCount++;
+    }
+
+    VboGrowStats stats = manager.getGrowStats();
+    qDebug() << "[VboBenchmark] grow: verts" << nTotalVerts
+        << "batches" << nBatchCount
+        << "grows" << stats.nGrowCount
+        << "bytesMoved" << stats.nBytesMoved
+        << "growStallMs" << stats.dStallMs
+        << "growBatchMs" << dGrowBatchMs << "(" << nGrowBatchCount << "batches )"
+        << "totalMs" << dTotalMs;
+
+    manager.clearAllPrimitives();
+}
+
+void VboBenchmark::runToggleBenchmark(QOpenGLContext* context, size_t nLines, size_t nTogglesPerFrame, size_t nFrames)
+{
+    if (!context || nLines == 0 || nTogglesPerFrame == 0 || nFrames == 0)
+        return;
+
+    QOpenGLFunctions_3_3_Core* gl = context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+    if (!gl)
+        return;
+
+    PolylinesVboManager manager;
+    if (!manager.initialize(context))
+        return;
+
+    const Color color(0.2f, 0.4f, 0.8f, 1.0f);
+    constexpr size_t nFloatsPerLine = 2 * 3;
+
+    std::vector<float> vVerts(TOGGLE_BATCH_LINES * nFloatsPerLine);
+    std::vector<std::tuple<long long, float*, size_t, Color>> vBatch;
+    vBatch.reserve(TOGGLE_BATCH_LINES);
+
+    // 折线 ID 为 1..nLines
+    for (size_t nAdded = 0; nAdded < nLines; nAdded += vBatch.size())
+    {
+        size_t nCount = std::min(TOGGLE_BATCH_LINES, nLines - nAdded);
+        vBatch.clear();
+        for (size_t i = 0; i < nCount; ++i)
+        {
+            float* pLine = vVerts.data() + i * nFloatsPerLine;
+            float x = FakeDataBase::getRandomFloat(-1.0f, 1.0f);
+            float y = FakeDataBase::getRandomFloat(-1.0f, 1.0f);
+            pLine[0] = x;
+            pLine[1] = y;
+            pLine[2] = 0.0f;
+            pLine[3] = x + FakeDataBase::getRandomFloat(-0.01f, 0.01f);
+            pLine[4] = y + FakeDataBase::getRandomFloat(-0.01f, 0.01f);
+            pLine[5] = 0.0f;
+            vBatch.emplace_back(static_cast<long long>(nAdded + i + 1), pLine, nFloatsPerLine, color);
+        }
+        manager.addPolylines(vBatch);
+    }
+
+    // 预热：首帧提交上传并生成绘制命令
+    manager.renderVisiblePrimitivesEx();
+    gl->glFinish();
+
+    std::vector<bool> vVisible(nLines, true);
+    double dToggleTotalMs = 0.0;
+    double dToggleMaxMs = 0.0;
+    double dRenderTotalMs = 0.0;
+    double dRenderMaxMs = 0.0;
+
+    for (size_t nFrame = 0; nFrame < nFrames; ++nFrame)
+    {
+        auto tStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < nTogglesPerFrame; ++i)
+        {
+            size_t nIdx = static_cast<size_t>(FakeDataBase::getRandomInt(0, static_cast<int>(nLines) - 1));
+            vVisible[nIdx] = !vVisible[nIdx];
+            manager.setPolylineVisible(static_cast<long long>(nIdx + 1), vVisible[nIdx]);
+        }
+        auto tToggled = std::chrono::steady_clock::now();
+
+        manager.renderVisiblePrimitivesEx();
+        gl->glFinish();
+        auto tRendered = std::chrono::steady_clock::now();
+
+        double dToggleMs = std::chrono::duration<double, std::milli>(tToggled - tStart).count();
+        double dRenderMs = std::chrono::duration<double, std::milli>(tRendered - tToggled).count();
+        dToggleTotalMs += dToggleMs;
+        dRenderTotalMs += dRenderMs;
+        dToggleMaxMs = std::max(dToggleMaxMs, dToggleMs);
+        dRenderMaxMs = std::max(dRenderMaxMs, dRenderMs);
+    }
+
+    qDebug() << "[VboBenchmark] toggle: lines" << nLines
+        << "togglesPerFrame" << nTogglesPerFrame
+        << "frames" << nFrames
+        << "toggleAvgMs" << dToggleTotalMs / nFrames << "toggleMaxMs" << dToggleMaxMs
+        << "renderAvgMs" << dRenderTotalMs / nFrames << "renderMaxMs" << dRenderMaxMs;
+
+    manager.clearAllPrimitives();
+}
+
+void VboBenchmark::runDefragBenchmark(QOpenGLContext* context, size_t nLines)
+{
+    if (!context || nLines == 0)
+        return;
+
+    QOpenGLFunctions_3_3_Core* gl = context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+    if (!gl)
+        return;
+
+    const Color color(0.2f, 0.4f, 0.8f, 1.0f);
+    constexpr size_t nFloatsPerLine = 4 * 3;
+
+    // 两种方式使用同一组删除的ID
+    std::vector<long long> vRemoveIds;
+    vRemoveIds.reserve(nLines * 6 / 10);
+    for (size_t i = 0; i < nLines; ++i)
+    {
+        if (FakeDataBase::getRandomInt(0, 9) < 6)
+            vRemoveIds.push_back(static_cast<long long>(i + 1));
+    }
+
+    for (int nPass = 0; nPass < 2; ++nPass)
+    {
+        const bool bBudgeted = nPass == 1;
+
+        PolylinesVboManager manager;
+        if (!manager.initialize(context))
+            return;
+
+        std::vector<float> vVerts(TOGGLE_BATCH_LINES * nFloatsPerLine);
+        std::vector<std::tuple<long long, float*, size_t, Color>> vBatch;
+        vBatch.reserve(TOGGLE_BATCH_LINES);
+        for (size_t nAdded = 0; nAdded < nLines; nAdded += vBatch.size())
+        {
+            size_t nCount = std::min(TOGGLE_BATCH_LINES, nLines - nAdded);
+            vBatch.clear();
+            for (size_t i = 0; i < nCount; ++i)
+            {
+                float* pLine = vVerts.data() + i * nFloatsPerLine;
+                for (size_t j = 0; j < nFloatsPerLine; j += 3)
+                {
+                    pLine[j + 0] = FakeDataBase::getRandomFloat(-1.0f, 1.0f);
+                    pLine[j + 1] = FakeDataBase::getRandomFloat(-1.0f, 1.0f);
+                    pLine[j + 2] = 0.0f;
+                }
+                vBatch.emplace_back(static_cast<long long>(nAdded + i + 1), pLine, nFloatsPerLine, color);
+            }
+            manager.addPolylines(vBatch);
+        }
+
+        manager.renderVisiblePrimitivesEx();
+        gl->glFinish();
+
+        if (bBudgeted)
+            manager.startBackgroundDefrag();
+
+        manager.removePolylines(vRemoveIds);
+
+        // 出帧直到不再有待整理的块（同步方式第一帧即完成），最多 10 秒
+        size_t nFrames = 0;
+        double dFrameMaxMs = 0.0;
+        double dFrameTotalMs = 0.0;
+        size_t nIdleFrames = 0;
+        auto tBegin = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - tBegin < std::chrono::seconds(10))
+        {
+            size_t nCompactBefore = manager.getCompactStats().nCompactCount;
+
+            auto tStart = std::chrono::steady_clock::now();
+            manager.renderVisiblePrimitivesEx();
+            gl->glFinish();
+            double dFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+            dFrameTotalMs += dFrameMs;
+            dFrameMaxMs = std::max(dFrameMaxMs, dFrameMs);
+            nFrames++;
+
+            // 连续 1 秒（后台规划间隔的数倍）没有新的压缩，认为整理结束
+            VboCompactStats stats = manager.getCompactStats();
+            bool bInFlight = stats.nPlanned > stats.nIncremental + stats.nAborted;
+            if (stats.nCompactCount != nCompactBefore || bInFlight)
+                nIdleFrames = 0;
+            else if (++nIdleFrames >= 60)
+                break;
+
+            if (bBudgeted)
+                std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+
+        manager.stopBackgroundDefrag();
+
+        VboCompactStats stats = manager.getCompactStats();
+        qDebug() << "[VboBenchmark] defrag:" << (bBudgeted ? "budgeted" : "sync")
+            << "lines" << nLines << "removed" << vRemoveIds.size()
+            << "frames" << nFrames
+            << "frameAvgMs" << dFrameTotalMs / nFrames << "frameMaxMs" << dFrameMaxMs
+            << "compactions" << stats.nCompactCount
+            << "bytesMoved" << stats.nBytesMoved
+            << "stepFrames" << stats.nStepFrames << "maxStepMs" << stats.dMaxStepMs
+            << "aborted" << stats.nAborted;
+
+        manager.clearAllPrimitives();
+    }
+}
+
+void VboBenchmark::runConcurrencyStress(QOpenGLContext* context, size_t nProducers, size_t nOpsPerProducer)
+{
+    if (!context || nProducers == 0 || nOpsPerProducer == 0)
+        return;
+
+    QOpenGLFunctions_3_3_Core* gl = context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+    if (!gl)
+        return;
+
+    PolylinesVboManager manager;
+    if (!manager.initialize(context))
+        return;
+
+    std::atomic<size_t> nFinished{ 0 };
+    std::vector<size_t> vLiveCounts(nProducers, 0);
+    std::vector<std::thread> vProducers;
+    vProducers.reserve(nProducers);
+
+    for (size_t p = 0; p < nProducers; ++p)
+    {
+        vProducers.emplace_back([&manager, &nFinished, &vLiveCounts, p, nOpsPerProducer] {
+            std::mt19937 rng(static_cast<unsigned>(p) + 1u);
+            std::uniform_real_distribution<float> coord(-1.0f, 1.0f);
+            std::uniform_real_distribution<float> delta(-0.02f, 0.02f);
+            std::uniform_int_distribution<int> op(0, 99);
+            std::uniform_int_distribution<int> points(2, 8);
+
+            // 每个线程使用独立的ID区间，命令之间没有跨线程依赖
+            const long long nIdBase = static_cast<long long>(p + 1) << 32;
+            long long nNextId = 0;
+            std::vector<long long> vLive;
+            const Color color(0.1f * static_cast<float>(p % 8), 0.6f, 0.8f, 1.0f);
+
+            auto makeVerts = [&]() {
+                int nPoints = points(rng);
+                std::vector<float> vVerts(static_cast<size_t>(nPoints) * 3);
+                float x = coord(rng);
+                float y = coord(rng);
+                for (int i = 0; i < nPoints; ++i)
+                {
+                    vVerts[i * 3 + 0] = x + delta(rng);
+                    vVerts[i * 3 + 1] = y + delta(rng);
+                    vVerts[i * 3 + 2] = 0.0f;
+                }
+                return vVerts;
+            };
+
+            for (size_t i = 0; i < nOpsPerProducer; ++i)
+            {
+                int nOp = op(rng);
+                if (vLive.empty() || nOp < 55)
+                {
+                    long long id = nIdBase + nNextId++;
+                    manager.enqueueAdd(id, makeVerts(), color);
+                    vLive.push_back(id);
+                }
+                else if (nOp < 70)
+                {
+                    size_t nIdx = rng() % vLive.size();
+                    manager.enqueueUpdate(vLive[nIdx], makeVerts());
+                }
+                else if (nOp < 80)
+                {
+                    size_t nIdx = rng() % vLive.size();
+                    manager.enqueueVisible(vLive[nIdx], (nOp & 1) != 0);
+                }
+                else
+                {
+                    size_t nIdx = rng() % vLive.size();
+                    manager.enqueueRemove(vLive[nIdx]);
+                    vLive[nIdx] = vLive.back();
+                    vLive.pop_back();
+                }
+            }
+
+            vLiveCounts[p] = vLive.size();
+            nFinished.fetch_add(1, std::memory_order_release);
+            });
+    }
+
+    size_t nFrames = 0;
+    size_t nMaxDrained = 0;
+    double dFrameTotalMs = 0.0;
+    double dFrameMaxMs = 0.0;
+
+    // 生产者运行期间持续出帧；最后再出一帧，取出生产者结束前提交的剩余命令
+    bool bLastFrame = false;
+    while (!bLastFrame)
+    {
+        bLastFrame = nFinished.load(std::memory_order_acquire) == nProducers;
+
+        auto tStart = std::chrono::steady_clock::now();
+        manager.renderVisiblePrimitivesEx();
+        gl->glFinish();
+        double dFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+        nMaxDrained = std::max(nMaxDrained, manager.getQueueStats().nLastDrained);
+        dFrameTotalMs += dFrameMs;
+        dFrameMaxMs = std::max(dFrameMaxMs, dFrameMs);
+        nFrames++;
+    }
+
+    for (std::thread& t : vProducers)
+        t.join();
+
+    size_t nExpectedLive = 0;
+    for (size_t nLive : vLiveCounts)
+        nExpectedLive += nLive;
+
+    VboQueueStats stats = manager.getQueueStats();
+    qDebug() << "[VboBenchmark] concurrency: producers" << nProducers
+        << "opsPerProducer" << nOpsPerProducer
+        << "frames" << nFrames
+        << "frameAvgMs" << dFrameTotalMs / nFrames << "frameMaxMs" << dFrameMaxMs
+        << "maxDrainedPerFrame" << nMaxDrained
+        << "enqueued" << stats.nEnqueued << "applied" << stats.nApplied << "rejected" << stats.nRejected
+        << "liveLines" << nExpectedLive;
+
+    if (stats.nApplied + stats.nRejected != stats.nEnqueued || stats.nRejected != 0)
+        qWarning() << "[VboBenchmark] concurrency: command queue lost or rejected commands";
+
+    manager.clearAllPrimitives();
+}
+
+void VboBenchmark::runIngestBenchmark(QOpenGLContext* context, size_t nLines, size_t nColors)
+{
+    if (!context || nLines == 0 || nColors == 0)
+        return;
+
+    QOpenGLFunctions_3_3_Core* gl = context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+    if (!gl)
+        return;
+
+    // 结构数组形式的输入：ID、顶点数、连续顶点、颜色
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<int> pointDist(2, 10);
+    std::uniform_real_distribution<float> posDist(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> stepDist(-0.01f, 0.01f);
+
+    std::vector<Color> vPalette;
+    for (size_t c = 0; c < nColors; ++c)
+        vPalette.emplace_back(posDist(rng) * 0.5f + 0.5f, posDist(rng) * 0.5f + 0.5f, posDist(rng) * 0.5f + 0.5f, 1.0f);
+
+    std::vector<long long> vIds(nLines);
+    std::vector<size_t> vCounts(nLines);
+    std::vector<Color> vColors(nLines);
+    std::vector<float> vVerts;
+    vVerts.reserve(nLines * 6 * 3);
+
+    for (size_t i = 0; i < nLines; ++i)
+    {
+        vIds[i] = static_cast<long long>(i + 1);
+        vCounts[i] = static_cast<size_t>(pointDist(rng));
+        vColors[i] = vPalette[i % nColors];
+
+        float x = posDist(rng);
+        float y = posDist(rng);
+        for (size_t j = 0; j < vCounts[i]; ++j)
+        {
+            vVerts.push_back(x);
+            vVerts.push_back(y);
+            vVerts.push_back(0.0f);
+            x += stepDist(rng);
+            y += stepDist(rng);
+        }
+    }
+
+    auto report = [&](const char* szName, double dIngestMs, double dUploadMs, size_t nAdded) {
+        qDebug() << "[VboBenchmark] ingest" << szName << ": lines" << nLines << "added" << nAdded
+            << "colors" << nColors << "verts" << vVerts.size() / 3
+            << "ingestMs" << dIngestMs
+            << "linesPerSec" << (dIngestMs > 0.0 ? nLines / (dIngestMs / 1000.0) : 0.0)
+            << "threads" << ThreadPool::global().getSlotCount()
+            << "firstFrameMs" << dUploadMs;
+        };
+
+    // 首帧：提交暂存区并绘制，含 glFinish
+    auto firstFrame = [&](auto& manager) {
+        auto tStart = std::chrono::steady_clock::now();
+        manager.renderVisiblePrimitivesEx();
+        gl->glFinish();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+        };
+
+    // tuple 批量接口
+    {
+        PolylinesVboManager manager;
+        if (!manager.initialize(context))
+            return;
+
+        std::vector<std::tuple<long long, float*, size_t, Color>> vBatch;
+        vBatch.reserve(nLines);
+        size_t nOffset = 0;
+        for (size_t i = 0; i < nLines; ++i)
+        {
+            vBatch.emplace_back(vIds[i], vVerts.data() + nOffset * 3, vCounts[i] * 3, vColors[i]);
+            nOffset += vCounts[i];
+        }
+
+        gl->glFinish();
+        auto tStart = std::chrono::steady_clock::now();
+        size_t nAdded = manager.addPolylines(vBatch);
+        double dIngestMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+        report("tuple", dIngestMs, firstFrame(manager), nAdded);
+        manager.clearAllPrimitives();
+    }
+
+    // 结构数组视图
+    {
+        PolylinesVboManager manager;
+        if (!manager.initialize(context))
+            return;
+
+        PolylineBatchView view;
+        view.pIds = vIds.data();
+        view.pVertCounts = vCounts.data();
+        view.pVerts = vVerts.data();
+        view.pColors = vColors.data();
+        view.nCount = nLines;
+
+        gl->glFinish();
+        auto tStart = std::chrono::steady_clock::now();
+        size_t nAdded = manager.ingestPolylines(view);
+        double dIngestMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+        report("span", dIngestMs, firstFrame(manager), nAdded);
+        manager.clearAllPrimitives();
+    }
+
+    // 同样的顶点按扇形三角化，走 addTriangles 批量接口
+    {
+        TriangleVboManager manager;
+
+        std::vector<unsigned int> vFanIndices;
+        for (unsigned int k = 1; k + 1 < 10; ++k)
+        {
+            vFanIndices.push_back(0);
+            vFanIndices.push_back(k);
+            vFanIndices.push_back(k + 1);
+        }
+
+        std::vector<std::tuple<long long, float*, size_t, unsigned int*, size_t, Color>> vBatch;
+        vBatch.reserve(nLines);
+        size_t nOffset = 0;
+        for (size_t i = 0; i < nLines; ++i)
+        {
+            // 2 个点的折线不足一个三角形，由 addTriangles 过滤
+            vBatch.emplace_back(vIds[i], vVerts.data() + nOffset * 3, vCounts[i],
+                vFanIndices.data(), (vCounts[i] - 2) * 3, vColors[i]);
+            nOffset += vCounts[i];
+        }
+
+        gl->glFinish();
+        auto tStart = std::chrono::steady_clock::now();
+        size_t nAdded = manager.addTriangles(vBatch);
+        double dIngestMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+        report("triangles", dIngestMs, firstFrame(manager), nAdded);
+        manager.clearAllPrimitives();
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef VBO_BENCHMARK_H
+#define VBO_BENCHMARK_H
+
+#include <cstddef>
+
+class QOpenGLContext;
+
+/**
+ * @brief VBO管理器性能基准
+ *
+ * 直接驱动 PolylinesVboManager，测量各类操作的GPU数据搬运量和耗时。
+ * 调用前必须保证 context 为当前上下文。
+ */
+class VboBenchmark final
+{
+public:
+    VboBenchmark() = default;
+    ~VboBenchmark() = default;
+
+public:
+    /**
+     * @brief 扩容基准
+     * 向单个颜色块持续追加折线，使其从初始的10万顶点增长到150万顶点，
+     * 输出扩容次数、GPU端搬运的字节数以及扩容造成的阻塞时间。
+     * @param context OpenGL上下文
+     * @param nPointsPerLine 每条折线的点数
+     * @param nLinesPerBatch 每批追加的折线数量
+     */
+    void runGrowBenchmark(QOpenGLContext* context,
+        size_t nPointsPerLine = 10, size_t nLinesPerBatch = 1000);
+
+    /**
+     * @brief 显隐切换基准
+     * 构造 nLines 条两点折线的场景，每帧随机切换 nTogglesPerFrame 条折线的可见性后提交绘制，
+     * 分别输出切换和绘制（含 glFinish）的平均 / 最大耗时，用于确认切换不会触发整块重建。
+     * 未绑定着色器，只衡量CPU端绘制命令的维护和提交开销。
+     * @param context OpenGL上下文
+     * @param nLines 场景中的折线数量
+     * @param nTogglesPerFrame 每帧切换的折线数量
+     * @param nFrames 帧数
+     */
+    void runToggleBenchmark(QOpenGLContext* context,
+        size_t nLines = 1'000'000, size_t nTogglesPerFrame = 1000, size_t nFrames = 100);
+
+    /**
+     * @brief 碎片整理基准
+     * 构造 nLines 条折线后随机删除 60%，分别以绘制时同步整块压缩、后台规划 + 分帧执行两种方式
+     * 持续出帧直到碎片整理完成，输出两种方式的最长帧耗时和分帧执行的步数。
+     * @param context OpenGL上下文
+     * @param nLines 场景中的折线数量
+     */
+    void runDefragBenchmark(QOpenGLContext* context, size_t nLines = 500'000);
+
+    /**
+     * @brief 并发编辑压力测试
+     * nProducers 个工作线程各自随机添加、更新、删除自己的折线（只通过 enqueue* 接口），
+     * 调用线程同时不断绘制帧并取出命令，输出帧耗时和每帧应用的命令数。
+     * 结束时检查全部命令都已应用，且没有被忽略的命令（每个线程的命令保持提交顺序）。
+     * @param context OpenGL上下文
+     * @param nProducers 工作线程数量
+     * @param nOpsPerProducer 每个工作线程提交的命令数
+     */
+    void runConcurrencyStress(QOpenGLContext* context,
+        size_t nProducers = 8, size_t nOpsPerProducer = 50'000);
+
+    /**
+     * @brief 批量导入基准
+     * 生成 nLines 条 2~10 点、nColors 种颜色交错的折线，分别用 tuple 批量接口和
+     * 结构数组视图（ingestPolylines）导入到新的管理器，输出导入耗时、每秒折线数、线程数，
+     * 以及首帧提交上传（含 glFinish）的耗时。同样的顶点再按扇形三角化后用 addTriangles 导入一次。
+     * 默认数量与 setLineDatasCRUD 的 MAX_COUNT 一致。
+     * @param context OpenGL上下文
+     * @param nLines 折线数量
+     * @param nColors 颜色数量
+     */
+    void runIngestBenchmark(QOpenGLContext* context, size_t nLines = 5'000'000, size_t nColors = 16);
+};
+
+#endif // VBO_BENCHMARK_H
@@ -1,4 +1,5 @@
 #include "Widget/RenderWidget.h"
+#include "FakeData/VboBenchmark.h"
 
 #include <QMouseEvent>
 #include <QWheelEvent>
@@ -57,6 +58,15 @@ namespace GLRhi
         if (!m_renderManager.initialize(this->context()))
             qFatal("Initialize render manager failed!");
 
+        // 伪数据都在 [-1, 1] 内，默认瓦片（1024）只会按原点分成四块；取 1/8 边长，
+        // 按瓦片分块（Shift+F9）时每种颜色分成 8x8 块，视口裁剪能整块跳过
+        auto lineRenderer = static_cast<LineRenderer*>(m_renderManager.getLineRenderer());
+        lineRenderer->setTileSize(0.25f);
+
+        // 量化块包围盒以第一条折线为中心：边长取 4 时无论中心在 [-1, 1] 内何处都能覆盖全部伪数据，
+        // 切换到 Half2 / Int16Quant（F8）后每种颜色只需一个块
+        lineRenderer->setQuantExtent(4.0f);
+
         // 初始化伪数据生成器
         m_dataGen = std::make_unique<FakeDataProvider>();
         m_dataGen->initialize();
@@ -82,6 +92,10 @@ namespace GLRhi
         glClearColor(b.r(), b.g(), b.b(), 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        QPointF worldTopLeft = m_camera.screenToWorld(QPointF(0, 0), size());
+        QPointF worldBottomRight = m_camera.screenToWorld(QPointF(width(), height()), size());
+        m_renderManager.setViewRect(QRectF(worldTopLeft, worldBottomRight).normalized());
+        m_renderManager.setPixelSize(m_camera.getPixelSize(size()));
         m_renderManager.render(m_camera.getMatrix());
 
         //checkGLError("paintGL");
@@ -157,8 +171,9 @@ namespace GLRhi
         }
         break;
         case Qt::Key_F4:
-            // F4：随机动态数据
+            // F4：随机动态数据，增删改记入变化日志，下一帧提交
             m_renderManager.dataCRUD();
+            update();
             qDebug() << "RandomDynamicData";
             break;
         case Qt::Key_F5:
@@ -222,6 +237,131 @@ namespace GLRhi
             update();
         }
         break;
+        case Qt::Key_F6:
+        {
+            // F6：VBO扩容基准测试；Shift+F6：碎片整理基准测试（同步压缩 / 分帧整理）；Ctrl+F6：批量导入基准测试
+            makeCurrent();
+            VboBenchmark benchmark;
+            if (event->modifiers() & Qt::ShiftModifier)
+                benchmark.runDefragBenchmark(context());
+            else if (event->modifiers() & Qt::ControlModifier)
+                benchmark.runIngestBenchmark(context());
+            else
+                benchmark.runGrowBenchmark(context());
+            doneCurrent();
+        }
+        break;
+        case Qt::Key_F7:
+        {
+            // F7：切换折线绘制方式（非索引 / 索引），用于对比
+            auto lineRenderer = static_cast<LineRenderer*>(m_renderManager.getLineRenderer());
+            bool bIndexed = lineRenderer->getDrawMode() == PolylineDrawMode::Arrays;
+            lineRenderer->setDrawMode(bIndexed ? PolylineDrawMode::Indexed : PolylineDrawMode::Arrays);
+            qDebug() << "Polyline draw mode (F7):" << (bIndexed ? "glMultiDrawElementsBaseVertex" : "glMultiDrawArrays");
+            update();
+        }
+        break;
+        case Qt::Key_F8:
+        {
+            // F8：轮换折线顶点格式，对之后新建的块生效（按 F5 重新生成数据后对比显存占用）
+            static const VertexFormat vFormats[] = {
+                VertexFormat::Float3, VertexFormat::Float2, VertexFormat::Half2, VertexFormat::Int16Quant };
+            static const char* vNames[] = { "Float3", "Float2", "Half2", "Int16Quant" };
+
+            auto lineRenderer = static_cast<LineRenderer*>(m_renderManager.getLineRenderer());
+            int nCur = static_cast<int>(lineRenderer->getVertexFormat());
+            int nNext = (nCur + 1) % 4;
+            lineRenderer->setVertexFormat(vFormats[nNext]);
+            qDebug() << "Polyline vertex format (F8):" << vNames[nNext];
+        }
+        break;
+        case Qt::Key_F9:
+        {
+            // F9：切换折线颜色存储方式；Shift+F9：切换按颜色 / 按瓦片分块。
+            // 都对之后新增的折线生效（按 F5 重新生成数据后对比绘制调用数和 F10 的裁剪统计）
+            auto lineRenderer = static_cast<LineRenderer*>(m_renderManager.getLineRenderer());
+            if (event->modifiers() & Qt::ShiftModifier)
+            {
+                bool bTiled = lineRenderer->getBlockPlacement() == BlockPlacement::ByColor;
+                lineRenderer->setBlockPlacement(bTiled ? BlockPlacement::ByTile : BlockPlacement::ByColor);
+                qDebug() << "Polyline block placement (Shift+F9):" << (bTiled ? "by color and tile" : "by color");
+                break;
+            }
+
+            bool bShared = lineRenderer->getColorStorage() == ColorStorage::PerBlock;
+            lineRenderer->setColorStorage(bShared ? ColorStorage::PerVertex : ColorStorage::PerBlock);
+            qDebug() << "Polyline color storage (F9):" << (bShared ? "shared blocks, per-vertex color" : "per-color blocks");
+        }
+        break;
+        case Qt::Key_F10:
+        {
+            if (event->modifiers() & Qt::ShiftModifier)
+            {
+                // Shift+F10：轮换折线的屏幕尺寸 LOD（关闭 / 跳过不足 1 像素的折线 / 按像素格子合并）
+                static const char* vNames[] = { "off", "skip sub-pixel", "coverage per pixel" };
+                auto lineRenderer = static_cast<LineRenderer*>(m_renderManager.getLineRenderer());
+                int nNext = (static_cast<int>(lineRenderer->getLodMode()) + 1) % 3;
+                lineRenderer->setLod(static_cast<ViewCuller::LodMode>(nNext), 1.0f);
+                qDebug() << "Polyline screen-size LOD (Shift+F10):" << vNames[nNext];
+                update();
+                break;
+            }
+            if (event->modifiers() & Qt::ControlModifier)
+            {
+                // Ctrl+F10：切换折线多分辨率简化，对之后新增的折线生成简化层（按 F5 重新生成数据后缩小视图对比）
+                auto lineRenderer = static_cast<LineRenderer*>(m_renderManager.getLineRenderer());
+                bool bSimplify = !lineRenderer->getSimplification();
+                lineRenderer->setSimplification(bSimplify);
+                qDebug() << "Polyline simplification levels (Ctrl+F10):" << (bSimplify ? "on" : "off");
+                update();
+                break;
+            }
+
+            // F10：输出上一帧的 GL 状态调用统计、每个折线块的内存状态、顶点缓存命中和视口裁剪情况
+            const GLStateStats& stats = m_renderManager.getStateStats();
+            qDebug() << "GL state calls (F10): issued" << stats.nIssued << ", skipped" << stats.nSkipped;
+
+            auto lineRenderer = static_cast<LineRenderer*>(m_renderManager.getLineRenderer());
+            for (const VboBlockTelemetry& tel : lineRenderer->getBlockTelemetry())
+            {
+                qDebug() << "  polyline block" << tel.nSerial << (tel.bShared ? "shared" : "per-color")
+                    << "capacity" << tel.nCapacity << "live" << tel.nLiveVerts << "dead" << tel.nDeadVerts
+                    << "holes" << tel.nHoleCount << "largestHole" << tel.nLargestHole
+                    << "frag" << tel.dFragmentation
+                    << "compactions" << tel.nCompactCount << "bytesMoved" << tel.nBytesMoved
+                    << "shadowBytes" << tel.nShadowBytes;
+            }
+
+            VboCacheStats cache = lineRenderer->getCacheStats();
+            qDebug() << "  vertex cache: entries" << cache.nEntries << "bytes" << cache.nBytes << "/" << cache.nCapacityBytes
+                << "hits" << cache.nHits << "misses" << cache.nMisses << "evictions" << cache.nEvictions
+                << "readbacks" << cache.nReadbacks << "readbackBytes" << cache.nReadbackBytes;
+
+            VboCullStats cull = lineRenderer->getCullStats();
+            qDebug() << "  view culling: blocks skipped" << cull.nBlocksSkipped << "full" << cull.nBlocksFull
+                << "culled" << cull.nBlocksCulled << "prims" << cull.nPrimsDrawn << "/" << cull.nPrimsTotal
+                << "lod dropped" << cull.nPrimsLod << "simplified" << cull.nPrimsSimplified
+                << "list rebuilds" << cull.nRebuilds;
+        }
+        break;
+        case Qt::Key_F11:
+        {
+            // F11：显隐切换基准测试（100 万条折线，每帧随机切换 1000 条）
+            makeCurrent();
+            VboBenchmark benchmark;
+            benchmark.runToggleBenchmark(context());
+            doneCurrent();
+        }
+        break;
+        case Qt::Key_F12:
+        {
+            // F12：并发编辑压力测试（8 个工作线程提交编辑，当前线程持续出帧）
+            makeCurrent();
+            VboBenchmark benchmark;
+            benchmark.runConcurrencyStress(context());
+            doneCurrent();
+        }
+        break;
         default:
             break;
         }
@@ -490,8 +630,8 @@ namespace GLRhi
 
             if (1)
             {
-                auto lineRenderer = static_cast<LineRenderer*>(m_renderManager.getLineRenderer());
-                lineRenderer->updateData(vPLineDatas);
+                // 经由数据管理器加载，commit() 的批量编辑和 dataCRUD() 才能按ID找到这些折线
+                m_renderManager.setPolylineDatas(vPLineDatas);
             }
 
             if (0)
@@ -525,12 +665,13 @@ namespace GLRhi
             }
         }
 
-        // 三角形数据
+        // 三角形数据：混合测试三角形和三角剖分数据一起经由数据管理器加载，ID 各不相同
+        std::vector<TriangleData> vTriDatas;
         if (1)
         {
-            std::vector<TriangleData> vTriDatas = m_dataGen->genTriangleData();
-            auto triRenderer = static_cast<TriangleRenderer*>(m_renderManager.getTriangleRenderer());
-            triRenderer->updateData(vTriDatas);
+            vTriDatas = m_dataGen->genTriangleData();
+            for (size_t i = 0; i < vTriDatas.size(); ++i)
+                vTriDatas[i].id = static_cast<long long>(i + 1);
         }
         // 三角剖分数据
         if (1)
@@ -539,16 +680,16 @@ namespace GLRhi
             fakeTriangleMesh.generatePolygons(10, 3, 12, 0.5f);
 
             GLRhi::Brush brush(0.8f, 0.4f, 0.1f, 1.0f, 0.0f);
-            GLRhi::TriangleData data = convertToTriangleData(fakeTriangleMesh, 1, brush);
-            triRenderer->updateData({ data });
+            long long nMeshId = static_cast<long long>(vTriDatas.size() + 1);
+            vTriDatas.push_back(convertToTriangleData(fakeTriangleMesh, nMeshId, brush));
         }
+        m_renderManager.setTriangleDatas(vTriDatas);
 
         // 纹理数据
         if (0)
         {
             std::vector<TextureData> vTexDatas = m_dataGen->genTextureData();
-            auto texRenderer = static_cast<TextureRenderer*>(m_renderManager.getTextureRenderer());
-            texRenderer->updateData(vTexDatas);
+            m_renderManager.setTextureDatas(vTexDatas);
         }
 
         // 实例化纹理数据
@@ -18,6 +18,9 @@ namespace GLRhi
         // 屏幕坐标 → 世界坐标
         QPointF screenToWorld(const QPointF& screenPos, const QSize& viewSz) const;
 
+        // 一个像素对应的世界长度（由 m_dScale 换算，X、Y 方向相同），用于屏幕尺寸 LOD
+        float getPixelSize(const QSize& viewSz) const;
+
         // 缩放到指定范围（自动居中）
         void zoomToRange(float minX, float minY, float maxX, float maxY,
             const QSize& viewSz);
@@ -0,0 +1,92 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "Common/DllSet.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace GLRhi
+{
+    /**
+     * @brief 固定大小的线程池，提供 parallelFor
+     *
+     * - 工作线程常驻，parallelFor 时唤醒，不为每次调用创建线程
+     * - 调用线程也参与执行，区段通过原子计数器领取，快的线程多领，慢的线程少领
+     * - 同一时刻只执行一个 parallelFor，多个线程同时调用时依次执行
+     * - 在工作线程内再次调用 parallelFor 时直接串行执行，不会死锁
+     *
+     * 只用于纯CPU计算，回调里不能调用 GL。
+     */
+    class GLRENDER_API ThreadPool
+    {
+    public:
+        /**
+         * @brief 区段回调
+         * @param nBegin 起始下标
+         * @param nEnd 结束下标（不含）
+         * @param nSlot 执行线程的编号，[0, getSlotCount())，可用作线程私有数据的下标
+         */
+        using RangeFn = std::function<void(size_t nBegin, size_t nEnd, size_t nSlot)>;
+
+    public:
+        /**
+         * @param nThreads 工作线程数，0 表示硬件线程数减 1（调用线程占一个）
+         */
+        explicit ThreadPool(size_t nThreads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        /**
+         * @brief 进程内共享的线程池
+         */
+        static ThreadPool& global();
+
+    public:
+        /**
+         * @brief 参与执行的线程数（工作线程 + 调用线程），即 nSlot 的上限
+         */
+        size_t getSlotCount() const { return m_vThreads.size() + 1; }
+
+        /**
+         * @brief 把 [0, nCount) 切成最多 nGrain 个元素的区段并行执行，全部完成后返回
+         * @param nCount 元素数量
+         * @param nGrain 单个区段的元素数，0 按 1 处理
+         * @param fn 区段回调
+         */
+        void parallelFor(size_t nCount, size_t nGrain, const RangeFn& fn);
+
+    private:
+        void workerLoop(size_t nSlot);
+
+        /**
+         * @brief 领取并执行区段，直到领完
+         */
+        void runChunks(size_t nSlot);
+
+    private:
+        std::vector<std::thread> m_vThreads;
+        std::mutex m_callMutex;                 // 串行化 parallelFor 调用
+
+        std::mutex m_mutex;                     // 保护以下状态
+        std::condition_variable m_cvWork;
+        std::condition_variable m_cvDone;
+        const RangeFn* m_pFn{ nullptr };
+        size_t m_nCount{ 0 };
+        size_t m_nGrain{ 1 };
+        uint64_t m_nGeneration{ 0 };            // 每次 parallelFor 递增，工作线程据此判断有新任务
+        size_t m_nBusy{ 0 };                    // 尚未完成本次任务的工作线程数
+        bool m_bStop{ false };
+
+        std::atomic<size_t> m_nNext{ 0 };       // 下一个待领取的元素下标
+    };
+}
+
+#endif // THREAD_POOL_H
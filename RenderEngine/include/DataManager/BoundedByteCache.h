@@ -0,0 +1,219 @@
+#ifndef BOUNDED_BYTE_CACHE_H
+#define BOUNDED_BYTE_CACHE_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include "DataManager/VboStats.h"
+
+namespace GLRhi
+{
+    /**
+     * @brief 按字节限制容量的 LRU 缓存
+     *
+     * 哈希表 + 侵入式双向链表：链表指针直接存放在哈希表的节点里（unordered_map 的元素地址在
+     * rehash 后保持不变），查找、提升、插入、删除、淘汰都是 O(1)。
+     *
+     * 容量按字节计：每个条目的大小由调用方给出（数据本身），再加上固定的节点开销。
+     * 单个条目超过总容量时不缓存。
+     *
+     * 不加锁，由调用方（顶点管理器的写锁）保护。PolylinesVboManager 和 TriangleVboManager 共用。
+     *
+     * @tparam K 键类型
+     * @tparam V 值类型，需要可移动
+     */
+    template <typename K, typename V>
+    class BoundedByteCache final
+    {
+    public:
+        explicit BoundedByteCache(size_t nCapacityBytes = 0)
+            : m_nCapacityBytes(nCapacityBytes)
+        {
+        }
+
+        BoundedByteCache(const BoundedByteCache&) = delete;
+        BoundedByteCache& operator=(const BoundedByteCache&) = delete;
+
+    public:
+        /**
+         * @brief 设置容量，超出部分立即按 LRU 淘汰
+         */
+        void setCapacity(size_t nCapacityBytes)
+        {
+            m_nCapacityBytes = nCapacityBytes;
+            evict();
+        }
+
+        /**
+         * @brief 查找并提升为最近使用，计入命中 / 未命中统计
+         * @return 未命中时为 nullptr；指针在下一次修改缓存之前有效
+         */
+        V* find(const K& key)
+        {
+            auto it = m_map.find(key);
+            if (it == m_map.end())
+            {
+                m_stats.nMisses++;
+                return nullptr;
+            }
+
+            m_stats.nHits++;
+            moveToFront(&it->second);
+            return &it->second.value;
+        }
+
+        /**
+         * @brief 插入或替换条目，并提升为最近使用
+         * @param key 键
+         * @param value 值
+         * @param nBytes 值的数据字节数（不含节点开销）
+         */
+        void put(const K& key, V value, size_t nBytes)
+        {
+            size_t nCost = nBytes + NODE_OVERHEAD;
+
+            auto it = m_map.find(key);
+            if (it != m_map.end())
+            {
+                Node* node = &it->second;
+                m_stats.nBytes -= node->nCost;
+                if (nCost > m_nCapacityBytes)
+                {
+                    unlink(node);
+                    m_map.erase(it);
+                    return;
+                }
+
+                node->value = std::move(value);
+                node->nCost = nCost;
+                m_stats.nBytes += nCost;
+                moveToFront(node);
+                evict();
+                return;
+            }
+
+            if (nCost > m_nCapacityBytes)
+                return;
+
+            auto res = m_map.emplace(key, Node());
+            Node* node = &res.first->second;
+            node->key = key;
+            node->value = std::move(value);
+            node->nCost = nCost;
+            m_stats.nBytes += nCost;
+            linkFront(node);
+            evict();
+        }
+
+        /**
+         * @brief 删除条目
+         * @return false 条目不存在
+         */
+        bool erase(const K& key)
+        {
+            auto it = m_map.find(key);
+            if (it == m_map.end())
+                return false;
+
+            m_stats.nBytes -= it->second.nCost;
+            unlink(&it->second);
+            m_map.erase(it);
+            return true;
+        }
+
+        /**
+         * @brief 清空所有条目，统计计数保留
+         */
+        void clear()
+        {
+            m_map.clear();
+            m_pHead = nullptr;
+            m_pTail = nullptr;
+            m_stats.nBytes = 0;
+        }
+
+        size_t size() const { return m_map.size(); }
+        size_t sizeBytes() const { return m_stats.nBytes; }
+        size_t capacityBytes() const { return m_nCapacityBytes; }
+
+        /**
+         * @brief 命中 / 未命中 / 淘汰统计（nReadbacks 等由调用方填写）
+         */
+        VboCacheStats getStats() const
+        {
+            VboCacheStats stats = m_stats;
+            stats.nEntries = m_map.size();
+            stats.nCapacityBytes = m_nCapacityBytes;
+            return stats;
+        }
+
+    private:
+        struct Node
+        {
+            K key{};
+            V value{};
+            size_t nCost{ 0 };          // 数据字节数 + 节点开销
+            Node* pPrev{ nullptr };     // 更近使用的节点
+            Node* pNext{ nullptr };     // 更久未使用的节点
+        };
+
+        // 每个条目的固定开销：节点本身加上哈希表的桶和指针
+        static constexpr size_t NODE_OVERHEAD = sizeof(Node) + 2 * sizeof(void*);
+
+        void linkFront(Node* node)
+        {
+            node->pPrev = nullptr;
+            node->pNext = m_pHead;
+            if (m_pHead)
+                m_pHead->pPrev = node;
+            m_pHead = node;
+            if (!m_pTail)
+                m_pTail = node;
+        }
+
+        void unlink(Node* node)
+        {
+            if (node->pPrev)
+                node->pPrev->pNext = node->pNext;
+            else
+                m_pHead = node->pNext;
+
+            if (node->pNext)
+                node->pNext->pPrev = node->pPrev;
+            else
+                m_pTail = node->pPrev;
+
+            node->pPrev = nullptr;
+            node->pNext = nullptr;
+        }
+
+        void moveToFront(Node* node)
+        {
+            if (node == m_pHead)
+                return;
+            unlink(node);
+            linkFront(node);
+        }
+
+        void evict()
+        {
+            while (m_stats.nBytes > m_nCapacityBytes && m_pTail)
+            {
+                Node* victim = m_pTail;
+                m_stats.nBytes -= victim->nCost;
+                m_stats.nEvictions++;
+                unlink(victim);
+                m_map.erase(victim->key);
+            }
+        }
+
+    private:
+        std::unordered_map<K, Node> m_map;
+        Node* m_pHead{ nullptr };       // 最近使用
+        Node* m_pTail{ nullptr };       // 最久未使用，优先淘汰
+        size_t m_nCapacityBytes{ 0 };
+        VboCacheStats m_stats;
+    };
+}
+
+#endif // BOUNDED_BYTE_CACHE_H
@@ -0,0 +1,100 @@
+#ifndef CHANGE_JOURNAL_H
+#define CHANGE_JOURNAL_H
+
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+
+namespace GLRhi
+{
+    /**
+     * @brief 图元的变化类型
+     */
+    enum class ChangeKind
+    {
+        Added,      // 新增
+        Geometry,   // 几何变化，样式不变，可原地更新
+        Style,      // 样式（颜色）变化，需要换块：先删除再添加
+        Removed     // 删除
+    };
+
+    /**
+     * @brief 按图元ID记录的变化日志
+     *
+     * 两次提交之间同一ID的多次变化合并为一条，提交时只处理最终的差异：
+     * - 新增后修改仍是新增，新增后删除互相抵消
+     * - 几何变化后又改样式按样式处理（删除再添加会带上最新的几何）
+     * - 删除后再添加按样式处理，因为提交端仍持有旧图元
+     *
+     * 不加锁，由调用方保证线程安全。
+     */
+    class ChangeJournal
+    {
+    public:
+        void record(long long id, ChangeKind kind)
+        {
+            auto it = m_changes.find(id);
+            if (it == m_changes.end())
+            {
+                m_changes.emplace(id, kind);
+                return;
+            }
+
+            ChangeKind& prev = it->second;
+            switch (prev)
+            {
+            case ChangeKind::Added:
+                if (kind == ChangeKind::Removed)
+                    m_changes.erase(it);
+                break;
+            case ChangeKind::Geometry:
+                prev = kind;
+                break;
+            case ChangeKind::Style:
+                if (kind == ChangeKind::Removed)
+                    prev = kind;
+                break;
+            case ChangeKind::Removed:
+                if (kind == ChangeKind::Added)
+                    prev = ChangeKind::Style;
+                break;
+            }
+        }
+
+        /**
+         * @brief 按提交顺序拆分：先删除 vRemove，再原地更新 vUpdate，最后批量添加 vAdd
+         * 样式变化同时出现在 vRemove 和 vAdd 中
+         */
+        void split(std::vector<long long>& vRemove, std::vector<long long>& vUpdate, std::vector<long long>& vAdd) const
+        {
+            for (const auto& change : m_changes)
+            {
+                switch (change.second)
+                {
+                case ChangeKind::Added:
+                    vAdd.push_back(change.first);
+                    break;
+                case ChangeKind::Geometry:
+                    vUpdate.push_back(change.first);
+                    break;
+                case ChangeKind::Style:
+                    vRemove.push_back(change.first);
+                    vAdd.push_back(change.first);
+                    break;
+                case ChangeKind::Removed:
+                    vRemove.push_back(change.first);
+                    break;
+                }
+            }
+        }
+
+        void clear() { m_changes.clear(); }
+        size_t size() const { return m_changes.size(); }
+        bool empty() const { return m_changes.empty(); }
+
+    private:
+        std::unordered_map<long long, ChangeKind> m_changes;   // ID -> 合并后的变化
+    };
+}
+
+#endif // CHANGE_JOURNAL_H
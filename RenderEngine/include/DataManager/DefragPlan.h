@@ -0,0 +1,90 @@
+#ifndef DEFRAG_PLAN_H
+#define DEFRAG_PLAN_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "DataManager/VboCompactor.h"
+#include <QOpenGLFunctions_3_3_Core>
+
+namespace GLRhi
+{
+    /**
+     * @brief 分帧碎片整理的每帧预算
+     *
+     * glCopyBufferSubData 在GPU端异步执行，CPU计时只反映提交开销，
+     * 因此同时限制每帧拷贝的字节数，避免把拷贝堆积到GPU上造成掉帧。
+     */
+    struct DefragBudget
+    {
+        double dMaxMs{ 1.0 };                   // 每帧最多用于提交拷贝的时间（毫秒）
+        size_t nMaxBytes{ 8u * 1024u * 1024u }; // 每帧最多拷贝的字节数
+    };
+
+    /**
+     * @brief 单个存活图元的新位置
+     */
+    struct DefragRelocation
+    {
+        size_t nPrimIdx{ 0 };       // 图元在块 vPrimitives 中的原下标
+        size_t nNewBaseVertex{ 0 }; // 压缩后的起始顶点
+        size_t nNewBaseIndex{ 0 };  // 压缩后的起始索引（仅三角形块）
+    };
+
+    /**
+     * @brief 单个块的碎片整理计划
+     *
+     * 由后台线程在读锁下生成（只读块的元数据，不调用GL），交给渲染线程按预算分帧执行：
+     * 存活数据逐步拷贝到备用缓冲区，全部完成后交换缓冲区并按重定位表改写图元信息。
+     *
+     * 规划之后块被编辑（nEditEpoch 变化）或被删除时，计划作废，由后台线程重新规划。
+     */
+    struct DefragPlan
+    {
+        uint64_t nBlockSerial{ 0 };     // 目标块序号
+        uint64_t nEditEpoch{ 0 };       // 规划时块的编辑计数
+        double dScore{ 0.0 };           // 碎片化评分（空闲顶点占比）
+
+        std::vector<DefragRelocation> vRelocations; // 存活图元，按新位置排列
+        VboCompactor vertMoves;         // 顶点搬运区段（字节）
+        VboCompactor idxMoves;          // 索引搬运区段（字节，仅三角形块）
+
+        size_t nVertexCount{ 0 };       // 压缩后的顶点高水位线
+        size_t nIndexCount{ 0 };        // 压缩后的索引高水位线
+        size_t nVertexBytes{ 0 };       // 备用顶点缓冲区的容量（字节）
+        size_t nIndexBytes{ 0 };        // 备用索引缓冲区的容量（字节），为0表示没有索引缓冲区
+
+        // 执行进度（渲染线程）
+        VboCompactor::Cursor vertCursor;
+        VboCompactor::Cursor idxCursor;
+        bool bStarted{ false };         // 已为备用缓冲区分配存储
+
+        bool isFinished() const { return vertMoves.isFinished(vertCursor) && idxMoves.isFinished(idxCursor); }
+
+        /**
+         * @brief 在预算内推进拷贝，首次调用时为备用缓冲区分配存储
+         *
+         * 按固定大小分片提交，每片之后检查耗时和字节数；每次至少推进一片，保证计划最终完成。
+         *
+         * @param gl OpenGL函数表
+         * @param nVbo 当前顶点缓冲区
+         * @param nVboSpare 备用顶点缓冲区，为0时自动创建
+         * @param nEbo 当前索引缓冲区（没有时为0）
+         * @param nEboSpare 备用索引缓冲区
+         * @param budget 每帧预算
+         * @return 本次拷贝的字节数
+         */
+        size_t step(QOpenGLFunctions_3_3_Core* gl, unsigned int nVbo, unsigned int& nVboSpare,
+            unsigned int nEbo, unsigned int& nEboSpare, const DefragBudget& budget);
+
+        /**
+         * @brief 碎片化评分：空闲单元占已用范围的比例，0 表示没有空洞
+         */
+        static double fragmentation(size_t nUsedUnits, size_t nFreeUnits)
+        {
+            return nUsedUnits > 0 ? double(nFreeUnits) / double(nUsedUnits) : 0.0;
+        }
+    };
+}
+
+#endif // DEFRAG_PLAN_H
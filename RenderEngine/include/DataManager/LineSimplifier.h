@@ -0,0 +1,81 @@
+#ifndef LINE_SIMPLIFIER_H
+#define LINE_SIMPLIFIER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "DataManager/VertexFormat.h"
+
+namespace GLRhi
+{
+    /**
+     * @brief 折线的简化层描述，存放在块的侧表中
+     * 各层顶点紧跟在原始顶点之后、位于图元的同一槽位内，按容差从细到粗排列
+     */
+    struct PolylineLod
+    {
+        static constexpr int MAX_LEVELS = 4;
+
+        uint32_t vOffset[MAX_LEVELS]{};     // 相对图元 nBaseVertex 的顶点偏移
+        uint32_t vCount[MAX_LEVELS]{};      // 该层的顶点数
+        float vTolerance[MAX_LEVELS]{};     // 该层的简化容差（世界坐标），逐层递增
+        uint8_t nLevels{ 0 };
+
+        size_t levelVerts() const
+        {
+            size_t nVerts = 0;
+            for (int i = 0; i < nLevels; ++i)
+                nVerts += vCount[i];
+            return nVerts;
+        }
+    };
+
+    /**
+     * @brief 一条折线的简化结果
+     */
+    struct SimplifiedLine
+    {
+        PolylineLod lod;
+        std::vector<float> vXyz;            // 各层顶点依次拼接，格式为[x1,y1,z1,...]
+
+        size_t levelVerts() const { return vXyz.size() / 3; }
+    };
+
+    /**
+     * @brief 折线多分辨率简化（Douglas–Peucker）
+     *
+     * 一次自顶向下的 Douglas–Peucker 为每个顶点求出重要度：该顶点被选为分割点时到弦的距离，
+     * 并以父分割点的重要度为上限。保留重要度大于容差的顶点，就等于用该容差单独跑一遍 Douglas–Peucker，
+     * 因此各层互相嵌套，一次计算即可按任意容差生成多层。
+     *
+     * 层的容差取折线包围盒长边的 1/1024、1/256、1/64、1/16，与世界坐标下的像素尺寸比较选层；
+     * 顶点数比上一层少不到 1/4 的层不单独存放。
+     * 最远点搜索在拆开的 x / y 数组上进行，支持 SSE2 时每次比较 4 个顶点。
+     * 只用线程局部的临时数组，可在线程池上并行调用。
+     */
+    class LineSimplifier
+    {
+    public:
+        static constexpr size_t MIN_VERTS = 32;    // 顶点数少于此值的折线不生成简化层
+
+        /**
+         * @brief 计算每个顶点的重要度，首尾顶点为无穷大
+         * @param pImportance 输出，长度为 nVerts
+         */
+        static void importance(const float* pXyz, size_t nVerts, float* pImportance);
+
+        /**
+         * @brief 生成简化层
+         * @param bounds 折线包围盒，用于确定各层容差
+         * @return false 表示折线太短或简化后顶点数没有明显减少，out 为空
+         */
+        static bool simplify(const float* pXyz, size_t nVerts, const QuantBox& bounds, SimplifiedLine& out);
+
+        /**
+         * @brief 按容差选层：返回容差不超过 fMaxTolerance 的最粗一层，没有时返回 -1（使用原始顶点）
+         */
+        static int selectLevel(const PolylineLod& lod, float fMaxTolerance);
+    };
+}
+
+#endif // LINE_SIMPLIFIER_H
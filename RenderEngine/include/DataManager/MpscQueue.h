@@ -0,0 +1,98 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace GLRhi
+{
+    /**
+     * @brief 无锁多生产者单消费者队列
+     *
+     * 链表实现（Vyukov MPSC）：
+     * - push() 可在任意线程调用，只有一次原子交换，不会阻塞
+     * - tryPop() 只能由一个线程调用（渲染线程）
+     * - 头部始终保留一个哨兵节点，出队的节点成为新的哨兵
+     *
+     * 生产者完成交换但尚未链接 next 的瞬间，消费者会看到队列为空，
+     * 该元素在下一次 tryPop() 时取出，不会丢失。
+     *
+     * @tparam T 元素类型，需要可默认构造、可移动
+     */
+    template <typename T>
+    class MpscQueue final
+    {
+    public:
+        MpscQueue()
+        {
+            Node* stub = new Node();
+            m_head.store(stub, std::memory_order_relaxed);
+            m_tail = stub;
+        }
+
+        ~MpscQueue()
+        {
+            T value;
+            while (tryPop(value))
+            {
+            }
+            delete m_tail;
+        }
+
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+    public:
+        /**
+         * @brief 入队，线程安全
+         */
+        void push(T&& value)
+        {
+            Node* node = new Node();
+            node->value = std::move(value);
+
+            // 先计数再发布，消费者取出时计数不会小于 0
+            m_nSize.fetch_add(1, std::memory_order_relaxed);
+            Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        /**
+         * @brief 出队，只能由消费者线程调用
+         * @param out 取出的元素
+         * @return false 队列为空
+         */
+        bool tryPop(T& out)
+        {
+            Node* tail = m_tail;
+            Node* next = tail->next.load(std::memory_order_acquire);
+            if (!next)
+                return false;
+
+            out = std::move(next->value);
+            m_tail = next;
+            delete tail;
+            m_nSize.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        /**
+         * @brief 近似的元素数量，仅用于统计
+         */
+        size_t sizeApprox() const { return m_nSize.load(std::memory_order_relaxed); }
+
+    private:
+        struct Node
+        {
+            std::atomic<Node*> next{ nullptr };
+            T value;
+        };
+
+        std::atomic<Node*> m_head{ nullptr };  // 生产者端，最新入队的节点
+        Node* m_tail{ nullptr };               // 消费者端，哨兵节点
+        std::atomic<size_t> m_nSize{ 0 };
+    };
+}
+
+#endif // MPSC_QUEUE_H
@@ -4,15 +4,43 @@
 #include "Common/DllSet.h"
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <shared_mutex>
 #include <atomic>
 #include <thread>
 #include <map>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include "Render/RenderCommon.h"
+#include "DataManager/VboStats.h"
+#include "DataManager/VboCompactor.h"
+#include "DataManager/RangeAllocator.h"
+#include "DataManager/StagingRing.h"
+#include "DataManager/VertexFormat.h"
+#include "DataManager/MpscQueue.h"
+#include "DataManager/DefragPlan.h"
+#include "DataManager/VboPolicy.h"
+#include "DataManager/BoundedByteCache.h"
+#include "DataManager/ShadowArena.h"
+#include "DataManager/ViewCuller.h"
+#include "DataManager/SpatialIndex.h"
+#include "DataManager/TileGrid.h"
+#include "DataManager/LineSimplifier.h"
+#include "Render/GLStateCache.h"
 #include <QOpenGLFunctions_3_3_Core>
 
 namespace GLRhi
 {
+    /**
+     * @brief 折线绘制方式
+     */
+    enum class PolylineDrawMode
+    {
+        Arrays,     // glMultiDrawArrays，按 first/count 直接绘制顶点，不需要 EBO
+        Indexed     // glMultiDrawElementsBaseVertex，使用管理器共享的递增索引缓冲区
+    };
+
     /**
      * @brief 折线图元信息结构体
      *
@@ -22,9 +50,16 @@ namespace GLRhi
     struct PrimitiveInfo
     {
         long long id{ -1 };          // 图元唯一标识符
-        GLsizei   nIndexCount{ 0 };  // 索引数量（2个顶点/线段，n个顶点有n-1个线段）
+        GLsizei   nIndexCount{ 0 };  // 绘制的顶点数量（n个顶点有n-1个线段），为0表示已删除
         GLint     nBaseVertex{ 0 };  // 基础顶点偏移量，用于索引复用
+        size_t    nVertexSlot{ 0 };  // 在VBO中占用的顶点数（含简化层，原地更新的上限，删除时整体归还）
+        uint32_t  nDrawSlot{ NO_DRAW_SLOT }; // 在块的绘制命令数组中的位置，不绘制时为 NO_DRAW_SLOT
         bool      bValid{ true };    // 图元有效性标志（false表示已删除）
+        QuantBox  bounds;            // 世界坐标包围盒，添加和更新时计算，用于视口裁剪
+        uint32_t  nLod{ NO_LOD };    // 简化层在块 vLods 中的下标，没有简化层时为 NO_LOD
+
+        static constexpr uint32_t NO_DRAW_SLOT = 0xFFFFFFFFu;
+        static constexpr uint32_t NO_LOD = 0xFFFFFFFFu;
     };
 
     /**
@@ -37,24 +72,91 @@ namespace GLRhi
     {
         unsigned int vao{ 0 };          // 顶点数组对象
         unsigned int vbo{ 0 };          // 顶点缓冲区对象
-        unsigned int ebo{ 0 };          // 索引缓冲区对象
+        unsigned int vboSpare{ 0 };     // 压缩时使用的备用顶点缓冲区（与 vbo 乒乓交换）
         Color color;                    // 该块所有折线的统一颜色
 
+        VertexFormat format{ VertexFormat::Float3 }; // 顶点存储格式，创建块时确定
+        QuantBox quantBox;              // Half2 / Int16Quant 的块包围盒，块内所有折线必须落在其中
+        bool bVertexColor{ false };     // 共享块：颜色作为 RGBA8 顶点属性存放，color 字段不使用
+
         size_t nVertexCapacity{ 0 };    // 顶点容量上限
-        size_t nIndexCapacity{ 0 };     // 索引容量上限
         size_t nVertexCount{ 0 };       // 当前实际使用的顶点数
-        size_t nIndexCount{ 0 };        // 当前实际使用的索引数
 
-        std::vector<GLsizei> vDrawCounts;       // 每个图元的索引数量数组，用于批量绘制
-        std::vector<GLint>   vBaseVertices;     // 每个图元的基础顶点偏移数组
+        std::vector<GLsizei> vDrawCounts;       // 每个图元的顶点数量数组，用于批量绘制
+        std::vector<GLint>   vBaseVertices;     // 每个图元的基础顶点偏移数组（Arrays 模式下作为 first）
+        GLsizei nMaxDrawCount{ 0 };             // vDrawCounts 中的最大值，索引模式下决定共享 EBO 的长度
+        std::vector<const void*> vIndexOffsets; // 索引模式下每个图元的索引偏移（共享递增索引，全部为 0），仅索引模式维护
+        std::vector<uint32_t> vDrawPrims;       // 绘制命令对应的 vPrimitives 下标（PrimitiveInfo::nDrawSlot 的反向索引）
         std::vector<PrimitiveInfo> vPrimitives; // 图元信息数组
 
+        QuantBox bounds;                        // 绘制图元包围盒的并集，只增不减，重建绘制命令时重新计算
+        uint64_t nDrawEpoch{ 0 };               // 绘制命令变化计数，裁剪列表据此判断是否过期
+        CulledDraws culled;                     // 视口裁剪后的绘制命令
+        uint32_t nTile{ TileGrid::NO_TILE };    // 按瓦片分块时图元中心所在瓦片的 Morton 键，创建块时确定
+
         std::unordered_map<long long, size_t> idToIndexMap; // 图元ID到索引的映射，用于快速查找
 
+        RangeAllocator vertAllocator;           // 顶点空洞分配器
+        std::vector<size_t> vFreePrimSlots;     // 已删除图元留下的 vPrimitives 空位，供新图元复用
+
+        std::vector<PolylineLod> vLods;         // 图元的简化层描述，由 PrimitiveInfo::nLod 引用
+        std::vector<uint32_t> vFreeLods;        // vLods 中已释放的位置
+        size_t nLodPrims{ 0 };                  // 带简化层的图元数
+
+        ShadowArena shadow;             // VBO 的CPU端影子副本，创建块时按 VboPolicy::bShadowArena 启用
+
+        uint64_t nSerial{ 0 };          // 块序号，创建时分配且不复用，碎片整理计划用它找回目标块
+        uint64_t nEditEpoch{ 0 };       // 编辑计数，顶点布局或内容变化时递增，用于判断整理计划是否过期
+
+        size_t nCompactCount{ 0 };      // 该块的压缩次数
+        size_t nCompactBytes{ 0 };      // 该块压缩时搬运的字节数
+        bool bFragAlerted{ false };     // 已发出碎片率告警，压缩后复位
+
         bool bDirty{ false };           // 标记绘制命令是否需要重建
         bool bCompact{ false };         // 标记是否需要进行内存碎片整理
     };
 
+    /**
+     * @brief 折线编辑命令
+     *
+     * 工作线程通过 PolylinesVboManager::enqueue*() 提交，渲染线程在帧开始时按提交顺序应用。
+     */
+    struct PolylineCommand
+    {
+        enum class Type
+        {
+            Add,        // 添加折线，ID 已存在时按更新处理
+            Update,     // 更新折线顶点
+            Remove,     // 删除折线
+            SetVisible  // 设置可见性
+        };
+
+        Type type{ Type::Add };
+        long long id{ -1 };
+        std::vector<float> vVerts;  // Add / Update 的顶点数据，格式为[x1,y1,z1,...]
+        Color color;                // Add 的颜色
+        bool bVisible{ true };      // SetVisible 的目标状态
+    };
+
+    /**
+     * @brief 折线批量导入的结构数组视图
+     *
+     * 只引用调用方的数组，不拷贝；ingestPolylines() 返回前数据必须保持有效。
+     * 顶点有两种给法：
+     * - pVerts：第 i 条折线的顶点紧接在第 i-1 条之后，顶点数少于 2 的折线会跳过（但仍占用其顶点）
+     * - pVertPtrs：每条折线各自的顶点指针，非空时忽略 pVerts
+     */
+    struct PolylineBatchView
+    {
+        const long long* pIds{ nullptr };       // 折线ID，nCount 个
+        const size_t* pVertCounts{ nullptr };   // 每条折线的顶点数，nCount 个
+        const float* pVerts{ nullptr };         // 所有折线的顶点依次紧密排列，格式为[x1,y1,z1,...]
+        const float* const* pVertPtrs{ nullptr }; // 每条折线的顶点指针，nCount 个；非空时忽略 pVerts
+        const Color* pColors{ nullptr };        // 每条折线的颜色，nCount 个；为空时全部使用 color
+        Color color;                            // pColors 为空时的统一颜色
+        size_t nCount{ 0 };                     // 折线数量
+    };
+
     //////////////////////////////////////////////////////////////////////////////////////////////
     /**
      * @class PolylinesVboManager
@@ -69,12 +171,20 @@ namespace GLRhi
      * - 自动内存碎片整理，保持长期稳定的内存使用效率
      * - 后台线程进行资源优化，不阻塞渲染线程
      * - 增量数据上传策略，减少GPU通信开销
-     * - 使用VAO/VBO/EBO进行高效渲染，支持OpenGL 3.3+
+     * - 使用VAO/VBO进行高效渲染，支持OpenGL 3.3+
+     * - 默认以 glMultiDrawArrays 绘制，不为折线保存索引；可在运行时切换到索引模式做对比
+     * - 可选紧凑顶点格式（Float2 / Half2 / Int16Quant），按块选择，由着色器中的 uQuantBox 反量化
+     * - 可选共享块模式：不同颜色的折线放进同一批大块，颜色作为顶点属性，绘制次数与颜色数量无关
+     *
+     * 线程模型：
+     * - addPolyline / updatePolyline / removePolyline 等同步接口会调用 GL，只能在渲染线程（上下文当前线程）使用
+     * - 工作线程使用 enqueue*() 把编辑放入无锁队列，不持有管理器的锁，也不会被渲染阻塞
+     * - 渲染线程在每帧开始时取出队列中的全部命令并应用，之后再绘制
      */
     class GLRENDER_API PolylinesVboManager final
     {
     public:
-        PolylinesVboManager();
+        explicit PolylinesVboManager(const VboPolicy& policy = VboPolicy());
         ~PolylinesVboManager();
 
     public:
@@ -101,6 +211,19 @@ namespace GLRhi
          */
         bool addPolylines(const std::vector<PolylineData>& vPolylineDatas);
 
+        /**
+         * @brief 按结构数组视图批量导入折线，不拷贝输入
+         *
+         * - 读锁下多线程统计每种颜色的折线数，前缀和后并行分桶（计数排序，桶内保持输入顺序）
+         * - 写锁下只做元数据提交：按颜色把折线装入块、扩容、登记图元（各块并行）
+         * - 解锁后在线程池上并行编码顶点，最后在本线程（渲染线程）写入暂存区并公开新折线的ID
+         * ID 已存在、批内重复或顶点数少于 2 的折线跳过。
+         *
+         * @param view 输入视图
+         * @return 添加成功的折线数量
+         */
+        size_t ingestPolylines(const PolylineBatchView& view);
+
         /**
          * @brief 删除指定ID的折线
          * 从管理器中移除指定ID的折线，不立即释放内存而是标记为待清理。
@@ -137,17 +260,144 @@ namespace GLRhi
          */
         void clearAllPrimitives();
 
+        /**
+         * @brief 提交编辑命令，可在任意线程调用
+         * 命令进入无锁队列后立即返回，在渲染线程下一次 drainCommands() 时按提交顺序生效。
+         * 同一线程提交的命令保持顺序；不同线程之间的顺序由入队时刻决定。
+         */
+        void enqueueAdd(long long id, std::vector<float> vertices, const Color& color);
+        void enqueueUpdate(long long id, std::vector<float> vertices);
+        void enqueueRemove(long long id);
+        void enqueueVisible(long long id, bool bVisible);
+
+        /**
+         * @brief 应用队列中的全部编辑命令，只能在渲染线程调用
+         * renderVisiblePrimitives*() 开始时会自动调用。
+         * @return 本次取出的命令数量
+         */
+        size_t drainCommands();
+
         /**
          * @brief 渲染所有可见的折线
          * 按颜色分组批量渲染所有可见的折线，是系统的核心渲染方法。
          * 应在OpenGL渲染上下文中调用。
          */
-        void renderVisiblePrimitives(); // glDrawElementsBaseVertex
-        void renderVisiblePrimitivesEx(); // glDrawElementsInstancedBaseVertex
+        void renderVisiblePrimitives(); // glDrawArrays / glDrawElementsBaseVertex
+        void renderVisiblePrimitivesEx(); // glMultiDrawArrays / glMultiDrawElementsBaseVertex
+
+        /**
+         * @brief 设置绘制方式
+         * 两种方式使用同一份顶点数据，可随时切换，下一帧生效。
+         * @param mode 绘制方式
+         */
+        void setDrawMode(PolylineDrawMode mode);
+        PolylineDrawMode getDrawMode() const;
+
+        /**
+         * @brief 设置新建块使用的顶点格式
+         * 已有的块保持原格式；之后新增的折线只进入格式相同的块。
+         * @param format 顶点格式
+         */
+        void setVertexFormat(VertexFormat format);
+        VertexFormat getVertexFormat() const;
+
+        /**
+         * @brief 设置 Half2 / Int16Quant 块包围盒的最小边长（世界坐标）
+         * 边长越大，附近的折线越容易合并到同一块，但量化精度越低。
+         * @param fExtent 最小边长
+         */
+        void setQuantExtent(float fExtent);
+
+        /**
+         * @brief 设置之后新增折线的颜色存储方式
+         * PerVertex 时折线进入共享块，颜色写入顶点属性；已有的折线保持原来的块。
+         * 着色器需要 location 1 的颜色属性和 uUseVertexColor uniform。
+         * @param storage 颜色存储方式
+         */
+        void setColorStorage(ColorStorage storage);
+        ColorStorage getColorStorage() const;
+
+        /**
+         * @brief 设置之后新增折线分配到块的方式
+         * ByTile 时同一颜色（共享块时不分颜色）内再按包围盒中心所在瓦片分块，块的包围盒紧凑，
+         * 视口裁剪能整块跳过；块列表按瓦片的 Morton 键排序，平移时访问的块基本连续。
+         * 已有的折线保持原来的块，更新后中心移到其它瓦片的折线迁移到新瓦片的块。
+         * @param placement 分块方式
+         */
+        void setBlockPlacement(BlockPlacement placement);
+        BlockPlacement getBlockPlacement() const;
+
+        /**
+         * @brief 设置按瓦片分块时的瓦片边长（世界坐标），之后新增的折线生效
+         * 瓦片越小块越多、裁剪越细，但每块装的折线越少，绘制调用越多。
+         * @param fTileSize 瓦片边长，不大于 0 时忽略
+         */
+        void setTileSize(float fTileSize);
+        float getTileSize() const;
+
+        /**
+         * @brief 设置渲染时使用的着色器程序及其 uniform 位置
+         * 设置后渲染不再查询 GL_CURRENT_PROGRAM 和 uniform 位置；未设置时按当前程序查询。
+         * @param prog 已链接程序的 uniform 描述，渲染时该程序必须处于使用状态
+         */
+        void setProgram(const ProgramUniforms& prog);
+
+        /**
+         * @brief 设置共享的 GL 状态缓存，VAO 绑定和 uniform 设置经由缓存去除重复调用
+         * @param cache 状态缓存，为空时直接调用 GL
+         */
+        void setStateCache(GLStateCache* cache);
+
+        /**
+         * @brief 设置共用的上传暂存区，为空时使用管理器自有的暂存区
+         * 切换前先提交已暂存的写入；使用共用暂存区时自有暂存区不占用 GL 资源。共用暂存区只能在渲染线程使用，
+         * 生命周期需长于管理器。
+         * @param pRing 暂存区，由调用方初始化和销毁
+         */
+        void setStagingRing(StagingRing* pRing);
 
         /**
-         * @brief 启动后台碎片整理线程
-         * 启动一个单独的线程进行内存碎片整理，定期检查并压缩需要整理的块。
+         * @brief 设置可见范围（世界坐标），绘制时只提交包围盒与之相交的折线
+         * 裁剪结果按外扩后的范围缓存，相机在外扩范围内移动时直接复用；传入空范围关闭裁剪
+         */
+        void setViewRect(const QuantBox& viewRect);
+
+        /**
+         * @brief 设置裁剪范围每个方向外扩的比例（相对可见范围的宽高），默认 ViewCuller::DEFAULT_MARGIN
+         */
+        void setCullMargin(float fMargin);
+
+        /**
+         * @brief 设置屏幕尺寸 LOD：包围盒投影后长边不足 fMinPixels 像素的折线跳过（Skip），
+         * 或按阈值大小的格子合并，每格只画一个折线的第一段线段（Coverage）。
+         * 只在设置了可见范围时生效，阈值随 setPixelSize() 换算成世界长度
+         */
+        void setLod(ViewCuller::LodMode mode, float fMinPixels = 1.0f);
+        ViewCuller::LodMode getLodMode() const;
+
+        /**
+         * @brief 设置一个像素对应的世界长度，由相机缩放换算，每帧与 setViewRect() 一起调用
+         */
+        void setPixelSize(float fWorldPerPixel);
+
+        /**
+         * @brief 设置多分辨率简化：开启后之后新增或更新的折线（不少于 LineSimplifier::MIN_VERTS 个顶点）
+         * 额外生成最多 4 层 Douglas–Peucker 简化顶点，紧跟原始顶点存放；绘制时按像素尺寸选择
+         * 容差不超过 fPixelTolerance 个像素的最粗一层。只在设置了可见范围时生效，关闭后全部按原始顶点绘制
+         */
+        void setSimplification(bool bEnable, float fPixelTolerance = 0.5f);
+        bool getSimplification() const;
+
+        /**
+         * @brief 获取最近一帧的视口裁剪统计
+         */
+        VboCullStats getCullStats() const;
+
+        /**
+         * @brief 启动后台碎片整理
+         * 后台线程只做CPU端规划（碎片评分、选择目标块、生成重定位表），不调用GL；
+         * 渲染线程每帧在预算内执行拷贝，完成后交换缓冲区。
+         * 启动后绘制时不再同步压缩块，避免整块压缩造成的掉帧。
          */
         void startBackgroundDefrag();
 
@@ -156,49 +406,392 @@ namespace GLRhi
          */
         void stopBackgroundDefrag();
 
+        /**
+         * @brief 设置分帧碎片整理的每帧预算
+         */
+        void setDefragBudget(const DefragBudget& budget);
+
+        /**
+         * @brief 获取扩容统计信息
+         */
+        VboGrowStats getGrowStats() const;
+        void resetGrowStats();
+
+        /**
+         * @brief 获取压缩统计信息
+         */
+        VboCompactStats getCompactStats() const;
+
+        /**
+         * @brief 设置内存与碎片整理策略
+         * 容量类参数对之后新建或扩容的块生效，阈值类参数立即生效。
+         */
+        void setPolicy(const VboPolicy& policy);
+        VboPolicy getPolicy() const;
+
+        /**
+         * @brief 获取每个块的实时状态（容量、存活/空洞顶点、空洞数、最大空洞、压缩次数和搬运量）
+         */
+        std::vector<VboBlockTelemetry> getBlockTelemetry() const;
+
+        /**
+         * @brief 碎片率告警回调
+         * 块的碎片率首次超过 VboPolicy::fFragAlertThreshold 时调用一次，压缩后复位。
+         * 告警在写锁内记录，由渲染线程在下一次绘制结束、释放锁之后调用，回调内可以调用管理器的接口。
+         */
+        using FragmentationAlert = std::function<void(const VboBlockTelemetry&)>;
+
+        /**
+         * @brief 设置碎片率告警回调，为空时输出 qWarning
+         */
+        void setFragmentationAlert(FragmentationAlert callback);
+
+        /**
+         * @brief 获取上传暂存区统计信息，使用共用暂存区时为所有使用者的合计
+         */
+        StagingStats getStagingStats() const;
+
+        /**
+         * @brief 获取编辑命令队列统计信息
+         */
+        VboQueueStats getQueueStats() const;
+
+        /**
+         * @brief 读取折线的顶点数据，格式为[x1,y1,z1,...]
+         * 块有影子副本时从影子副本解码；否则先查缓存，未命中时从GPU回读（需要在渲染线程调用）。
+         * 二维 / 量化格式的块解码后会丢失 z 或带有量化误差。
+         * @return false 折线不存在
+         */
+        bool getPolyline(long long id, std::vector<float>& vVerts);
+
+        /**
+         * @brief 查询包围盒与 rect（世界坐标）相交的折线，包含隐藏的折线
+         * @param vIds 结果追加到末尾
+         * @return 本次找到的数量
+         */
+        size_t queryPolylines(const QuantBox& rect, std::vector<long long>& vIds) const;
+
+        /**
+         * @brief 拾取距离点 (x, y) 最近的可见折线（按线段距离）
+         * 候选折线的顶点按 getPolyline() 的方式读取，需要在渲染线程调用。
+         * @param fMaxDist 最大拾取距离（世界坐标）
+         * @param pDist 可选，返回实际距离
+         * @return false 表示范围内没有折线
+         */
+        bool pickPolyline(float x, float y, float fMaxDist, long long& id, float* pDist = nullptr);
+
+        /**
+         * @brief 获取顶点缓存统计信息（命中、未命中、淘汰、GPU回读）
+         */
+        VboCacheStats getCacheStats() const;
+
     private:
+        /**
+         * @brief 批量导入时一条折线的位置
+         */
+        struct IngestLine
+        {
+            size_t nLine{ 0 };              // 在 PolylineBatchView 中的下标
+            const float* pXyz{ nullptr };   // 顶点数据
+            QuantBox bounds;                // 包围盒，分桶时计算
+            const SimplifiedLine* pLod{ nullptr }; // 简化层，未生成时为空
+        };
+
+        /**
+         * @brief 绘制时为图元选层，交给 ViewCuller::cull() / assign()
+         */
+        struct LevelPicker
+        {
+            const ColorVBOBlock* block{ nullptr };
+            float fMaxTolerance{ 0.0f };    // 允许的最大容差（世界坐标）
+
+            bool operator()(uint32_t nPrimIdx, GLsizei& nCount, GLint& nBase) const;
+        };
+
+        /**
+         * @brief 批量导入时一条折线占用的顶点数（原始顶点加简化层）
+         */
+        static size_t ingestVerts(const PolylineBatchView& view, const IngestLine& line);
+
+        /**
+         * @brief 批量导入时装入同一块的一段连续折线
+         */
+        struct IngestRun
+        {
+            ColorVBOBlock* block{ nullptr };
+            size_t nBaseVertex{ 0 };        // 在块中的起始顶点
+            size_t nFirst{ 0 };             // 第一条折线在导入顺序中的下标
+            size_t nLines{ 0 };
+            size_t nVerts{ 0 };
+            Color color;                    // 折线颜色（共享块写入顶点属性）
+            std::unique_ptr<unsigned char[]> pEncoded; // 块没有影子副本时的编码结果
+        };
+
+        /**
+         * @brief 从游标 (pLine, nInLine) 开始把 nVerts 个顶点按块的格式编码到 pDst，游标随之前移
+         * 折线在输入中不连续，逐条编码，不经过中间数组。只读块的格式信息，可在工作线程调用。
+         */
+        static void encodeLines(const ColorVBOBlock* block, const PolylineBatchView& view,
+            const IngestLine*& pLine, size_t& nInLine, size_t nVerts, uint32_t nRgba, unsigned char* pDst);
+
         /**
          * @brief 查找或创建指定颜色的VBO块
          *
-         * 首先查找现有可用的同色块，不存在则创建新块。
+         * 优先选择空洞能容纳 nNeedVerts 的同色块，其次是尚有余量的同色块，都不存在则创建新块。
          *
          * @param color 目标颜色
+         * @param nNeedVerts 需要的顶点数，用于匹配空洞
+         * @param bounds 需要容纳的范围
+         * @param nTile 瓦片键，只在该瓦片的块中查找
          * @return 指向ColorVBOBlock的指针，失败返回nullptr
          */
-        ColorVBOBlock* getColorBlock(const Color& color);
+        ColorVBOBlock* getColorBlock(const Color& color, size_t nNeedVerts = 0, const QuantBox& bounds = QuantBox(),
+            uint32_t nTile = TileGrid::NO_TILE);
 
         /**
          * @brief 创建新的颜色VBO块
-         * 分配并初始化新的ColorVBOBlock对象及其OpenGL资源。
+         * 分配并初始化新的ColorVBOBlock对象及其OpenGL资源，顶点格式取当前设置。
          * @param color 块颜色
+         * @param bounds 需要容纳的范围，用于确定 Half2 / Int16Quant 块的包围盒
+         * @param nTile 块所属的瓦片键
          * @return 指向新创建块的指针
          */
-        ColorVBOBlock* createNewColorBlock(const Color& color);
+        ColorVBOBlock* createNewColorBlock(const Color& color, const QuantBox& bounds = QuantBox(),
+            uint32_t nTile = TileGrid::NO_TILE);
+
+        /**
+         * @brief 判断块能否接收新的折线：格式与当前设置一致，且包围盒能容纳 bounds
+         */
+        bool blockAccepts(const ColorVBOBlock* block, const QuantBox& bounds) const;
+
+        /**
+         * @brief 包围盒对应的瓦片键，按颜色分块时返回 TileGrid::NO_TILE
+         */
+        uint32_t tileOf(const QuantBox& bounds) const;
+
+        /**
+         * @brief 开启简化时为折线生成简化层
+         * @return false 表示未开启、折线太短或简化效果不明显
+         */
+        bool simplifyLine(const float* pXyz, size_t nVertCount, const QuantBox& bounds, SimplifiedLine& out) const;
+
+        /**
+         * @brief 为图元登记简化层，优先复用 vLods 中释放的位置
+         */
+        void attachLod(ColorVBOBlock* block, PrimitiveInfo& prim, const PolylineLod& lod);
+
+        /**
+         * @brief 释放图元的简化层记录（顶点随图元槽位一起归还）
+         */
+        void releaseLod(ColorVBOBlock* block, PrimitiveInfo& prim);
+
+        /**
+         * @brief 图元实际存放的顶点数：原始顶点加简化层
+         */
+        static size_t primVerts(const ColorVBOBlock* block, const PrimitiveInfo& prim);
+
+        /**
+         * @brief 块的裁剪覆盖情况；块内有简化层且需要选层时，完全可见的块也走裁剪列表
+         */
+        ViewCuller::Coverage coverageOf(const ColorVBOBlock* block) const;
+
+        /**
+         * @brief 添加单条折线（调用方已持有写锁且已确认ID不存在）
+         */
+        bool addPolylineLocked(long long id, const float* vertices, size_t vertexCount, const Color& color);
+
+        /**
+         * @brief 删除单条折线（调用方已持有写锁）
+         */
+        bool removePolylineLocked(long long id);
+
+        /**
+         * @brief 更新单条折线（调用方已持有写锁）
+         */
+        bool updatePolylineLocked(long long id, const float* vertices, size_t vertexCount);
+
+        /**
+         * @brief 设置单条折线可见性（调用方已持有写锁）
+         */
+        bool setPolylineVisibleLocked(long long id, bool bVisible);
+
+        /**
+         * @brief 取出并应用队列中的全部命令（调用方已持有写锁）
+         */
+        size_t drainCommandsLocked();
+
+        /**
+         * @brief 应用单条命令（调用方已持有写锁）
+         * @return false 命令被忽略（参数无效或ID不存在）
+         */
+        bool applyCommand(PolylineCommand& cmd);
 
         /**
          * @brief 确保VBO块有足够容量
          * 检查并在必要时扩容指定的VBO块。
          * @param block 要检查的块
          * @param needVert 需要的顶点数量
-         * @param needIdx 需要的索引数量
          */
-        void checkBlockCapacity(ColorVBOBlock* block, size_t needVert, size_t needIdx);
+        void checkBlockCapacity(ColorVBOBlock* block, size_t needVert);
+
+        /**
+         * @brief 无损扩容单个缓冲区
+         * 新建更大的缓冲区，用 glCopyBufferSubData 在GPU端拷贝旧内容后替换旧缓冲区。
+         * @param buffer 要扩容的缓冲区，完成后被替换为新缓冲区
+         * @param nUsedBytes 需要保留的旧数据字节数
+         * @param nNewBytes 新缓冲区的字节数
+         */
+        void growBuffer(unsigned int& buffer, size_t nUsedBytes, size_t nNewBytes);
+
+        /**
+         * @brief 配置块的VAO
+         * 将块当前的VBO绑定到VAO并设置顶点属性。
+         * @param block 目标块
+         */
+        void setupBlockVao(ColorVBOBlock* block);
+
+        /**
+         * @brief 在块内分配顶点区段
+         * 优先复用空洞，没有合适的空洞时在末尾追加（必要时扩容）。
+         * @param block 目标块
+         * @param nVertCount 顶点数
+         * @return 区段起始顶点
+         */
+        size_t allocVertices(ColorVBOBlock* block, size_t nVertCount);
+
+        /**
+         * @brief 归还顶点区段
+         * 区段并入空洞表；位于末尾时直接回退高水位线。空洞过多时标记块需要压缩。
+         * @param block 目标块
+         * @param nBaseVertex 区段起始顶点
+         * @param nVertCount 顶点数
+         */
+        void freeVertices(ColorVBOBlock* block, size_t nBaseVertex, size_t nVertCount);
+
+        /**
+         * @brief 在块内分配图元记录位置，优先复用已删除图元的空位
+         */
+        size_t allocPrimSlot(ColorVBOBlock* block);
+
+        /**
+         * @brief 将顶点按块的格式编码后写入暂存区
+         * @param block 目标块
+         * @param nBaseVertex 起始顶点
+         * @param pXyz 顶点数据，格式为[x1,y1,z1,...]
+         * @param nVertCount 顶点数
+         */
+        void uploadVertices(ColorVBOBlock* block, size_t nBaseVertex, const float* pXyz, size_t nVertCount,
+            const Color& color);
+
+        /**
+         * @brief 绘制所有块（调用方已持有锁），先按颜色分组的块，再共享块
+         * @param bMultiDraw true 使用 glMultiDraw*，false 逐图元绘制
+         */
+        void renderBlocks(bool bMultiDraw);
+
+        /**
+         * @brief 绘制单个块，必要时先压缩、重建绘制命令
+         */
+        void drawBlock(ColorVBOBlock* block, GLint uQuantLoc, bool bIndexed, bool bMultiDraw);
+
+        /**
+         * @brief 裁剪范围变化后，用空间索引一次查出可见折线，直接生成各部分可见块的裁剪列表
+         * 之后只有绘制命令变化的块才退回到块内逐个测试
+         */
+        void cullFromIndex();
+
+        /**
+         * @brief 遍历所有块（按颜色分组的块和共享块）
+         */
+        template <typename Fn>
+        void forEachBlock(Fn&& fn)
+        {
+            for (auto& pair : m_colorBlocksMap)
+                for (ColorVBOBlock* block : pair.second)
+                    fn(block);
+            for (ColorVBOBlock* block : m_vSharedBlocks)
+                fn(block);
+        }
+
+        template <typename Fn>
+        void forEachBlock(Fn&& fn) const
+        {
+            for (const auto& pair : m_colorBlocksMap)
+                for (const ColorVBOBlock* block : pair.second)
+                    fn(block);
+            for (const ColorVBOBlock* block : m_vSharedBlocks)
+                fn(block);
+        }
+
+        /**
+         * @brief 块的缓冲区即将删除，丢弃暂存区中写往它们的未提交写入（共用暂存区时不影响其它管理器）
+         */
+        void discardStaged(const ColorVBOBlock* block);
+
+        /**
+         * @brief 生成块的实时状态
+         */
+        VboBlockTelemetry makeTelemetry(const ColorVBOBlock* block) const;
+
+        /**
+         * @brief 块的碎片率首次超过告警阈值时记录告警（调用方已持有写锁）
+         */
+        void checkFragmentation(ColorVBOBlock* block);
+
+        /**
+         * @brief 调用已记录的碎片率告警（渲染线程，不持有写锁）
+         */
+        void dispatchFragAlerts();
 
         /**
          * @brief 增量上传单个图元
-         * 将单个图元的数据上传到GPU，只更新必要的部分。
+         * 将单个图元的数据写入暂存区，渲染前合并提交到GPU。
          * @param block 目标块
          * @param primIdx 图元在块中的索引
+         * @param pXyz 顶点数据，格式为[x1,y1,z1,...]
+         * @param nVertCount 顶点数
+         * @param nFirstVertex 相对图元 nBaseVertex 的写入位置，上传简化层时非 0
          */
-        void uploadSinglePrimitive(ColorVBOBlock* block, size_t primIdx);
+        void uploadSinglePrimitive(ColorVBOBlock* block, size_t primIdx, const float* pXyz, size_t nVertCount,
+            size_t nFirstVertex = 0);
 
         /**
          * @brief 压缩内存块
-         * 移除已删除的图元并重建内存布局，消除空洞。
+         * 移除已删除的图元，存活图元的顶点在GPU端搬运到备用缓冲区后交换，消除空洞。
          * @param block 要压缩的块
          */
         void compactBlock(ColorVBOBlock* block);
 
+        /**
+         * @brief 为块生成压缩计划：存活图元依次紧密排列，只读元数据，不调用GL
+         * @param block 目标块
+         * @param plan 输出的计划
+         */
+        void buildCompactPlan(const ColorVBOBlock* block, DefragPlan& plan) const;
+
+        /**
+         * @brief 按计划的重定位表改写块的图元信息（缓冲区已交换后调用）
+         * 移除已删除图元的记录，更新ID映射，清空空洞表。
+         */
+        void applyCompactPlan(ColorVBOBlock* block, const DefragPlan& plan);
+
+        /**
+         * @brief 选择碎片最严重的块并生成整理计划（后台线程，调用方已持有读锁）
+         * @return 没有需要整理的块时为空
+         */
+        std::unique_ptr<DefragPlan> planDefrag() const;
+
+        /**
+         * @brief 在预算内推进整理计划（渲染线程，调用方已持有写锁）
+         * 接收后台线程提交的计划，校验目标块未被编辑，执行拷贝，完成后交换缓冲区。
+         */
+        void stepDefrag();
+
+        /**
+         * @brief 按序号查找块，块已删除时返回 nullptr
+         */
+        ColorVBOBlock* findBlockBySerial(uint64_t nSerial);
+
         /**
          * @brief 重建绘制命令
          * 根据块中的图元数据重新生成批量绘制命令。
@@ -206,12 +799,42 @@ namespace GLRhi
          */
         void rebuildDrawCmds(ColorVBOBlock* block);
 
-        void touchCache(long long id);
+        /**
+         * @brief 按图元当前状态增量维护块的绘制命令，O(1)
+         * 可见则追加或原地改写；隐藏或删除则把最后一条命令换到它的位置（swap-remove）。
+         * 块已标记重建时不处理，由下一次 rebuildDrawCmds 统一生成。
+         * @param block 目标块
+         * @param nPrimIdx 图元在块中的索引
+         */
+        void syncDrawCmd(ColorVBOBlock* block, size_t nPrimIdx);
+
+        /**
+         * @brief 确保共享的递增索引缓冲区至少有 nCount 个索引（仅索引模式使用）
+         * 所有块共用一份 0,1,2,... 索引，绘制时由 basevertex 定位到各折线。
+         * @param nCount 需要的索引数量
+         */
+        void ensureRampEbo(size_t nCount);
+
+        /**
+         * @brief 将共享索引缓冲区绑定到当前VAO（需在 bindBlock 之后调用）
+         */
+        void bindRampEbo();
+
+        /**
+         * @brief 将折线顶点放入缓存（调用方已持有写锁）
+         * 块有影子副本时不缓存，读取直接从影子副本解码。
+         */
+        void cacheVertices(const ColorVBOBlock* block, long long id, const float* vertices, size_t vertexCount);
+
+        /**
+         * @brief getPolyline() 的实现（调用方已持有写锁）
+         */
+        bool readPolylineLocked(long long id, std::vector<float>& vVerts);
 
         /**
          * @brief 绑定块的OpenGL资源
          *
-         * 激活指定块的VAO、VBO、EBO等资源。
+         * 激活指定块的VAO、VBO等资源。
          *
          * @param block 要绑定的块
          */
@@ -220,16 +843,21 @@ namespace GLRhi
         /**
          * @brief 解绑当前块的OpenGL资源
          *
-         * 安全地解除当前绑定的资源。
+         * 安全地解除当前绑定的资源。有状态缓存时不解绑，帧末统一解绑。
          */
         void unbindBlock();
 
+        // 经由状态缓存设置 uniform，没有缓存时直接调用 GL
+        void setUniform4f(GLint nLoc, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const;
+        void setUniform1i(GLint nLoc, GLint v) const;
+
     private:
         QOpenGLFunctions_3_3_Core* m_gl{ nullptr };
         QOpenGLContext* m_context{ nullptr };
         mutable std::shared_mutex m_mutex;
 
         std::unordered_map<uint32_t, std::vector<ColorVBOBlock*>> m_colorBlocksMap; // 按颜色键分组的VBO块映射
+        std::vector<ColorVBOBlock*> m_vSharedBlocks;    // 共享块（颜色为顶点属性），与颜色数量无关
         /**
          * @brief 位置信息结构体
          * 存储折线在系统中的精确位置，用于快速查找和更新。
@@ -242,16 +870,59 @@ namespace GLRhi
             size_t   nPrimIdx{ 0 };             // 在块中的图元索引
         };
         std::unordered_map<long long, Location> m_IDLocationMap; // ID到位置的快速映射
+        std::unordered_set<long long> m_ingestingIds;            // 批量导入中尚未公开的ID，编码完成后才放进 m_IDLocationMap
 
-        // 顶点缓存（用于增量上传和 compact）
-        std::unordered_map<long long, std::vector<float>> m_vVertexCache; // 原始顶点数据缓存
-        // LRU
-        std::list<long long> m_vertexCacheOrder;
-        static constexpr size_t MAX_CACHE_SIZE = 5000;  // 只缓存最近 5000 条被改过的线
+        // 原始顶点缓存，按 VboPolicy::nCacheBytes 限制容量的 LRU，未命中时从GPU回读
+        BoundedByteCache<long long, std::vector<float>> m_vertexCache;
+        size_t m_nReadbacks{ 0 };                   // 缓存未命中后的GPU回读次数（写锁保护）
+        size_t m_nReadbackBytes{ 0 };               // GPU回读的字节数
 
         // 后台碎片整理相关
         std::thread m_defragThread;                 // 后台碎片整理线程
         std::atomic<bool> m_bStopDefrag{ false };   // 线程停止标志
+        std::atomic<bool> m_bDefragEnabled{ false }; // 分帧整理已启动，绘制时不再同步压缩
+        std::atomic<bool> m_bDefragBusy{ false };   // 有计划尚未执行完，后台线程暂停规划
+        std::mutex m_defragMutex;                   // 保护 m_pPendingPlan
+        std::unique_ptr<DefragPlan> m_pPendingPlan; // 后台线程生成、等待渲染线程接收的计划
+        std::unique_ptr<DefragPlan> m_pActivePlan;  // 渲染线程正在执行的计划（写锁保护）
+        DefragBudget m_defragBudget;                // 每帧预算
+        uint64_t m_nNextBlockSerial{ 1 };           // 下一个块序号
+
+        VboPolicy m_policy;                         // 内存与碎片整理策略
+        std::mutex m_alertMutex;                    // 保护 m_fragAlert 和 m_vFragAlerts
+        FragmentationAlert m_fragAlert;             // 碎片率告警回调
+        std::vector<VboBlockTelemetry> m_vFragAlerts; // 已记录、等待渲染线程调用的告警
+
+        MpscQueue<PolylineCommand> m_commandQueue;  // 工作线程提交的编辑命令，渲染线程帧开始时取出
+        std::atomic<size_t> m_nEnqueued{ 0 };       // 累计入队的命令数
+        VboQueueStats m_queueStats;                 // 队列统计（除 nEnqueued 外由写锁保护）
+
+        VboGrowStats m_growStats;                   // 扩容统计
+        VboCompactStats m_compactStats;             // 压缩统计
+
+        StagingRing m_ownStaging;                   // 自有的上传暂存区，未设置共用暂存区时使用
+        StagingRing* m_pStaging{ &m_ownStaging };   // 当前使用的上传暂存区，编辑在渲染前合并提交
+
+        std::atomic<PolylineDrawMode> m_drawMode{ PolylineDrawMode::Arrays }; // 绘制方式
+        unsigned int m_nRampEbo{ 0 };               // 索引模式下所有块共享的递增索引缓冲区
+        size_t m_nRampCount{ 0 };                   // 共享索引缓冲区中的索引数量
+
+        VertexFormat m_vertexFormat{ VertexFormat::Float3 }; // 新建块的顶点格式
+        float m_fQuantExtent{ 2.0f };               // 量化块包围盒的最小边长
+        ColorStorage m_colorStorage{ ColorStorage::PerBlock }; // 新增折线的颜色存储方式
+        BlockPlacement m_blockPlacement{ BlockPlacement::ByColor }; // 新增折线的分块方式
+        float m_fTileSize{ TileGrid::DEFAULT_TILE_SIZE };   // 按瓦片分块时的瓦片边长
+        bool m_bSimplify{ false };                  // 新增折线是否生成简化层
+        float m_fSimplifyPixels{ 0.5f };            // 选层时允许的最大容差（像素）
+
+        ProgramUniforms m_programUniforms;          // 渲染程序的 uniform 位置，未设置时按当前程序查询
+        GLStateCache* m_stateCache{ nullptr };      // 共享的 GL 状态缓存（由渲染器设置）
+
+        ViewCuller m_culler;                        // 视口裁剪（写锁保护）
+        VboCullStats m_cullStats;                   // 最近一帧的裁剪统计
+
+        SpatialIndex m_spatialIndex;                // 按ID索引的折线包围盒，增删改时同步维护
+        uint64_t m_nIndexCullEpoch{ ~0ull };        // 上次用索引生成裁剪列表时的 ViewCuller::epoch()
     };
 }
 
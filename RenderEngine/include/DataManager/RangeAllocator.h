@@ -0,0 +1,72 @@
+#ifndef RANGE_ALLOCATOR_H
+#define RANGE_ALLOCATOR_H
+
+#include <map>
+#include <set>
+#include <utility>
+#include <cstddef>
+
+namespace GLRhi
+{
+    /**
+     * @brief 区段分配器（空闲链表）
+     *
+     * 管理VBO/EBO块内部被释放的区段（单位为顶点或索引，不是字节）。
+     * 只记录空洞：块末尾的追加由调用方按高水位线处理，分配失败时再追加。
+     *
+     * - 按起点排序的表用于释放时与前后相邻空洞合并
+     * - 按（大小, 起点）排序的表用于最佳适配分配，尽量保留大空洞；删除空洞按键直接定位，O(log n)
+     */
+    class RangeAllocator
+    {
+    public:
+        static constexpr size_t INVALID_OFFSET = static_cast<size_t>(-1);
+
+    public:
+        RangeAllocator() = default;
+        ~RangeAllocator() = default;
+
+    public:
+        /**
+         * @brief 从空洞中分配区段（最佳适配）
+         * @param nSize 需要的单元数
+         * @return 区段起点，没有足够大的空洞时返回 INVALID_OFFSET
+         */
+        size_t allocate(size_t nSize);
+
+        /**
+         * @brief 释放区段，并与相邻空洞合并
+         * @param nOffset 区段起点
+         * @param nSize 区段单元数
+         */
+        void free(size_t nOffset, size_t nSize);
+
+        /**
+         * @brief 回收末尾空洞
+         * 若存在以 nEnd 结尾的空洞，将其移出空闲表并把 nEnd 缩回该空洞的起点。
+         * @param nEnd 当前高水位线，回收后被更新
+         * @return true 回收了末尾空洞
+         */
+        bool trimTail(size_t& nEnd);
+
+        /**
+         * @brief 清空所有空洞（块压缩或清空后调用）
+         */
+        void reset();
+
+        size_t getFreeUnits() const { return m_nFreeUnits; }
+        size_t getHoleCount() const { return m_mapByOffset.size(); }
+        size_t getLargestHole() const;
+
+    private:
+        void insertHole(size_t nOffset, size_t nSize);
+        void eraseHole(std::map<size_t, size_t>::iterator it);
+
+    private:
+        std::map<size_t, size_t> m_mapByOffset;         // 起点 -> 大小
+        std::set<std::pair<size_t, size_t>> m_setBySize; // （大小, 起点），同样大小时按起点排序
+        size_t m_nFreeUnits{ 0 };                       // 空洞总单元数
+    };
+}
+
+#endif // RANGE_ALLOCATOR_H
@@ -0,0 +1,103 @@
+#ifndef SHADOW_ARENA_H
+#define SHADOW_ARENA_H
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstddef>
+#include "DataManager/VboCompactor.h"
+
+namespace GLRhi
+{
+    /**
+     * @brief 缓冲区的CPU端影子副本
+     *
+     * 按字节偏移与块的 VBO / EBO 布局一一对应，保存的是编码后的数据：
+     * - 分块存储：内存由固定大小的块组成，按需追加，扩容不搬运已有数据，也没有逐图元的堆分配
+     * - 块大小是元素（顶点 / 索引）大小的整数倍，单个元素不会跨块，可以直接在块内编码
+     * - 压缩时按与GPU相同的拷贝区段在CPU端 memcpy，读取图元数据不需要 glGetBufferSubData
+     *
+     * 默认构造的副本未启用，init() 之后才会分配内存。不加锁，由管理器的写锁保护。
+     */
+    class ShadowArena
+    {
+    public:
+        static constexpr size_t ELEMS_PER_CHUNK = 32768;   // 每块容纳的元素数
+
+    public:
+        ShadowArena() = default;
+        ~ShadowArena() = default;
+
+        ShadowArena(ShadowArena&&) = default;
+        ShadowArena& operator=(ShadowArena&&) = default;
+
+    public:
+        /**
+         * @brief 启用影子副本
+         * @param nElemBytes 元素大小（顶点步长或索引大小）
+         */
+        void init(size_t nElemBytes);
+
+        bool isEnabled() const { return m_nChunkBytes > 0; }
+
+        /**
+         * @brief 在 [nOffset, nOffset + nBytes) 上逐块调用 fn(pData, nRangeOffset, nSpanBytes)
+         * 不足的块自动分配。nOffset 必须是元素大小的整数倍，每段都包含完整的元素。
+         * nRangeOffset 为该段相对 nOffset 的偏移。
+         */
+        template <typename Fn>
+        void forEachSpan(size_t nOffset, size_t nBytes, Fn&& fn)
+        {
+            ensure(nOffset + nBytes);
+            size_t nDone = 0;
+            while (nDone < nBytes)
+            {
+                size_t nPos = nOffset + nDone;
+                size_t nInChunk = nPos % m_nChunkBytes;
+                size_t nSpan = std::min(nBytes - nDone, m_nChunkBytes - nInChunk);
+                fn(m_vChunks[nPos / m_nChunkBytes].get() + nInChunk, nDone, nSpan);
+                nDone += nSpan;
+            }
+        }
+
+        /**
+         * @brief 确保 [0, nEndBytes) 已分配
+         * 分配不加锁；多个线程并行写入不同区段前，先在单线程中调用一次，之后 forEachSpan 不再分配。
+         */
+        void ensure(size_t nEndBytes);
+
+        /**
+         * @brief 写入数据，不足的块自动分配
+         */
+        void write(size_t nOffset, const void* pSrc, size_t nBytes);
+
+        /**
+         * @brief 读出数据，调用方保证区段已经写入过
+         */
+        void read(size_t nOffset, void* pDst, size_t nBytes) const;
+
+        /**
+         * @brief 按压缩区段重排数据，与 VboCompactor 在GPU端的拷贝一致
+         * 存活数据拷贝到新的块中后替换旧块，区段之外的数据丢弃。
+         * @param moves 拷贝区段（字节）
+         * @param nUsedBytes 压缩后使用的字节数
+         */
+        void compact(const VboCompactor& moves, size_t nUsedBytes);
+
+        /**
+         * @brief 释放全部内存，保持启用状态
+         */
+        void clear();
+
+        /**
+         * @brief 已分配的内存（字节）
+         */
+        size_t memoryBytes() const { return m_vChunks.size() * m_nChunkBytes; }
+
+    private:
+        std::vector<std::unique_ptr<unsigned char[]>> m_vChunks;
+        size_t m_nChunkBytes{ 0 };      // 单块字节数，0 表示未启用
+    };
+}
+
+#endif // SHADOW_ARENA_H
@@ -0,0 +1,188 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace GLRhi
+{
+    /**
+     * @brief 按图元ID索引的槽位表
+     *
+     * 数据紧密存放在 dense 数组中，遍历连续、没有空洞；ID 经稀疏索引映射到槽位，槽位再指向 dense 下标：
+     * - 增、删、改、查都是 O(1)：删除时把 dense 末尾元素搬到空位（swap-remove），只改写被搬动元素的槽位
+     * - 槽位删除后进入空闲表复用，每次复用递增代数（generation）；Handle 记录代数，
+     *   槽位被删除或复用后旧 Handle 自动失效，不会误指到其它图元
+     * - 按ID查找不比较几何数据，几何完全相同的两个图元也能区分
+     *
+     * 不加锁，由调用方保证线程安全。
+     */
+    template <typename T>
+    class SlotMap
+    {
+    public:
+        static constexpr uint32_t INVALID = 0xFFFFFFFFu;
+
+        /**
+         * @brief 槽位句柄，槽位被删除或复用后失效
+         */
+        struct Handle
+        {
+            uint32_t nSlot{ INVALID };
+            uint32_t nGeneration{ 0 };
+
+            bool isNull() const { return nSlot == INVALID; }
+        };
+
+    public:
+        /**
+         * @brief 插入或覆盖
+         * @return 图元的句柄；ID 已存在时覆盖数据，句柄不变
+         */
+        Handle insert(long long id, T value)
+        {
+            auto it = m_idToSlot.find(id);
+            if (it != m_idToSlot.end())
+            {
+                m_vValues[m_vSlots[it->second].nDense] = std::move(value);
+                return { it->second, m_vSlots[it->second].nGeneration };
+            }
+
+            uint32_t nSlot = 0;
+            if (!m_vFreeSlots.empty())
+            {
+                nSlot = m_vFreeSlots.back();
+                m_vFreeSlots.pop_back();
+            }
+            else
+            {
+                nSlot = static_cast<uint32_t>(m_vSlots.size());
+                m_vSlots.emplace_back();
+            }
+
+            Slot& slot = m_vSlots[nSlot];
+            slot.nDense = static_cast<uint32_t>(m_vValues.size());
+            m_vValues.push_back(std::move(value));
+            m_vIds.push_back(id);
+            m_vDenseToSlot.push_back(nSlot);
+            m_idToSlot.emplace(id, nSlot);
+            return { nSlot, slot.nGeneration };
+        }
+
+        /**
+         * @brief 删除，末尾元素搬到空位
+         * @return false 表示 ID 不存在
+         */
+        bool erase(long long id)
+        {
+            auto it = m_idToSlot.find(id);
+            if (it == m_idToSlot.end())
+                return false;
+
+            uint32_t nSlot = it->second;
+            uint32_t nDense = m_vSlots[nSlot].nDense;
+            uint32_t nLast = static_cast<uint32_t>(m_vValues.size() - 1);
+            if (nDense != nLast)
+            {
+                m_vValues[nDense] = std::move(m_vValues[nLast]);
+                m_vIds[nDense] = m_vIds[nLast];
+                m_vDenseToSlot[nDense] = m_vDenseToSlot[nLast];
+                m_vSlots[m_vDenseToSlot[nDense]].nDense = nDense;
+            }
+
+            m_vValues.pop_back();
+            m_vIds.pop_back();
+            m_vDenseToSlot.pop_back();
+
+            m_vSlots[nSlot].nGeneration++;
+            m_vSlots[nSlot].nDense = INVALID;
+            m_vFreeSlots.push_back(nSlot);
+            m_idToSlot.erase(it);
+            return true;
+        }
+
+        T* find(long long id)
+        {
+            auto it = m_idToSlot.find(id);
+            return it == m_idToSlot.end() ? nullptr : &m_vValues[m_vSlots[it->second].nDense];
+        }
+
+        const T* find(long long id) const
+        {
+            auto it = m_idToSlot.find(id);
+            return it == m_idToSlot.end() ? nullptr : &m_vValues[m_vSlots[it->second].nDense];
+        }
+
+        /**
+         * @brief 按句柄访问，句柄已失效时返回 nullptr
+         */
+        T* get(Handle handle)
+        {
+            if (handle.nSlot >= m_vSlots.size() || m_vSlots[handle.nSlot].nGeneration != handle.nGeneration)
+                return nullptr;
+            return &m_vValues[m_vSlots[handle.nSlot].nDense];
+        }
+
+        Handle handleOf(long long id) const
+        {
+            auto it = m_idToSlot.find(id);
+            if (it == m_idToSlot.end())
+                return {};
+            return { it->second, m_vSlots[it->second].nGeneration };
+        }
+
+        bool contains(long long id) const { return m_idToSlot.count(id) != 0; }
+
+        void reserve(size_t nCount)
+        {
+            m_vValues.reserve(nCount);
+            m_vIds.reserve(nCount);
+            m_vDenseToSlot.reserve(nCount);
+            m_idToSlot.reserve(nCount);
+        }
+
+        /**
+         * @brief 清空；槽位代数保留，清空前取得的句柄全部失效
+         */
+        void clear()
+        {
+            for (uint32_t nSlot : m_vDenseToSlot)
+            {
+                m_vSlots[nSlot].nGeneration++;
+                m_vSlots[nSlot].nDense = INVALID;
+                m_vFreeSlots.push_back(nSlot);
+            }
+            m_vValues.clear();
+            m_vIds.clear();
+            m_vDenseToSlot.clear();
+            m_idToSlot.clear();
+        }
+
+        size_t size() const { return m_vValues.size(); }
+        bool empty() const { return m_vValues.empty(); }
+
+        // 紧密数组，下标 i 的元素ID为 ids()[i]；插入和删除会改变元素的位置
+        std::vector<T>& values() { return m_vValues; }
+        const std::vector<T>& values() const { return m_vValues; }
+        const std::vector<long long>& ids() const { return m_vIds; }
+
+    private:
+        struct Slot
+        {
+            uint32_t nDense{ INVALID };     // 在 dense 数组中的下标
+            uint32_t nGeneration{ 0 };      // 删除一次加一
+        };
+
+        std::vector<T> m_vValues;                   // dense：数据
+        std::vector<long long> m_vIds;              // dense：对应的ID
+        std::vector<uint32_t> m_vDenseToSlot;       // dense：对应的槽位，swap-remove 时修正槽位
+        std::vector<Slot> m_vSlots;                 // 槽位
+        std::vector<uint32_t> m_vFreeSlots;         // 空闲槽位
+        std::unordered_map<long long, uint32_t> m_idToSlot; // 稀疏索引：ID -> 槽位
+    };
+}
+
+#endif // SLOT_MAP_H
@@ -0,0 +1,205 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include "DataManager/VertexFormat.h"
+
+namespace GLRhi
+{
+    /**
+     * @brief 按图元ID索引包围盒的松散四叉树
+     *
+     * 节点的松散范围是格子向四周各扩半个格子，图元放在中心所在、且边长不小于图元尺寸的最深格子里，
+     * 因此每个图元只属于一个节点，增删改都是 O(深度)：
+     * - 更新时中心仍在原格子且尺寸不超过格子边长，只改包围盒，不移动节点
+     * - 新图元落在根节点外时，根节点向该方向成倍扩大，已有节点不动
+     * - 节点在最后一个图元离开时回收
+     *
+     * 批量插入在线程池上并行计算每个图元的落点路径，再串行挂到节点上。
+     * 不加锁，由管理器的锁保护。
+     */
+    class SpatialIndex
+    {
+    public:
+        static constexpr int MAX_DEPTH = 24;       // 最小格子 = 首个根格子边长 / 2^MAX_DEPTH
+
+        struct Entry
+        {
+            long long id{ 0 };
+            QuantBox bounds;
+        };
+
+        /**
+         * @brief 最近图元查询的精确距离回调，返回点到图元的距离
+         * 返回值不能小于点到图元包围盒的距离
+         */
+        using DistanceFn = std::function<float(long long id)>;
+
+    public:
+        /**
+         * @brief 插入图元，ID已存在时按 update() 处理
+         */
+        void insert(long long id, const QuantBox& bounds);
+
+        /**
+         * @brief 批量插入，落点在线程池上并行计算
+         */
+        void insert(const std::vector<Entry>& vEntries);
+
+        /**
+         * @brief 更新图元包围盒
+         * @return false 表示ID不存在
+         */
+        bool update(long long id, const QuantBox& bounds);
+
+        bool erase(long long id);
+        void clear();
+
+        size_t size() const { return m_idToRecord.size(); }
+        bool empty() const { return m_idToRecord.empty(); }
+        bool contains(long long id) const { return m_idToRecord.count(id) != 0; }
+        size_t getNodeCount() const { return m_vNodes.size() - m_vFreeNodes.size(); }
+
+        /**
+         * @brief 遍历包围盒与 rect 相交的图元，fn(long long id, const QuantBox& bounds)
+         * 节点松散范围整个落在 rect 内时，子树内的图元不再逐个测试
+         */
+        template <typename Fn>
+        void query(const QuantBox& rect, Fn&& fn) const;
+
+        /**
+         * @brief 收集包围盒与 rect 相交的图元ID（追加到 vIds）
+         * @return 本次追加的数量
+         */
+        size_t query(const QuantBox& rect, std::vector<long long>& vIds) const;
+
+        /**
+         * @brief 查找距离点 (x, y) 最近且不超过 fMaxDist 的图元
+         * 按节点和包围盒距离由近到远展开，fnDist 为空时以包围盒距离为准
+         * @return false 表示范围内没有图元
+         */
+        bool nearest(float x, float y, float fMaxDist, const DistanceFn& fnDist,
+            long long& id, float* pDist = nullptr) const;
+
+    private:
+        static constexpr uint32_t NO_NODE = 0xFFFFFFFFu;
+        static constexpr int PATH_LEVELS = 32;      // Path 能记录的层数（64 位，每层 2 位）
+
+        struct Node
+        {
+            float fMinX{ 0.0f };                // 格子左下角
+            float fMinY{ 0.0f };
+            float fSize{ 0.0f };                // 格子边长
+            uint32_t nParent{ NO_NODE };
+            uint32_t vChildren[4]{ NO_NODE, NO_NODE, NO_NODE, NO_NODE };
+            std::vector<uint32_t> vRecords;     // 挂在本节点的图元
+            size_t nSubtree{ 0 };               // 子树内的图元数，为 0 时遍历跳过
+
+            // 松散范围：格子向四周各扩半个格子
+            QuantBox looseBounds() const;
+        };
+
+        struct Record
+        {
+            long long id{ 0 };
+            QuantBox bounds;
+            uint32_t nNode{ NO_NODE };
+            uint32_t nPos{ 0 };                 // 在节点 vRecords 中的位置
+        };
+
+        // 图元在树中的落点：从根节点起 nDepth 层，每层 2 位象限
+        struct Path
+        {
+            uint64_t nBits{ 0 };
+            int nDepth{ 0 };
+        };
+
+    private:
+        uint32_t allocNode(float fMinX, float fMinY, float fSize, uint32_t nParent);
+        uint32_t allocRecord(long long id, const QuantBox& bounds);
+
+        /**
+         * @brief 扩大根节点，使其能容纳 bounds（中心在根格子内，尺寸不超过根边长）
+         */
+        void growRoot(const QuantBox& bounds);
+
+        Path pathOf(const QuantBox& bounds) const;
+        uint32_t nodeAt(const Path& path);
+        void attach(uint32_t nRecord, uint32_t nNode);
+        void detach(uint32_t nRecord);
+
+        // 图元能否留在节点中：中心在格子内且尺寸不超过边长；无效包围盒只能放在根节点
+        bool fits(const Node& node, uint32_t nNode, const QuantBox& bounds) const;
+
+        // 能留在节点中，且放不进更深的子格子（更新时据此决定是否原地修改）
+        bool fitsTightly(const Node& node, uint32_t nNode, const QuantBox& bounds) const;
+
+    private:
+        std::vector<Node> m_vNodes;
+        std::vector<uint32_t> m_vFreeNodes;
+        std::vector<Record> m_vRecords;
+        std::vector<uint32_t> m_vFreeRecords;
+        std::unordered_map<long long, uint32_t> m_idToRecord;
+        uint32_t m_nRoot{ NO_NODE };
+        float m_fMinCell{ 0.0f };               // 最小格子边长，首个图元确定根节点时设定
+    };
+
+    template <typename Fn>
+    void SpatialIndex::query(const QuantBox& rect, Fn&& fn) const
+    {
+        if (m_nRoot == NO_NODE || rect.isEmpty())
+            return;
+
+        std::vector<uint32_t> vStack{ m_nRoot };
+        std::vector<uint32_t> vAll;
+        while (!vStack.empty())
+        {
+            const Node& node = m_vNodes[vStack.back()];
+            uint32_t nNode = vStack.back();
+            vStack.pop_back();
+            if (node.nSubtree == 0)
+                continue;
+
+            QuantBox loose = node.looseBounds();
+            if (nNode != m_nRoot && !rect.intersects(loose))
+                continue;
+
+            if (nNode != m_nRoot && rect.contains(loose))
+            {
+                // 整个子树都在范围内：不再测试包围盒
+                vAll.push_back(nNode);
+                while (!vAll.empty())
+                {
+                    const Node& inner = m_vNodes[vAll.back()];
+                    vAll.pop_back();
+                    for (uint32_t nRecord : inner.vRecords)
+                        fn(m_vRecords[nRecord].id, m_vRecords[nRecord].bounds);
+                    for (uint32_t nChild : inner.vChildren)
+                    {
+                        if (nChild != NO_NODE && m_vNodes[nChild].nSubtree > 0)
+                            vAll.push_back(nChild);
+                    }
+                }
+                continue;
+            }
+
+            for (uint32_t nRecord : node.vRecords)
+            {
+                const Record& rec = m_vRecords[nRecord];
+                if (rect.intersects(rec.bounds))
+                    fn(rec.id, rec.bounds);
+            }
+            for (uint32_t nChild : node.vChildren)
+            {
+                if (nChild != NO_NODE)
+                    vStack.push_back(nChild);
+            }
+        }
+    }
+}
+
+#endif // SPATIAL_INDEX_H
@@ -0,0 +1,152 @@
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <QOpenGLFunctions_3_3_Core>
+
+class QOpenGLContext;
+
+namespace GLRhi
+{
+    /**
+     * @brief 上传暂存环形缓冲区统计
+     */
+    struct StagingStats
+    {
+        size_t nStagedBytes{ 0 };   // 经暂存区上传的字节数
+        size_t nDirectBytes{ 0 };   // 超出暂存区容量、直接 glBufferSubData 上传的字节数
+        size_t nCopyCalls{ 0 };     // 合并后的 glCopyBufferSubData 调用次数
+        size_t nFlushCount{ 0 };    // 提交次数
+        size_t nFenceWaits{ 0 };    // 因环形区回绕而等待栅栏的次数
+    };
+
+    /**
+     * @brief 顶点数据上传用的暂存环形缓冲区
+     *
+     * PolylinesVboManager 和 TriangleVboManager 的上传子系统，RenderManager 持有一个实例供两者共用：
+     * - 编辑时只把数据写入暂存区并记录目标位置，不直接调用 glBufferSubData
+     * - 同一目标缓冲区上首尾相接的写入自动合并，flush() 时用少量 glCopyBufferSubData 拷贝到目标
+     * - 每次 flush() 的区段用栅栏保护，环形区回绕覆盖前等待GPU用完
+     *
+     * 存储方式：
+     * - 支持 ARB_buffer_storage 时使用持久映射（PERSISTENT | COHERENT），数据直接写入映射内存
+     * - 否则退回 GL 3.3 路径：先写入CPU端暂存，flush() 时用
+     *   glMapBufferRange(UNSYNCHRONIZED | INVALIDATE_RANGE) 一次性写入本帧区段
+     *
+     * 注意：目标缓冲区被删除或替换（扩容、压缩、清空）前必须先 flush() 或 discard()。
+     * 不加锁，只能在渲染线程使用；共用时统计为所有使用者的合计。
+     */
+    class StagingRing
+    {
+    public:
+        StagingRing() = default;
+        ~StagingRing() = default;
+
+        StagingRing(const StagingRing&) = delete;
+        StagingRing& operator=(const StagingRing&) = delete;
+
+    public:
+        /**
+         * @brief 初始化暂存区
+         * @param context OpenGL上下文，用于查询 ARB_buffer_storage
+         * @param nCapacity 暂存区字节数
+         * @return true 初始化成功
+         */
+        bool initialize(QOpenGLContext* context, size_t nCapacity = DEFAULT_CAPACITY);
+
+        /**
+         * @brief 释放暂存区及所有未完成的栅栏
+         */
+        void destroy();
+
+        /**
+         * @brief 预留一段暂存空间，由调用方直接写入
+         * 写入内容会在 flush() 时拷贝到 nDstBuffer 的 nDstOffset 处。
+         * @param nDstBuffer 目标缓冲区
+         * @param nDstOffset 目标偏移（字节）
+         * @param nSize 字节数
+         * @return 可写入的指针；超出暂存区容量或未初始化时返回 nullptr
+         */
+        void* reserve(unsigned int nDstBuffer, size_t nDstOffset, size_t nSize);
+
+        /**
+         * @brief 上传一段数据
+         * 数据写入暂存区等待 flush()；超出暂存区容量时先提交已暂存的数据再直接上传。
+         * @param nDstBuffer 目标缓冲区
+         * @param nDstOffset 目标偏移（字节）
+         * @param pData 数据
+         * @param nSize 字节数
+         */
+        void upload(unsigned int nDstBuffer, size_t nDstOffset, const void* pData, size_t nSize);
+
+        /**
+         * @brief 提交暂存的数据
+         * 把本帧暂存的写入拷贝到各目标缓冲区，并插入栅栏保护这段暂存区。
+         */
+        void flush();
+
+        /**
+         * @brief 丢弃尚未提交的写入（目标缓冲区即将整体删除时使用）
+         */
+        void discard();
+
+        /**
+         * @brief 只丢弃写往 nDstBuffer 的未提交写入，共用暂存区时不影响其它使用者
+         */
+        void discard(unsigned int nDstBuffer);
+
+        bool isInitialized() const { return m_nBuffer != 0; }
+        bool isPersistent() const { return m_pMapped != nullptr; }
+        bool hasPending() const { return !m_vPending.empty(); }
+        const StagingStats& getStats() const { return m_stats; }
+        void resetStats() { m_stats = StagingStats{}; }
+
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 8 * 1024 * 1024;
+
+    private:
+        /**
+         * @brief 一次待提交的拷贝
+         */
+        struct PendingCopy
+        {
+            unsigned int nDstBuffer{ 0 };
+            size_t nSrcOffset{ 0 };
+            size_t nDstOffset{ 0 };
+            size_t nSize{ 0 };
+        };
+
+        /**
+         * @brief 已提交、GPU可能仍在读取的暂存区段
+         */
+        struct InFlightRegion
+        {
+            size_t nBegin{ 0 };
+            size_t nEnd{ 0 };
+            GLsync fence{ nullptr };
+        };
+
+        size_t allocate(size_t nSize);
+        void waitForRange(size_t nBegin, size_t nEnd);
+        void retireSignaled();
+        unsigned char* writePointer(size_t nOffset);
+
+    private:
+        QOpenGLFunctions_3_3_Core* m_gl{ nullptr };
+        unsigned int m_nBuffer{ 0 };                // 暂存缓冲区
+        size_t m_nCapacity{ 0 };
+        unsigned char* m_pMapped{ nullptr };        // 持久映射指针（无 ARB_buffer_storage 时为空）
+        std::vector<unsigned char> m_vCpuStaging;   // GL 3.3 路径下的CPU端暂存
+
+        size_t m_nHead{ 0 };                        // 下一次写入位置
+        size_t m_nFrameBegin{ 0 };                  // 本帧（上次 flush 之后）暂存区段的起点
+        std::vector<PendingCopy> m_vPending;        // 待提交的拷贝
+        std::deque<InFlightRegion> m_inFlight;      // 受栅栏保护的区段，按提交顺序排列
+
+        StagingStats m_stats;
+    };
+}
+
+#endif // STAGING_RING_H
@@ -0,0 +1,71 @@
+#ifndef TILE_GRID_H
+#define TILE_GRID_H
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "DataManager/VertexFormat.h"
+
+namespace GLRhi
+{
+    /**
+     * @brief 按瓦片分块时使用的网格
+     *
+     * 世界坐标按 fTileSize 划分为正方形瓦片，图元归属其包围盒中心所在的瓦片。
+     * 瓦片键是两个 16 位格子坐标交错得到的 Morton（Z 序）码：键相邻的瓦片在空间上也大多相邻，
+     * 块按键排序后，平移视口时访问的块在块列表中基本连续。
+     * 格子坐标以原点为中心夹到 [-32768, 32766]，超出范围的图元归入边缘瓦片。
+     */
+    namespace TileGrid
+    {
+        static constexpr uint32_t NO_TILE = 0xFFFFFFFFu;       // 不按瓦片分块
+        static constexpr float DEFAULT_TILE_SIZE = 1024.0f;
+
+        inline uint32_t spreadBits(uint32_t v)
+        {
+            v &= 0x0000FFFFu;
+            v = (v | (v << 8)) & 0x00FF00FFu;
+            v = (v | (v << 4)) & 0x0F0F0F0Fu;
+            v = (v | (v << 2)) & 0x33333333u;
+            v = (v | (v << 1)) & 0x55555555u;
+            return v;
+        }
+
+        inline uint32_t cellOf(float fCoord, float fTileSize)
+        {
+            float fCell = std::floor(fCoord / fTileSize);
+            fCell = std::min(std::max(fCell, -32768.0f), 32766.0f);
+            return static_cast<uint32_t>(static_cast<int32_t>(fCell) + 32768);
+        }
+
+        /**
+         * @brief 包围盒中心所在瓦片的 Morton 键，空包围盒归入原点瓦片
+         */
+        inline uint32_t keyOf(const QuantBox& bounds, float fTileSize)
+        {
+            float fCx = 0.0f;
+            float fCy = 0.0f;
+            if (!bounds.isEmpty())
+            {
+                fCx = 0.5f * (bounds.fMinX + bounds.fMaxX);
+                fCy = 0.5f * (bounds.fMinY + bounds.fMaxY);
+            }
+            return spreadBits(cellOf(fCx, fTileSize)) | (spreadBits(cellOf(fCy, fTileSize)) << 1);
+        }
+
+        /**
+         * @brief 块列表按瓦片键排序的比较器，用于 std::equal_range / std::upper_bound
+         * Block 需要 nTile 成员
+         */
+        struct BlockOrder
+        {
+            template <typename Block>
+            bool operator()(const Block* block, uint32_t nTile) const { return block->nTile < nTile; }
+
+            template <typename Block>
+            bool operator()(uint32_t nTile, const Block* block) const { return nTile < block->nTile; }
+        };
+    }
+}
+
+#endif // TILE_GRID_H
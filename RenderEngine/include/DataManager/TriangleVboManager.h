@@ -4,11 +4,28 @@
 #include "Common/DllSet.h"
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <shared_mutex>
 #include <atomic>
 #include <thread>
 #include <map>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include "Render/RenderCommon.h"
+#include "DataManager/VboStats.h"
+#include "DataManager/VboCompactor.h"
+#include "DataManager/RangeAllocator.h"
+#include "DataManager/StagingRing.h"
+#include "DataManager/VertexFormat.h"
+#include "DataManager/DefragPlan.h"
+#include "DataManager/VboPolicy.h"
+#include "DataManager/BoundedByteCache.h"
+#include "DataManager/ShadowArena.h"
+#include "DataManager/ViewCuller.h"
+#include "DataManager/SpatialIndex.h"
+#include "DataManager/TileGrid.h"
+#include "Render/GLStateCache.h"
 #include <QOpenGLFunctions_3_3_Core>
 
 namespace GLRhi
@@ -23,9 +40,15 @@ namespace GLRhi
     {
         long long id{ -1 };          // 图元唯一标识符（多边形ID）
         GLsizei   nIndexCount{ 0 };  // 索引数量（三角形数量 * 3）
-        GLint     nBaseVertex{ 0 };  // 基础顶点偏移量，用于索引复用
+        GLint     nBaseVertex{ 0 };  // 基础顶点偏移量，EBO中存储相对索引，绘制时由 basevertex 定位
         size_t    nBaseIndex{ 0 };   // 索引在EBO中的起始位置（用于渲染时计算偏移）
+        size_t    nVertexCount{ 0 }; // 在VBO中占用的顶点数（压缩时按此搬运，不依赖CPU缓存）
+        size_t    nIndexSlot{ 0 };   // 在EBO中占用的索引数（原地更新的上限）
+        uint32_t  nDrawSlot{ NO_DRAW_SLOT }; // 在块的绘制命令数组中的位置，不绘制时为 NO_DRAW_SLOT
         bool      bValid{ true };    // 图元有效性标志（false表示已删除）
+        QuantBox  bounds;            // 世界坐标包围盒，添加和更新时计算，用于视口裁剪
+
+        static constexpr uint32_t NO_DRAW_SLOT = 0xFFFFFFFFu;
     };
 
     /**
@@ -39,8 +62,14 @@ namespace GLRhi
         unsigned int vao{ 0 };          // 顶点数组对象
         unsigned int vbo{ 0 };          // 顶点缓冲区对象
         unsigned int ebo{ 0 };          // 索引缓冲区对象
+        unsigned int vboSpare{ 0 };     // 压缩时使用的备用顶点缓冲区（与 vbo 乒乓交换）
+        unsigned int eboSpare{ 0 };     // 压缩时使用的备用索引缓冲区（与 ebo 乒乓交换）
         Color color;                    // 该块所有三角形的统一颜色
 
+        VertexFormat format{ VertexFormat::Float3 }; // 顶点存储格式，创建块时确定
+        QuantBox quantBox;              // Half2 / Int16Quant 的块包围盒，块内所有多边形必须落在其中
+        bool bVertexColor{ false };     // 共享块：颜色作为 RGBA8 顶点属性存放，color 字段不使用
+
         size_t nVertexCapacity{ 0 };    // 顶点容量上限
         size_t nIndexCapacity{ 0 };     // 索引容量上限
         size_t nVertexCount{ 0 };       // 当前实际使用的顶点数
@@ -48,10 +77,31 @@ namespace GLRhi
 
         std::vector<GLsizei> vDrawCounts;       // 每个图元的索引数量数组，用于批量绘制
         std::vector<GLint>   vBaseVertices;     // 每个图元的基础顶点偏移数组
+        std::vector<const void*> vIndexOffsets; // 每个图元的索引在EBO中的字节偏移数组
+        std::vector<uint32_t> vDrawPrims;       // 绘制命令对应的 vPrimitives 下标（TrianglePrimitiveInfo::nDrawSlot 的反向索引）
         std::vector<TrianglePrimitiveInfo> vPrimitives; // 图元信息数组
 
+        QuantBox bounds;                        // 绘制图元包围盒的并集，只增不减，重建绘制命令时重新计算
+        uint64_t nDrawEpoch{ 0 };               // 绘制命令变化计数，裁剪列表据此判断是否过期
+        CulledDraws culled;                     // 视口裁剪后的绘制命令
+        uint32_t nTile{ TileGrid::NO_TILE };    // 按瓦片分块时图元中心所在瓦片的 Morton 键，创建块时确定
+
         std::unordered_map<long long, size_t> idToIndexMap; // 图元ID到索引的映射，用于快速查找
 
+        RangeAllocator vertAllocator;           // 顶点空洞分配器
+        RangeAllocator idxAllocator;            // 索引空洞分配器
+
+        ShadowArena shadowVbo;          // VBO 的CPU端影子副本，创建块时按 VboPolicy::bShadowArena 启用
+        ShadowArena shadowEbo;          // EBO 的CPU端影子副本（相对索引）
+        std::vector<size_t> vFreePrimSlots;     // 已删除图元留下的 vPrimitives 空位，供新图元复用
+
+        uint64_t nSerial{ 0 };          // 块序号，创建时分配且不复用，碎片整理计划用它找回目标块
+        uint64_t nEditEpoch{ 0 };       // 编辑计数，顶点/索引布局或内容变化时递增，用于判断整理计划是否过期
+
+        size_t nCompactCount{ 0 };      // 该块的压缩次数
+        size_t nCompactBytes{ 0 };      // 该块压缩时搬运的字节数
+        bool bFragAlerted{ false };     // 已发出碎片率告警，压缩后复位
+
         bool bDirty{ false };           // 标记绘制命令是否需要重建
         bool bCompact{ false };         // 标记是否需要进行内存碎片整理
     };
@@ -72,14 +122,24 @@ namespace GLRhi
      * - 增量数据上传策略，减少GPU通信开销
      * - 使用VAO/VBO/EBO进行高效渲染，支持OpenGL 3.3+
      * - 支持多边形三角剖分后的批量三角形管理
+     * - 可选紧凑顶点格式（Float2 / Half2 / Int16Quant），按块选择，由着色器中的 uQuantBox 反量化
+     * - 可选共享块模式：不同颜色的多边形放进同一批大块，颜色作为顶点属性，绘制次数与颜色数量无关
      */
     class GLRENDER_API TriangleVboManager final
     {
     public:
-        TriangleVboManager();
+        explicit TriangleVboManager(const VboPolicy& policy = VboPolicy());
         ~TriangleVboManager();
 
     public:
+        /**
+         * @brief 绑定 OpenGL 上下文并创建上传暂存区
+         * 构造时上下文已是当前上下文则无需调用；由渲染器持有时在渲染器初始化中调用。
+         * @param context OpenGL上下文
+         * @return false 上下文为空或不支持 OpenGL 3.3
+         */
+        bool initialize(QOpenGLContext* context);
+
         /**
          * @brief 添加一个多边形（三角剖分后的三角形）
          * 将一个多边形的三角剖分结果添加到管理器中，自动按颜色分组存储。
@@ -98,6 +158,7 @@ namespace GLRhi
         /**
          * @brief 批量添加多个多边形（三角剖分后的三角形）
          * 一次性添加多个多边形，比单个添加更高效。
+         * 分组、顶点编码和索引打包在线程池上并行，写锁只覆盖元数据提交，GL 上传留在本线程。
          * @param vTriangleDatas 三角形数据向量，每个元素为 (id, vertices, vertexCount, indices, indexCount, color)
          * @return 成功添加的多边形数量
          */
@@ -155,8 +216,98 @@ namespace GLRhi
         void renderVisiblePrimitivesEx(); // glMultiDrawElementsBaseVertex
 
         /**
-         * @brief 启动后台碎片整理线程
-         * 启动一个单独的线程进行内存碎片整理，定期检查并压缩需要整理的块。
+         * @brief 设置新建块使用的顶点格式
+         * 已有的块保持原格式；之后新增的多边形只进入格式相同的块。
+         * @param format 顶点格式
+         */
+        void setVertexFormat(VertexFormat format);
+        VertexFormat getVertexFormat() const;
+
+        /**
+         * @brief 设置 Half2 / Int16Quant 块包围盒的最小边长（世界坐标）
+         * @param fExtent 最小边长
+         */
+        void setQuantExtent(float fExtent);
+
+        /**
+         * @brief 设置之后新增多边形的颜色存储方式
+         * PerVertex 时多边形进入共享块，颜色写入顶点属性；已有的多边形保持原来的块。
+         * 着色器需要 location 1 的颜色属性和 uUseVertexColor uniform。
+         * @param storage 颜色存储方式
+         */
+        void setColorStorage(ColorStorage storage);
+        ColorStorage getColorStorage() const;
+
+        /**
+         * @brief 设置之后新增多边形分配到块的方式
+         * ByTile 时同一颜色（共享块时不分颜色）内再按包围盒中心所在瓦片分块，视口裁剪能整块跳过。
+         * 已有的多边形保持原来的块，更新后中心移到其它瓦片的多边形迁移到新瓦片的块。
+         * @param placement 分块方式
+         */
+        void setBlockPlacement(BlockPlacement placement);
+        BlockPlacement getBlockPlacement() const;
+
+        /**
+         * @brief 设置按瓦片分块时的瓦片边长（世界坐标），之后新增的多边形生效
+         * @param fTileSize 瓦片边长，不大于 0 时忽略
+         */
+        void setTileSize(float fTileSize);
+        float getTileSize() const;
+
+        /**
+         * @brief 设置渲染时使用的着色器程序及其 uniform 位置
+         * 设置后渲染不再查询 GL_CURRENT_PROGRAM 和 uniform 位置；未设置时按当前程序查询。
+         * @param prog 已链接程序的 uniform 描述，渲染时该程序必须处于使用状态
+         */
+        void setProgram(const ProgramUniforms& prog);
+
+        /**
+         * @brief 设置共享的 GL 状态缓存，VAO 绑定和 uniform 设置经由缓存去除重复调用
+         * @param cache 状态缓存，为空时直接调用 GL
+         */
+        void setStateCache(GLStateCache* cache);
+
+        /**
+         * @brief 设置共用的上传暂存区，为空时使用管理器自有的暂存区
+         * 切换前先提交已暂存的写入；使用共用暂存区时自有暂存区不占用 GL 资源。共用暂存区只能在渲染线程使用，
+         * 生命周期需长于管理器。
+         * @param pRing 暂存区，由调用方初始化和销毁
+         */
+        void setStagingRing(StagingRing* pRing);
+
+        /**
+         * @brief 设置可见范围（世界坐标），绘制时只提交包围盒与之相交的多边形
+         * 裁剪结果按外扩后的范围缓存，相机在外扩范围内移动时直接复用；传入空范围关闭裁剪
+         */
+        void setViewRect(const QuantBox& viewRect);
+
+        /**
+         * @brief 设置裁剪范围每个方向外扩的比例（相对可见范围的宽高），默认 ViewCuller::DEFAULT_MARGIN
+         */
+        void setCullMargin(float fMargin);
+
+        /**
+         * @brief 设置屏幕尺寸 LOD：包围盒投影后长边不足 fMinPixels 像素的多边形跳过（Skip），
+         * 或按阈值大小的格子合并，每格只画一个多边形的第一个三角形（Coverage）。
+         * 只在设置了可见范围时生效，阈值随 setPixelSize() 换算成世界长度
+         */
+        void setLod(ViewCuller::LodMode mode, float fMinPixels = 1.0f);
+        ViewCuller::LodMode getLodMode() const;
+
+        /**
+         * @brief 设置一个像素对应的世界长度，由相机缩放换算，每帧与 setViewRect() 一起调用
+         */
+        void setPixelSize(float fWorldPerPixel);
+
+        /**
+         * @brief 获取最近一帧的视口裁剪统计
+         */
+        VboCullStats getCullStats() const;
+
+        /**
+         * @brief 启动后台碎片整理
+         * 后台线程只做CPU端规划，不调用GL；渲染线程每帧在预算内搬运顶点和索引，完成后交换缓冲区。
+         * 启动后绘制时不再同步压缩块。
          */
         void startBackgroundDefrag();
 
@@ -165,24 +316,144 @@ namespace GLRhi
          */
         void stopBackgroundDefrag();
 
+        /**
+         * @brief 设置分帧碎片整理的每帧预算
+         */
+        void setDefragBudget(const DefragBudget& budget);
+
+        /**
+         * @brief 获取扩容统计信息
+         */
+        VboGrowStats getGrowStats() const;
+        void resetGrowStats();
+
+        /**
+         * @brief 获取压缩统计信息
+         */
+        VboCompactStats getCompactStats() const;
+
+        /**
+         * @brief 设置内存与碎片整理策略
+         * 容量类参数对之后新建或扩容的块生效，阈值类参数立即生效。
+         */
+        void setPolicy(const VboPolicy& policy);
+        VboPolicy getPolicy() const;
+
+        /**
+         * @brief 获取每个块的实时状态（容量、存活/空洞顶点、空洞数、最大空洞、压缩次数和搬运量）
+         */
+        std::vector<VboBlockTelemetry> getBlockTelemetry() const;
+
+        /**
+         * @brief 碎片率告警回调
+         * 块的碎片率首次超过 VboPolicy::fFragAlertThreshold 时调用一次，压缩后复位。
+         * 告警在写锁内记录，由渲染线程在下一次绘制结束、释放锁之后调用，回调内可以调用管理器的接口。
+         */
+        using FragmentationAlert = std::function<void(const VboBlockTelemetry&)>;
+
+        /**
+         * @brief 设置碎片率告警回调，为空时输出 qWarning
+         */
+        void setFragmentationAlert(FragmentationAlert callback);
+
+        /**
+         * @brief 获取上传暂存区统计信息，使用共用暂存区时为所有使用者的合计
+         */
+        StagingStats getStagingStats() const;
+
+        /**
+         * @brief 读取多边形的顶点（[x1,y1,z1,...]）和相对索引
+         * 块有影子副本时从影子副本解码；否则先查缓存，未命中时从GPU回读（需要在渲染线程调用）。
+         * 二维 / 量化格式的块解码后会丢失 z 或带有量化误差。
+         * @return false 多边形不存在
+         */
+        bool getTriangle(long long id, std::vector<float>& vVerts, std::vector<unsigned int>& vIndices);
+
+        /**
+         * @brief 查询包围盒与 rect（世界坐标）相交的多边形，包含隐藏的多边形
+         * @param vIds 结果追加到末尾
+         * @return 本次找到的数量
+         */
+        size_t queryTriangles(const QuantBox& rect, std::vector<long long>& vIds) const;
+
+        /**
+         * @brief 拾取距离点 (x, y) 最近的可见多边形，点落在某个三角形内时距离为 0
+         * 候选多边形的数据按 getTriangle() 的方式读取，需要在渲染线程调用。
+         * @param fMaxDist 最大拾取距离（世界坐标）
+         * @param pDist 可选，返回实际距离
+         * @return false 表示范围内没有多边形
+         */
+        bool pickTriangle(float x, float y, float fMaxDist, long long& id, float* pDist = nullptr);
+
+        /**
+         * @brief 获取顶点缓存统计信息（命中、未命中、淘汰、GPU回读）
+         */
+        VboCacheStats getCacheStats() const;
+
     private:
+        /**
+         * @brief 批量添加时装入同一块的一组连续多边形
+         */
+        struct IngestRun
+        {
+            TriangleColorVBOBlock* block{ nullptr };
+            size_t nBaseVertex{ 0 };        // 在块中的起始顶点
+            size_t nBaseIndex{ 0 };         // 在块中的起始索引
+            size_t nFirst{ 0 };             // 第一个多边形在添加顺序中的下标
+            size_t nPrims{ 0 };
+            size_t nVerts{ 0 };
+            size_t nIndices{ 0 };
+            Color color;                    // 多边形颜色（共享块写入顶点属性）
+            std::unique_ptr<unsigned char[]> pEncoded;  // 块没有影子副本时的顶点编码结果
+            std::unique_ptr<unsigned int[]> pIndices;   // 块没有影子副本时打包的相对索引
+        };
+
         /**
          * @brief 查找或创建指定颜色的VBO块
          *
-         * 首先查找现有可用的同色块，不存在则创建新块。
+         * 优先选择空洞能同时容纳所需顶点和索引的同色块，其次是尚有余量的同色块，都不存在则创建新块。
          *
          * @param color 目标颜色
+         * @param nNeedVerts 需要的顶点数，用于匹配空洞
+         * @param nNeedIdx 需要的索引数，用于匹配空洞
+         * @param bounds 需要容纳的范围
+         * @param nTile 瓦片键，只在该瓦片的块中查找
          * @return 指向TriangleColorVBOBlock的指针，失败返回nullptr
          */
-        TriangleColorVBOBlock* getColorBlock(const Color& color);
+        TriangleColorVBOBlock* getColorBlock(const Color& color, size_t nNeedVerts = 0, size_t nNeedIdx = 0,
+            const QuantBox& bounds = QuantBox(), uint32_t nTile = TileGrid::NO_TILE);
 
         /**
          * @brief 创建新的颜色VBO块
-         * 分配并初始化新的TriangleColorVBOBlock对象及其OpenGL资源。
+         * 分配并初始化新的TriangleColorVBOBlock对象及其OpenGL资源，顶点格式取当前设置。
          * @param color 块颜色
+         * @param bounds 需要容纳的范围，用于确定 Half2 / Int16Quant 块的包围盒
+         * @param nTile 块所属的瓦片键
          * @return 指向新创建块的指针
          */
-        TriangleColorVBOBlock* createNewColorBlock(const Color& color);
+        TriangleColorVBOBlock* createNewColorBlock(const Color& color, const QuantBox& bounds = QuantBox(),
+            uint32_t nTile = TileGrid::NO_TILE);
+
+        /**
+         * @brief 判断块能否接收新的多边形：格式与当前设置一致，且包围盒能容纳 bounds
+         */
+        bool blockAccepts(const TriangleColorVBOBlock* block, const QuantBox& bounds) const;
+
+        /**
+         * @brief 包围盒对应的瓦片键，按颜色分块时返回 TileGrid::NO_TILE
+         */
+        uint32_t tileOf(const QuantBox& bounds) const;
+
+        /**
+         * @brief 添加单个多边形（调用方已持有写锁且已确认ID不存在）
+         */
+        bool addTriangleLocked(long long id, const float* vertices, size_t vertexCount,
+            const unsigned int* indices, size_t indexCount, const Color& color);
+
+        /**
+         * @brief 删除单个多边形（调用方已持有写锁）
+         */
+        bool removeTriangleLocked(long long id);
 
         /**
          * @brief 确保VBO块有足够容量
@@ -193,21 +464,170 @@ namespace GLRhi
          */
         void checkBlockCapacity(TriangleColorVBOBlock* block, size_t needVert, size_t needIdx);
 
+        /**
+         * @brief 无损扩容单个缓冲区
+         * 新建更大的缓冲区，用 glCopyBufferSubData 在GPU端拷贝旧内容后替换旧缓冲区。
+         * @param buffer 要扩容的缓冲区，完成后被替换为新缓冲区
+         * @param nUsedBytes 需要保留的旧数据字节数
+         * @param nNewBytes 新缓冲区的字节数
+         */
+        void growBuffer(unsigned int& buffer, size_t nUsedBytes, size_t nNewBytes);
+
+        /**
+         * @brief 配置块的VAO
+         * 将块当前的VBO/EBO绑定到VAO并设置顶点属性。
+         * @param block 目标块
+         */
+        void setupBlockVao(TriangleColorVBOBlock* block);
+
+        /**
+         * @brief 在块内分配顶点区段和索引区段
+         * 优先复用空洞，没有合适的空洞时在末尾追加（必要时扩容）。
+         * @param block 目标块
+         * @param nVertCount 顶点数
+         * @param nIdxCount 索引数
+         * @param nBaseVertex 输出：区段起始顶点
+         * @param nBaseIndex 输出：区段起始索引
+         */
+        void allocRanges(TriangleColorVBOBlock* block, size_t nVertCount, size_t nIdxCount,
+            size_t& nBaseVertex, size_t& nBaseIndex);
+
+        /**
+         * @brief 归还图元占用的顶点区段和索引区段
+         * 区段并入空洞表；位于末尾时直接回退高水位线。空洞过多时标记块需要压缩。
+         * @param block 目标块
+         * @param prim 图元信息
+         */
+        void freeRanges(TriangleColorVBOBlock* block, const TrianglePrimitiveInfo& prim);
+
+        /**
+         * @brief 在块内分配图元记录位置，优先复用已删除图元的空位
+         */
+        size_t allocPrimSlot(TriangleColorVBOBlock* block);
+
+        /**
+         * @brief 将顶点按块的格式编码后写入暂存区
+         * @param block 目标块
+         * @param nBaseVertex 起始顶点
+         * @param pXyz 顶点数据，格式为[x1,y1,z1,...]
+         * @param nVertCount 顶点数
+         */
+        void uploadVertices(TriangleColorVBOBlock* block, size_t nBaseVertex, const float* pXyz, size_t nVertCount,
+            const Color& color);
+
+        /**
+         * @brief 将相对索引写入暂存区，块有影子副本时同时写入影子副本
+         * @param block 目标块
+         * @param nBaseIndex 起始索引
+         * @param pIndices 相对索引
+         * @param nIdxCount 索引数
+         */
+        void uploadIndices(TriangleColorVBOBlock* block, size_t nBaseIndex, const unsigned int* pIndices, size_t nIdxCount);
+
+        /**
+         * @brief 绘制所有块（调用方已持有锁），先按颜色分组的块，再共享块
+         * @param bMultiDraw true 使用 glMultiDrawElementsBaseVertex，false 逐图元绘制
+         */
+        void renderBlocks(bool bMultiDraw);
+
+        /**
+         * @brief 绘制单个块，必要时先压缩、重建绘制命令
+         */
+        void drawBlock(TriangleColorVBOBlock* block, GLint uQuantLoc, bool bMultiDraw);
+
+        /**
+         * @brief 裁剪范围变化后，用空间索引一次查出可见多边形，直接生成各部分可见块的裁剪列表
+         */
+        void cullFromIndex();
+
+        /**
+         * @brief 遍历所有块（按颜色分组的块和共享块）
+         */
+        template <typename Fn>
+        void forEachBlock(Fn&& fn)
+        {
+            for (auto& pair : m_colorBlocksMap)
+                for (TriangleColorVBOBlock* block : pair.second)
+                    fn(block);
+            for (TriangleColorVBOBlock* block : m_vSharedBlocks)
+                fn(block);
+        }
+
+        template <typename Fn>
+        void forEachBlock(Fn&& fn) const
+        {
+            for (const auto& pair : m_colorBlocksMap)
+                for (const TriangleColorVBOBlock* block : pair.second)
+                    fn(block);
+            for (const TriangleColorVBOBlock* block : m_vSharedBlocks)
+                fn(block);
+        }
+
+        /**
+         * @brief 块的缓冲区即将删除，丢弃暂存区中写往它们的未提交写入（共用暂存区时不影响其它管理器）
+         */
+        void discardStaged(const TriangleColorVBOBlock* block);
+
+        /**
+         * @brief 生成块的实时状态
+         */
+        VboBlockTelemetry makeTelemetry(const TriangleColorVBOBlock* block) const;
+
+        /**
+         * @brief 块的碎片率首次超过告警阈值时记录告警（调用方已持有写锁）
+         */
+        void checkFragmentation(TriangleColorVBOBlock* block);
+
+        /**
+         * @brief 调用已记录的碎片率告警（渲染线程，不持有写锁）
+         */
+        void dispatchFragAlerts();
+
         /**
          * @brief 增量上传单个图元
-         * 将单个图元的数据上传到GPU，只更新必要的部分。
+         * 将单个图元的数据写入暂存区，渲染前合并提交到GPU。
          * @param block 目标块
          * @param primIdx 图元在块中的索引
+         * @param vertices 顶点数据，格式为[x1,y1,z1,...]
+         * @param vertexCount 顶点数
+         * @param indices 相对索引
+         * @param indexCount 索引数
          */
-        void uploadSinglePrimitive(TriangleColorVBOBlock* block, size_t primIdx);
+        void uploadSinglePrimitive(TriangleColorVBOBlock* block, size_t primIdx,
+            const float* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
 
         /**
          * @brief 压缩内存块
-         * 移除已删除的图元并重建内存布局，消除空洞。
+         * 移除已删除的图元，存活图元的顶点和索引在GPU端搬运到备用缓冲区后交换，消除空洞。
          * @param block 要压缩的块
          */
         void compactBlock(TriangleColorVBOBlock* block);
 
+        /**
+         * @brief 为块生成压缩计划：存活图元的顶点和索引依次紧密排列，只读元数据，不调用GL
+         */
+        void buildCompactPlan(const TriangleColorVBOBlock* block, DefragPlan& plan) const;
+
+        /**
+         * @brief 按计划的重定位表改写块的图元信息（缓冲区已交换后调用）
+         */
+        void applyCompactPlan(TriangleColorVBOBlock* block, const DefragPlan& plan);
+
+        /**
+         * @brief 选择碎片最严重的块并生成整理计划（后台线程，调用方已持有读锁）
+         */
+        std::unique_ptr<DefragPlan> planDefrag() const;
+
+        /**
+         * @brief 在预算内推进整理计划（渲染线程，调用方已持有写锁）
+         */
+        void stepDefrag();
+
+        /**
+         * @brief 按序号查找块，块已删除时返回 nullptr
+         */
+        TriangleColorVBOBlock* findBlockBySerial(uint64_t nSerial);
+
         /**
          * @brief 重建绘制命令
          * 根据块中的图元数据重新生成批量绘制命令。
@@ -215,7 +635,26 @@ namespace GLRhi
          */
         void rebuildDrawCmds(TriangleColorVBOBlock* block);
 
-        void touchCache(long long id);
+        /**
+         * @brief 按图元当前状态增量维护块的绘制命令，O(1)
+         * 可见则追加或原地改写；隐藏或删除则把最后一条命令换到它的位置（swap-remove）。
+         * 块已标记重建时不处理，由下一次 rebuildDrawCmds 统一生成。
+         * @param block 目标块
+         * @param nPrimIdx 图元在块中的索引
+         */
+        void syncDrawCmd(TriangleColorVBOBlock* block, size_t nPrimIdx);
+
+        /**
+         * @brief 将多边形的顶点和索引放入缓存（调用方已持有写锁）
+         * 块有影子副本时不缓存，读取直接从影子副本解码。
+         */
+        void cacheTriangle(const TriangleColorVBOBlock* block, long long id, const float* vertices, size_t vertexCount,
+            const unsigned int* indices, size_t indexCount);
+
+        /**
+         * @brief getTriangle() 的实现（调用方已持有写锁）
+         */
+        bool readTriangleLocked(long long id, std::vector<float>& vVerts, std::vector<unsigned int>& vIndices);
 
         /**
          * @brief 绑定块的OpenGL资源
@@ -229,15 +668,20 @@ namespace GLRhi
         /**
          * @brief 解绑当前块的OpenGL资源
          *
-         * 安全地解除当前绑定的资源。
+         * 安全地解除当前绑定的资源。有状态缓存时不解绑，帧末统一解绑。
          */
         void unbindBlock() const;
 
+        // 经由状态缓存设置 uniform，没有缓存时直接调用 GL
+        void setUniform4f(GLint nLoc, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const;
+        void setUniform1i(GLint nLoc, GLint v) const;
+
     private:
         QOpenGLFunctions_3_3_Core* m_gl{ nullptr };
         mutable std::shared_mutex m_mutex;
 
         std::unordered_map<uint32_t, std::vector<TriangleColorVBOBlock*>> m_colorBlocksMap; // 按颜色键分组的VBO块映射
+        std::vector<TriangleColorVBOBlock*> m_vSharedBlocks;    // 共享块（颜色为顶点属性），与颜色数量无关
         /**
          * @brief 位置信息结构体
          * 存储多边形在系统中的精确位置，用于快速查找和更新。
@@ -250,21 +694,54 @@ namespace GLRhi
             size_t   nPrimIdx{ 0 };             // 在块中的图元索引
         };
         std::unordered_map<long long, Location> m_IDLocationMap; // ID到位置的快速映射
+        std::unordered_set<long long> m_ingestingIds;            // 批量添加中尚未公开的ID，编码完成后才放进 m_IDLocationMap
 
-        // 顶点和索引缓存（用于增量上传和 compact）
+        // 原始顶点和索引缓存，按 VboPolicy::nCacheBytes 限制容量的 LRU，未命中时从GPU回读
         struct TriangleData
         {
             std::vector<float> vertices;
             std::vector<unsigned int> indices;
         };
-        std::unordered_map<long long, TriangleData> m_vTriangleCache; // 原始顶点和索引数据缓存
-        // LRU
-        std::list<long long> m_triangleCacheOrder;
-        static constexpr size_t MAX_CACHE_SIZE = 5000;  // 只缓存最近 5000 个被改过的多边形
+        BoundedByteCache<long long, TriangleData> m_triangleCache;
+        size_t m_nReadbacks{ 0 };                   // 缓存未命中后的GPU回读次数（写锁保护）
+        size_t m_nReadbackBytes{ 0 };               // GPU回读的字节数
 
         // 后台碎片整理相关
         std::thread m_defragThread;                 // 后台碎片整理线程
         std::atomic<bool> m_bStopDefrag{ false };   // 线程停止标志
+        std::atomic<bool> m_bDefragEnabled{ false }; // 分帧整理已启动，绘制时不再同步压缩
+        std::atomic<bool> m_bDefragBusy{ false };   // 有计划尚未执行完，后台线程暂停规划
+        std::mutex m_defragMutex;                   // 保护 m_pPendingPlan
+        std::unique_ptr<DefragPlan> m_pPendingPlan; // 后台线程生成、等待渲染线程接收的计划
+        std::unique_ptr<DefragPlan> m_pActivePlan;  // 渲染线程正在执行的计划（写锁保护）
+        DefragBudget m_defragBudget;                // 每帧预算
+        uint64_t m_nNextBlockSerial{ 1 };           // 下一个块序号
+
+        VboPolicy m_policy;                         // 内存与碎片整理策略
+        std::mutex m_alertMutex;                    // 保护 m_fragAlert 和 m_vFragAlerts
+        FragmentationAlert m_fragAlert;             // 碎片率告警回调
+        std::vector<VboBlockTelemetry> m_vFragAlerts; // 已记录、等待渲染线程调用的告警
+
+        VboGrowStats m_growStats;                   // 扩容统计
+        VboCompactStats m_compactStats;             // 压缩统计
+
+        StagingRing m_ownStaging;                   // 自有的上传暂存区，未设置共用暂存区时使用
+        StagingRing* m_pStaging{ &m_ownStaging };   // 当前使用的上传暂存区，编辑在渲染前合并提交
+
+        VertexFormat m_vertexFormat{ VertexFormat::Float3 }; // 新建块的顶点格式
+        float m_fQuantExtent{ 2.0f };               // 量化块包围盒的最小边长
+        ColorStorage m_colorStorage{ ColorStorage::PerBlock }; // 新增多边形的颜色存储方式
+        BlockPlacement m_blockPlacement{ BlockPlacement::ByColor }; // 新增多边形的分块方式
+        float m_fTileSize{ TileGrid::DEFAULT_TILE_SIZE };   // 按瓦片分块时的瓦片边长
+
+        ProgramUniforms m_programUniforms;          // 渲染程序的 uniform 位置，未设置时按当前程序查询
+        GLStateCache* m_stateCache{ nullptr };      // 共享的 GL 状态缓存（由渲染器设置）
+
+        ViewCuller m_culler;                        // 视口裁剪（写锁保护）
+        VboCullStats m_cullStats;                   // 最近一帧的裁剪统计
+
+        SpatialIndex m_spatialIndex;                // 按ID索引的多边形包围盒，增删改时同步维护
+        uint64_t m_nIndexCullEpoch{ ~0ull };        // 上次用索引生成裁剪列表时的 ViewCuller::epoch()
     };
 }
 
@@ -0,0 +1,124 @@
+#ifndef VBO_COMPACTOR_H
+#define VBO_COMPACTOR_H
+
+#include <vector>
+#include <cstddef>
+#include <QOpenGLFunctions_3_3_Core>
+
+namespace GLRhi
+{
+    /**
+     * @brief GPU端缓冲区压缩器
+     *
+     * CPU只负责规划存活数据的搬运区段（源偏移 -> 目标偏移），
+     * 实际数据由 glCopyBufferSubData 在GPU端拷贝到备用缓冲区，完成后交换两个缓冲区（乒乓）。
+     * 整个过程没有CPU与GPU之间的数据往返。
+     *
+     * 典型用法：
+     * @code
+     * VboCompactor compactor;
+     * compactor.addRange(nSrc, nDst, nBytes);   // 按图元逐个添加，相邻区段自动合并
+     * compactor.compactBuffer(gl, block->vbo, block->vboSpare, nCapacityBytes);
+     * @endcode
+     */
+    class VboCompactor
+    {
+    public:
+        /**
+         * @brief 单个拷贝区段（字节）
+         */
+        struct CopyRange
+        {
+            size_t nSrcOffset{ 0 };     // 源缓冲区偏移
+            size_t nDstOffset{ 0 };     // 目标缓冲区偏移
+            size_t nSize{ 0 };          // 拷贝字节数
+        };
+
+        /**
+         * @brief 分帧执行时的进度
+         */
+        struct Cursor
+        {
+            size_t nRange{ 0 };         // 当前区段下标
+            size_t nOffset{ 0 };        // 当前区段内已拷贝的字节数
+        };
+
+    public:
+        VboCompactor() = default;
+        ~VboCompactor() = default;
+
+    public:
+        /**
+         * @brief 添加一个拷贝区段
+         * 与上一个区段在源和目标上都首尾相接时合并为一个区段，减少拷贝调用次数。
+         * @param nSrcOffset 源偏移（字节）
+         * @param nDstOffset 目标偏移（字节）
+         * @param nSize 字节数，为0时忽略
+         */
+        void addRange(size_t nSrcOffset, size_t nDstOffset, size_t nSize);
+
+        /**
+         * @brief 清空已规划的区段
+         */
+        void clear();
+
+        bool empty() const { return m_vRanges.empty(); }
+        size_t getRangeCount() const { return m_vRanges.size(); }
+        size_t getTotalBytes() const { return m_nTotalBytes; }
+        const std::vector<CopyRange>& getRanges() const { return m_vRanges; }
+
+        /**
+         * @brief 执行拷贝
+         * 将所有区段从 nSrcBuffer 拷贝到 nDstBuffer，调用方保证目标缓冲区空间足够。
+         * @param gl OpenGL函数表
+         * @param nSrcBuffer 源缓冲区
+         * @param nDstBuffer 目标缓冲区
+         * @return 拷贝的字节数
+         */
+        size_t execute(QOpenGLFunctions_3_3_Core* gl, unsigned int nSrcBuffer, unsigned int nDstBuffer) const;
+
+        /**
+         * @brief 乒乓压缩一个缓冲区
+         * 为备用缓冲区分配 nCapacityBytes 的存储，执行拷贝后交换 nBuffer 与 nSpare，
+         * 并释放旧缓冲区的存储（保留对象名供下次使用），压缩结束后显存只保留一份。
+         * @param gl OpenGL函数表
+         * @param nBuffer 当前缓冲区，完成后为压缩后的缓冲区
+         * @param nSpare 备用缓冲区，为0时自动创建
+         * @param nCapacityBytes 新缓冲区的容量（字节）
+         * @return 拷贝的字节数
+         */
+        size_t compactBuffer(QOpenGLFunctions_3_3_Core* gl,
+            unsigned int& nBuffer, unsigned int& nSpare, size_t nCapacityBytes) const;
+
+        /**
+         * @brief 从 cursor 处继续拷贝，最多 nMaxBytes 字节，区段可以在中间断开
+         * 用于把一次压缩拆到多帧执行，调用方保证两次调用之间源缓冲区的存活数据不变。
+         * @param gl OpenGL函数表
+         * @param nSrcBuffer 源缓冲区
+         * @param nDstBuffer 目标缓冲区
+         * @param cursor 执行进度，完成后推进
+         * @param nMaxBytes 本次最多拷贝的字节数
+         * @return 本次拷贝的字节数
+         */
+        size_t executePartial(QOpenGLFunctions_3_3_Core* gl, unsigned int nSrcBuffer, unsigned int nDstBuffer,
+            Cursor& cursor, size_t nMaxBytes) const;
+
+        bool isFinished(const Cursor& cursor) const { return cursor.nRange >= m_vRanges.size(); }
+
+        /**
+         * @brief 为缓冲区分配 nBytes 的存储（内容未定义），nBuffer 为0时自动创建
+         */
+        static void allocStorage(QOpenGLFunctions_3_3_Core* gl, unsigned int& nBuffer, size_t nBytes);
+
+        /**
+         * @brief 释放缓冲区的存储，只保留对象名
+         */
+        static void releaseStorage(QOpenGLFunctions_3_3_Core* gl, unsigned int nBuffer);
+
+    private:
+        std::vector<CopyRange> m_vRanges;   // 已合并的拷贝区段
+        size_t m_nTotalBytes{ 0 };          // 总拷贝字节数
+    };
+}
+
+#endif // VBO_COMPACTOR_H
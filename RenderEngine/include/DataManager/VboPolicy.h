@@ -0,0 +1,37 @@
+#ifndef VBO_POLICY_H
+#define VBO_POLICY_H
+
+#include <cstddef>
+
+namespace GLRhi
+{
+    /**
+     * @brief VBO管理器的内存与碎片整理策略
+     *
+     * PolylinesVboManager / TriangleVboManager 共用。容量类参数只影响之后新建或扩容的块，
+     * 阈值类参数立即生效。默认值与之前的固定常量相同。
+     */
+    struct VboPolicy
+    {
+        size_t nInitCapacity{ 100'000 };        // 新块的初始顶点容量（三角形块的索引容量相同）
+        size_t nGrowStep{ 200'000 };            // 容量翻倍仍不够时，在需求之上额外预留的数量
+        size_t nMaxVertsPerBlock{ 1'500'000 };  // 按 Float3 计的单块顶点上限，紧凑格式按字节折算可容纳更多
+        float fCompactThreshold{ 0.70f };       // 使用率低于该值时块需要压缩
+        size_t nCacheBytes{ 64u * 1024u * 1024u }; // 顶点缓存（LRU）的容量（字节），未命中时从GPU回读
+        bool bShadowArena{ true };              // 新建块在CPU端保留与VBO布局一致的影子副本，读取图元不再回读GPU
+        int nDefragIntervalMs{ 300 };           // 后台整理线程的规划间隔（毫秒），小于 1 时按 1 毫秒
+        float fFragAlertThreshold{ 0.5f };      // 碎片率（空闲 / 已用范围）超过该值时告警，<= 0 关闭告警
+
+        /**
+         * @brief 单块的字节上限
+         */
+        size_t maxBytesPerBlock() const { return nMaxVertsPerBlock * 3 * sizeof(float); }
+
+        /**
+         * @brief 后台整理线程实际使用的规划间隔，至少 1 毫秒，避免线程空转抢锁
+         */
+        int defragIntervalMs() const { return nDefragIntervalMs > 0 ? nDefragIntervalMs : 1; }
+    };
+}
+
+#endif // VBO_POLICY_H
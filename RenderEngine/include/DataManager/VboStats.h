@@ -0,0 +1,116 @@
+#ifndef VBO_STATS_H
+#define VBO_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GLRhi
+{
+    /**
+     * @brief VBO块扩容统计
+     *
+     * 记录扩容时在GPU端搬运的数据量和CPU端的阻塞耗时，用于评估扩容开销。
+     */
+    struct VboGrowStats
+    {
+        size_t nGrowCount{ 0 };     // 扩容次数
+        size_t nBytesMoved{ 0 };    // 通过 glCopyBufferSubData 搬运的字节数
+        double dStallMs{ 0.0 };     // 扩容操作在CPU端的耗时（毫秒）
+    };
+
+    /**
+     * @brief VBO块压缩统计
+     *
+     * 压缩在GPU端完成，这里只记录搬运量，用于确认压缩没有产生CPU与GPU之间的数据往返。
+     */
+    struct VboCompactStats
+    {
+        size_t nCompactCount{ 0 };  // 压缩次数
+        size_t nCopyCalls{ 0 };     // glCopyBufferSubData 调用次数（合并后的区段数）
+        size_t nBytesMoved{ 0 };    // GPU端搬运的字节数
+
+        // 分帧碎片整理（后台规划，渲染线程按预算执行）
+        size_t nPlanned{ 0 };       // 渲染线程接收的计划数
+        size_t nIncremental{ 0 };   // 分帧完成的压缩次数（同时计入 nCompactCount）
+        size_t nAborted{ 0 };       // 因块被编辑或删除而作废的计划数
+        size_t nStepFrames{ 0 };    // 执行过拷贝的帧数
+        double dMaxStepMs{ 0.0 };   // 单帧拷贝提交的最长耗时（毫秒）
+    };
+
+    /**
+     * @brief 单个VBO块的实时状态
+     *
+     * 顶点数均以顶点为单位；被删除图元留下的空洞计为 dead，隐藏的图元仍计为 live。
+     */
+    struct VboBlockTelemetry
+    {
+        uint64_t nSerial{ 0 };          // 块序号
+        uint32_t nColorKey{ 0 };        // 块颜色（Color::toUInt32()），共享块为 0
+        bool bShared{ false };          // 共享块（颜色为顶点属性）
+        size_t nVertexStride{ 0 };      // 每个顶点的字节数
+
+        size_t nCapacity{ 0 };          // 顶点容量
+        size_t nLiveVerts{ 0 };         // 存活图元占用的顶点数
+        size_t nDeadVerts{ 0 };         // 空洞中的顶点数
+        size_t nHoleCount{ 0 };         // 空洞数量
+        size_t nLargestHole{ 0 };       // 最大空洞的顶点数
+        size_t nPrimCount{ 0 };         // 存活图元数
+        double dFragmentation{ 0.0 };   // 碎片率：nDeadVerts / (nLiveVerts + nDeadVerts)
+
+        size_t nIndexCapacity{ 0 };     // 索引容量（仅三角形块）
+        size_t nLiveIndices{ 0 };       // 存活图元占用的索引数（仅三角形块）
+
+        size_t nCompactCount{ 0 };      // 该块的压缩次数
+        size_t nBytesMoved{ 0 };        // 该块压缩时搬运的字节数
+
+        size_t nShadowBytes{ 0 };       // CPU端影子副本占用的内存（VboPolicy::bShadowArena），未启用时为 0
+    };
+
+    /**
+     * @brief 视口裁剪统计（最近一帧）
+     */
+    struct VboCullStats
+    {
+        size_t nBlocksSkipped{ 0 }; // 整块不可见，未绘制
+        size_t nBlocksFull{ 0 };    // 整块可见，使用完整的绘制命令
+        size_t nBlocksCulled{ 0 };  // 部分可见，使用裁剪后的绘制命令
+        size_t nPrimsTotal{ 0 };    // 可绘制的图元数
+        size_t nPrimsDrawn{ 0 };    // 实际提交的图元数
+        size_t nPrimsLod{ 0 };      // 屏幕尺寸过小被跳过或合并掉的图元数（整块跳过的不计入）
+        size_t nPrimsSimplified{ 0 }; // 改用简化层绘制的图元数
+        size_t nRebuilds{ 0 };      // 累计重建裁剪列表的块次数
+    };
+
+    /**
+     * @brief 顶点缓存统计
+     *
+     * 缓存未命中时需要从GPU回读（glGetBufferSubData）并解码，nReadbacks 用于衡量这部分开销。
+     */
+    struct VboCacheStats
+    {
+        size_t nHits{ 0 };          // 命中次数
+        size_t nMisses{ 0 };        // 未命中次数
+        size_t nEvictions{ 0 };     // 因容量不足淘汰的条目数
+        size_t nEntries{ 0 };       // 当前条目数
+        size_t nBytes{ 0 };         // 当前占用字节数（含节点开销）
+        size_t nCapacityBytes{ 0 }; // 容量（字节）
+        size_t nReadbacks{ 0 };     // 未命中后从GPU回读的次数
+        size_t nReadbackBytes{ 0 }; // 从GPU回读的字节数
+    };
+
+    /**
+     * @brief 编辑命令队列统计
+     *
+     * 工作线程提交的编辑在渲染线程帧开始时统一应用，用于确认队列不会持续积压。
+     */
+    struct VboQueueStats
+    {
+        size_t nEnqueued{ 0 };      // 累计入队的命令数
+        size_t nApplied{ 0 };       // 累计应用成功的命令数
+        size_t nRejected{ 0 };      // 累计被忽略的命令数（参数无效或ID不存在）
+        size_t nLastDrained{ 0 };   // 最近一次取出的命令数
+        double dLastDrainMs{ 0.0 }; // 最近一次应用命令的耗时（毫秒）
+    };
+}
+
+#endif // VBO_STATS_H
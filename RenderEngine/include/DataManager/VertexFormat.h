@@ -0,0 +1,154 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <QOpenGLFunctions_3_3_Core>
+
+namespace GLRhi
+{
+    /**
+     * @brief VBO块的顶点存储格式
+     *
+     * 着色器只使用 xy，z 固定为0或由 uDepth 提供，所以紧凑格式只存两个分量。
+     */
+    enum class VertexFormat
+    {
+        Float3,         // 3 x float，12 字节（原始格式）
+        Float2,         // 2 x float，8 字节，无损
+        Half2,          // 2 x half，4 字节，存储相对块包围盒中心的偏移
+        Int16Quant      // 2 x int16，4 字节，按块包围盒归一化量化
+    };
+
+    /**
+     * @brief 图元颜色的存储方式
+     */
+    enum class ColorStorage
+    {
+        PerBlock,       // 按颜色分块，每块一次 glUniform4f(uColor)
+        PerVertex       // 所有颜色共用少量大块，颜色作为 RGBA8 顶点属性交错存放
+    };
+
+    /**
+     * @brief 图元分配到块的方式
+     */
+    enum class BlockPlacement
+    {
+        ByColor,        // 只按颜色（共享块不区分颜色），按加入顺序装满一块再开下一块
+        ByTile          // 同一颜色内再按包围盒中心所在的瓦片分块，块在空间上紧凑，可整块裁剪
+    };
+
+    /**
+     * @brief 二维轴对齐包围盒，用于块内顶点量化和视口裁剪
+     */
+    struct QuantBox
+    {
+        float fMinX{ 0.0f };
+        float fMinY{ 0.0f };
+        float fMaxX{ -1.0f };
+        float fMaxY{ -1.0f };
+
+        bool isEmpty() const { return fMaxX < fMinX || fMaxY < fMinY; }
+
+        void expand(float x, float y);
+        void expand(const QuantBox& other);
+        bool contains(const QuantBox& other) const;
+        bool intersects(const QuantBox& other) const;
+    };
+
+    /**
+     * @brief 顶点格式编解码
+     *
+     * 负责把缓存中的 [x,y,z] 浮点数据编码成块的存储格式、配置对应的顶点属性，
+     * 以及计算着色器中 uQuantBox 需要的反量化参数：pos.xy = attr.xy * uQuantBox.xy + uQuantBox.zw。
+     *
+     * 共享块在位置之后交错存放 RGBA8 颜色（location 1），每个顶点多 COLOR_BYTES 字节。
+     */
+    class VertexCodec
+    {
+    public:
+        static constexpr size_t COLOR_BYTES = 4;
+
+        /**
+         * @brief 每个顶点占用的字节数
+         * @param format 位置格式
+         * @param bVertexColor 是否交错存放 RGBA8 颜色
+         */
+        static size_t stride(VertexFormat format, bool bVertexColor = false);
+
+        /**
+         * @brief 该格式是否依赖块包围盒（Half2 / Int16Quant）
+         */
+        static bool needsBox(VertexFormat format);
+
+        /**
+         * @brief 计算顶点数据的包围盒，支持 SSE2 时每次处理 4 个顶点
+         * @param pXyz 顶点数据，格式为[x1,y1,z1,x2,y2,z2,...]
+         * @param nVertCount 顶点数
+         */
+        static QuantBox boundsOf(const float* pXyz, size_t nVertCount);
+
+        /**
+         * @brief 为新块生成包围盒
+         * 以 need 的中心为中心，每个方向至少扩展到 fMinExtent，让附近的后续图元也能放进同一个块。
+         * @param need 必须包含的范围
+         * @param fMinExtent 最小边长
+         */
+        static QuantBox makeBlockBox(const QuantBox& need, float fMinExtent);
+
+        /**
+         * @brief 将顶点编码为块的存储格式
+         * @param format 存储格式
+         * @param box 块包围盒（Float2 / Float3 时忽略）
+         * @param pXyz 源顶点数据，格式为[x1,y1,z1,...]
+         * @param nVertCount 顶点数
+         * @param pDst 目标地址，至少 nVertCount * nDstStride 字节
+         * @param nDstStride 目标中相邻顶点的间隔，0 表示紧密排列
+         */
+        static void encode(VertexFormat format, const QuantBox& box,
+            const float* pXyz, size_t nVertCount, void* pDst, size_t nDstStride = 0);
+
+        /**
+         * @brief 将块存储格式的顶点解码回 [x,y,z]，encode 的逆过程
+         * 二维格式解码出的 z 为 0；Half2 / Int16Quant 有量化误差。
+         * @param pSrc 源地址
+         * @param nSrcStride 源中相邻顶点的间隔，0 表示紧密排列
+         * @param pXyz 输出，至少 nVertCount * 3 个 float
+         */
+        static void decode(VertexFormat format, const QuantBox& box,
+            const void* pSrc, size_t nVertCount, float* pXyz, size_t nSrcStride = 0);
+
+        /**
+         * @brief 为交错存放的顶点写入相同的颜色
+         * @param pDst 第一个顶点的颜色地址
+         * @param nDstStride 相邻顶点的间隔
+         * @param nVertCount 顶点数
+         * @param nRgba Color::toUInt32() 的结果，内存中依次为 R,G,B,A
+         */
+        static void writeColor(void* pDst, size_t nDstStride, size_t nVertCount, uint32_t nRgba);
+
+        /**
+         * @brief 为当前绑定的 VAO/VBO 配置顶点属性
+         * location 0 为位置；bVertexColor 时 location 1 为归一化的 RGBA8 颜色。
+         */
+        static void setupAttrib(QOpenGLFunctions_3_3_Core* gl, VertexFormat format, bool bVertexColor = false);
+
+        /**
+         * @brief 计算反量化参数
+         * @param out 输出 (scaleX, scaleY, offsetX, offsetY)
+         */
+        static void dequantParams(VertexFormat format, const QuantBox& box, float out[4]);
+
+        /**
+         * @brief float 转 IEEE 754 半精度
+         */
+        static uint16_t floatToHalf(float f);
+
+        /**
+         * @brief IEEE 754 半精度转 float
+         */
+        static float halfToFloat(uint16_t h);
+    };
+}
+
+#endif // VERTEX_FORMAT_H
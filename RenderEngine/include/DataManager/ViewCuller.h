@@ -0,0 +1,225 @@
+#ifndef VIEW_CULLER_H
+#define VIEW_CULLER_H
+
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+#include <cstdint>
+#include <cstddef>
+#include "DataManager/VertexFormat.h"
+
+namespace GLRhi
+{
+    /**
+     * @brief 块内按视口裁剪后的绘制命令
+     * 与块的绘制命令数组格式相同，可直接交给 glMultiDraw*
+     */
+    struct CulledDraws
+    {
+        std::vector<GLsizei> vDrawCounts;
+        std::vector<GLint> vBaseVertices;
+        std::vector<const void*> vIndexOffsets; // 只在块维护索引偏移时填充
+        size_t nLodDropped{ 0 };                // 因屏幕尺寸过小被跳过或合并掉的图元数
+        size_t nSimplified{ 0 };                // 改用简化层绘制的图元数
+        uint64_t nDrawEpoch{ ~0ull };           // 生成时块的 nDrawEpoch
+        uint64_t nViewEpoch{ ~0ull };           // 生成时 ViewCuller 的 epoch()
+    };
+
+    /**
+     * @brief 视口裁剪
+     *
+     * 裁剪范围是可见范围按 margin 向四周外扩后的矩形，块按它缓存裁剪后的绘制命令：
+     * - 相机在外扩范围内平移、缩小视野不到一半时，裁剪范围不变，缓存的绘制命令继续使用
+     * - 移出外扩范围或放大超过一倍时重新外扩，epoch() 递增，各块在下次绘制时重建
+     * - 块的绘制命令变化（nDrawEpoch 递增）时只重建该块
+     *
+     * 屏幕尺寸 LOD：包围盒投影到屏幕后长边不足 fMinPixels 像素的图元按 LodMode 跳过或合并。
+     * 阈值换算成世界长度后向下取到 2 的整数次幂，缩放在同一档内时不重建裁剪列表。
+     * 开启多分辨率时，像素尺寸同样按 2 的整数次幂分档，生成列表时由调用方按档位为图元选层。
+     *
+     * 不加锁，由管理器的锁保护。
+     */
+    class ViewCuller
+    {
+    public:
+        static constexpr float DEFAULT_MARGIN = 0.25f;  // 每个方向外扩可见范围宽高的比例
+
+        enum class Coverage
+        {
+            Outside,    // 块完全不可见，跳过
+            Inside,     // 块完全在裁剪范围内，使用完整的绘制命令
+            Partial     // 部分可见，使用裁剪后的绘制命令
+        };
+
+        enum class LodMode
+        {
+            Off,        // 不按屏幕尺寸过滤
+            Skip,       // 过小的图元不绘制
+            Coverage    // 过小的图元按阈值大小的格子合并，每格只画一个，且只画前 nCollapsedCount 个顶点
+        };
+
+    public:
+        /**
+         * @brief 设置可见范围（世界坐标），空范围表示关闭裁剪
+         * @return true 表示裁剪范围发生了变化
+         */
+        bool setViewRect(const QuantBox& viewRect);
+
+        void setMargin(float fMargin);
+        float getMargin() const { return m_fMargin; }
+
+        bool isEnabled() const { return !m_cullRect.isEmpty(); }
+        const QuantBox& getCullRect() const { return m_cullRect; }
+        uint64_t epoch() const { return m_nEpoch; }
+
+        /**
+         * @brief 设置屏幕尺寸 LOD 的方式和像素阈值，只在裁剪开启时生效
+         * @param nCollapsedCount Coverage 模式下合并后代表图元绘制的顶点（索引）数
+         * @return true 表示裁剪结果会变化
+         */
+        bool setLod(LodMode mode, float fMinPixels, GLsizei nCollapsedCount);
+        LodMode getLodMode() const { return m_lodMode; }
+
+        /**
+         * @brief 设置一个像素对应的世界长度（由相机缩放换算），每帧调用
+         * @return true 表示 LOD 阈值换档，epoch() 递增
+         */
+        bool setPixelSize(float fWorldPerPixel);
+
+        // 当前 LOD 阈值（世界长度），0 表示不按屏幕尺寸过滤
+        float getLodSize() const { return m_lodMode == LodMode::Off ? 0.0f : m_fLodSize; }
+
+        /**
+         * @brief 开启或关闭多分辨率选层：开启后像素尺寸换档时 epoch() 递增，列表按新的档位重新选层
+         */
+        void setPixelLevels(bool bEnable);
+
+        // 档位化的像素尺寸（世界长度，不大于实际像素尺寸），0 表示不选层
+        float getPixelLevel() const { return m_bPixelLevels ? m_fPixelLevel : 0.0f; }
+
+        /**
+         * @brief 默认的选层回调：始终使用绘制命令中的完整图元
+         * 回调形式为 bool(uint32_t nPrimIdx, GLsizei& nCount, GLint& nBase)，改用其它层时返回 true
+         */
+        struct FullLevel
+        {
+            bool operator()(uint32_t, GLsizei&, GLint&) const { return false; }
+        };
+
+        Coverage classify(const QuantBox& bounds) const;
+
+        /**
+         * @brief 取块裁剪后的绘制命令，过期时按图元包围盒重建
+         * Block 需要 vDrawPrims / vPrimitives[].bounds / vDrawCounts / vBaseVertices / vIndexOffsets /
+         * nDrawEpoch / culled 成员。fnLevel 为保留的图元选择绘制的层。
+         */
+        template <typename Block, typename LevelFn = FullLevel>
+        const CulledDraws& cull(Block& block, const LevelFn& fnLevel = LevelFn())
+        {
+            CulledDraws& out = block.culled;
+            if (out.nDrawEpoch == block.nDrawEpoch && out.nViewEpoch == m_nEpoch)
+                return out;
+
+            beginList(out);
+            const bool bOffsets = block.vIndexOffsets.size() == block.vDrawCounts.size();
+            for (size_t i = 0; i < block.vDrawPrims.size(); ++i)
+            {
+                const QuantBox& bounds = block.vPrimitives[block.vDrawPrims[i]].bounds;
+                if (m_cullRect.intersects(bounds))
+                    append(block, out, i, bounds, bOffsets, fnLevel);
+            }
+
+            out.nDrawEpoch = block.nDrawEpoch;
+            out.nViewEpoch = m_nEpoch;
+            m_nRebuilds++;
+            return out;
+        }
+
+        /**
+         * @brief 用空间索引查出的可见绘制槽位直接生成块的裁剪列表，槽位按升序排列后写入
+         * 槽位必须来自当前的绘制命令数组（块不脏）
+         */
+        template <typename Block, typename LevelFn = FullLevel>
+        void assign(Block& block, std::vector<uint32_t>& vSlots, const LevelFn& fnLevel = LevelFn())
+        {
+            CulledDraws& out = block.culled;
+            std::sort(vSlots.begin(), vSlots.end());
+
+            beginList(out);
+            const bool bOffsets = block.vIndexOffsets.size() == block.vDrawCounts.size();
+            for (uint32_t nSlot : vSlots)
+                append(block, out, nSlot, block.vPrimitives[block.vDrawPrims[nSlot]].bounds, bOffsets, fnLevel);
+
+            out.nDrawEpoch = block.nDrawEpoch;
+            out.nViewEpoch = m_nEpoch;
+            m_nRebuilds++;
+        }
+
+        // 累计重建裁剪列表的块次数
+        size_t getRebuildCount() const { return m_nRebuilds; }
+
+    private:
+        enum class Detail
+        {
+            Keep,       // 正常绘制
+            Drop,       // 过小，不绘制
+            Collapse    // 过小，作为所在格子的代表绘制
+        };
+
+        /**
+         * @brief 按屏幕尺寸判断图元的绘制方式，Coverage 模式下登记所在格子
+         */
+        Detail detailOf(const QuantBox& bounds);
+
+        void beginList(CulledDraws& out);
+
+        template <typename Block, typename LevelFn>
+        void append(const Block& block, CulledDraws& out, size_t nSlot, const QuantBox& bounds, bool bOffsets,
+            const LevelFn& fnLevel)
+        {
+            GLsizei nCount = block.vDrawCounts[nSlot];
+            GLint nBase = block.vBaseVertices[nSlot];
+            switch (detailOf(bounds))
+            {
+            case Detail::Drop:
+                out.nLodDropped++;
+                return;
+            case Detail::Collapse:
+                nCount = std::min(nCount, m_nCollapsedCount);
+                break;
+            case Detail::Keep:
+                if (fnLevel(block.vDrawPrims[nSlot], nCount, nBase))
+                    out.nSimplified++;
+                break;
+            }
+
+            out.vDrawCounts.push_back(nCount);
+            out.vBaseVertices.push_back(nBase);
+            if (bOffsets)
+                out.vIndexOffsets.push_back(block.vIndexOffsets[nSlot]);
+        }
+
+        // 重新计算档位化的 LOD 阈值，换档时递增 epoch
+        bool updateLodSize();
+
+        // 重新计算档位化的像素尺寸，选层开启且换档时递增 epoch
+        bool updatePixelLevel();
+
+    private:
+        QuantBox m_cullRect;                // 外扩后的裁剪范围，空表示不裁剪
+        float m_fMargin{ DEFAULT_MARGIN };
+        uint64_t m_nEpoch{ 0 };
+        size_t m_nRebuilds{ 0 };
+
+        LodMode m_lodMode{ LodMode::Off };
+        float m_fMinPixels{ 1.0f };         // LOD 像素阈值
+        float m_fPixelSize{ 0.0f };         // 一个像素对应的世界长度，0 表示未设置
+        float m_fLodSize{ 0.0f };           // 档位化后的世界长度阈值，0 表示不过滤
+        GLsizei m_nCollapsedCount{ 2 };
+        bool m_bPixelLevels{ false };
+        float m_fPixelLevel{ 0.0f };        // 档位化的像素尺寸
+        std::unordered_set<uint64_t> m_cells;   // Coverage 模式下当前列表已占用的格子
+    };
+}
+
+#endif // VIEW_CULLER_H
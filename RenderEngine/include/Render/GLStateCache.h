@@ -0,0 +1,127 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include "Common/DllSet.h"
+#include <QOpenGLFunctions_3_3_Core>
+#include <unordered_map>
+#include <vector>
+
+namespace GLRhi
+{
+    /**
+     * @brief 着色器程序及其 uniform 位置
+     *
+     * 链接后解析一次，交给顶点管理器使用，渲染时不再调用
+     * glGetIntegerv(GL_CURRENT_PROGRAM) / glGetUniformLocation。
+     * 着色器中不存在的 uniform 位置为 -1。
+     */
+    struct GLRENDER_API ProgramUniforms
+    {
+        GLuint nProgram{ 0 };
+        GLint nColorLoc{ -1 };          // uColor
+        GLint nQuantBoxLoc{ -1 };       // uQuantBox
+        GLint nUseVertexColorLoc{ -1 }; // uUseVertexColor
+
+        bool isValid() const { return nProgram != 0; }
+
+        /**
+         * @brief 查询已链接程序的 uniform 位置
+         */
+        static ProgramUniforms resolve(QOpenGLFunctions_3_3_Core* gl, GLuint nProgram);
+    };
+
+    /**
+     * @brief 每帧的 GL 调用统计
+     */
+    struct GLStateStats
+    {
+        size_t nIssued{ 0 };    // 实际发出的状态调用（glUseProgram / glBindVertexArray / glUniform*）
+        size_t nSkipped{ 0 };   // 因状态未变化而省去的调用，包括省去的 uniform 位置查询
+    };
+
+    /**
+     * @brief GL 状态缓存
+     *
+     * 由 RenderManager 持有，所有渲染器和顶点管理器共用，记录当前程序、VAO
+     * 以及每个程序已设置的 uniform 值，跳过与当前状态相同的调用。
+     *
+     * - 只在渲染线程使用，不加锁
+     * - 绕过缓存修改了这些状态的代码必须调用 invalidate()
+     * - beginFrame() 会清空缓存，帧之间（数据上传、Qt 绘制）对状态的修改不会造成误判
+     */
+    class GLRENDER_API GLStateCache
+    {
+    public:
+        GLStateCache() = default;
+        ~GLStateCache() = default;
+
+    public:
+        void initialize(QOpenGLFunctions_3_3_Core* gl);
+
+        /**
+         * @brief 开始新的一帧：保存上一帧统计并清空缓存
+         */
+        void beginFrame();
+
+        /**
+         * @brief 结束本帧：解绑程序和 VAO，把干净的状态交还给 Qt
+         */
+        void endFrame();
+
+        /**
+         * @brief 忘记所有缓存的状态，下一次调用一定会发出
+         */
+        void invalidate();
+
+        void useProgram(GLuint nProgram);
+        void bindVertexArray(GLuint nVao);
+
+        /**
+         * @brief 记录在缓存之外已经完成的 VAO 绑定（如创建块时配置顶点属性）
+         */
+        void assumeVertexArray(GLuint nVao) { m_nVao = nVao; }
+
+        // 设置当前程序的 uniform，值未变化时跳过
+        void uniform1i(GLint nLoc, GLint v);
+        void uniform1f(GLint nLoc, GLfloat v);
+        void uniform4f(GLint nLoc, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+
+        /**
+         * @brief 记录在缓存之外省去的调用（如预先解析的 uniform 位置）
+         */
+        void addSkipped(size_t nCount) { m_frameStats.nSkipped += nCount; }
+
+        GLuint currentProgram() const { return m_nProgram; }
+
+        // 上一帧 / 当前帧的统计
+        const GLStateStats& getLastFrameStats() const { return m_lastFrameStats; }
+        const GLStateStats& getFrameStats() const { return m_frameStats; }
+
+    private:
+        struct UniformValue
+        {
+            bool bSet{ false };
+            GLfloat v[4]{ 0.0f, 0.0f, 0.0f, 0.0f };
+        };
+
+        /**
+         * @brief 比较并记录 uniform 值
+         * @return true 表示值有变化，需要发出调用
+         */
+        bool updateUniform(GLint nLoc, const GLfloat v[4]);
+
+    private:
+        QOpenGLFunctions_3_3_Core* m_gl{ nullptr };
+
+        static constexpr GLuint UNKNOWN = ~0u;      // 状态未知，下一次一定发出调用
+        GLuint m_nProgram{ UNKNOWN };
+        GLuint m_nVao{ UNKNOWN };
+
+        std::unordered_map<GLuint, std::vector<UniformValue>> m_uniforms; // 程序 -> 按位置索引的 uniform 值
+
+        GLStateStats m_frameStats;
+        GLStateStats m_lastFrameStats;
+    };
+}
+
+#endif // GL_STATE_CACHE_H
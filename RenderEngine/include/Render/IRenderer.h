@@ -5,6 +5,7 @@
 #include <QOpenGLFunctions_3_3_Core>
 #include <QOpenGLShaderProgram>
 #include "Common/Brush.h"
+#include "Render/GLStateCache.h"
 
 namespace GLRhi
 {
@@ -39,6 +40,13 @@ namespace GLRhi
         GLuint createVbo();
         GLuint createEbo();
 
+        // GL 状态缓存（由 RenderManager 在 initialize 之前设置，为空时直接调用 GL）
+        void setStateCache(GLStateCache* cache);
+
+        // 使用 / 释放 m_program，有状态缓存时跳过重复的 glUseProgram
+        void useProgram();
+        void releaseProgram();
+
         // 绑定
         void bindVao(GLuint vao);
         void bindVbo(GLuint vbo);
@@ -68,6 +76,7 @@ namespace GLRhi
         QOpenGLFunctions_3_3_Core* m_gl = nullptr;
         QOpenGLShaderProgram* m_program = nullptr;
         QOpenGLContext* m_context = nullptr;
+        GLStateCache* m_stateCache = nullptr;
 
         int m_nColorLoc = -1;       // 颜色Uniform位置
         int m_nDepthLoc = -1;       // 深度
@@ -25,6 +25,53 @@ namespace GLRhi
         void updateData(const std::vector<PolylineData>& vPolylineDatas);
         void addPolyline(long long id, const float* verts, size_t n, float r, float g, float b);
 
+        // 折线绘制方式：glMultiDrawArrays 或共享索引的 glMultiDrawElementsBaseVertex
+        void setDrawMode(PolylineDrawMode mode);
+        PolylineDrawMode getDrawMode() const;
+
+        // 新建块的顶点格式（已有数据保持原格式，重新加载后生效）
+        void setVertexFormat(VertexFormat format);
+        VertexFormat getVertexFormat() const;
+
+        // Half2 / Int16Quant 块包围盒的最小边长（世界坐标），应覆盖一个块内折线的分布范围，之后新建的块生效
+        void setQuantExtent(float fExtent);
+
+        // 新增折线的颜色存储方式：按颜色分块，或共享块 + 顶点颜色
+        void setColorStorage(ColorStorage storage);
+        ColorStorage getColorStorage() const;
+
+        // 新增折线的分块方式：只按颜色，或颜色内再按瓦片（块在空间上紧凑，视口裁剪整块跳过）
+        void setBlockPlacement(BlockPlacement placement);
+        BlockPlacement getBlockPlacement() const;
+
+        // 按瓦片分块时的瓦片边长（世界坐标），应与数据范围相称，之后新增的折线生效
+        void setTileSize(float fTileSize);
+        float getTileSize() const;
+
+        // 折线VBO的内存策略和每块的实时状态
+        void setVboPolicy(const VboPolicy& policy);
+        std::vector<VboBlockTelemetry> getBlockTelemetry() const;
+        VboCacheStats getCacheStats() const;
+
+        // 视口裁剪：可见范围（世界坐标，空范围关闭裁剪）和最近一帧的裁剪统计
+        void setViewRect(const QRectF& rect);
+        VboCullStats getCullStats() const;
+
+        // 屏幕尺寸 LOD：长边不足 fMinPixels 像素的折线跳过或按格子合并，阈值随每帧的像素尺寸换算
+        void setLod(ViewCuller::LodMode mode, float fMinPixels = 1.0f);
+        ViewCuller::LodMode getLodMode() const;
+        void setPixelSize(float fWorldPerPixel);
+
+        // 多分辨率简化：之后新增的折线生成简化层，缩小时按像素尺寸选层绘制
+        void setSimplification(bool bEnable, float fPixelTolerance = 0.5f);
+        bool getSimplification() const;
+
+        // 折线顶点管理器，供 RenderDataManager 按ID增量转发编辑
+        PolylinesVboManager* getVboManager();
+
+        // 共用的上传暂存区（由 RenderManager 在 initialize 之前设置，为空时使用管理器自有的暂存区）
+        void setStagingRing(StagingRing* pRing);
+
 
     private:
         QMatrix3x3 m_mat;
@@ -0,0 +1,78 @@
+#ifndef RENDER_BATCH_H
+#define RENDER_BATCH_H
+
+#include "Render/RenderCommon.h"
+#include "Common/DllSet.h"
+
+#include <vector>
+#include <string>
+
+namespace GLRhi
+{
+    /**
+     * @brief 批量编辑的操作类型
+     */
+    enum class BatchOp
+    {
+        Add,
+        Modify,
+        Remove
+    };
+
+    /**
+     * @brief 跨渲染器的批量编辑（事务）
+     *
+     * 由 RenderManager::beginBatch() 取得，在任意线程中记录折线、三角形、纹理的增删改，
+     * 再交给 RenderManager::commit()。提交时在调用线程校验，校验失败整批丢弃；
+     * 校验通过的批次在下一帧开始时按记录顺序一次性应用，同一帧内不会只应用一部分。
+     * 批次本身不持有共享状态，不同线程各自使用自己的批次，无需加锁。
+     */
+    class GLRENDER_API RenderBatch
+    {
+    public:
+        template <typename T>
+        struct Edit
+        {
+            BatchOp op;
+            T data;         // Remove 时只用到ID
+        };
+
+    public:
+        void addLines(const PolylineData& lines);
+        void modifyLines(const PolylineData& lines);
+        void removeLines(const std::vector<long long>& vIds);
+
+        void addTriangle(const TriangleData& triangle);
+        void modifyTriangle(const TriangleData& triangle);
+        void removeTriangles(const std::vector<long long>& vIds);
+
+        void addTexture(const TextureData& texture);
+        void modifyTexture(const TextureData& texture);
+        void removeTextures(const std::vector<long long>& vIds);
+
+        /**
+         * @brief 校验全部编辑：顶点数与 vCount 一致、索引是三的倍数且不越界
+         * @param pError 失败时写入第一处错误
+         */
+        bool validate(std::string* pError = nullptr) const;
+
+        bool empty() const;
+        size_t size() const;
+        void clear();
+
+        bool hasLineEdits() const { return !m_vLineEdits.empty(); }
+        bool hasTriangleEdits() const { return !m_vTriangleEdits.empty(); }
+        bool hasTextureEdits() const { return !m_vTextureEdits.empty(); }
+
+        const std::vector<Edit<PolylineData>>& getLineEdits() const { return m_vLineEdits; }
+        const std::vector<Edit<TriangleData>>& getTriangleEdits() const { return m_vTriangleEdits; }
+        const std::vector<Edit<TextureData>>& getTextureEdits() const { return m_vTextureEdits; }
+
+    private:
+        std::vector<Edit<PolylineData>> m_vLineEdits;
+        std::vector<Edit<TriangleData>> m_vTriangleEdits;
+        std::vector<Edit<TextureData>> m_vTextureEdits;
+    };
+}
+
+#endif // RENDER_BATCH_H
@@ -7,7 +7,20 @@
 namespace GLRhi
 {
     class Impl;
-
+    class PolylinesVboManager;
+    class TriangleVboManager;
+    class TextureRenderer;
+    class RenderBatch;
+
+    /**
+     * @brief 图元数据管理器
+     *
+     * 每种图元按ID存放在槽位表（SlotMap）中，增删改查都是 O(1)，批量操作是 O(k)，不比较几何数据。
+     * 关联了顶点管理器时，增删改只按ID记入变化日志，不调用 GL；flush() 把日志中的差异一次性提交给顶点管理器，
+     * 同一ID在两次提交之间的多次变化只提交最终结果。flush() 会调用 GL，需要在渲染线程调用，RenderManager 每帧开始时调用一次。
+     * 折线、实例化折线以 PolylineData 中的每个 vId 为单位管理，其余图元以各自的 id 为单位。
+     * 添加已存在的ID时按修改处理；修改、删除不存在的ID时忽略。
+     */
     class GLRENDER_API RenderDataManager final
     {
     public:
@@ -15,6 +28,40 @@ namespace GLRhi
         ~RenderDataManager();
 
     public:
+        /**
+         * @brief 关联折线顶点管理器，已有折线整体导入一次，之后的编辑记入日志由 flush() 提交；传入 nullptr 取消关联
+         */
+        void attachLineManager(PolylinesVboManager* manager);
+
+        /**
+         * @brief 关联三角形顶点管理器，已有三角形整体导入一次，之后的编辑记入日志由 flush() 提交；传入 nullptr 取消关联
+         */
+        void attachTriangleManager(TriangleVboManager* manager);
+
+        /**
+         * @brief 关联纹理渲染器，已有纹理整体导入一次，之后的编辑记入日志由 flush() 按ID提交；传入 nullptr 取消关联
+         */
+        void attachTextureRenderer(TextureRenderer* renderer);
+
+        /**
+         * @brief 把变化日志提交给已关联的顶点管理器和纹理渲染器并清空日志
+         * 删除和样式变化一次批量删除，几何变化逐条原地更新，新增和样式变化一次批量导入
+         */
+        void flush();
+
+        // 尚未提交的变化数（按ID合并后）
+        size_t getPendingChangeCount() const;
+
+        /**
+         * @brief 按记录顺序应用一个已校验的批次，折线、三角形和纹理的变化记入日志
+         */
+        void applyBatch(const RenderBatch& batch);
+
+        // 紧密存放的全部三角形 / 纹理，供整体导入使用；增删后元素位置会变化
+        const std::vector<TriangleData>& getTriangles() const;
+        const std::vector<TextureData>& getTextures() const;
+
+        // 整体替换（先删除旧数据，再按批量添加处理）
         void setPolylineDatas(std::vector<PolylineData>& datas);
         void setLineDatasCRUD();
 
@@ -72,18 +119,21 @@ namespace GLRhi
         void removeInstanceTexture(const TextureData& instanceTexture);
         void removeInstanceTextures(const std::vector<TextureData>& instanceTextures);
 
+        /////////////////////
+        // 按ID删除
+        void removeLines(const std::vector<long long>& vIds);
+        void removeTriangles(const std::vector<long long>& vIds);
+        void removeTextures(const std::vector<long long>& vIds);
+
+        size_t getLineCount() const;
+        size_t getTriangleCount() const;
+        size_t getTextureCount() const;
+
         /////////////////////
         void deleteAll();
 
     private:
         Impl* m_impl{ nullptr };
-
-        std::vector<PolylineData> m_vPolylineDatas;             // 线段数据
-        std::vector<TriangleData> m_vTriangleDatas;             // 三角形数据
-        std::vector<TextureData> m_vTextureDatas;               // 纹理数据
-        std::vector<InstanceTexData> m_vInstanceTextureDatas;   // 实例纹理数据
-        std::vector<InstanceLineData> m_vInstanceLineDatas;     // 实例线段数据
-        std::vector<InstanceTriangleData> m_vInstanceTriangleDatas; // 实例三角形数据
     };
 }
 #endif
\ No newline at end of file
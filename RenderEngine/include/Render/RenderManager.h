@@ -17,6 +17,9 @@
 
 #include "Common/DllSet.h"
 #include "Render/RenderDataManager.h"
+#include "Render/RenderBatch.h"
+#include "Render/GLStateCache.h"
+#include "DataManager/StagingRing.h"
 
 // #include "FakeData/FakeDataProvider.h"
 // #include "FakeData/InstanceLineFakeData.h"
@@ -24,6 +27,7 @@
 #include <QOpenGLFunctions_3_3_Core>
 
 #include <memory>
+#include <mutex>
 
 namespace GLRhi
 {
@@ -40,6 +44,12 @@ namespace GLRhi
         // 渲染
         void render(const float* cameraMat);
 
+        // 可见范围（世界坐标），渲染器据此做视口裁剪；空范围关闭裁剪
+        void setViewRect(const QRectF& rect);
+
+        // 一个像素对应的世界长度，渲染器据此换算屏幕尺寸 LOD 的阈值
+        void setPixelSize(float fWorldPerPixel);
+
         // 清理所有渲染器
         void cleanup();
 
@@ -61,10 +71,38 @@ namespace GLRhi
 
         void dataCRUD();
 
+        /**
+         * @brief 整体替换折线 / 三角形 / 纹理数据，只能在渲染线程调用
+         * 数据存放在数据管理器中，下一帧开始时转发给渲染器。数据管理器是这些图元唯一的数据来源：
+         * commit() 的批量编辑按ID作用于经由这里加载的数据，不要再直接调用渲染器的 updateData()
+         */
+        void setPolylineDatas(std::vector<PolylineData>& datas);
+        void setTriangleDatas(std::vector<TriangleData>& datas);
+        void setTextureDatas(std::vector<TextureData>& datas);
+
+        /**
+         * @brief 开始一个跨渲染器的批量编辑，可在任意线程调用
+         */
+        RenderBatch beginBatch() const;
+
+        /**
+         * @brief 提交批量编辑，可在任意线程调用
+         * 在调用线程校验，失败时整批丢弃；通过后排队，下一帧开始时所有已提交的批次一起应用，
+         * 折线、三角形、纹理在同一帧内一次上传，不会出现只应用一半的帧。
+         * 编辑作用于 set*Datas() 加载到数据管理器中的图元。
+         * @return false 表示校验失败
+         */
+        bool commit(RenderBatch batch);
+
+        // 上一帧的 GL 状态调用统计（实际发出 / 被状态缓存省去）
+        const GLStateStats& getStateStats() const;
+
     private:
         QOpenGLFunctions_3_3_Core* m_gl{ nullptr };  // OpenGL函数指针
         QOpenGLContext* m_context{ nullptr };
         Brush m_bgColor{ 1.0, 1.0, 0.0, -1.0 }; // 背景色
+        GLStateCache m_stateCache;                  // 所有渲染器共用的 GL 状态缓存
+        StagingRing m_stagingRing;                  // 折线、三角形顶点管理器共用的上传暂存区，需晚于渲染器析构
 
         // 渲染器
         std::unique_ptr<IRenderer> m_boardRenderer{ nullptr };
@@ -86,6 +124,13 @@ namespace GLRhi
         // std::unique_ptr<FakeDataProvider> m_dataGen{ nullptr };
 
         RenderDataManager m_dataManager;
+
+        std::mutex m_batchMutex;                    // 只保护已提交的批次队列
+        std::vector<RenderBatch> m_vCommittedBatches;
+
+    private:
+        // 应用已提交的批次，在渲染线程每帧开始时调用
+        void applyCommittedBatches();
     };
 }
 #endif // RENDERMANAGER_H
\ No newline at end of file
@@ -5,10 +5,18 @@
 #include "Render/RenderCommon.h"
 
 #include <vector>
+#include <unordered_map>
 #include <QOpenGLShaderProgram>
 
 namespace GLRhi
 {
+    /**
+     * @brief 纹理渲染器
+     *
+     * 所有纹理图元的顶点和索引放在同一对 VBO / EBO 中，按ID记录每个图元占用的区段。
+     * 增删改按ID作用于各自的区段，编辑先写入CPU端副本，一次编辑结束时只上传变化的范围；
+     * 容量不足或空洞过多时才整体重建上传。图元引用的纹理对象由渲染器负责删除，不再被引用时释放。
+     */
     class GLRENDER_API TextureRenderer : public IRenderer
     {
     public:
@@ -19,23 +27,60 @@ namespace GLRhi
         bool initialize(QOpenGLContext* context) override;
         void render(const float* matMVP = nullptr) override;
         void cleanup() override;
+
+        // 整体替换所有纹理图元
         void updateData(const std::vector<TextureData>& vTexDatas);
 
+        /**
+         * @brief 按ID增量编辑，依次删除、原地更新、添加，变化的顶点和索引一次上传
+         * 更新和添加的数据只在调用期间读取；更新不存在的ID、添加已存在的ID按另一种操作处理
+         */
+        void applyEdits(const std::vector<long long>& vRemove,
+            const std::vector<const TextureData*>& vUpdate,
+            const std::vector<const TextureData*>& vAdd);
+
     private:
         struct Batch
         {
+            long long id;
+            unsigned int vertexOffset;  // 顶点偏移（顶点个数）
+            unsigned int vertexSlot;    // 占用的顶点数，原地更新的上限
             unsigned int indexOffset;   // 索引偏移（元素个数）
+            unsigned int indexSlot;     // 占用的索引数，原地更新的上限
             unsigned int indexCount;
             GLuint tex;                 // 纹理
             Brush brush;                // 画刷
         };
 
+        void removeBatch(long long id);
+        void writeBatch(Batch& batch, const TextureData& texData);
+        void appendBatch(const TextureData& texData);
+        void retainTexture(GLuint tex);
+        void releaseTexture(GLuint tex);
+        void compact();
+        void markDirty(size_t nVertBegin, size_t nVertEnd, size_t nIdxBegin, size_t nIdxEnd);
+        void upload();
+
         GLuint m_nVao = 0;
         GLuint m_nVbo = 0;
         GLuint m_nEbo = 0;
 
-        std::vector<Batch> m_vBatches;
-        std::vector<GLuint> m_vTextureIds; // 存储纹理ID以在清理时释放
+        std::vector<Batch> m_vBatches;                      // 绘制顺序
+        std::unordered_map<long long, size_t> m_idToBatch;  // 图元ID -> m_vBatches 下标
+        std::unordered_map<GLuint, size_t> m_texRefs;       // 纹理ID -> 引用它的图元数
+        std::vector<GLuint> m_vReleasedTex;                 // 引用数降为 0、本次编辑结束时删除的纹理
+
+        // GPU 缓冲区的CPU端副本，x, y, u, v / 绝对索引
+        std::vector<float> m_vVerts;
+        std::vector<unsigned int> m_vIndices;
+        size_t m_nDeadVerts = 0;        // 删除和搬迁留下的空洞顶点数
+        size_t m_nDeadIndices = 0;
+
+        size_t m_nVboCapacity = 0;      // GPU 缓冲区容量（浮点数 / 索引个数），超出时整体重建
+        size_t m_nEboCapacity = 0;
+        bool m_bRealloc = false;        // 需要整体重建上传
+        size_t m_nDirtyVertBegin = 0, m_nDirtyVertEnd = 0;  // 待上传的顶点范围（浮点数）
+        size_t m_nDirtyIdxBegin = 0, m_nDirtyIdxEnd = 0;    // 待上传的索引范围
 
         // Uniform
         GLint m_uCameraMatLoc = -1;
@@ -5,6 +5,8 @@
 #include "Render/RenderCommon.h"
 #include <vector>
 #include <QOpenGLShaderProgram>
+#include <QRectF>
+#include "DataManager/TriangleVboManager.h"
 
 namespace GLRhi
 {
@@ -20,33 +22,34 @@ namespace GLRhi
         void cleanup() override;
 
     public:
+        void clearData() override;
+
+        // 整体替换管理器中的三角形
         void updateData(const std::vector<TriangleData>& vTriDatas);
 
         // 是否启用颜色混合
         void setBlendEnabled(bool enabled);
         bool isBlendEnabled() const;
 
-    public:
-    private:
-        struct Batch
-        {
-            unsigned int indexOffset; // 索引缓冲区偏移（字节）
-            unsigned int indexCount;  // 索引数量
-            Brush brush;
-        };
+        // 视口裁剪：可见范围（世界坐标，空范围关闭裁剪）和一个像素对应的世界长度
+        void setViewRect(const QRectF& rect);
+        void setPixelSize(float fWorldPerPixel);
 
-        GLuint m_nVao = 0;
-        GLuint m_nVbo = 0;
-        GLuint m_nEbo = 0;
+        // 三角形顶点管理器，供 RenderDataManager 按ID增量转发编辑
+        TriangleVboManager* getVboManager();
 
-        std::vector<Batch> m_vecBatches;
+        // 共用的上传暂存区（由 RenderManager 在 initialize 之前设置，为空时使用管理器自有的暂存区）
+        void setStagingRing(StagingRing* pRing);
 
+    private:
         bool m_bBlend = true;
 
         // Uniform
         GLint m_uCameraMatLoc = -1;
         GLint m_uColorLoc = -1;
         GLint m_uDepthLoc = -1;
+
+        TriangleVboManager m_triBuffer;
     };
 }
 
@@ -102,6 +102,16 @@ namespace GLRhi
         return QPointF(worldX, worldY);
     }
 
+    // -----------------------------------------------------------------
+    float Camera::getPixelSize(const QSize& viewSz) const
+    {
+        if (viewSz.isEmpty() || std::fabs(m_dScale) < 1e-6f)
+            return 0.0f;
+
+        // 屏幕宽 w 像素对应 NDC 宽 2，NDC 到世界除以 sx；sy = sx * aspect，Y 方向结果相同
+        return 2.0f / (static_cast<float>(viewSz.width()) * std::fabs(m_dScale));
+    }
+
     // -----------------------------------------------------------------
     void Camera::zoomToRange(float minX, float minY,
         float maxX, float maxY, const QSize& viewSz)
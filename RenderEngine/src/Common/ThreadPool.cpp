@@ -0,0 +1,124 @@
+#include "Common/ThreadPool.h"
+
+#include <algorithm>
+
+namespace GLRhi
+{
+    namespace
+    {
+        // 当前线程是否正在执行线程池的任务（工作线程，或正在 parallelFor 中的调用线程），嵌套调用时串行执行
+        thread_local bool t_bInPool = false;
+    }
+
+    ThreadPool::ThreadPool(size_t nThreads)
+    {
+        if (nThreads == 0)
+        {
+            size_t nHardware = std::thread::hardware_concurrency();
+            nThreads = nHardware > 1 ? nHardware - 1 : 0;
+        }
+
+        m_vThreads.reserve(nThreads);
+        for (size_t i = 0; i < nThreads; ++i)
+            m_vThreads.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStop = true;
+        }
+        m_cvWork.notify_all();
+
+        for (std::thread& t : m_vThreads)
+        {
+            if (t.joinable())
+                t.join();
+        }
+    }
+
+    ThreadPool& ThreadPool::global()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    void ThreadPool::parallelFor(size_t nCount, size_t nGrain, const RangeFn& fn)
+    {
+        if (nCount == 0)
+            return;
+
+        nGrain = std::max<size_t>(nGrain, 1);
+
+        // 只有一个区段、没有工作线程或嵌套调用时直接在当前线程执行
+        if (nCount <= nGrain || m_vThreads.empty() || t_bInPool)
+        {
+            for (size_t nBegin = 0; nBegin < nCount; nBegin += nGrain)
+                fn(nBegin, std::min(nBegin + nGrain, nCount), 0);
+            return;
+        }
+
+        std::lock_guard<std::mutex> callLock(m_callMutex);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pFn = &fn;
+            m_nCount = nCount;
+            m_nGrain = nGrain;
+            m_nNext.store(0, std::memory_order_relaxed);
+            m_nBusy = m_vThreads.size();
+            m_nGeneration++;
+        }
+        m_cvWork.notify_all();
+
+        t_bInPool = true;
+        runChunks(0);
+        t_bInPool = false;
+
+        // 等所有工作线程退出本次任务，之后 fn 才能销毁
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvDone.wait(lock, [this] { return m_nBusy == 0; });
+        m_pFn = nullptr;
+    }
+
+    void ThreadPool::workerLoop(size_t nSlot)
+    {
+        t_bInPool = true;
+        uint64_t nSeen = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cvWork.wait(lock, [&] { return m_bStop || m_nGeneration != nSeen; });
+                if (m_bStop)
+                    return;
+                nSeen = m_nGeneration;
+            }
+
+            runChunks(nSlot);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_nBusy == 0)
+                    m_cvDone.notify_one();
+            }
+        }
+    }
+
+    void ThreadPool::runChunks(size_t nSlot)
+    {
+        const RangeFn& fn = *m_pFn;
+        const size_t nCount = m_nCount;
+        const size_t nGrain = m_nGrain;
+
+        while (true)
+        {
+            size_t nBegin = m_nNext.fetch_add(nGrain, std::memory_order_relaxed);
+            if (nBegin >= nCount)
+                return;
+            fn(nBegin, std::min(nBegin + nGrain, nCount), nSlot);
+        }
+    }
+}
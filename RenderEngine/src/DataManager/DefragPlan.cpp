@@ -0,0 +1,46 @@
+#include "DataManager/DefragPlan.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace GLRhi
+{
+    namespace
+    {
+        constexpr size_t DEFRAG_CHUNK_BYTES = 256u * 1024u; // 每片拷贝的字节数，片之间检查预算
+    }
+
+    size_t DefragPlan::step(QOpenGLFunctions_3_3_Core* gl, unsigned int nVbo, unsigned int& nVboSpare,
+        unsigned int nEbo, unsigned int& nEboSpare, const DefragBudget& budget)
+    {
+        if (!gl)
+            return 0;
+
+        if (!bStarted)
+        {
+            VboCompactor::allocStorage(gl, nVboSpare, nVertexBytes);
+            if (nIndexBytes > 0)
+                VboCompactor::allocStorage(gl, nEboSpare, nIndexBytes);
+            bStarted = true;
+        }
+
+        auto tStart = std::chrono::steady_clock::now();
+        const size_t nMaxBytes = std::max<size_t>(budget.nMaxBytes, 1);
+
+        size_t nMoved = 0;
+        while (!isFinished() && nMoved < nMaxBytes)
+        {
+            size_t nChunk = std::min(DEFRAG_CHUNK_BYTES, nMaxBytes - nMoved);
+            if (!vertMoves.isFinished(vertCursor))
+                nMoved += vertMoves.executePartial(gl, nVbo, nVboSpare, vertCursor, nChunk);
+            else
+                nMoved += idxMoves.executePartial(gl, nEbo, nEboSpare, idxCursor, nChunk);
+
+            double dElapsedMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - tStart).count();
+            if (dElapsedMs >= budget.dMaxMs)
+                break;
+        }
+        return nMoved;
+    }
+}
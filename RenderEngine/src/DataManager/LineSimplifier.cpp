@@ -0,0 +1,197 @@
+#include "DataManager/LineSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GLRHI_SIMPLIFY_SSE2 1
+#endif
+
+namespace GLRhi
+{
+    namespace
+    {
+        struct SplitRange
+        {
+            uint32_t nFirst{ 0 };
+            uint32_t nLast{ 0 };
+            float fCap{ 0.0f };         // 父分割点的重要度
+        };
+
+        /**
+         * @brief 在 (nFirst, nLast) 之间找离弦 nFirst-nLast 最远的顶点
+         * 弦长不为 0 时比较 |叉积|（与点到直线的距离成正比），首尾重合时比较到端点距离的平方。
+         * 距离相同时取下标最小的顶点，与逐个比较的结果一致。
+         */
+        uint32_t farthest(const float* pX, const float* pY, uint32_t nFirst, uint32_t nLast, float& fDist)
+        {
+            const float fAx = pX[nFirst];
+            const float fAy = pY[nFirst];
+            const float fDx = pX[nLast] - fAx;
+            const float fDy = pY[nLast] - fAy;
+            const float fLen2 = fDx * fDx + fDy * fDy;
+            const bool bChord = fLen2 > 0.0f;
+
+            float fBest = -1.0f;
+            uint32_t nBest = nFirst + 1;
+            uint32_t i = nFirst + 1;
+
+#ifdef GLRHI_SIMPLIFY_SSE2
+            if (nLast - i >= 8)
+            {
+                const __m128 vAx = _mm_set1_ps(fAx);
+                const __m128 vAy = _mm_set1_ps(fAy);
+                const __m128 vDx = _mm_set1_ps(fDx);
+                const __m128 vDy = _mm_set1_ps(fDy);
+                const __m128 vAbs = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+                const __m128i vStep = _mm_set1_epi32(4);
+
+                __m128 vBest = _mm_set1_ps(-1.0f);
+                __m128i vBestIdx = _mm_setzero_si128();
+                __m128i vIdx = _mm_setr_epi32(int(i), int(i + 1), int(i + 2), int(i + 3));
+
+                for (; i + 4 <= nLast; i += 4)
+                {
+                    __m128 vPx = _mm_sub_ps(_mm_loadu_ps(pX + i), vAx);
+                    __m128 vPy = _mm_sub_ps(_mm_loadu_ps(pY + i), vAy);
+                    __m128 vMetric = bChord ?
+                        _mm_and_ps(_mm_sub_ps(_mm_mul_ps(vPx, vDy), _mm_mul_ps(vPy, vDx)), vAbs) :
+                        _mm_add_ps(_mm_mul_ps(vPx, vPx), _mm_mul_ps(vPy, vPy));
+
+                    // 严格大于才替换，每个通道保留最早出现的最大值
+                    __m128i vMask = _mm_castps_si128(_mm_cmpgt_ps(vMetric, vBest));
+                    vBest = _mm_max_ps(vBest, vMetric);
+                    vBestIdx = _mm_or_si128(_mm_and_si128(vMask, vIdx), _mm_andnot_si128(vMask, vBestIdx));
+                    vIdx = _mm_add_epi32(vIdx, vStep);
+                }
+
+                float vLaneBest[4];
+                int32_t vLaneIdx[4];
+                _mm_storeu_ps(vLaneBest, vBest);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(vLaneIdx), vBestIdx);
+                for (int k = 0; k < 4; ++k)
+                {
+                    uint32_t nIdx = static_cast<uint32_t>(vLaneIdx[k]);
+                    if (vLaneBest[k] > fBest || (vLaneBest[k] == fBest && nIdx < nBest))
+                    {
+                        fBest = vLaneBest[k];
+                        nBest = nIdx;
+                    }
+                }
+            }
+#endif
+
+            for (; i < nLast; ++i)
+            {
+                float fPx = pX[i] - fAx;
+                float fPy = pY[i] - fAy;
+                float fMetric = bChord ? std::fabs(fPx * fDy - fPy * fDx) : fPx * fPx + fPy * fPy;
+                if (fMetric > fBest)
+                {
+                    fBest = fMetric;
+                    nBest = i;
+                }
+            }
+
+            fDist = bChord ? fBest / std::sqrt(fLen2) : std::sqrt(fBest);
+            return nBest;
+        }
+    }
+
+    void LineSimplifier::importance(const float* pXyz, size_t nVerts, float* pImportance)
+    {
+        if (nVerts == 0)
+            return;
+
+        // 拆成 x / y 两个连续数组，最远点搜索按 4 个顶点一组比较
+        thread_local std::vector<float> vX;
+        thread_local std::vector<float> vY;
+        thread_local std::vector<SplitRange> vStack;
+        vX.resize(nVerts);
+        vY.resize(nVerts);
+        for (size_t i = 0; i < nVerts; ++i)
+        {
+            vX[i] = pXyz[i * 3];
+            vY[i] = pXyz[i * 3 + 1];
+        }
+
+        const float fInf = std::numeric_limits<float>::infinity();
+        pImportance[0] = fInf;
+        pImportance[nVerts - 1] = fInf;
+
+        // 显式栈代替递归，长折线不会栈溢出；每个内部顶点恰好被选为分割点一次
+        vStack.clear();
+        vStack.push_back({ 0, static_cast<uint32_t>(nVerts - 1), fInf });
+        while (!vStack.empty())
+        {
+            SplitRange range = vStack.back();
+            vStack.pop_back();
+            if (range.nLast - range.nFirst < 2)
+                continue;
+
+            float fDist = 0.0f;
+            uint32_t nSplit = farthest(vX.data(), vY.data(), range.nFirst, range.nLast, fDist);
+            float fImportance = std::min(fDist, range.fCap);
+            pImportance[nSplit] = fImportance;
+
+            vStack.push_back({ range.nFirst, nSplit, fImportance });
+            vStack.push_back({ nSplit, range.nLast, fImportance });
+        }
+    }
+
+    bool LineSimplifier::simplify(const float* pXyz, size_t nVerts, const QuantBox& bounds, SimplifiedLine& out)
+    {
+        out.lod = PolylineLod();
+        out.vXyz.clear();
+
+        float fExtent = std::max(bounds.fMaxX - bounds.fMinX, bounds.fMaxY - bounds.fMinY);
+        if (nVerts < MIN_VERTS || nVerts > 0xFFFFFFFFu || !(fExtent > 0.0f))
+            return false;
+
+        thread_local std::vector<float> vImportance;
+        vImportance.resize(nVerts);
+        importance(pXyz, nVerts, vImportance.data());
+
+        size_t nPrev = nVerts;
+        size_t nOffset = nVerts;
+        for (int nLevel = 0; nLevel < PolylineLod::MAX_LEVELS; ++nLevel)
+        {
+            // 容差依次为长边的 1/1024、1/256、1/64、1/16
+            float fTolerance = fExtent / float(1u << (2 * (PolylineLod::MAX_LEVELS - nLevel) + 2));
+            size_t nKeep = 0;
+            for (size_t i = 0; i < nVerts; ++i)
+                nKeep += vImportance[i] > fTolerance ? 1 : 0;
+
+            if (nKeep * 4 > nPrev * 3)
+                continue;
+
+            PolylineLod& lod = out.lod;
+            lod.vOffset[lod.nLevels] = static_cast<uint32_t>(nOffset);
+            lod.vCount[lod.nLevels] = static_cast<uint32_t>(nKeep);
+            lod.vTolerance[lod.nLevels] = fTolerance;
+            lod.nLevels++;
+
+            for (size_t i = 0; i < nVerts; ++i)
+            {
+                if (vImportance[i] > fTolerance)
+                    out.vXyz.insert(out.vXyz.end(), pXyz + i * 3, pXyz + i * 3 + 3);
+            }
+            nOffset += nKeep;
+            nPrev = nKeep;
+        }
+
+        return out.lod.nLevels > 0;
+    }
+
+    int LineSimplifier::selectLevel(const PolylineLod& lod, float fMaxTolerance)
+    {
+        for (int i = lod.nLevels - 1; i >= 0; --i)
+        {
+            if (lod.vTolerance[i] <= fMaxTolerance)
+                return i;
+        }
+        return -1;
+    }
+}
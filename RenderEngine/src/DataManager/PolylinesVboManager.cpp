@@ -22,22 +22,20 @@
 #include <chrono>
 #include <QDebug>
 #include <unordered_set>
+#include <limits>
+#include <cmath>
 
 #include "DataManager/PolylinesVboManager.h"
+#include "Common/ThreadPool.h"
 
 namespace GLRhi
 {
-    // 类常量定义
+    // 类常量定义（容量、阈值等可调参数见 VboPolicy）
     namespace
     {
-        static constexpr size_t INIT_CAPACITY = 100'000; // 改这里！原来 1'000'000 太离谱
-        static constexpr size_t GROW_STEP = 200'000;
-        static constexpr size_t MAX_VERT_PER_BLOCK = 1'500'000;
-
-        // static constexpr size_t INIT_CAPACITY = 1'000'000;     // VBO块的初始容量
-        // static constexpr size_t GROW_STEP = 500'000;         // 容量增长步长
-        // static constexpr size_t MAX_VERT_PER_BLOCK = 2'000'000; // 每个VBO块的最大顶点数量
-        static constexpr float COMPACT_THRESHOLD = 0.70f; // 使用率 < 70% 才压缩
+        static constexpr size_t RAMP_MIN_COUNT = 4096;    // 共享递增索引缓冲区的最小长度
+        static constexpr size_t INGEST_GRAIN = 16384;     // 批量导入时每个并行区段的最少折线数
+        static constexpr size_t ENCODE_GRAIN = 65536;     // 批量导入时每个编码任务的顶点数
     }
 
     /**
@@ -46,8 +44,11 @@ namespace GLRhi
      * 在构造时尝试获取当前的OpenGL上下文，并初始化相关资源。
      * 注意：在创建此对象时，必须确保OpenGL上下文已经初始化。
      */
-    PolylinesVboManager::PolylinesVboManager()
+    PolylinesVboManager::PolylinesVboManager(const VboPolicy& policy)
+        : m_policy(policy)
     {
+        m_vertexCache.setCapacity(m_policy.nCacheBytes);
+
         if (QOpenGLContext::currentContext())
         {
             m_gl = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_3_Core>();
@@ -73,25 +74,29 @@ namespace GLRhi
         stopBackgroundDefrag();
 
         std::unique_lock<std::shared_mutex> lock(m_mutex);
-        for (auto& pair : m_colorBlocksMap)
-        {
-            for (ColorVBOBlock* block : pair.second)
+        m_ownStaging.destroy();
+
+        if (m_gl && m_nRampEbo)
+            m_gl->glDeleteBuffers(1, &m_nRampEbo);
+        m_nRampEbo = 0;
+        m_nRampCount = 0;
+
+        forEachBlock([this](ColorVBOBlock* block) {
+            discardStaged(block);
+            if (m_gl)
             {
-                if (m_gl)
-                {
-                    m_gl->glDeleteVertexArrays(1, &block->vao);
-                    m_gl->glDeleteBuffers(1, &block->vbo);
-                    m_gl->glDeleteBuffers(1, &block->ebo);
-                }
-                delete block;
+                m_gl->glDeleteVertexArrays(1, &block->vao);
+                m_gl->glDeleteBuffers(1, &block->vbo);
+                m_gl->glDeleteBuffers(1, &block->vboSpare);
             }
-        }
+            delete block;
+            });
 
         m_colorBlocksMap.clear();
+        m_vSharedBlocks.clear();
         m_IDLocationMap.clear();
         m_IDLocationMap.reserve(0);
-        m_vVertexCache.clear();
-        m_vVertexCache.reserve(0);
+        m_vertexCache.clear();
     }
 
 
@@ -112,6 +117,9 @@ namespace GLRhi
         }
 
         m_gl->initializeOpenGLFunctions();
+
+        if (m_pStaging == &m_ownStaging && !m_ownStaging.initialize(context))
+            qWarning() << "[LineBufferManager] initialize: failed to create staging ring";
         return true;
     }
 
@@ -135,43 +143,58 @@ namespace GLRhi
             return false;
 
         std::unique_lock<std::shared_mutex> lock(m_mutex);
+        if (m_ingestingIds.count(id))
+            return false;   // 批量导入正在写入同ID的折线
         if (m_IDLocationMap.count(id))
         {
-            m_mutex.unlock();
+            lock.unlock();
             setPolylineVisible(id, true);
             return false;
         }
 
-        ColorVBOBlock* block = getColorBlock(color);
-        if (!block)
-            return false;
+        return addPolylineLocked(id, vertices, vertexCount, color);
+    }
 
+    bool PolylinesVboManager::addPolylineLocked(long long id,
+        const float* vertices, size_t vertexCount, const Color& color)
+    {
         size_t nVertCount = vertexCount / 3;
-        checkBlockCapacity(block,
-            block->nVertexCount + nVertCount,
-            block->nIndexCount + nVertCount);
+        QuantBox bounds = VertexCodec::boundsOf(vertices, nVertCount);
+
+        // 简化层紧跟原始顶点，和原始顶点放在同一个槽位里
+        SimplifiedLine simplified;
+        const bool bLod = simplifyLine(vertices, nVertCount, bounds, simplified);
+        const size_t nSlotVerts = nVertCount + simplified.levelVerts();
+
+        ColorVBOBlock* block = getColorBlock(color, nSlotVerts, bounds, tileOf(bounds));
+        if (!block)
+            return false;
 
-        GLint nBaseVertex = static_cast<GLint>(block->nVertexCount);
+        // 优先复用空洞，否则在末尾追加
+        size_t nBaseVertex = allocVertices(block, nSlotVerts);
 
         PrimitiveInfo prim;
         prim.id = id;
         prim.nIndexCount = static_cast<GLsizei>(nVertCount);
-        prim.nBaseVertex = nBaseVertex;
+        prim.nBaseVertex = static_cast<GLint>(nBaseVertex);
+        prim.nVertexSlot = nSlotVerts;
         prim.bValid = true;
+        prim.bounds = bounds;
+        if (bLod)
+            attachLod(block, prim, simplified.lod);
 
-        size_t nPrimIdx = block->vPrimitives.size();
-        block->vPrimitives.push_back(std::move(prim));
+        size_t nPrimIdx = allocPrimSlot(block);
+        block->vPrimitives[nPrimIdx] = prim;
         block->idToIndexMap[id] = nPrimIdx;
+        syncDrawCmd(block, nPrimIdx);
 
-        block->nVertexCount += nVertCount;
-        block->nIndexCount += nVertCount;
-        block->bDirty = true;
-
-        // 将顶点数据复制到缓存中
-        m_vVertexCache[id].assign(vertices, vertices + vertexCount);
         m_IDLocationMap[id] = { color.toUInt32(), color, block, nPrimIdx };
+        m_spatialIndex.insert(id, prim.bounds);
 
-        uploadSinglePrimitive(block, nPrimIdx); // 增量上传，只传这一条
+        uploadSinglePrimitive(block, nPrimIdx, vertices, nVertCount); // 增量上传，只传这一条
+        if (bLod)
+            uploadSinglePrimitive(block, nPrimIdx, simplified.vXyz.data(), simplified.levelVerts(), nVertCount);
+        cacheVertices(block, id, vertices, vertexCount);
         return true;
     }
 
@@ -179,7 +202,8 @@ namespace GLRhi
      * @brief 批量添加多条折线到渲染管理器
      *
      * 一次性添加多个折线组，每个折线组包含多条折线。
-     * 内部会遍历所有折线数据并调用addPolyline添加每条折线。
+     * 每个折线组直接作为 PolylineBatchView 交给 ingestPolylines()，不拷贝顶点。
+     * ID 已存在的折线不重复添加，可见性也保持原样（调用方隐藏的折线不会被重新显示）。
      *
      * @param vPlDatas 折线数据数组，每个元素包含一组相关的折线
      * @return true 如果所有折线都添加成功，false 如果至少有一条折线添加失败
@@ -191,202 +215,517 @@ namespace GLRhi
         bool bAllSuccess = true;
         for (auto& data : vPlDatas)
         {
-            size_t offset = 0;
-            for (size_t i = 0; i < data.vId.size(); ++i)
+            size_t nLines = std::min(data.vId.size(), data.vCount.size());
+            size_t nExpected = 0;
+            for (size_t i = 0; i < nLines; ++i)
             {
-                size_t nCount = data.vCount[i];
-                if (nCount < 2)
-                {
-                    offset += nCount;
-                    continue;
-                }
-
-                std::vector<float> vVerts;
-                vVerts.reserve(nCount * 3);
-                const float* src = data.vVerts.data() + offset * 3;
-                vVerts.insert(vVerts.end(), src, src + nCount * 3);
+                if (data.vCount[i] >= 2)
+                    nExpected++;
+            }
 
-                Color c(data.brush.getColor());
-                if (!addPolyline(data.vId[i], vVerts.data(), vVerts.size(), c))
-                {
-                    touchCache(data.vId[i]);
-                    bAllSuccess = false;
-                }
+            PolylineBatchView view;
+            view.pIds = data.vId.data();
+            view.pVertCounts = data.vCount.data();
+            view.pVerts = data.vVerts.data();
+            view.color = Color(data.brush.getColor());
+            view.nCount = nLines;
 
-                offset += nCount;
-            }
+            // 有折线没有加入（多为ID已存在）：导入只登记新折线，不改动已有折线，这里也不再补做可见性
+            if (ingestPolylines(view) != nExpected)
+                bAllSuccess = false;
         }
         return bAllSuccess;
     }
 
     /**
-     * @brief 批量添加多条折线
+     * @brief 按结构数组视图批量导入折线
      *
-     * 比逐个调用 addPolyline() 快 5~20 倍，专为一次性加载数十万条线设计。
-     * 内部会：
-     * - 按颜色自动分组
-     * - 每种颜色只扩容/上传一次
-     * - 最小化锁粒度、OpenGL 调用、内存拷贝
+     * 分五步：
+     * 1. 读锁下并行：输入按区段切分，每个区段统计各颜色的折线数、顶点数和包围盒，并过滤无效折线
+     * 2. 合并各区段的统计，前缀和得到每个（区段, 颜色）的写入位置，再并行把折线下标分到各颜色桶，
+     *    同时算出每条折线在 pVerts 中的顶点偏移（计数排序，不比较、不加锁）；开启简化时顺带生成简化层
+     * 3. 写锁下只提交元数据：逐个颜色桶装块，能放进当前块的折线组成一段，整段只扩容一次，
+     *    放不下时换到下一个块；然后按块并行登记图元信息。新折线的ID记入 m_ingestingIds，暂不公开
+     * 4. 解锁后把各段切成固定顶点数的任务，在线程池上并行编码到影子副本或临时内存
+     * 5. 写锁下在本线程（渲染线程）写入暂存区，公开新折线的位置
      *
-     * @param vPolylineDatas 批量数据：{id, vertices, color}
-     * @return 添加成功的图元数量（失败的会跳过并打印警告）
+     * @param view 输入视图
+     * @return 添加成功的折线数量
      */
-    size_t PolylinesVboManager::addPolylines(
-        const std::vector<std::tuple<long long, float*, size_t, Color>>& vPolylineDatas)
+    size_t PolylinesVboManager::ingestPolylines(const PolylineBatchView& view)
     {
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
-        if (vPolylineDatas.empty() || !m_gl)
+        if (view.nCount == 0 || !view.pIds || !view.pVertCounts || (!view.pVerts && !view.pVertPtrs) || !m_gl)
             return 0;
 
-        // Step 1: 预处理 — 按颜色分组 + 过滤无效数据 + 预检查ID冲突
-        struct BatchGroup
+        ThreadPool& pool = ThreadPool::global();
+        const size_t nLines = view.nCount;
+        const size_t nChunkLines = std::max(INGEST_GRAIN, (nLines + pool.getSlotCount() * 4 - 1) / (pool.getSlotCount() * 4));
+        const size_t nChunks = (nLines + nChunkLines - 1) / nChunkLines;
+        const uint32_t nDefaultKey = view.color.toUInt32();
+
+        // 按瓦片分块时桶键的高 32 位是瓦片键，否则为 NO_TILE
+        std::vector<uint32_t> vTiles;
+        std::vector<QuantBox> vLineBounds;
+        auto keyOf = [&](size_t i) {
+            uint64_t nTile = vTiles.empty() ? TileGrid::NO_TILE : vTiles[i];
+            return (nTile << 32) | (view.pColors ? view.pColors[i].toUInt32() : nDefaultKey);
+            };
+
+        // 区段内单个颜色的统计
+        struct ChunkBucket
         {
-            Color color;
-            std::vector<size_t> indices; // 在 vPolylineDatas 中的下标
-            size_t totalVerts = 0;
-            size_t totalIndices = 0;
+            size_t nLines{ 0 };
+            size_t nVerts{ 0 };
+            QuantBox bounds;
+            size_t nBucket{ 0 };        // 合并后的全局桶下标
+            size_t nWritePos{ 0 };      // 第 2 步中该区段在桶内的写入位置
+        };
+        struct ChunkStats
+        {
+            std::unordered_map<uint64_t, ChunkBucket> buckets;
         };
 
-        std::unordered_map<uint32_t, BatchGroup> colorGroups;
-        std::vector<bool> validFlags(vPolylineDatas.size(), true);
-        size_t validCount = 0;
+        std::vector<ChunkStats> vChunks(nChunks);
+        std::vector<uint8_t> vValid(nLines, 0);
+        const bool bNeedBounds = VertexCodec::needsBox(m_vertexFormat);
+
+        // 每个区段首条折线的顶点偏移
+        std::vector<size_t> vChunkVertBase(nChunks, 0);
+        if (!view.pVertPtrs)
+        {
+            size_t nVertOffset = 0;
+            for (size_t i = 0; i < nLines; ++i)
+            {
+                if (i % nChunkLines == 0)
+                    vChunkVertBase[i / nChunkLines] = nVertOffset;
+                nVertOffset += view.pVertCounts[i];
+            }
+        }
 
+        // 第 1 步：并行统计；按瓦片分块时顺带计算包围盒和瓦片键
+        bool bSimplify = false;
         {
             std::shared_lock<std::shared_mutex> readLock(m_mutex);
-            for (size_t i = 0; i < vPolylineDatas.size(); ++i) // 遍历组
+            const float fTileSize = m_fTileSize;
+            bSimplify = m_bSimplify;
+            if (m_blockPlacement == BlockPlacement::ByTile)
             {
-                const auto& [id, verts, vertexCount, color] = vPolylineDatas[i]; // tuple 多段线
+                vTiles.resize(nLines, TileGrid::NO_TILE);
+                vLineBounds.resize(nLines);
+            }
 
-                if (vertexCount < 6)
+            pool.parallelFor(nChunks, 1, [&](size_t nBegin, size_t nEnd, size_t) {
+                for (size_t c = nBegin; c < nEnd; ++c)
                 {
-                    validFlags[i] = false;
-                    continue;
-                }
+                    ChunkStats& stats = vChunks[c];
+                    size_t nFirst = c * nChunkLines;
+                    size_t nLast = std::min(nFirst + nChunkLines, nLines);
+                    size_t nVertOffset = vChunkVertBase[c];
+                    for (size_t i = nFirst; i < nLast; ++i)
+                    {
+                        size_t nCount = view.pVertCounts[i];
+                        nVertOffset += nCount;
+                        if (nCount < 2 || m_IDLocationMap.count(view.pIds[i]))
+                            continue;
 
-                if (m_IDLocationMap.count(id))
-                {
-                    validFlags[i] = false;
-                    continue;
+                        vValid[i] = 1;
+                        if (!vTiles.empty())
+                        {
+                            const float* pXyz = view.pVertPtrs ? view.pVertPtrs[i] : view.pVerts + (nVertOffset - nCount) * 3;
+                            vLineBounds[i] = VertexCodec::boundsOf(pXyz, nCount);
+                            vTiles[i] = TileGrid::keyOf(vLineBounds[i], fTileSize);
+                        }
+                        ChunkBucket& bucket = stats.buckets[keyOf(i)];
+                        bucket.nLines++;
+                        bucket.nVerts += nCount;
+                    }
                 }
+                });
+        }
 
-                size_t nVertCount = vertexCount / 3;
-                uint32_t key = color.toUInt32();
-
-                auto& batchGroup = colorGroups[key];
-                batchGroup.color = color;
-
-                batchGroup.indices.push_back(i);
-                batchGroup.totalVerts += nVertCount;
-                batchGroup.totalIndices += nVertCount;
-                validCount++;
+        // 合并：确定全局桶，以及每个（区段, 颜色, 瓦片）在桶内的起始位置
+        struct Bucket
+        {
+            Color color;
+            uint32_t nTile{ TileGrid::NO_TILE };
+            size_t nBegin{ 0 };         // 在 vSorted 中的起始下标
+            size_t nLines{ 0 };
+            QuantBox bounds;
+        };
+        std::vector<Bucket> vBuckets;
+        std::unordered_map<uint64_t, size_t> keyToBucket;
+        for (ChunkStats& stats : vChunks)
+        {
+            for (auto& [key, cb] : stats.buckets)
+            {
+                auto res = keyToBucket.emplace(key, vBuckets.size());
+                if (res.second)
+                    vBuckets.emplace_back();
+                cb.nBucket = res.first->second;
+                cb.nWritePos = vBuckets[cb.nBucket].nLines; // 暂存区段在桶内的相对位置
+                vBuckets[cb.nBucket].nLines += cb.nLines;
             }
         }
 
-        if (validCount == 0)
+        size_t nTotalValid = 0;
+        for (Bucket& bucket : vBuckets)
+        {
+            bucket.nBegin = nTotalValid;
+            nTotalValid += bucket.nLines;
+        }
+        if (nTotalValid == 0)
             return 0;
 
-        std::unique_lock<std::shared_mutex> writeLock(m_mutex);
+        // 第 2 步：并行分桶，桶内保持输入顺序；需要包围盒时顺带计算，开启简化时顺带生成简化层
+        std::vector<IngestLine> vSorted(nTotalValid);
+        std::vector<std::unique_ptr<SimplifiedLine>> vSimplified(bSimplify ? nTotalValid : 0);
+        pool.parallelFor(nChunks, 1, [&](size_t nBegin, size_t nEnd, size_t) {
+            for (size_t c = nBegin; c < nEnd; ++c)
+            {
+                ChunkStats& stats = vChunks[c];
+                for (auto& entry : stats.buckets)
+                    entry.second.nWritePos += vBuckets[entry.second.nBucket].nBegin;
+
+                size_t nFirst = c * nChunkLines;
+                size_t nLast = std::min(nFirst + nChunkLines, nLines);
+                size_t nVertOffset = vChunkVertBase[c];
+                for (size_t i = nFirst; i < nLast; ++i)
+                {
+                    size_t nCount = view.pVertCounts[i];
+                    if (vValid[i])
+                    {
+                        ChunkBucket& cb = stats.buckets[keyOf(i)];
+                        const float* pXyz = view.pVertPtrs ? view.pVertPtrs[i] : view.pVerts + nVertOffset * 3;
+                        QuantBox bounds = vTiles.empty() ? VertexCodec::boundsOf(pXyz, nCount) : vLineBounds[i];
+                        const SimplifiedLine* pLod = nullptr;
+                        if (bSimplify && nCount >= LineSimplifier::MIN_VERTS)
+                        {
+                            std::unique_ptr<SimplifiedLine> pSimplified(new SimplifiedLine());
+                            if (LineSimplifier::simplify(pXyz, nCount, bounds, *pSimplified))
+                            {
+                                pLod = pSimplified.get();
+                                vSimplified[cb.nWritePos] = std::move(pSimplified);
+                            }
+                        }
+                        vSorted[cb.nWritePos++] = { i, pXyz, bounds, pLod };
+                        if (bNeedBounds)
+                            cb.bounds.expand(bounds);
+                    }
+                    nVertOffset += nCount;
+                }
+            }
+            });
+
+        for (const ChunkStats& stats : vChunks)
+        {
+            for (const auto& entry : stats.buckets)
+            {
+                Bucket& bucket = vBuckets[entry.second.nBucket];
+                bucket.bounds.expand(entry.second.bounds);
+            }
+        }
+        for (Bucket& bucket : vBuckets)
+        {
+            // 取该颜色第一条折线的颜色值
+            size_t nLine = vSorted[bucket.nBegin].nLine;
+            bucket.color = view.pColors ? view.pColors[nLine] : view.color;
+            if (!vTiles.empty())
+                bucket.nTile = vTiles[nLine];
+        }
 
+        // 第 3 步：写锁下提交元数据（装块、扩容、登记图元），不编码顶点
+        std::vector<IngestRun> vRuns;
+        std::vector<Location> vPending(nTotalValid);    // 新折线的位置，编码完成后才公开
         size_t nAdd = 0;
 
-        for (auto& [key, group] : colorGroups)
+        std::unique_lock<std::shared_mutex> writeLock(m_mutex);
+        m_ingestingIds.reserve(m_ingestingIds.size() + nTotalValid);
+
+        for (const Bucket& bucket : vBuckets)
         {
-            ColorVBOBlock* block = getColorBlock(group.color);
-            if (!block)
+            const uint32_t nKey = bucket.color.toUInt32();
+            size_t k = bucket.nBegin;
+            const size_t nEndLine = bucket.nBegin + bucket.nLines;
+            ColorVBOBlock* block = nullptr;
+
+            while (k < nEndLine)
             {
-                qCritical() << "Failed to create color block for batch add";
-                continue;
+                if (!block)
+                    block = getColorBlock(bucket.color, 0, bucket.bounds, bucket.nTile);
+                if (!block)
+                {
+                    qCritical() << "Failed to create color block for ingest";
+                    break;
+                }
+
+                size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+                size_t nMaxVerts = m_policy.maxBytesPerBlock() / nStride;
+                size_t nRoom = nMaxVerts > block->nVertexCount ? nMaxVerts - block->nVertexCount : 0;
+
+                // 收集能放进当前块的一段；空块至少放一条，超长折线单独成块。
+                // 保留的折线原地前移到 vSorted[nAdd...]，之后按段连续编码
+                size_t nFirst = nAdd;
+                size_t nRunVerts = 0;
+                for (; k < nEndLine; ++k)
+                {
+                    const IngestLine line = vSorted[k];
+                    size_t nCount = ingestVerts(view, line);
+                    if (nRunVerts + nCount > nRoom && (nRunVerts > 0 || block->nVertexCount > 0))
+                        break;
+
+                    // 读锁释放后可能有同ID的折线加入，批内也可能有重复ID，其它导入也可能正在写同一ID。
+                    // ID 只记入 m_ingestingIds，编码完成后才放进 m_IDLocationMap，
+                    // 其它线程的查询、删除、隐藏在此之前都找不到这条折线
+                    long long id = view.pIds[line.nLine];
+                    if (m_IDLocationMap.count(id) || !m_ingestingIds.insert(id).second)
+                        continue;
+
+                    vPending[nAdd] = { nKey, bucket.color, block, 0 };
+                    vSorted[nAdd++] = line;
+                    nRunVerts += nCount;
+                }
+
+                if (nAdd == nFirst)
+                {
+                    // 当前块放不下下一条折线：换一个新块
+                    if (k < nEndLine)
+                        block = createNewColorBlock(bucket.color, bucket.bounds, bucket.nTile);
+                    continue;
+                }
+
+                // 整段只扩容一次；影子副本的内存也在这里分配，编码时各线程只写不分配
+                checkBlockCapacity(block, block->nVertexCount + nRunVerts);
+
+                IngestRun run;
+                run.block = block;
+                run.nBaseVertex = block->nVertexCount;
+                run.nFirst = nFirst;
+                run.nLines = nAdd - nFirst;
+                run.nVerts = nRunVerts;
+                run.color = bucket.color;
+                vRuns.push_back(std::move(run));
+
+                block->nVertexCount += nRunVerts;
+                if (block->shadow.isEnabled())
+                    block->shadow.ensure(block->nVertexCount * nStride);
+
+                // 还有剩余时说明当前块已满
+                if (k < nEndLine)
+                    block = nullptr;
             }
+        }
+
+        if (vRuns.empty())
+            return 0;
 
-            checkBlockCapacity(block,
-                block->nVertexCount + group.totalVerts,
-                block->nIndexCount + group.totalIndices);
+        // 各块的图元表、ID表和绘制命令互不相关，按块并行登记
+        std::vector<std::vector<size_t>> vBlockRuns;
+        {
+            std::unordered_map<ColorVBOBlock*, size_t> blockToGroup;
+            for (size_t r = 0; r < vRuns.size(); ++r)
+            {
+                auto res = blockToGroup.emplace(vRuns[r].block, vBlockRuns.size());
+                if (res.second)
+                    vBlockRuns.emplace_back();
+                vBlockRuns[res.first->second].push_back(r);
+            }
+        }
 
-            // 预计算本次批次在块中的起始偏移
-            GLint nBaseVertexStart = static_cast<GLint>(block->nVertexCount);
-            size_t nVertOffset = block->nVertexCount; // 顶点偏移
-            size_t nIdxOffset = block->nIndexCount;   // 索引偏移
+        pool.parallelFor(vBlockRuns.size(), 1, [&](size_t nBegin, size_t nEnd, size_t) {
+            for (size_t g = nBegin; g < nEnd; ++g)
+            {
+                ColorVBOBlock* block = vRuns[vBlockRuns[g].front()].block;
+                size_t nNewLines = 0;
+                for (size_t r : vBlockRuns[g])
+                    nNewLines += vRuns[r].nLines;
+                block->idToIndexMap.reserve(block->idToIndexMap.size() + nNewLines);
+                block->vPrimitives.reserve(block->vPrimitives.size() + nNewLines);
+
+                for (size_t r : vBlockRuns[g])
+                {
+                    const IngestRun& run = vRuns[r];
+                    size_t nVertOffset = run.nBaseVertex;
+                    for (size_t i = run.nFirst; i < run.nFirst + run.nLines; ++i)
+                    {
+                        long long id = view.pIds[vSorted[i].nLine];
+                        size_t nCount = view.pVertCounts[vSorted[i].nLine];
+                        size_t nSlotVerts = ingestVerts(view, vSorted[i]);
+
+                        PrimitiveInfo prim;
+                        prim.id = id;
+                        prim.nIndexCount = static_cast<GLsizei>(nCount);
+                        prim.nBaseVertex = static_cast<GLint>(nVertOffset);
+                        prim.nVertexSlot = nSlotVerts;
+                        prim.bValid = true;
+                        prim.bounds = vSorted[i].bounds;
+                        if (vSorted[i].pLod)
+                            attachLod(block, prim, vSorted[i].pLod->lod);
+
+                        size_t nPrimIdx = allocPrimSlot(block);
+                        block->vPrimitives[nPrimIdx] = prim;
+                        block->idToIndexMap[id] = nPrimIdx;
+                        syncDrawCmd(block, nPrimIdx);
+
+                        vPending[i].nPrimIdx = nPrimIdx;
+                        nVertOffset += nSlotVerts;
+                    }
+                }
+            }
+            });
 
-            // 准备批量上传用的连续缓冲区
-            std::vector<float> vBatchVerts;
-            std::vector<unsigned int> vBatchIndices;
-            vBatchVerts.reserve(group.totalVerts * 3);
-            vBatchIndices.reserve(group.totalIndices);
+        writeLock.unlock();
 
-            std::vector<PrimitiveInfo> vNewPrims;
-            vNewPrims.reserve(group.indices.size());
+        // 第 4 步：不持锁并行编码。新区段只有本次导入引用，同步接口只在渲染线程（即本线程）调用，
+        // 新折线还不在 m_IDLocationMap 中，其它线程不会访问这些区段
+        struct EncodeJob
+        {
+            size_t nRun{ 0 };
+            size_t nFirst{ 0 };         // 第一条折线在导入顺序中的下标
+            size_t nLines{ 0 };
+            size_t nVertOffset{ 0 };    // 相对 run.nBaseVertex 的顶点偏移
+            size_t nVerts{ 0 };
+        };
+        std::vector<EncodeJob> vJobs;
+        for (size_t r = 0; r < vRuns.size(); ++r)
+        {
+            IngestRun& run = vRuns[r];
+            if (!run.block->shadow.isEnabled())
+                run.pEncoded.reset(new unsigned char[run.nVerts * VertexCodec::stride(run.block->format, run.block->bVertexColor)]);
+
+            EncodeJob job;
+            job.nRun = r;
+            job.nFirst = run.nFirst;
+            for (size_t i = run.nFirst; i < run.nFirst + run.nLines; ++i)
+            {
+                job.nLines++;
+                job.nVerts += ingestVerts(view, vSorted[i]);
+                if (job.nVerts >= ENCODE_GRAIN || i + 1 == run.nFirst + run.nLines)
+                {
+                    vJobs.push_back(job);
+                    job.nFirst = i + 1;
+                    job.nVertOffset += job.nVerts;
+                    job.nLines = 0;
+                    job.nVerts = 0;
+                }
+            }
+        }
 
-            // 遍历该颜色组所有图元
-            for (size_t idx : group.indices)
+        pool.parallelFor(vJobs.size(), 1, [&](size_t nBegin, size_t nEnd, size_t) {
+            for (size_t j = nBegin; j < nEnd; ++j)
             {
-                if (!validFlags[idx])
+                const EncodeJob& job = vJobs[j];
+                IngestRun& run = vRuns[job.nRun];
+                ColorVBOBlock* block = run.block;
+                size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+                const IngestLine* pLines = vSorted.data() + job.nFirst;
+                uint32_t nRgba = run.color.toUInt32();
+
+                // 影子副本的分段边界可能落在折线中间，游标会在下一段继续
+                size_t nInLine = 0;
+                if (!block->shadow.isEnabled())
+                {
+                    encodeLines(block, view, pLines, nInLine, job.nVerts, nRgba, run.pEncoded.get() + job.nVertOffset * nStride);
                     continue;
+                }
 
-                const auto& [id, verts, vertexCount, color] = vPolylineDatas[idx];
-                size_t nVertCount = vertexCount / 3;
-                PrimitiveInfo prim;
-                prim.id = id;
-                prim.nIndexCount = static_cast<GLsizei>(nVertCount);
-                prim.nBaseVertex = static_cast<GLint>(nVertOffset);
-                prim.bValid = true;
-
-                // 记录图元信息
-                size_t nPrimIdxInBlock = block->vPrimitives.size() + vNewPrims.size();
-                vNewPrims.push_back(std::move(prim));
-                block->idToIndexMap[id] = nPrimIdxInBlock;
-
-                // 缓存顶点（用于后续 update / compact）
-                m_vVertexCache[id].assign(verts, verts + vertexCount);
-
-                // 填充批量缓冲区
-                vBatchVerts.insert(vBatchVerts.end(), verts, verts + vertexCount);
-                for (size_t i = 0; i < nVertCount; ++i)
-                    vBatchIndices.push_back(static_cast<unsigned int>(nVertOffset + i));
-
-                // 更新位置映射
-                m_IDLocationMap[id] = { key, color, block, nPrimIdxInBlock };
-
-                nVertOffset += nVertCount;
-                nIdxOffset += nVertCount;
-                nAdd++;
+                block->shadow.forEachSpan((run.nBaseVertex + job.nVertOffset) * nStride, job.nVerts * nStride,
+                    [&](unsigned char* pSpan, size_t, size_t nSpan) {
+                        encodeLines(block, view, pLines, nInLine, nSpan / nStride, nRgba, pSpan);
+                    });
             }
+            });
 
-            //  一次性上传
-            if (!vBatchVerts.empty())
+        // 第 5 步：写入暂存区（渲染前统一提交），然后公开新折线的位置
+        writeLock.lock();
+
+        for (IngestRun& run : vRuns)
+        {
+            ColorVBOBlock* block = run.block;
+            size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+            size_t nOffset = run.nBaseVertex * nStride;
+            size_t nBytes = run.nVerts * nStride;
+            block->nEditEpoch++;
+
+            if (block->shadow.isEnabled())
             {
-                GLsizeiptr vertByteOffset = static_cast<GLsizeiptr>(nBaseVertexStart) * 3 * sizeof(float);
-                GLsizeiptr idxByteOffset = static_cast<GLsizeiptr>(nBaseVertexStart) * sizeof(unsigned int);
-
-                // 上传顶点
-                m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-                m_gl->glBufferSubData(GL_ARRAY_BUFFER, vertByteOffset,
-                    static_cast<GLsizeiptr>(vBatchVerts.size() * sizeof(float)), vBatchVerts.data());
-
-                // 上传索引
-                m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-                m_gl->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, idxByteOffset,
-                    static_cast<GLsizeiptr>(vBatchIndices.size() * sizeof(unsigned int)), vBatchIndices.data());
+                block->shadow.forEachSpan(nOffset, nBytes, [&](unsigned char* pSpan, size_t nRangeOffset, size_t nSpan) {
+                    m_pStaging->upload(block->vbo, nOffset + nRangeOffset, pSpan, nSpan);
+                    });
+                continue;
             }
 
-            // 追加图元信息
-            block->vPrimitives.insert(block->vPrimitives.end(),
-                std::make_move_iterator(vNewPrims.begin()),
-                std::make_move_iterator(vNewPrims.end()));
+            m_pStaging->upload(block->vbo, nOffset, run.pEncoded.get(), nBytes);
+            run.pEncoded.reset();
+        }
 
-            // 更新块统计
-            block->nVertexCount += group.totalVerts;
-            block->nIndexCount += group.totalIndices;
-            block->bDirty = true;
+        std::vector<SpatialIndex::Entry> vIndexed;
+        vIndexed.reserve(nAdd);
+        for (const IngestRun& run : vRuns)
+        {
+            for (size_t i = run.nFirst; i < run.nFirst + run.nLines; ++i)
+            {
+                long long id = view.pIds[vSorted[i].nLine];
+                m_ingestingIds.erase(id);
+                m_IDLocationMap.emplace(id, vPending[i]);
+                vIndexed.push_back({ id, vSorted[i].bounds });
+                cacheVertices(run.block, id, vSorted[i].pXyz, view.pVertCounts[vSorted[i].nLine] * 3);
+            }
         }
+        m_spatialIndex.insert(vIndexed);
 
         return nAdd;
     }
 
+    /**
+     * @brief 批量添加多条折线
+     *
+     * 比逐个调用 addPolyline() 快 5~20 倍，专为一次性加载数百万条线设计。
+     * 转成结构数组视图后交给 ingestPolylines()：
+     * - 按颜色并行分组，每个块每段只扩容/上传一次
+     * - 顶点打包和编码在线程池上并行，写锁只覆盖元数据提交
+     * - 不拷贝顶点，GL 调用只在本线程
+     *
+     * @param vPolylineDatas 批量数据：{id, vertices, vertexCount(浮点数个数), color}
+     * @return 添加成功的图元数量（失败的会跳过并打印警告）
+     */
+    size_t PolylinesVboManager::addPolylines(
+        const std::vector<std::tuple<long long, float*, size_t, Color>>& vPolylineDatas)
+    {
+        if (vPolylineDatas.empty() || !m_gl)
+            return 0;
+
+        // 拆成结构数组，顶点仍引用调用方的内存；分组、编码和登记都由 ingestPolylines() 完成
+        const size_t nCount = vPolylineDatas.size();
+        std::vector<long long> vIds(nCount);
+        std::vector<size_t> vVertCounts(nCount);
+        std::vector<const float*> vVertPtrs(nCount);
+        std::vector<Color> vColors(nCount);
+
+        ThreadPool::global().parallelFor(nCount, INGEST_GRAIN, [&](size_t nBegin, size_t nEnd, size_t) {
+            for (size_t i = nBegin; i < nEnd; ++i)
+            {
+                const auto& [id, verts, vertexCount, color] = vPolylineDatas[i]; // tuple 多段线
+                vIds[i] = id;
+                vVertCounts[i] = verts ? vertexCount / 3 : 0;
+                vVertPtrs[i] = verts;
+                vColors[i] = color;
+            }
+            });
+
+        PolylineBatchView view;
+        view.pIds = vIds.data();
+        view.pVertCounts = vVertCounts.data();
+        view.pVertPtrs = vVertPtrs.data();
+        view.pColors = vColors.data();
+        view.nCount = nCount;
+        return ingestPolylines(view);
+    }
+
     /**
      * @brief 从渲染管理器中移除指定ID的折线
      *
-     * 通过ID查找并移除折线，标记为无效并触发后续的内存整理。
-     * 实际的内存释放会在碎片整理时进行，以优化性能。
+     * 通过ID查找并移除折线，顶点区段立即归还给块内的空洞表，供后续新增或更新复用。
+     * 只有空洞占比过高（使用率低于 VboPolicy::fCompactThreshold）时才标记整块压缩。
      *
      * @param id 要移除的折线的唯一标识符
      * @return true 如果成功移除，false 如果折线不存在
@@ -394,6 +733,11 @@ namespace GLRhi
     bool PolylinesVboManager::removePolyline(long long id)
     {
         std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return removePolylineLocked(id);
+    }
+
+    bool PolylinesVboManager::removePolylineLocked(long long id)
+    {
         auto it = m_IDLocationMap.find(id);
         if (it == m_IDLocationMap.end())
             return false;
@@ -402,13 +746,20 @@ namespace GLRhi
         ColorVBOBlock* block = loc.block;
         PrimitiveInfo& prim = block->vPrimitives[loc.nPrimIdx];
 
+        // 顶点区段归还给空洞表，图元位置留给后续新增复用
+        freeVertices(block, static_cast<size_t>(prim.nBaseVertex), prim.nVertexSlot);
+        block->vFreePrimSlots.push_back(loc.nPrimIdx);
+        releaseLod(block, prim);
+
+        prim.id = -1;
         prim.bValid = false;
         prim.nIndexCount = 0;
-        block->bDirty = true;
-        block->bCompact = true;
+        prim.nVertexSlot = 0;
+        syncDrawCmd(block, loc.nPrimIdx);
 
         m_IDLocationMap.erase(it);
-        m_vVertexCache.erase(id);
+        m_vertexCache.erase(id);
+        m_spatialIndex.erase(id);
         block->idToIndexMap.erase(id);
 
         // 立即重新整理VBO数据，确保删除后顶点数据是连续的
@@ -428,23 +779,8 @@ namespace GLRhi
 
         for (long long id : vIds)
         {
-            auto it = m_IDLocationMap.find(id);
-            if (it == m_IDLocationMap.end())
-                continue;
-
-            const Location& loc = it->second;
-            ColorVBOBlock* block = loc.block;
-            PrimitiveInfo& prim = block->vPrimitives[loc.nPrimIdx];
-
-            prim.bValid = false;
-            prim.nIndexCount = 0;
-            block->bDirty = true;
-            block->bCompact = true;
-
-            m_IDLocationMap.erase(it);
-            m_vVertexCache.erase(id);
-            block->idToIndexMap.erase(id);
-            ++nDelCount;
+            if (removePolylineLocked(id))
+                ++nDelCount;
         }
         return nDelCount;
     }
@@ -453,8 +789,9 @@ namespace GLRhi
      * @brief 更新指定ID的折线数据
      *
      * 更新现有折线的顶点数据，根据顶点数量变化采用不同策略：
-     * - 顶点数量变化不大时，直接增量更新
-     * - 顶点数量变化超过50%时，采用删除后重新添加的策略，确保内存使用合理
+     * - 新顶点数不超过原槽位时，直接原地增量更新
+     * - 超过原槽位时，归还旧区段后在块内重新分配（优先复用空洞），图元记录保持不变
+     * - 新顶点超出量化块的包围盒时，从原块删除后重新添加到能容纳它的块
      *
      * @param id 要更新的折线的唯一标识符
      * @param vVerts 新的顶点数据，格式为[x1,y1,z1,x2,y2,z2,...]
@@ -468,6 +805,11 @@ namespace GLRhi
             return false;
 
         std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return updatePolylineLocked(id, vertices, vertexCount);
+    }
+
+    bool PolylinesVboManager::updatePolylineLocked(long long id, const float* vertices, size_t vertexCount)
+    {
         auto it = m_IDLocationMap.find(id);
         if (it == m_IDLocationMap.end())
             return false;
@@ -477,24 +819,47 @@ namespace GLRhi
         size_t nPrimIdx = loc.nPrimIdx;
         PrimitiveInfo& prim = block->vPrimitives[nPrimIdx];
 
-        size_t nOldVertCount = static_cast<size_t>(prim.nIndexCount); // 旧顶点数
         size_t nNewVertCount = vertexCount / 3;
-        if (nNewVertCount > nOldVertCount)
+        QuantBox bounds = VertexCodec::boundsOf(vertices, nNewVertCount);
+        const bool bOutOfBox = VertexCodec::needsBox(block->format) && !block->quantBox.contains(bounds);
+        const bool bOutOfTile = block->nTile != TileGrid::NO_TILE &&
+            block->nTile != TileGrid::keyOf(bounds, m_fTileSize);
+        if (bOutOfBox || bOutOfTile)
         {
-            Color c = loc.color;
-            lock.unlock();
-            removePolyline(id);
-            return addPolyline(id, vertices, vertexCount, c);
+            // 超出块包围盒或移到了其它瓦片：迁移到合适的块
+            Color color = loc.color;
+            removePolylineLocked(id);
+            return addPolylineLocked(id, vertices, vertexCount, color);
+        }
+
+        // 简化层随顶点重新生成，和原始顶点一起放进槽位
+        SimplifiedLine simplified;
+        const bool bLod = simplifyLine(vertices, nNewVertCount, bounds, simplified);
+        const size_t nSlotVerts = nNewVertCount + simplified.levelVerts();
+        releaseLod(block, prim);
+
+        if (nSlotVerts > prim.nVertexSlot)
+        {
+            // 原槽位放不下：先归还旧区段（会与相邻空洞合并），再在同一块内重新分配，
+            // 可能原地向后扩展，也可能落入其他空洞，只有都放不下时才追加到末尾
+            freeVertices(block, static_cast<size_t>(prim.nBaseVertex), prim.nVertexSlot);
+            prim.nBaseVertex = static_cast<GLint>(allocVertices(block, nSlotVerts));
+            prim.nVertexSlot = nSlotVerts;
         }
+        if (bLod)
+            attachLod(block, prim, simplified.lod);
 
         prim.nIndexCount = static_cast<GLsizei>(nNewVertCount);
         prim.bValid = true;
+        prim.bounds = bounds;
+        m_spatialIndex.update(id, prim.bounds);
 
-        // 将顶点数据复制到缓存中
-        m_vVertexCache[id].assign(vertices, vertices + vertexCount);
-        block->bDirty = true;
+        syncDrawCmd(block, nPrimIdx);
 
-        uploadSinglePrimitive(block, nPrimIdx);
+        uploadSinglePrimitive(block, nPrimIdx, vertices, nNewVertCount);
+        if (bLod)
+            uploadSinglePrimitive(block, nPrimIdx, simplified.vXyz.data(), simplified.levelVerts(), nNewVertCount);
+        cacheVertices(block, id, vertices, vertexCount);
         return true;
     }
 
@@ -510,6 +875,11 @@ namespace GLRhi
     bool PolylinesVboManager::setPolylineVisible(long long id, bool bVisible)
     {
         std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return setPolylineVisibleLocked(id, bVisible);
+    }
+
+    bool PolylinesVboManager::setPolylineVisibleLocked(long long id, bool bVisible)
+    {
         auto it = m_IDLocationMap.find(id);
         if (it == m_IDLocationMap.end())
             return false;
@@ -522,7 +892,7 @@ namespace GLRhi
         // bVisible = !bTest;
 
         loc.block->vPrimitives[loc.nPrimIdx].bValid = bVisible;
-        loc.block->bDirty = true;
+        syncDrawCmd(loc.block, loc.nPrimIdx);
         return true;
     }
 
@@ -539,30 +909,153 @@ namespace GLRhi
     void PolylinesVboManager::clearAllPrimitives()
     {
         // stopBackgroundDefrag();
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
         std::unique_lock<std::shared_mutex> lock(m_mutex);
-        for (auto& pair : m_colorBlocksMap)
+
+        // 整理计划指向的块即将删除
+        m_pActivePlan.reset();
         {
-            for (ColorVBOBlock* block : pair.second)
+            std::lock_guard<std::mutex> planLock(m_defragMutex);
+            m_pPendingPlan.reset();
+        }
+        m_bDefragBusy = false;
+
+        forEachBlock([this](ColorVBOBlock* block) {
+            discardStaged(block);
+            if (m_gl)
             {
-                if (m_gl)
-                {
-                    m_gl->glDeleteVertexArrays(1, &block->vao);
-                    m_gl->glDeleteBuffers(1, &block->vbo);
-                    m_gl->glDeleteBuffers(1, &block->ebo);
-                }
-                delete block;
+                m_gl->glDeleteVertexArrays(1, &block->vao);
+                m_gl->glDeleteBuffers(1, &block->vbo);
+                m_gl->glDeleteBuffers(1, &block->vboSpare);
             }
-        }
+            delete block;
+            });
         m_colorBlocksMap.clear();
+        m_vSharedBlocks.clear();
         m_IDLocationMap.clear();
         m_IDLocationMap.reserve(0);
-        m_vVertexCache.clear();
-        m_vVertexCache.reserve(0);
+        m_vertexCache.clear();
+        m_spatialIndex.clear();
+    }
+
+    // ===================================================================
+    // 编辑命令队列（工作线程提交，渲染线程应用）
+    // ===================================================================
+
+    void PolylinesVboManager::enqueueAdd(long long id, std::vector<float> vertices, const Color& color)
+    {
+        PolylineCommand cmd;
+        cmd.type = PolylineCommand::Type::Add;
+        cmd.id = id;
+        cmd.vVerts = std::move(vertices);
+        cmd.color = color;
+        m_commandQueue.push(std::move(cmd));
+        m_nEnqueued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void PolylinesVboManager::enqueueUpdate(long long id, std::vector<float> vertices)
+    {
+        PolylineCommand cmd;
+        cmd.type = PolylineCommand::Type::Update;
+        cmd.id = id;
+        cmd.vVerts = std::move(vertices);
+        m_commandQueue.push(std::move(cmd));
+        m_nEnqueued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void PolylinesVboManager::enqueueRemove(long long id)
+    {
+        PolylineCommand cmd;
+        cmd.type = PolylineCommand::Type::Remove;
+        cmd.id = id;
+        m_commandQueue.push(std::move(cmd));
+        m_nEnqueued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void PolylinesVboManager::enqueueVisible(long long id, bool bVisible)
+    {
+        PolylineCommand cmd;
+        cmd.type = PolylineCommand::Type::SetVisible;
+        cmd.id = id;
+        cmd.bVisible = bVisible;
+        m_commandQueue.push(std::move(cmd));
+        m_nEnqueued.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t PolylinesVboManager::drainCommands()
+    {
+        if (!m_gl)
+            return 0;
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return drainCommandsLocked();
+    }
+
+    /**
+     * @brief 取出并应用队列中的全部命令
+     *
+     * 生产者只碰无锁队列，从不持有 m_mutex，所以渲染线程在这里不会等待生产者。
+     * 命令按入队顺序逐条应用，其间新入队的命令也会一并取出。
+     *
+     * @return 本次取出的命令数量
+     */
+    size_t PolylinesVboManager::drainCommandsLocked()
+    {
+        if (m_commandQueue.sizeApprox() == 0)
+        {
+            m_queueStats.nLastDrained = 0;
+            m_queueStats.dLastDrainMs = 0.0;
+            return 0;
+        }
+
+        auto tStart = std::chrono::steady_clock::now();
+
+        size_t nDrained = 0;
+        PolylineCommand cmd;
+        while (m_commandQueue.tryPop(cmd))
+        {
+            ++nDrained;
+            if (applyCommand(cmd))
+                m_queueStats.nApplied++;
+            else
+                m_queueStats.nRejected++;
+        }
+
+        m_queueStats.nLastDrained = nDrained;
+        m_queueStats.dLastDrainMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - tStart).count();
+        return nDrained;
+    }
+
+    bool PolylinesVboManager::applyCommand(PolylineCommand& cmd)
+    {
+        switch (cmd.type)
+        {
+        case PolylineCommand::Type::Add:
+        {
+            if (cmd.vVerts.size() < 6)
+                return false;
+
+            // 生产者之间无法得知ID是否已存在，重复添加按更新处理，最后提交的数据生效
+            if (m_ingestingIds.count(cmd.id))
+                return false;
+            if (m_IDLocationMap.count(cmd.id))
+                return updatePolylineLocked(cmd.id, cmd.vVerts.data(), cmd.vVerts.size());
+            return addPolylineLocked(cmd.id, cmd.vVerts.data(), cmd.vVerts.size(), cmd.color);
+        }
+        case PolylineCommand::Type::Update:
+            if (cmd.vVerts.size() < 6)
+                return false;
+            return updatePolylineLocked(cmd.id, cmd.vVerts.data(), cmd.vVerts.size());
+        case PolylineCommand::Type::Remove:
+            return removePolylineLocked(cmd.id);
+        case PolylineCommand::Type::SetVisible:
+            return setPolylineVisibleLocked(cmd.id, cmd.bVisible);
+        }
+        return false;
     }
 
     // ===================================================================
-    // 渲染核心（最高性能：glMultiDrawElementsBaseVertex）
+    // 渲染核心（最高性能：glMultiDrawArrays / glMultiDrawElementsBaseVertex）
     // ===================================================================
 
     /**
@@ -570,7 +1063,7 @@ namespace GLRhi
      *
      * 这是渲染的核心方法，采用了多项优化技术：
      * - 按颜色分组渲染，减少着色器 uniform 更新和状态切换
-     * - 使用 glDrawElementsBaseVertex 进行高效绘制
+     * - 使用 glDrawArrays（或索引模式下的 glDrawElementsBaseVertex）进行绘制
      * - 延迟重建绘制命令，避免不必要的计算
      * - 自动进行内存碎片整理
      *
@@ -583,19 +1076,81 @@ namespace GLRhi
      * 6. 压缩需要整理的块
      * 7. 绑定块并执行渲染
      *
-     * @note 此方法应在 OpenGL 渲染上下文中调用
+     * @note 此方法应在 OpenGL 渲染上下文中调用。绘制前先应用队列中的编辑命令；
+     *       绘制过程会压缩块、重建绘制命令，因此持有写锁。释放锁后调用期间记录的碎片率告警。
      */
     void PolylinesVboManager::renderVisiblePrimitives()
     {
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
         if (!m_gl)
             return;
 
-        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            drainCommandsLocked();
+            renderBlocks(false);
+        }
+        dispatchFragAlerts();
+    }
+
+    void PolylinesVboManager::renderVisiblePrimitivesEx()
+    {
+        if (!m_gl)
+            return;
+
+        {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            drainCommandsLocked();
+            if (!m_colorBlocksMap.empty() || !m_vSharedBlocks.empty())
+                renderBlocks(true);
+        }
+        dispatchFragAlerts();
+    }
+
+    /**
+     * @brief 按块绘制所有可见折线（调用方已持有锁）
+     *
+     * 先绘制按颜色分组的块（每组一次 glUniform4f），再绘制共享块：
+     * 共享块的颜色来自顶点属性，整块一次多重绘制，与颜色数量无关。
+     *
+     * @param bMultiDraw true 使用 glMultiDraw*，false 逐图元绘制
+     */
+    void PolylinesVboManager::renderBlocks(bool bMultiDraw)
+    {
+        // 提交本帧暂存的编辑，之后整理拷贝读取的是最新内容
+        m_pStaging->flush();
+        stepDefrag();
+
+        size_t nRebuilds = m_cullStats.nRebuilds;
+        m_cullStats = VboCullStats();
+        m_cullStats.nRebuilds = nRebuilds;
+
+        if (m_culler.isEnabled() && m_nIndexCullEpoch != m_culler.epoch())
+        {
+            size_t nBefore = m_culler.getRebuildCount();
+            cullFromIndex();
+            m_cullStats.nRebuilds += m_culler.getRebuildCount() - nBefore;
+            m_nIndexCullEpoch = m_culler.epoch();
+        }
+
+        // 优先使用预先解析的 uniform 位置，未设置程序时才按当前程序查询
+        ProgramUniforms prog = m_programUniforms;
+        if (prog.isValid())
+        {
+            if (m_stateCache)
+                m_stateCache->addSkipped(4); // glGetIntegerv + 3 次 glGetUniformLocation
+        }
+        else
+        {
+            GLint nProg = 0;
+            m_gl->glGetIntegerv(GL_CURRENT_PROGRAM, &nProg);
+            prog = ProgramUniforms::resolve(m_gl, static_cast<GLuint>(nProg));
+        }
+
+        const GLint uColorLoc = prog.nColorLoc;
+        const GLint uQuantLoc = prog.nQuantBoxLoc;
+        const GLint uVertColorLoc = prog.nUseVertexColorLoc;
 
-        GLint nProg = 0;
-        m_gl->glGetIntegerv(GL_CURRENT_PROGRAM, &nProg);
-        GLint uColorLoc = (nProg > 0) ? m_gl->glGetUniformLocation(nProg, "uColor") : -1;
+        const bool bIndexed = m_drawMode.load() == PolylineDrawMode::Indexed;
 
         for (const auto& pair : m_colorBlocksMap)
         {
@@ -604,99 +1159,174 @@ namespace GLRhi
                 continue;
 
             const Color& c = vBlocks[0]->color;
-            if (uColorLoc != -1)
-                m_gl->glUniform4f(uColorLoc, c.r(), c.g(), c.b(), c.a());
+            setUniform4f(uColorLoc, c.r(), c.g(), c.b(), c.a());
 
             for (ColorVBOBlock* block : vBlocks)
-            {
-                if (block->vDrawCounts.empty() && !block->bDirty)
-                    continue;
+                drawBlock(block, uQuantLoc, bIndexed, bMultiDraw);
+        }
 
-                if (block->bDirty)
-                    rebuildDrawCmds(block);
+        if (m_vSharedBlocks.empty())
+            return;
 
-                if (block->bCompact)
-                    compactBlock(block);
+        setUniform1i(uVertColorLoc, 1);
 
-                if (block->vDrawCounts.empty())
-                    continue;
-
-                bindBlock(block);
-
-                for (size_t i = 0; i < block->vDrawCounts.size(); ++i)
-                {
-                    m_gl->glDrawElementsBaseVertex(
-                        GL_LINE_STRIP,
-                        block->vDrawCounts[i],
-                        GL_UNSIGNED_INT,
-                        nullptr,
-                        block->vBaseVertices[i]);
-                }
+        for (ColorVBOBlock* block : m_vSharedBlocks)
+            drawBlock(block, uQuantLoc, bIndexed, bMultiDraw);
 
-                unbindBlock();
-            }
-        }
+        setUniform1i(uVertColorLoc, 0);
     }
 
-    void PolylinesVboManager::renderVisiblePrimitivesEx()
+    /**
+     * @brief 用空间索引生成裁剪列表
+     *
+     * 一次范围查询取出裁剪范围内的全部折线，按所属块收集绘制槽位。
+     * 只处理部分可见且绘制命令有效的块：完全可见或完全不可见的块不需要列表，
+     * 脏块的槽位即将失效，重建后由 ViewCuller::cull() 在块内重新测试。
+     */
+    void PolylinesVboManager::cullFromIndex()
     {
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
-        if (!m_gl || m_colorBlocksMap.empty())
-            return;
-
-        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::unordered_map<ColorVBOBlock*, std::vector<uint32_t>> blockSlots;
+        m_spatialIndex.query(m_culler.getCullRect(), [&](long long id, const QuantBox&) {
+            auto it = m_IDLocationMap.find(id);
+            if (it == m_IDLocationMap.end())
+                return;
 
-        GLint nProg = 0;
-        m_gl->glGetIntegerv(GL_CURRENT_PROGRAM, &nProg);
-        GLint uColorLoc = (nProg > 0) ? m_gl->glGetUniformLocation(nProg, "uColor") : -1;
+            ColorVBOBlock* block = it->second.block;
+            uint32_t nSlot = block->vPrimitives[it->second.nPrimIdx].nDrawSlot;
+            if (nSlot != PrimitiveInfo::NO_DRAW_SLOT && !block->bDirty)
+                blockSlots[block].push_back(nSlot);
+            });
 
-        //static std::vector<const void*> vOffsets(100000, nullptr);
+        const float fMaxTolerance = m_fSimplifyPixels * m_culler.getPixelLevel();
+        forEachBlock([&](ColorVBOBlock* block) {
+            if (block->bDirty || block->vDrawCounts.empty() || coverageOf(block) != ViewCuller::Coverage::Partial)
+                return;
 
-        for (const auto& pair : m_colorBlocksMap)
-        {
-            const auto& vBlocks = pair.second;
-            if (vBlocks.empty())
-                continue;
+            m_culler.assign(*block, blockSlots[block], LevelPicker{ block, fMaxTolerance });
+            });
+    }
 
-            const Color& c = vBlocks[0]->color;
-            if (uColorLoc != -1)
-                m_gl->glUniform4f(uColorLoc, c.r(), c.g(), c.b(), c.a());
+    /**
+     * @brief 绘制单个块
+     *
+     * 需要时先压缩再重建绘制命令（压缩会改变 basevertex），然后设置反量化参数并绘制。
+     *
+     * @param block 目标块
+     * @param uQuantLoc uQuantBox 的 uniform 位置
+     * @param bIndexed 是否使用共享索引缓冲区绘制
+     * @param bMultiDraw 是否使用多重绘制
+     */
+    void PolylinesVboManager::drawBlock(ColorVBOBlock* block, GLint uQuantLoc, bool bIndexed, bool bMultiDraw)
+    {
+        // 分帧整理启动后由 stepDefrag() 按预算压缩，这里不再整块同步压缩
+        if (block->bCompact && !m_bDefragEnabled.load(std::memory_order_relaxed))
+            compactBlock(block);
 
-            for (ColorVBOBlock* block : vBlocks)
-            {
-                if (block->bDirty)
-                    rebuildDrawCmds(block);
+        if (block->bDirty)
+            rebuildDrawCmds(block);
 
-                if (block->bCompact)
-                    compactBlock(block);
+        if (block->vDrawCounts.empty())
+            return;
 
-                if (block->vDrawCounts.empty())
-                    continue;
+        // 视口裁剪：整块不可见时跳过，部分可见时使用缓存的裁剪列表
+        const GLsizei* pCounts = block->vDrawCounts.data();
+        const GLint* pBaseVertices = block->vBaseVertices.data();
+        GLsizei nPrimCount = static_cast<GLsizei>(block->vDrawCounts.size());
+        m_cullStats.nPrimsTotal += block->vDrawCounts.size();
 
-                bindBlock(block);
+        if (m_culler.isEnabled())
+        {
+            switch (coverageOf(block))
+            {
+            case ViewCuller::Coverage::Outside:
+                m_cullStats.nBlocksSkipped++;
+                return;
+            case ViewCuller::Coverage::Inside:
+                m_cullStats.nBlocksFull++;
+                break;
+            case ViewCuller::Coverage::Partial:
+            {
+                size_t nRebuilds = m_culler.getRebuildCount();
+                const CulledDraws& culled = m_culler.cull(*block,
+                    LevelPicker{ block, m_fSimplifyPixels * m_culler.getPixelLevel() });
+                m_cullStats.nRebuilds += m_culler.getRebuildCount() - nRebuilds;
+                m_cullStats.nBlocksCulled++;
+                m_cullStats.nPrimsLod += culled.nLodDropped;
+                m_cullStats.nPrimsSimplified += culled.nSimplified;
+                if (culled.vDrawCounts.empty())
+                    return;
+
+                pCounts = culled.vDrawCounts.data();
+                pBaseVertices = culled.vBaseVertices.data();
+                nPrimCount = static_cast<GLsizei>(culled.vDrawCounts.size());
+                break;
+            }
+            }
+        }
+        m_cullStats.nPrimsDrawn += static_cast<size_t>(nPrimCount);
 
-                GLsizei nPrimCount = static_cast<GLsizei>(block->vDrawCounts.size());
+        if (uQuantLoc != -1)
+        {
+            float vQuant[4];
+            VertexCodec::dequantParams(block->format, block->quantBox, vQuant);
+            setUniform4f(uQuantLoc, vQuant[0], vQuant[1], vQuant[2], vQuant[3]);
+        }
 
-                static thread_local std::vector<const void*> g_nullPointers;
-                if (g_nullPointers.size() < 200000)
-                    g_nullPointers.assign(200000, nullptr);
+        if (!bIndexed)
+        {
+            // 折线顶点在块内连续存放，first = basevertex，不需要索引
+            bindBlock(block);
+            if (bMultiDraw)
+            {
+                m_gl->glMultiDrawArrays(
+                    GL_LINE_STRIP,
+                    pBaseVertices,  // first[]
+                    pCounts,        // count[]
+                    nPrimCount);
+            }
+            else
+            {
+                for (GLsizei i = 0; i < nPrimCount; ++i)
+                    m_gl->glDrawArrays(GL_LINE_STRIP, pBaseVertices[i], pCounts[i]);
+            }
+            unbindBlock();
+            return;
+        }
 
-                // 构造一个全是 nullptr 的指针数组
-                // 因为使用的是相对索引（0,1,2,...），所有 draw command 的 index offset 都是 0
-                const void** ptrs = g_nullPointers.data();
+        ensureRampEbo(static_cast<size_t>(block->nMaxDrawCount));
+        bindBlock(block);
+        bindRampEbo();
 
-                m_gl->glMultiDrawElementsBaseVertex(
+        if (bMultiDraw)
+        {
+            // 偏移数组只在索引模式下维护，刚切换到索引模式时补齐一次
+            if (block->vIndexOffsets.size() != block->vDrawCounts.size())
+                block->vIndexOffsets.resize(block->vDrawCounts.size(), nullptr);
+
+            // 所有 draw command 共用递增索引（0,1,2,...），index offset 都是 0，裁剪后数量只少不多
+            m_gl->glMultiDrawElementsBaseVertex(
+                GL_LINE_STRIP,
+                pCounts,                        // nCount[]
+                GL_UNSIGNED_INT,
+                block->vIndexOffsets.data(),    // [nullptr, nullptr, ...]，长度 >= primCount
+                nPrimCount,                     // draw command 数量
+                pBaseVertices                   // basevertex[]
+            );
+        }
+        else
+        {
+            for (GLsizei i = 0; i < nPrimCount; ++i)
+            {
+                m_gl->glDrawElementsBaseVertex(
                     GL_LINE_STRIP,
-                    block->vDrawCounts.data(), // nCount[]
+                    pCounts[i],
                     GL_UNSIGNED_INT,
-                    ptrs,               // 必须是 [nullptr, nullptr, ...]，长度 = primCount
-                    nPrimCount,                 // draw command 数量
-                    block->vBaseVertices.data() // basevertex[]
-                );
-
-                unbindBlock();
+                    nullptr,
+                    pBaseVertices[i]);
             }
         }
+
+        unbindBlock();
     }
 
     // ===================================================================
@@ -710,244 +1340,393 @@ namespace GLRhi
      * 这是实现颜色分组渲染优化的关键方法。
      *
      * @param color 要查找的颜色
+     * @param nNeedVerts 需要的顶点数，优先选择空洞能容纳它的块
+     * @param bounds 需要容纳的范围（仅 Half2 / Int16Quant 块检查）
+     * @param nTile 瓦片键，只在该瓦片的块中查找；TileGrid::NO_TILE 表示按颜色分块
      * @return 指向ColorVBOBlock的指针，如果无法创建则返回nullptr
      */
-    ColorVBOBlock* PolylinesVboManager::getColorBlock(const Color& color)
+    ColorVBOBlock* PolylinesVboManager::getColorBlock(const Color& color, size_t nNeedVerts,
+        const QuantBox& bounds, uint32_t nTile)
     {
-        uint32_t nKey = color.toUInt32();
-        auto& vBlocks = m_colorBlocksMap[nKey];
+        // 共享块模式下不区分颜色；块列表按瓦片键有序，只看同一瓦片的块
+        auto& vBlocks = (m_colorStorage == ColorStorage::PerVertex) ?
+            m_vSharedBlocks : m_colorBlocksMap[color.toUInt32()];
+        auto range = std::equal_range(vBlocks.begin(), vBlocks.end(), nTile, TileGrid::BlockOrder());
+
+        // 先找能直接放进空洞的块，不增加高水位线
+        if (nNeedVerts > 0)
+        {
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (blockAccepts(*it, bounds) && (*it)->vertAllocator.getLargestHole() >= nNeedVerts)
+                    return *it;
+            }
+        }
 
-        for (ColorVBOBlock* b : vBlocks)
+        // 块大小按字节限制，紧凑格式的块能容纳更多顶点
+        for (auto it = range.first; it != range.second; ++it)
         {
-            if (b->nVertexCount + 5000 < MAX_VERT_PER_BLOCK)
+            ColorVBOBlock* b = *it;
+            size_t nMaxVerts = m_policy.maxBytesPerBlock() / VertexCodec::stride(b->format, b->bVertexColor);
+            if (blockAccepts(b, bounds) && b->nVertexCount + 5000 < nMaxVerts)
                 return b;
         }
 
-        return createNewColorBlock(color);
+        return createNewColorBlock(color, bounds, nTile);
+    }
+
+    bool PolylinesVboManager::blockAccepts(const ColorVBOBlock* block, const QuantBox& bounds) const
+    {
+        if (block->format != m_vertexFormat)
+            return false;
+
+        return !VertexCodec::needsBox(block->format) || block->quantBox.contains(bounds);
+    }
+
+    uint32_t PolylinesVboManager::tileOf(const QuantBox& bounds) const
+    {
+        if (m_blockPlacement != BlockPlacement::ByTile)
+            return TileGrid::NO_TILE;
+
+        return TileGrid::keyOf(bounds, m_fTileSize);
     }
 
     /**
      * @brief 创建新的颜色VBO块
      *
      * 分配并初始化一个新的ColorVBOBlock对象，包括：
-     * - 创建OpenGL缓冲区对象（VAO、VBO、EBO）
-     * - 设置初始容量
+     * - 创建OpenGL缓冲区对象（VAO、VBO）
+     * - 设置初始容量和顶点格式（Half2 / Int16Quant 同时确定块包围盒）
      * - 配置顶点属性指针
      * - 将新块添加到颜色映射中
      *
      * @param color 该块的颜色
+     * @param bounds 需要容纳的范围
+     * @param nTile 块所属的瓦片键，块按它有序插入块列表
      * @return 指向新创建的ColorVBOBlock的指针
      */
-    ColorVBOBlock* PolylinesVboManager::createNewColorBlock(const Color& color)
+    ColorVBOBlock* PolylinesVboManager::createNewColorBlock(const Color& color, const QuantBox& bounds, uint32_t nTile)
     {
         ColorVBOBlock* block = new ColorVBOBlock();
+        block->nSerial = m_nNextBlockSerial++;
         block->color = color;
+        block->nTile = nTile;
+        block->format = m_vertexFormat;
+        block->bVertexColor = (m_colorStorage == ColorStorage::PerVertex);
+        if (VertexCodec::needsBox(block->format))
+            block->quantBox = VertexCodec::makeBlockBox(bounds, m_fQuantExtent);
+        if (m_policy.bShadowArena)
+            block->shadow.init(VertexCodec::stride(block->format, block->bVertexColor));
 
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
         m_gl->glGenVertexArrays(1, &block->vao);
         m_gl->glGenBuffers(1, &block->vbo);
-        m_gl->glGenBuffers(1, &block->ebo);
-
-        block->nVertexCapacity = INIT_CAPACITY;
-        block->nIndexCapacity = INIT_CAPACITY;
 
-        m_gl->glBindVertexArray(block->vao);
+        block->nVertexCapacity = m_policy.nInitCapacity;
 
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
         m_gl->glBufferData(GL_ARRAY_BUFFER,
-            static_cast<GLsizeiptr>(INIT_CAPACITY * 3 * sizeof(float)),
-            nullptr, GL_DYNAMIC_DRAW);
-
-        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-        m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-            static_cast<GLsizeiptr>(INIT_CAPACITY * sizeof(unsigned int)),
+            static_cast<GLsizeiptr>(m_policy.nInitCapacity * VertexCodec::stride(block->format, block->bVertexColor)),
             nullptr, GL_DYNAMIC_DRAW);
 
-        m_gl->glEnableVertexAttribArray(0);
-        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
-
-        m_gl->glBindVertexArray(0);
+        setupBlockVao(block);
 
-        m_colorBlocksMap[color.toUInt32()].push_back(block);
+        // 同一瓦片的块按创建顺序排在一起；按颜色分块时瓦片键都是 NO_TILE，等同于追加到末尾
+        auto& vBlocks = block->bVertexColor ? m_vSharedBlocks : m_colorBlocksMap[color.toUInt32()];
+        vBlocks.insert(std::upper_bound(vBlocks.begin(), vBlocks.end(), nTile, TileGrid::BlockOrder()), block);
         return block;
     }
 
     /**
      * @brief 确保VBO块有足够的容量
      *
-     * 检查并在必要时扩容指定的VBO块，以容纳所需的顶点和索引数量。
-     * 如果块空间不足，将重新分配更大的缓冲区并复制现有数据。
+     * 检查并在必要时扩容指定的VBO块，以容纳所需的顶点数量。
+     * 扩容为无损操作：新缓冲区分配后，旧内容通过 glCopyBufferSubData 在GPU端拷贝过去，
+     * 不需要CPU重新上传，也不需要从GPU回读，被LRU淘汰的折线数据同样得以保留。
+     * 影子副本按块追加内存，扩容时不需要处理。
      *
      * @param block 要检查容量的VBO块
      * @param nNeedV 需要的顶点数量
-     * @param nNeedI 需要的索引数量
      */
-    void PolylinesVboManager::checkBlockCapacity(ColorVBOBlock* block, size_t nNeedV, size_t nNeedI)
+    void PolylinesVboManager::checkBlockCapacity(ColorVBOBlock* block, size_t nNeedV)
     {
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
-
-        if (1)
-        {
-            // Grok 优化版
-            if (nNeedV <= block->nVertexCapacity && nNeedI <= block->nIndexCapacity)
-                return;
+        // 批量添加直接在高水位线之后追加，也经过这里
+        block->nEditEpoch++;
+        if (nNeedV <= block->nVertexCapacity)
+            return;
 
-            size_t nNewCap = block->nVertexCapacity * 2;
-            if (nNewCap < nNeedV)
-                nNewCap = nNeedV + GROW_STEP;
+        auto tStart = std::chrono::steady_clock::now();
 
-            block->nVertexCapacity = nNewCap;
-            block->nIndexCapacity = nNewCap;
+        // 暂存的写入指向旧缓冲区，必须在替换前提交
+        m_pStaging->flush();
 
-            // Orphaning：只重新分配，不拷贝旧数据
-            m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-            m_gl->glBufferData(GL_ARRAY_BUFFER,
-                nNewCap * 3 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        size_t nNewCap = block->nVertexCapacity * 2;
+        if (nNewCap < nNeedV)
+            nNewCap = nNeedV + m_policy.nGrowStep;
 
-            m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-            m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                nNewCap * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+        size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+        size_t nUsedVertBytes = block->nVertexCount * nStride;
 
-            // 旧数据全丢！因为我们有 m_vVertexCache 缓存，下次 compact 时会重建
-            block->bCompact = true;  // 强制下次 compact 时重建
+        growBuffer(block->vbo, nUsedVertBytes, nNewCap * nStride);
 
-            return;
-        }
-        else
-        {
-            // 没崩溃过
-            if (nNeedV <= block->nVertexCapacity && nNeedI <= block->nIndexCapacity)
-                return;
+        block->nVertexCapacity = nNewCap;
 
-            size_t nNewV = block->nVertexCapacity;
-            size_t nNewI = block->nIndexCapacity;
+        // 缓冲区对象已替换，VAO 需要重新指向新的 VBO
+        setupBlockVao(block);
 
-            while (nNewV < nNeedV)
-                nNewV += GROW_STEP;
-            while (nNewI < nNeedI)
-                nNewI += GROW_STEP;
+        std::chrono::duration<double, std::milli> dElapsed = std::chrono::steady_clock::now() - tStart;
+        m_growStats.nGrowCount++;
+        m_growStats.nBytesMoved += nUsedVertBytes;
+        m_growStats.dStallMs += dElapsed.count();
+    }
 
-            // 保存旧容量信息，用于后续重新上传数据
-            size_t nOldVertexCount = block->nVertexCount;
-            size_t nOldIndexCount = block->nIndexCount;
+    /**
+     * @brief 无损扩容单个缓冲区
+     *
+     * 使用 GL_COPY_READ_BUFFER / GL_COPY_WRITE_BUFFER 绑定点完成拷贝，
+     * 不会改动当前 VAO 记录的 GL_ELEMENT_ARRAY_BUFFER 绑定。
+     *
+     * @param buffer 要扩容的缓冲区，完成后被替换为新缓冲区
+     * @param nUsedBytes 需要保留的旧数据字节数
+     * @param nNewBytes 新缓冲区的字节数
+     */
+    void PolylinesVboManager::growBuffer(unsigned int& buffer, size_t nUsedBytes, size_t nNewBytes)
+    {
+        unsigned int nNewBuffer = 0;
+        m_gl->glGenBuffers(1, &nNewBuffer);
 
-            block->nVertexCapacity = nNewV;
-            block->nIndexCapacity = nNewI;
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, nNewBuffer);
+        m_gl->glBufferData(GL_COPY_WRITE_BUFFER,
+            static_cast<GLsizeiptr>(nNewBytes), nullptr, GL_DYNAMIC_DRAW);
 
-            // Orphaning 重新分配 - 但这次我们需要重新上传数据
-            m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-            m_gl->glBufferData(GL_ARRAY_BUFFER,
-                static_cast<GLsizeiptr>(nNewV * 3 * sizeof(float)), nullptr, GL_DYNAMIC_DRAW);
+        if (nUsedBytes > 0)
+        {
+            m_gl->glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                0, 0, static_cast<GLsizeiptr>(nUsedBytes));
+            m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
 
-            m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-            m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                static_cast<GLsizeiptr>(nNewI * sizeof(unsigned int)), nullptr, GL_DYNAMIC_DRAW);
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_gl->glDeleteBuffers(1, &buffer);
+        buffer = nNewBuffer;
+    }
 
-            // 重新上传所有图元的数据
-            if (nOldVertexCount > 0)
-            {
-                std::vector<float> allVertices;
-                std::vector<unsigned int> allIndices;
+    /**
+     * @brief 配置块的VAO
+     *
+     * 创建块以及扩容替换缓冲区后调用，保证VAO记录的是当前的VBO。
+     * 块不带 EBO：索引模式下绘制前由 bindRampEbo() 绑定共享的递增索引缓冲区。
+     *
+     * @param block 目标块
+     */
+    void PolylinesVboManager::setupBlockVao(ColorVBOBlock* block)
+    {
+        m_gl->glBindVertexArray(block->vao);
 
-                allVertices.reserve(nOldVertexCount * 3);
-                allIndices.reserve(nOldIndexCount);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
+        VertexCodec::setupAttrib(m_gl, block->format, block->bVertexColor);
 
-                // 从顶点缓存中收集所有有效图元的数据
-                // 每次扩容就重传整个 block（几百万顶点） !!!!
-                size_t currentBase = 0;
-                for (size_t i = 0; i < block->vPrimitives.size(); ++i)
-                {
-                    const PrimitiveInfo& prim = block->vPrimitives[i];
-                    if (prim.bValid)
-                    {
-                        auto it = m_vVertexCache.find(prim.id);
-                        if (it != m_vVertexCache.end())
-                        {
-                            const std::vector<float>& vertices = it->second;
-                            size_t vertexCount = vertices.size() / 3;
+        m_gl->glBindVertexArray(0);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-                            // 添加顶点数据
-                            allVertices.insert(allVertices.end(), vertices.begin(), vertices.end());
+        if (m_stateCache)
+            m_stateCache->assumeVertexArray(0);
+    }
 
-                            // 添加索引数据
-                            for (size_t j = 0; j < vertexCount; ++j)
-                            {
-                                allIndices.push_back(static_cast<unsigned int>(currentBase + j));
-                            }
+    /**
+     * @brief 在块内分配顶点区段
+     *
+     * @param block 目标块
+     * @param nVertCount 顶点数
+     * @return 区段起始顶点
+     */
+    size_t PolylinesVboManager::allocVertices(ColorVBOBlock* block, size_t nVertCount)
+    {
+        block->nEditEpoch++;
+        size_t nBase = block->vertAllocator.allocate(nVertCount);
+        if (nBase != RangeAllocator::INVALID_OFFSET)
+            return nBase;
 
-                            currentBase += vertexCount;
-                        }
-                    }
-                }
+        checkBlockCapacity(block, block->nVertexCount + nVertCount);
 
-                // 上传重新收集的数据
-                m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-                m_gl->glBufferSubData(GL_ARRAY_BUFFER, 0,
-                    static_cast<GLsizeiptr>(allVertices.size() * sizeof(float)), allVertices.data());
+        nBase = block->nVertexCount;
+        block->nVertexCount += nVertCount;
+        return nBase;
+    }
 
-                m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-                m_gl->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
-                    static_cast<GLsizeiptr>(allIndices.size() * sizeof(unsigned int)), allIndices.data());
-            }
+    /**
+     * @brief 归还顶点区段
+     *
+     * @param block 目标块
+     * @param nBaseVertex 区段起始顶点
+     * @param nVertCount 顶点数
+     */
+    void PolylinesVboManager::freeVertices(ColorVBOBlock* block, size_t nBaseVertex, size_t nVertCount)
+    {
+        if (nVertCount == 0)
             return;
+
+        block->nEditEpoch++;
+        block->vertAllocator.free(nBaseVertex, nVertCount);
+        block->vertAllocator.trimTail(block->nVertexCount);
+
+        // 空洞能被后续新增复用，只有使用率过低时才需要整块压缩
+        size_t nFree = block->vertAllocator.getFreeUnits();
+        block->bCompact = block->nVertexCount > 0 &&
+            double(block->nVertexCount - nFree) / block->nVertexCount < m_policy.fCompactThreshold;
+        checkFragmentation(block);
+    }
+
+    size_t PolylinesVboManager::allocPrimSlot(ColorVBOBlock* block)
+    {
+        if (!block->vFreePrimSlots.empty())
+        {
+            size_t nPrimIdx = block->vFreePrimSlots.back();
+            block->vFreePrimSlots.pop_back();
+            return nPrimIdx;
         }
+
+        block->vPrimitives.emplace_back();
+        return block->vPrimitives.size() - 1;
     }
 
     /**
      * @brief 上传单个折线到VBO块
      *
-     * 将折线数据（顶点和索引）上传到指定的VBO块中，包括：
-     * - 计算顶点和索引的偏移量
-     * - 使用glBufferSubData更新VBO和EBO
-     * - 计算相对索引值
-     * - 更新渲染相关状态
+     * 将调用方传入的顶点写入暂存区，渲染前由 StagingRing::flush() 合并拷贝到VBO块。
+     * 折线按 GL_LINE_STRIP 顺序绘制，不需要生成索引。
      *
      * @param block 目标VBO块
      * @param nPrimIdx 要上传的折线在块中的索引
+     * @param pXyz 顶点数据，格式为[x1,y1,z1,...]
+     * @param nVertCount 顶点数
      */
-    void PolylinesVboManager::uploadSinglePrimitive(ColorVBOBlock* block, size_t nPrimIdx)
+    void PolylinesVboManager::uploadSinglePrimitive(ColorVBOBlock* block, size_t nPrimIdx,
+        const float* pXyz, size_t nVertCount, size_t nFirstVertex)
     {
         const PrimitiveInfo& prim = block->vPrimitives[nPrimIdx];
         if (!prim.bValid)
             return;
 
-        auto it = m_vVertexCache.find(prim.id);
-        if (it == m_vVertexCache.end())
-            return;
+        // 共享块的颜色写入顶点属性，需要取图元自己的颜色
+        Color color = block->color;
+        if (block->bVertexColor)
+        {
+            auto locIt = m_IDLocationMap.find(prim.id);
+            if (locIt != m_IDLocationMap.end())
+                color = locIt->second.color;
+        }
+
+        uploadVertices(block, static_cast<size_t>(prim.nBaseVertex) + nFirstVertex, pXyz, nVertCount, color);
+    }
+
+    /**
+     * @brief 将顶点按块的格式编码后写入暂存区
+     *
+     * 块有影子副本时编码到影子副本，再从影子副本拷贝到暂存区；
+     * 否则直接编码到暂存区预留的内存中，超出暂存区容量时先编码到临时数组再上传。
+     * 共享块在每个顶点的位置之后写入 RGBA8 颜色。
+     *
+     * @param block 目标块
+     * @param nBaseVertex 起始顶点
+     * @param pXyz 顶点数据，格式为[x1,y1,z1,...]
+     * @param nVertCount 顶点数
+     * @param color 折线颜色（仅共享块使用）
+     */
+    void PolylinesVboManager::uploadVertices(ColorVBOBlock* block, size_t nBaseVertex,
+        const float* pXyz, size_t nVertCount, const Color& color)
+    {
+        block->nEditEpoch++;
 
-        const std::vector<float>& vVerts = it->second;
-        size_t nVertCount = vVerts.size() / 3;
+        size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+        size_t nBytes = nVertCount * nStride;
+        size_t nOffset = nBaseVertex * nStride;
 
-        GLsizeiptr nVertOffset = static_cast<GLsizeiptr>(prim.nBaseVertex) * 3 * sizeof(float);
-        GLsizeiptr nIdxOffset = static_cast<GLsizeiptr>(prim.nBaseVertex) * sizeof(unsigned int);
+        auto encodeTo = [&](unsigned char* pDst) {
+            VertexCodec::encode(block->format, block->quantBox, pXyz, nVertCount, pDst, nStride);
+            if (block->bVertexColor)
+                VertexCodec::writeColor(pDst + VertexCodec::stride(block->format), nStride, nVertCount, color.toUInt32());
+            };
 
-        // 顶点
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+        if (block->shadow.isEnabled())
+        {
+            block->shadow.forEachSpan(nOffset, nBytes, [&](unsigned char* pSpan, size_t nRangeOffset, size_t nSpan) {
+                size_t nFirst = nRangeOffset / nStride;
+                size_t nCount = nSpan / nStride;
+                VertexCodec::encode(block->format, block->quantBox, pXyz + nFirst * 3, nCount, pSpan, nStride);
+                if (block->bVertexColor)
+                    VertexCodec::writeColor(pSpan + VertexCodec::stride(block->format), nStride, nCount, color.toUInt32());
+                m_pStaging->upload(block->vbo, nOffset + nRangeOffset, pSpan, nSpan);
+                });
+            return;
+        }
 
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-        m_gl->glBufferSubData(GL_ARRAY_BUFFER, nVertOffset,
-            static_cast<GLsizeiptr>(vVerts.size() * sizeof(float)), vVerts.data());
+        void* pDst = m_pStaging->reserve(block->vbo, nOffset, nBytes);
+        if (pDst)
+        {
+            encodeTo(static_cast<unsigned char*>(pDst));
+            return;
+        }
 
-        // 索引
-        std::vector<unsigned int> vIndices(nVertCount);
-        for (size_t i = 0; i < nVertCount; ++i)
-            vIndices[i] = static_cast<unsigned int>(prim.nBaseVertex + i);
+        std::vector<unsigned char> vEncoded(nBytes);
+        encodeTo(vEncoded.data());
+        m_pStaging->upload(block->vbo, nOffset, vEncoded.data(), nBytes);
+    }
 
-        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-        m_gl->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, nIdxOffset,
-            static_cast<GLsizeiptr>(vIndices.size() * sizeof(unsigned int)), vIndices.data());
+    /**
+     * @brief 把批量导入的折线按块的格式连续编码
+     *
+     * 折线在输入中不连续（按颜色分桶后交错），用游标逐条编码到目标内存，不经过中间数组。
+     * 目标可能被影子副本的分段边界切开，pLine / nInLine 记录编码到的位置，下一次调用从这里继续。
+     * 带简化层的折线在原始顶点之后接着编码简化层，nInLine 超过原始顶点数时指向简化层。
+     * 只读块的格式信息，可在工作线程调用。
+     *
+     * @param block 目标块
+     * @param view 输入视图
+     * @param pLine 游标：当前折线，编码后前移
+     * @param nInLine 游标：当前折线内已编码的顶点数
+     * @param nVerts 本次编码的顶点数
+     * @param nRgba 折线颜色（仅共享块使用）
+     * @param pDst 目标内存
+     */
+    void PolylinesVboManager::encodeLines(const ColorVBOBlock* block, const PolylineBatchView& view,
+        const IngestLine*& pLine, size_t& nInLine, size_t nVerts, uint32_t nRgba, unsigned char* pDst)
+    {
+        size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+        while (nVerts > 0)
+        {
+            size_t nCount = view.pVertCounts[pLine->nLine];
+            size_t nTotal = ingestVerts(view, *pLine);
+            const bool bLevels = nInLine >= nCount;
+            const float* pSrc = bLevels ? pLine->pLod->vXyz.data() + (nInLine - nCount) * 3 : pLine->pXyz + nInLine * 3;
+            size_t n = std::min((bLevels ? nTotal : nCount) - nInLine, nVerts);
+
+            VertexCodec::encode(block->format, block->quantBox, pSrc, n, pDst, nStride);
+            if (block->bVertexColor)
+                VertexCodec::writeColor(pDst + VertexCodec::stride(block->format), nStride, n, nRgba);
+
+            pDst += n * nStride;
+            nVerts -= n;
+            nInLine += n;
+            if (nInLine == nTotal)
+            {
+                ++pLine;
+                nInLine = 0;
+            }
+        }
     }
 
     /**
      * @brief 压缩VBO块，整理内存碎片
      *
      * 当块中存在被删除的折线时，此方法负责：
-     * - 移除无效的折线数据
-     * - 重新组织顶点和索引数据以消除空洞
-     * - 更新所有受影响的折线的基础顶点偏移
-     * - 重置缓冲区大小为实际使用大小
+     * - 在CPU端规划存活折线的搬运区段（只涉及图元元数据，不读取顶点）
+     * - 用 glCopyBufferSubData 把存活顶点批量拷贝到备用缓冲区，然后交换两个缓冲区
+     * - 更新所有受影响的折线的基础顶点偏移，移除已删除图元的记录
      * - 重新生成绘制命令
      *
+     * 隐藏的折线（bValid == false 但 nIndexCount > 0）同样保留。
+     *
      * @param block 要压缩的VBO块
      */
     void PolylinesVboManager::compactBlock(ColorVBOBlock* block)
@@ -955,189 +1734,946 @@ namespace GLRhi
         if (!block->bCompact || block->nVertexCount == 0)
             return;
 
-        std::vector<float> newVerts;
-        std::vector<unsigned int> newIndices;
-        newVerts.reserve(block->nVertexCount * 3 * 3 / 4);  // 预估 75% 存活
-        newIndices.reserve(block->nVertexCount);
+        // 暂存的写入指向旧缓冲区，必须在搬运前提交
+        m_pStaging->flush();
 
-        size_t currentBase = 0;
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+        DefragPlan plan;
+        buildCompactPlan(block, plan);
+
+        size_t nMoved = plan.vertMoves.compactBuffer(m_gl, block->vbo, block->vboSpare, plan.nVertexBytes);
+        setupBlockVao(block);
+
+        m_compactStats.nCompactCount++;
+        m_compactStats.nCopyCalls += plan.vertMoves.getRangeCount();
+        m_compactStats.nBytesMoved += nMoved;
+        block->nCompactBytes += nMoved;
+
+        applyCompactPlan(block, plan);
+    }
+
+    /**
+     * @brief 生成块的压缩计划
+     *
+     * 存活折线（连同简化层）按 vPrimitives 的顺序依次紧密排列，相邻折线的搬运区段自动合并。
+     * 只读取图元元数据，可以在后台线程持有读锁时调用。
+     *
+     * @param block 目标块
+     * @param plan 输出的计划
+     */
+    void PolylinesVboManager::buildCompactPlan(const ColorVBOBlock* block, DefragPlan& plan) const
+    {
+        const size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
 
-        for (PrimitiveInfo& prim : block->vPrimitives)
+        plan.nBlockSerial = block->nSerial;
+        plan.nEditEpoch = block->nEditEpoch;
+        plan.vRelocations.reserve(block->vPrimitives.size() - block->vFreePrimSlots.size());
+
+        size_t nCurrentBase = 0;
+        for (size_t i = 0; i < block->vPrimitives.size(); ++i)
         {
-            if (!prim.bValid || prim.nIndexCount <= 1)
+            const PrimitiveInfo& prim = block->vPrimitives[i];
+            if (prim.nIndexCount <= 0)
                 continue;
 
-            // Step 1: 先尝试从缓存拿（最快）
-            auto cacheIt = m_vVertexCache.find(prim.id);
-            const std::vector<float>* vertsPtr = nullptr;
-            std::vector<float> tempVerts;
+            size_t nCount = primVerts(block, prim);
+            plan.vertMoves.addRange(static_cast<size_t>(prim.nBaseVertex) * nStride, nCurrentBase * nStride, nCount * nStride);
+            plan.vRelocations.push_back({ i, nCurrentBase, 0 });
+            nCurrentBase += nCount;
+        }
 
-            if (cacheIt != m_vVertexCache.end())
-            {
-                vertsPtr = &cacheIt->second;
-            }
-            else
-            {
-                // Step 2: 缓存没了？从当前 VBO 里把旧数据读回来！（关键兜底！）
-                // 这才是真正的「数据永不丢失」
-                size_t oldOffset = static_cast<size_t>(prim.nBaseVertex);
-                size_t vertCount = static_cast<size_t>(prim.nIndexCount);
-
-                tempVerts.resize(vertCount * 3);
-                m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-                m_gl->glGetBufferSubData(GL_ARRAY_BUFFER,
-                    oldOffset * 3 * sizeof(float),
-                    vertCount * 3 * sizeof(float),
-                    tempVerts.data());
-
-                vertsPtr = &tempVerts;
-
-                // 可选：重新放回缓存（防止下次又读）
-                // m_vVertexCache[prim.id] = std::move(tempVerts);
-                // touchCache(prim.id);
-            }
+        plan.nVertexCount = nCurrentBase;
+        plan.nVertexBytes = block->nVertexCapacity * nStride;
+    }
 
-            const auto& verts = *vertsPtr;
-            size_t nCount = verts.size() / 3;
+    /**
+     * @brief 按重定位表改写块的图元信息
+     *
+     * 缓冲区已经交换为压缩后的内容。只保留重定位表中的图元，更新ID映射，
+     * 清空空洞表并标记绘制命令需要重建。
+     *
+     * @param block 目标块
+     * @param plan 已执行的计划
+     */
+    void PolylinesVboManager::applyCompactPlan(ColorVBOBlock* block, const DefragPlan& plan)
+    {
+        // 影子副本按相同的区段在CPU端重排
+        block->shadow.compact(plan.vertMoves,
+            plan.nVertexCount * VertexCodec::stride(block->format, block->bVertexColor));
 
-            // 写入新缓冲区
-            newVerts.insert(newVerts.end(), verts.begin(), verts.end());
-            for (size_t i = 0; i < nCount; ++i)
-                newIndices.push_back(static_cast<unsigned int>(currentBase + i));
+        std::vector<PrimitiveInfo> vLivePrims;
+        vLivePrims.reserve(plan.vRelocations.size());
+        block->idToIndexMap.clear();
 
-            // 更新 base vertex
-            prim.nBaseVertex = static_cast<GLint>(currentBase);
-            currentBase += nCount;
+        for (const DefragRelocation& reloc : plan.vRelocations)
+        {
+            size_t nNewIdx = vLivePrims.size();
+            vLivePrims.push_back(block->vPrimitives[reloc.nPrimIdx]);
+            PrimitiveInfo& prim = vLivePrims.back();
+            prim.nBaseVertex = static_cast<GLint>(reloc.nNewBaseVertex);
+            prim.nVertexSlot = primVerts(block, prim);
+
+            block->idToIndexMap[prim.id] = nNewIdx;
+            auto locIt = m_IDLocationMap.find(prim.id);
+            if (locIt != m_IDLocationMap.end())
+                locIt->second.nPrimIdx = nNewIdx;
         }
 
-        // 一次性上传新数据
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-        m_gl->glBufferData(GL_ARRAY_BUFFER,
-            block->nVertexCapacity * 3 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
-        m_gl->glBufferSubData(GL_ARRAY_BUFFER, 0,
-            newVerts.size() * sizeof(float), newVerts.data());
-
-        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-        m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-            block->nIndexCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
-        m_gl->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
-            newIndices.size() * sizeof(unsigned int), newIndices.data());
-
-        // 更新统计
-        block->nVertexCount = currentBase;
-        block->nIndexCount = currentBase;
+        // 压缩后没有空洞
+        block->vPrimitives.swap(vLivePrims);
+        block->vFreePrimSlots.clear();
+        block->vertAllocator.reset();
+        block->nVertexCount = plan.nVertexCount;
+        block->nEditEpoch++;
+        block->nCompactCount++;
+        block->bFragAlerted = false;
         block->bCompact = false;
         block->bDirty = true;
     }
 
+    /**
+     * @brief 重建块的绘制命令
+     *
+     * 命令数组按可见图元数精确定长，容量在多次重建之间保留，稳定状态下不再分配内存。
+     *
+     * @param block 目标块
+     */
     void PolylinesVboManager::rebuildDrawCmds(ColorVBOBlock* block)
     {
-        block->vDrawCounts.clear();
-        block->vBaseVertices.clear();
-
+        size_t nDrawCount = 0;
         for (const PrimitiveInfo& prim : block->vPrimitives)
         {
             if (prim.bValid && prim.nIndexCount > 0)
+                nDrawCount++;
+        }
+
+        block->vDrawCounts.resize(nDrawCount);
+        block->vBaseVertices.resize(nDrawCount);
+        block->vDrawPrims.resize(nDrawCount);
+        block->nMaxDrawCount = 0;
+        block->bounds = QuantBox();
+        block->nDrawEpoch++;
+
+        uint32_t nSlot = 0;
+        for (size_t i = 0; i < block->vPrimitives.size(); ++i)
+        {
+            PrimitiveInfo& prim = block->vPrimitives[i];
+            if (!prim.bValid || prim.nIndexCount <= 0)
             {
-                block->vDrawCounts.push_back(prim.nIndexCount);
-                block->vBaseVertices.push_back(prim.nBaseVertex);
+                prim.nDrawSlot = PrimitiveInfo::NO_DRAW_SLOT;
+                continue;
             }
+
+            block->vDrawCounts[nSlot] = prim.nIndexCount;
+            block->vBaseVertices[nSlot] = prim.nBaseVertex;
+            block->vDrawPrims[nSlot] = static_cast<uint32_t>(i);
+            block->nMaxDrawCount = std::max(block->nMaxDrawCount, prim.nIndexCount);
+            block->bounds.expand(prim.bounds);
+            prim.nDrawSlot = nSlot++;
         }
 
+        if (m_drawMode.load() == PolylineDrawMode::Indexed)
+            block->vIndexOffsets.assign(nDrawCount, nullptr);
+        else
+            block->vIndexOffsets.clear();
+
         block->bDirty = false;
     }
 
-    void PolylinesVboManager::touchCache(long long id)
+    /**
+     * @brief 增量维护单个图元的绘制命令
+     *
+     * 命令顺序不影响绘制结果，删除时把最后一条命令搬到空出的位置，
+     * 通过 vDrawPrims 反向索引修正被搬动图元的 nDrawSlot，显隐切换和删除都是 O(1)。
+     * nMaxDrawCount 只增不减，删除后可能偏大，仅让共享索引缓冲区多保留一些索引。
+     * 块包围盒同样只增不减，删除后偏大只会让裁剪少跳过一些块。
+     *
+     * @param block 目标块
+     * @param nPrimIdx 图元在块中的索引
+     */
+    void PolylinesVboManager::syncDrawCmd(ColorVBOBlock* block, size_t nPrimIdx)
     {
-        m_vertexCacheOrder.remove(id);
-        m_vertexCacheOrder.push_front(id);
-        if (m_vertexCacheOrder.size() > MAX_CACHE_SIZE)
+        if (block->bDirty)
+            return;
+
+        PrimitiveInfo& prim = block->vPrimitives[nPrimIdx];
+        const bool bDraw = prim.bValid && prim.nIndexCount > 0;
+        const bool bIndexOffsets = !block->vIndexOffsets.empty() || m_drawMode.load() == PolylineDrawMode::Indexed;
+
+        block->nDrawEpoch++;
+        if (bDraw)
+            block->bounds.expand(prim.bounds);
+
+        if (bDraw && prim.nDrawSlot != PrimitiveInfo::NO_DRAW_SLOT)
+        {
+            // 原地改写（更新后顶点数或位置变化）
+            block->vDrawCounts[prim.nDrawSlot] = prim.nIndexCount;
+            block->vBaseVertices[prim.nDrawSlot] = prim.nBaseVertex;
+            block->nMaxDrawCount = std::max(block->nMaxDrawCount, prim.nIndexCount);
+            return;
+        }
+
+        if (bDraw)
+        {
+            prim.nDrawSlot = static_cast<uint32_t>(block->vDrawCounts.size());
+            block->vDrawCounts.push_back(prim.nIndexCount);
+            block->vBaseVertices.push_back(prim.nBaseVertex);
+            block->vDrawPrims.push_back(static_cast<uint32_t>(nPrimIdx));
+            block->nMaxDrawCount = std::max(block->nMaxDrawCount, prim.nIndexCount);
+            if (bIndexOffsets)
+                block->vIndexOffsets.resize(block->vDrawCounts.size(), nullptr);
+            return;
+        }
+
+        if (prim.nDrawSlot == PrimitiveInfo::NO_DRAW_SLOT)
+            return;
+
+        // swap-remove：最后一条命令填到空位
+        uint32_t nSlot = prim.nDrawSlot;
+        uint32_t nLast = static_cast<uint32_t>(block->vDrawCounts.size() - 1);
+        if (nSlot != nLast)
         {
-            long long old = m_vertexCacheOrder.back();
-            m_vertexCacheOrder.pop_back();
-            m_vVertexCache.erase(old);
+            block->vDrawCounts[nSlot] = block->vDrawCounts[nLast];
+            block->vBaseVertices[nSlot] = block->vBaseVertices[nLast];
+            block->vDrawPrims[nSlot] = block->vDrawPrims[nLast];
+            block->vPrimitives[block->vDrawPrims[nSlot]].nDrawSlot = nSlot;
         }
+
+        block->vDrawCounts.pop_back();
+        block->vBaseVertices.pop_back();
+        block->vDrawPrims.pop_back();
+        if (bIndexOffsets)
+            block->vIndexOffsets.resize(block->vDrawCounts.size(), nullptr);
+
+        prim.nDrawSlot = PrimitiveInfo::NO_DRAW_SLOT;
     }
 
-    void PolylinesVboManager::bindBlock(ColorVBOBlock* block)
+    /**
+     * @brief 确保共享的递增索引缓冲区足够长
+     *
+     * 索引模式下所有块共用一份 0,1,2,... 索引，长度只取决于最长的折线，
+     * 而不是像每块一个 EBO 那样与顶点数等量增长。只在渲染线程中调用。
+     *
+     * @param nCount 需要的索引数量
+     */
+    void PolylinesVboManager::ensureRampEbo(size_t nCount)
     {
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
-        m_gl->glBindVertexArray(block->vao);
+        if (nCount <= m_nRampCount && m_nRampEbo)
+            return;
+
+        size_t nNewCount = std::max(nCount, m_nRampCount * 2);
+        if (nNewCount < RAMP_MIN_COUNT)
+            nNewCount = RAMP_MIN_COUNT;
+
+        std::vector<unsigned int> vRamp(nNewCount);
+        for (size_t i = 0; i < nNewCount; ++i)
+            vRamp[i] = static_cast<unsigned int>(i);
+
+        if (!m_nRampEbo)
+            m_gl->glGenBuffers(1, &m_nRampEbo);
+
+        // 用 COPY_WRITE 绑定点上传，不影响当前 VAO 的 ELEMENT_ARRAY_BUFFER 绑定
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, m_nRampEbo);
+        m_gl->glBufferData(GL_COPY_WRITE_BUFFER,
+            static_cast<GLsizeiptr>(nNewCount * sizeof(unsigned int)), vRamp.data(), GL_STATIC_DRAW);
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        m_nRampCount = nNewCount;
     }
 
-    void PolylinesVboManager::unbindBlock()
+    void PolylinesVboManager::bindRampEbo()
     {
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
-        m_gl->glBindVertexArray(0);
+        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_nRampEbo);
     }
 
-    void PolylinesVboManager::startBackgroundDefrag()
+    void PolylinesVboManager::setDrawMode(PolylineDrawMode mode)
     {
-        if (1)
-        {
-            m_bStopDefrag = false;
-            m_defragThread = std::thread([this] {
-                while (!m_bStopDefrag)
-                {
-                    //std::this_thread::sleep_for(std::chrono::seconds(5));
-                    for (int i = 0; i < 30 && !m_bStopDefrag.load(); ++i)
-                    {
-                        std::this_thread::sleep_for(std::chrono::milliseconds(300));
-                        if (m_bStopDefrag)
-                            return;
-                    }
+        m_drawMode.store(mode);
+    }
 
-                    std::shared_lock lock(m_mutex);
-                    for (auto& pair : m_colorBlocksMap)
-                    {
-                        for (ColorVBOBlock* block : pair.second)
-                        {
-                            // 只有使用率 < 50% 才值得整理
-                            if (block->bCompact && block->nVertexCount > 0)
-                            {
-                                double dUsage = double(block->nVertexCount) / block->nVertexCapacity;
-                                if (dUsage < 0.7)
-                                {
-                                    lock.unlock();
-                                    std::unique_lock writeLock(m_mutex);
-                                    compactBlock(block);
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                }
-                });
+    PolylineDrawMode PolylinesVboManager::getDrawMode() const
+    {
+        return m_drawMode.load();
+    }
+
+    void PolylinesVboManager::setVertexFormat(VertexFormat format)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_vertexFormat = format;
+    }
+
+    VertexFormat PolylinesVboManager::getVertexFormat() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_vertexFormat;
+    }
+
+    void PolylinesVboManager::setColorStorage(ColorStorage storage)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_colorStorage = storage;
+    }
+
+    ColorStorage PolylinesVboManager::getColorStorage() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_colorStorage;
+    }
+
+    void PolylinesVboManager::setBlockPlacement(BlockPlacement placement)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_blockPlacement = placement;
+    }
+
+    BlockPlacement PolylinesVboManager::getBlockPlacement() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_blockPlacement;
+    }
+
+    void PolylinesVboManager::setTileSize(float fTileSize)
+    {
+        if (fTileSize <= 0.0f)
+            return;
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_fTileSize = fTileSize;
+    }
+
+    float PolylinesVboManager::getTileSize() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_fTileSize;
+    }
+
+    void PolylinesVboManager::setProgram(const ProgramUniforms& prog)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_programUniforms = prog;
+    }
+
+    void PolylinesVboManager::setStateCache(GLStateCache* cache)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_stateCache = cache;
+    }
+
+    void PolylinesVboManager::discardStaged(const ColorVBOBlock* block)
+    {
+        m_pStaging->discard(block->vbo);
+        m_pStaging->discard(block->vboSpare);
+    }
+
+    void PolylinesVboManager::setStagingRing(StagingRing* pRing)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        StagingRing* pNext = pRing ? pRing : &m_ownStaging;
+        if (pNext == m_pStaging)
+            return;
+
+        // 已暂存的写入先提交，之后不会再经由原暂存区提交
+        m_pStaging->flush();
+        if (m_pStaging == &m_ownStaging)
+            m_ownStaging.destroy();
+        else if (pNext == &m_ownStaging && QOpenGLContext::currentContext())
+            m_ownStaging.initialize(QOpenGLContext::currentContext());
+        m_pStaging = pNext;
+    }
+
+    void PolylinesVboManager::setViewRect(const QuantBox& viewRect)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_culler.setViewRect(viewRect);
+    }
+
+    void PolylinesVboManager::setCullMargin(float fMargin)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_culler.setMargin(fMargin);
+    }
+
+    void PolylinesVboManager::setLod(ViewCuller::LodMode mode, float fMinPixels)
+    {
+        // 合并后的代表图元只画第一段线段（2 个顶点）
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_culler.setLod(mode, fMinPixels, 2);
+    }
+
+    ViewCuller::LodMode PolylinesVboManager::getLodMode() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_culler.getLodMode();
+    }
+
+    void PolylinesVboManager::setPixelSize(float fWorldPerPixel)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_culler.setPixelSize(fWorldPerPixel);
+    }
+
+    void PolylinesVboManager::setSimplification(bool bEnable, float fPixelTolerance)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_bSimplify = bEnable;
+        if (fPixelTolerance > 0.0f)
+            m_fSimplifyPixels = fPixelTolerance;
+        m_culler.setPixelLevels(bEnable);
+    }
+
+    bool PolylinesVboManager::getSimplification() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_bSimplify;
+    }
+
+    bool PolylinesVboManager::simplifyLine(const float* pXyz, size_t nVertCount, const QuantBox& bounds,
+        SimplifiedLine& out) const
+    {
+        return m_bSimplify && LineSimplifier::simplify(pXyz, nVertCount, bounds, out);
+    }
+
+    void PolylinesVboManager::attachLod(ColorVBOBlock* block, PrimitiveInfo& prim, const PolylineLod& lod)
+    {
+        if (block->vFreeLods.empty())
+        {
+            prim.nLod = static_cast<uint32_t>(block->vLods.size());
+            block->vLods.push_back(lod);
         }
         else
         {
-            if (m_defragThread.joinable())
-                return;
+            prim.nLod = block->vFreeLods.back();
+            block->vFreeLods.pop_back();
+            block->vLods[prim.nLod] = lod;
+        }
+        block->nLodPrims++;
+    }
 
-            m_bStopDefrag = false;
-            m_defragThread = std::thread([this] {
-                while (!m_bStopDefrag.load())
-                {
-                    // 50次 × 300毫秒 / 次 = 15000毫秒 = 15秒
-                    for (int i = 0; i < 30 && !m_bStopDefrag.load(); ++i)
-                        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    void PolylinesVboManager::releaseLod(ColorVBOBlock* block, PrimitiveInfo& prim)
+    {
+        if (prim.nLod == PrimitiveInfo::NO_LOD)
+            return;
+
+        block->vFreeLods.push_back(prim.nLod);
+        block->nLodPrims--;
+        prim.nLod = PrimitiveInfo::NO_LOD;
+    }
+
+    size_t PolylinesVboManager::primVerts(const ColorVBOBlock* block, const PrimitiveInfo& prim)
+    {
+        size_t nVerts = static_cast<size_t>(prim.nIndexCount);
+        if (prim.nLod != PrimitiveInfo::NO_LOD)
+            nVerts += block->vLods[prim.nLod].levelVerts();
+        return nVerts;
+    }
+
+    size_t PolylinesVboManager::ingestVerts(const PolylineBatchView& view, const IngestLine& line)
+    {
+        return view.pVertCounts[line.nLine] + (line.pLod ? line.pLod->levelVerts() : 0);
+    }
+
+    ViewCuller::Coverage PolylinesVboManager::coverageOf(const ColorVBOBlock* block) const
+    {
+        ViewCuller::Coverage coverage = m_culler.classify(block->bounds);
+        if (coverage == ViewCuller::Coverage::Inside && block->nLodPrims > 0 && m_culler.getPixelLevel() > 0.0f)
+            return ViewCuller::Coverage::Partial;
+        return coverage;
+    }
+
+    /**
+     * @brief 为图元选层
+     *
+     * 选容差不超过允许值的最粗一层，改写为该层的顶点数和起始顶点；没有合适的层时保持原始顶点。
+     */
+    bool PolylinesVboManager::LevelPicker::operator()(uint32_t nPrimIdx, GLsizei& nCount, GLint& nBase) const
+    {
+        const PrimitiveInfo& prim = block->vPrimitives[nPrimIdx];
+        if (prim.nLod == PrimitiveInfo::NO_LOD || fMaxTolerance <= 0.0f)
+            return false;
+
+        const PolylineLod& lod = block->vLods[prim.nLod];
+        int nLevel = LineSimplifier::selectLevel(lod, fMaxTolerance);
+        if (nLevel < 0)
+            return false;
+
+        nCount = static_cast<GLsizei>(lod.vCount[nLevel]);
+        nBase += static_cast<GLint>(lod.vOffset[nLevel]);
+        return true;
+    }
+
+    VboCullStats PolylinesVboManager::getCullStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_cullStats;
+    }
+
+    void PolylinesVboManager::setQuantExtent(float fExtent)
+    {
+        if (fExtent <= 0.0f)
+            return;
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_fQuantExtent = fExtent;
+    }
+
+    void PolylinesVboManager::cacheVertices(const ColorVBOBlock* block, long long id,
+        const float* vertices, size_t vertexCount)
+    {
+        if (block->shadow.isEnabled())
+            return;
+
+        m_vertexCache.put(id, std::vector<float>(vertices, vertices + vertexCount), vertexCount * sizeof(float));
+    }
+
+    /**
+     * @brief 读取折线的顶点
+     *
+     * 块有影子副本时直接从影子副本解码，不涉及GPU。
+     * 否则先查缓存，未命中时提交暂存区，再用 glGetBufferSubData 回读该折线的顶点区段，
+     * 按块的存储格式解码后放回缓存。回读会让CPU等待GPU，次数记录在 VboCacheStats::nReadbacks。
+     * 回读需要在渲染线程调用（当前上下文有效）。
+     */
+    bool PolylinesVboManager::getPolyline(long long id, std::vector<float>& vVerts)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return readPolylineLocked(id, vVerts);
+    }
+
+    bool PolylinesVboManager::readPolylineLocked(long long id, std::vector<float>& vVerts)
+    {
+        auto it = m_IDLocationMap.find(id);
+        if (it == m_IDLocationMap.end())
+            return false;
+
+        const ColorVBOBlock* block = it->second.block;
+        const PrimitiveInfo& prim = block->vPrimitives[it->second.nPrimIdx];
+        size_t nVertCount = static_cast<size_t>(prim.nIndexCount);
+        size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+        size_t nBytes = nVertCount * nStride;
+
+        std::vector<unsigned char> vEncoded(nBytes);
+        vVerts.resize(nVertCount * 3);
+
+        if (block->shadow.isEnabled())
+        {
+            block->shadow.read(static_cast<size_t>(prim.nBaseVertex) * nStride, vEncoded.data(), nBytes);
+            VertexCodec::decode(block->format, block->quantBox, vEncoded.data(), nVertCount, vVerts.data(), nStride);
+            return true;
+        }
+
+        if (const std::vector<float>* pCached = m_vertexCache.find(id))
+        {
+            vVerts = *pCached;
+            return true;
+        }
+
+        if (!m_gl)
+            return false;
+
+        // 该折线可能还有未提交的写入
+        m_pStaging->flush();
+
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, block->vbo);
+        m_gl->glGetBufferSubData(GL_COPY_READ_BUFFER,
+            static_cast<GLintptr>(static_cast<size_t>(prim.nBaseVertex) * nStride),
+            static_cast<GLsizeiptr>(nBytes), vEncoded.data());
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        VertexCodec::decode(block->format, block->quantBox, vEncoded.data(), nVertCount, vVerts.data(), nStride);
+
+        m_nReadbacks++;
+        m_nReadbackBytes += nBytes;
+        cacheVertices(block, id, vVerts.data(), vVerts.size());
+        return true;
+    }
+
+    size_t PolylinesVboManager::queryPolylines(const QuantBox& rect, std::vector<long long>& vIds) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_spatialIndex.query(rect, vIds);
+    }
+
+    /**
+     * @brief 拾取最近的可见折线
+     *
+     * 空间索引按包围盒距离由近到远给出候选，只有包围盒距离小于当前最优值的折线才读取顶点、
+     * 计算点到各线段的精确距离，通常只需读取少数几条折线。
+     */
+    bool PolylinesVboManager::pickPolyline(float x, float y, float fMaxDist, long long& id, float* pDist)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+        std::vector<float> vVerts;
+        auto fnDist = [&](long long nCandidate) {
+            auto it = m_IDLocationMap.find(nCandidate);
+            if (it == m_IDLocationMap.end() ||
+                !it->second.block->vPrimitives[it->second.nPrimIdx].bValid ||
+                !readPolylineLocked(nCandidate, vVerts))
+                return std::numeric_limits<float>::infinity();
+
+            float fBest2 = std::numeric_limits<float>::infinity();
+            for (size_t i = 0; i + 5 < vVerts.size(); i += 3)
+            {
+                float ax = vVerts[i], ay = vVerts[i + 1];
+                float dx = vVerts[i + 3] - ax, dy = vVerts[i + 4] - ay;
+                float fLen2 = dx * dx + dy * dy;
+                float t = fLen2 > 0.0f ? std::clamp(((x - ax) * dx + (y - ay) * dy) / fLen2, 0.0f, 1.0f) : 0.0f;
+                float ex = ax + t * dx - x, ey = ay + t * dy - y;
+                fBest2 = std::min(fBest2, ex * ex + ey * ey);
+            }
+            return std::sqrt(fBest2);
+            };
+
+        return m_spatialIndex.nearest(x, y, fMaxDist, fnDist, id, pDist);
+    }
+
+    VboCacheStats PolylinesVboManager::getCacheStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        VboCacheStats stats = m_vertexCache.getStats();
+        stats.nReadbacks = m_nReadbacks;
+        stats.nReadbackBytes = m_nReadbackBytes;
+        return stats;
+    }
+
+    void PolylinesVboManager::bindBlock(ColorVBOBlock* block)
+    {
+        if (m_stateCache)
+            m_stateCache->bindVertexArray(block->vao);
+        else
+            m_gl->glBindVertexArray(block->vao);
+    }
+
+    void PolylinesVboManager::unbindBlock()
+    {
+        if (!m_stateCache)
+            m_gl->glBindVertexArray(0);
+    }
 
+    void PolylinesVboManager::setUniform4f(GLint nLoc, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const
+    {
+        if (nLoc < 0)
+            return;
+
+        if (m_stateCache)
+            m_stateCache->uniform4f(nLoc, x, y, z, w);
+        else
+            m_gl->glUniform4f(nLoc, x, y, z, w);
+    }
+
+    void PolylinesVboManager::setUniform1i(GLint nLoc, GLint v) const
+    {
+        if (nLoc < 0)
+            return;
+
+        if (m_stateCache)
+            m_stateCache->uniform1i(nLoc, v);
+        else
+            m_gl->glUniform1i(nLoc, v);
+    }
+
+    VboGrowStats PolylinesVboManager::getGrowStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_growStats;
+    }
+
+    void PolylinesVboManager::resetGrowStats()
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_growStats = VboGrowStats{};
+    }
+
+    VboCompactStats PolylinesVboManager::getCompactStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_compactStats;
+    }
+
+    StagingStats PolylinesVboManager::getStagingStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_pStaging->getStats();
+    }
+
+    VboQueueStats PolylinesVboManager::getQueueStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        VboQueueStats stats = m_queueStats;
+        stats.nEnqueued = m_nEnqueued.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    /**
+     * @brief 启动后台碎片整理
+     *
+     * 压缩需要调用 GL，只能在渲染线程执行，因此整理拆成两部分：
+     * - 后台线程：定期在读锁下为碎片最严重的块生成计划（纯CPU），交给渲染线程
+     * - 渲染线程：stepDefrag() 每帧在预算内执行拷贝，完成后交换缓冲区
+     * 同一时刻最多只有一个计划，执行完或作废后才规划下一个。
+     */
+    void PolylinesVboManager::startBackgroundDefrag()
+    {
+        if (m_defragThread.joinable())
+            return;
+
+        m_bStopDefrag = false;
+        m_bDefragEnabled = true;
+        m_defragThread = std::thread([this] {
+            int nIntervalMs = 0;
+            {
+                std::shared_lock<std::shared_mutex> lock(m_mutex);
+                nIntervalMs = m_policy.defragIntervalMs();
+            }
+
+            while (!m_bStopDefrag)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(nIntervalMs));
+                if (m_bStopDefrag)
+                    return;
+
+                if (m_bDefragBusy.load())
+                    continue;
+
+                std::unique_ptr<DefragPlan> pPlan;
+                {
                     std::shared_lock<std::shared_mutex> lock(m_mutex);
-                    for (auto& pair : m_colorBlocksMap)
-                        for (ColorVBOBlock* b : pair.second)
-                            compactBlock(b);
-                } });
+                    nIntervalMs = m_policy.defragIntervalMs();
+                    pPlan = planDefrag();
+                }
+                if (!pPlan)
+                    continue;
+
+                // 先置忙再提交，渲染线程接收前不会再规划
+                m_bDefragBusy = true;
+                std::lock_guard<std::mutex> planLock(m_defragMutex);
+                m_pPendingPlan = std::move(pPlan);
+            }
+            });
+    }
+
+    /**
+     * @brief 选择碎片最严重的块并生成整理计划
+     *
+     * 评分为空闲顶点占已用范围的比例，只有使用率低于 VboPolicy::fCompactThreshold 的块才是候选。
+     * 调用方已持有读锁，整个过程不调用GL。
+     *
+     * @return 没有需要整理的块时为空
+     */
+    std::unique_ptr<DefragPlan> PolylinesVboManager::planDefrag() const
+    {
+        const ColorVBOBlock* victim = nullptr;
+        double dBestScore = 1.0 - m_policy.fCompactThreshold;
+
+        auto score = [&](const ColorVBOBlock* block) {
+            double dScore = DefragPlan::fragmentation(block->nVertexCount, block->vertAllocator.getFreeUnits());
+            if (dScore > dBestScore)
+            {
+                dBestScore = dScore;
+                victim = block;
+            }
+            };
+        for (const auto& pair : m_colorBlocksMap)
+            for (const ColorVBOBlock* block : pair.second)
+                score(block);
+        for (const ColorVBOBlock* block : m_vSharedBlocks)
+            score(block);
+
+        if (!victim)
+            return nullptr;
+
+        auto pPlan = std::make_unique<DefragPlan>();
+        pPlan->dScore = dBestScore;
+        buildCompactPlan(victim, *pPlan);
+        return pPlan;
+    }
+
+    /**
+     * @brief 在预算内推进整理计划
+     *
+     * 目标块被删除、在规划之后被编辑或整理已停止时，计划作废并释放备用缓冲区的存储；
+     * 后台线程随后按块的最新状态重新规划。
+     */
+    void PolylinesVboManager::stepDefrag()
+    {
+        if (!m_pActivePlan)
+        {
+            if (!m_bDefragBusy.load())
+                return;
+
+            std::lock_guard<std::mutex> planLock(m_defragMutex);
+            m_pActivePlan = std::move(m_pPendingPlan);
+            if (!m_pActivePlan)
+                return;
+            m_compactStats.nPlanned++;
+        }
+
+        DefragPlan& plan = *m_pActivePlan;
+        ColorVBOBlock* block = findBlockBySerial(plan.nBlockSerial);
+        if (!block || block->nEditEpoch != plan.nEditEpoch || !m_bDefragEnabled.load())
+        {
+            if (block && plan.bStarted)
+                VboCompactor::releaseStorage(m_gl, block->vboSpare);
+            m_compactStats.nAborted++;
+            m_pActivePlan.reset();
+            m_bDefragBusy = false;
+            return;
         }
+
+        unsigned int nNoEbo = 0; // 折线块没有索引缓冲区
+        auto tStart = std::chrono::steady_clock::now();
+        size_t nMoved = plan.step(m_gl, block->vbo, block->vboSpare, 0, nNoEbo, m_defragBudget);
+        double dStepMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+        m_compactStats.nBytesMoved += nMoved;
+        block->nCompactBytes += nMoved;
+        m_compactStats.nStepFrames++;
+        m_compactStats.dMaxStepMs = std::max(m_compactStats.dMaxStepMs, dStepMs);
+
+        if (!plan.isFinished())
+            return;
+
+        // 拷贝全部提交：交换缓冲区，旧缓冲区只保留对象名
+        std::swap(block->vbo, block->vboSpare);
+        VboCompactor::releaseStorage(m_gl, block->vboSpare);
+        setupBlockVao(block);
+
+        m_compactStats.nCompactCount++;
+        m_compactStats.nIncremental++;
+        m_compactStats.nCopyCalls += plan.vertMoves.getRangeCount();
+
+        applyCompactPlan(block, plan);
+
+        m_pActivePlan.reset();
+        m_bDefragBusy = false;
+    }
+
+    ColorVBOBlock* PolylinesVboManager::findBlockBySerial(uint64_t nSerial)
+    {
+        ColorVBOBlock* found = nullptr;
+        forEachBlock([&](ColorVBOBlock* block) {
+            if (block->nSerial == nSerial)
+                found = block;
+            });
+        return found;
+    }
+
+    void PolylinesVboManager::setPolicy(const VboPolicy& policy)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_policy = policy;
+        m_vertexCache.setCapacity(m_policy.nCacheBytes);
+    }
+
+    VboPolicy PolylinesVboManager::getPolicy() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_policy;
+    }
+
+    void PolylinesVboManager::setFragmentationAlert(FragmentationAlert callback)
+    {
+        std::lock_guard<std::mutex> alertLock(m_alertMutex);
+        m_fragAlert = std::move(callback);
+    }
+
+    std::vector<VboBlockTelemetry> PolylinesVboManager::getBlockTelemetry() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::vector<VboBlockTelemetry> vTelemetry;
+        forEachBlock([&](const ColorVBOBlock* block) {
+            vTelemetry.push_back(makeTelemetry(block));
+            });
+        return vTelemetry;
+    }
+
+    VboBlockTelemetry PolylinesVboManager::makeTelemetry(const ColorVBOBlock* block) const
+    {
+        VboBlockTelemetry tel;
+        tel.nSerial = block->nSerial;
+        tel.bShared = block->bVertexColor;
+        tel.nColorKey = block->bVertexColor ? 0 : block->color.toUInt32();
+        tel.nVertexStride = VertexCodec::stride(block->format, block->bVertexColor);
+
+        tel.nCapacity = block->nVertexCapacity;
+        tel.nDeadVerts = std::min(block->nVertexCount, block->vertAllocator.getFreeUnits());
+        tel.nLiveVerts = block->nVertexCount - tel.nDeadVerts;
+        tel.nHoleCount = block->vertAllocator.getHoleCount();
+        tel.nLargestHole = block->vertAllocator.getLargestHole();
+        tel.nPrimCount = block->idToIndexMap.size();
+        tel.dFragmentation = DefragPlan::fragmentation(block->nVertexCount, tel.nDeadVerts);
+
+        tel.nCompactCount = block->nCompactCount;
+        tel.nBytesMoved = block->nCompactBytes;
+        tel.nShadowBytes = block->shadow.memoryBytes();
+        return tel;
+    }
+
+    /**
+     * @brief 检查块的碎片率
+     *
+     * 碎片率首次超过 VboPolicy::fFragAlertThreshold 时记录一条告警，之后不再重复告警，直到块被压缩。
+     * 这里持有写锁，回调可能再调用管理器的接口，因此只记录，由 dispatchFragAlerts() 在锁外调用。
+     *
+     * @param block 目标块
+     */
+    void PolylinesVboManager::checkFragmentation(ColorVBOBlock* block)
+    {
+        if (block->bFragAlerted || m_policy.fFragAlertThreshold <= 0.0f)
+            return;
+
+        double dFrag = DefragPlan::fragmentation(block->nVertexCount, block->vertAllocator.getFreeUnits());
+        if (dFrag <= m_policy.fFragAlertThreshold)
+            return;
+
+        block->bFragAlerted = true;
+        std::lock_guard<std::mutex> alertLock(m_alertMutex);
+        m_vFragAlerts.push_back(makeTelemetry(block));
+    }
+
+    /**
+     * @brief 调用已记录的碎片率告警
+     *
+     * 在渲染线程绘制结束、释放写锁之后调用。未设置回调时输出警告。
+     */
+    void PolylinesVboManager::dispatchFragAlerts()
+    {
+        std::vector<VboBlockTelemetry> vAlerts;
+        FragmentationAlert fnAlert;
+        {
+            std::lock_guard<std::mutex> alertLock(m_alertMutex);
+            if (m_vFragAlerts.empty())
+                return;
+            vAlerts.swap(m_vFragAlerts);
+            fnAlert = m_fragAlert;
+        }
+
+        for (const VboBlockTelemetry& tel : vAlerts)
+        {
+            if (fnAlert)
+            {
+                fnAlert(tel);
+                continue;
+            }
+
+            qWarning() << "[PolylinesVboManager] block" << tel.nSerial << "fragmentation" << tel.dFragmentation
+                << "live" << tel.nLiveVerts << "dead" << tel.nDeadVerts
+                << "holes" << tel.nHoleCount << "largestHole" << tel.nLargestHole
+                << "capacity" << tel.nCapacity;
+        }
+    }
+
+    void PolylinesVboManager::setDefragBudget(const DefragBudget& budget)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_defragBudget = budget;
     }
 
     void PolylinesVboManager::stopBackgroundDefrag()
     {
+        // 未完成的计划在下一帧作废，之后绘制时恢复同步压缩
+        m_bDefragEnabled = false;
         m_bStopDefrag = true;
         if (m_defragThread.joinable())
-        {
-            m_bStopDefrag = true;
             m_defragThread.join();
-        }
     }
 } // namespace GLRhi
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "DataManager/RangeAllocator.h"
+
+#include <iterator>
+
+namespace GLRhi
+{
+    size_t RangeAllocator::allocate(size_t nSize)
+    {
+        if (nSize == 0)
+            return INVALID_OFFSET;
+
+        // 大小不小于 nSize 的最小空洞，同样大小时取起点最小的
+        auto it = m_setBySize.lower_bound({ nSize, 0 });
+        if (it == m_setBySize.end())
+            return INVALID_OFFSET;
+
+        size_t nHoleSize = it->first;
+        size_t nOffset = it->second;
+        eraseHole(m_mapByOffset.find(nOffset));
+
+        // 剩余部分放回空闲表
+        if (nHoleSize > nSize)
+            insertHole(nOffset + nSize, nHoleSize - nSize);
+
+        return nOffset;
+    }
+
+    void RangeAllocator::free(size_t nOffset, size_t nSize)
+    {
+        if (nSize == 0)
+            return;
+
+        // 与后一个空洞合并
+        auto next = m_mapByOffset.find(nOffset + nSize);
+        if (next != m_mapByOffset.end())
+        {
+            nSize += next->second;
+            eraseHole(next);
+        }
+
+        // 与前一个空洞合并
+        auto prev = m_mapByOffset.lower_bound(nOffset);
+        if (prev != m_mapByOffset.begin())
+        {
+            --prev;
+            if (prev->first + prev->second == nOffset)
+            {
+                nOffset = prev->first;
+                nSize += prev->second;
+                eraseHole(prev);
+            }
+        }
+
+        insertHole(nOffset, nSize);
+    }
+
+    bool RangeAllocator::trimTail(size_t& nEnd)
+    {
+        if (m_mapByOffset.empty())
+            return false;
+
+        auto last = std::prev(m_mapByOffset.end());
+        if (last->first + last->second != nEnd)
+            return false;
+
+        nEnd = last->first;
+        eraseHole(last);
+        return true;
+    }
+
+    void RangeAllocator::reset()
+    {
+        m_mapByOffset.clear();
+        m_setBySize.clear();
+        m_nFreeUnits = 0;
+    }
+
+    size_t RangeAllocator::getLargestHole() const
+    {
+        return m_setBySize.empty() ? 0 : m_setBySize.rbegin()->first;
+    }
+
+    void RangeAllocator::insertHole(size_t nOffset, size_t nSize)
+    {
+        m_mapByOffset.emplace(nOffset, nSize);
+        m_setBySize.emplace(nSize, nOffset);
+        m_nFreeUnits += nSize;
+    }
+
+    void RangeAllocator::eraseHole(std::map<size_t, size_t>::iterator it)
+    {
+        m_setBySize.erase({ it->second, it->first });
+        m_nFreeUnits -= it->second;
+        m_mapByOffset.erase(it);
+    }
+}
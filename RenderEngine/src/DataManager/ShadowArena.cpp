@@ -0,0 +1,68 @@
+#include "DataManager/ShadowArena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace GLRhi
+{
+    void ShadowArena::init(size_t nElemBytes)
+    {
+        m_vChunks.clear();
+        m_nChunkBytes = nElemBytes * ELEMS_PER_CHUNK;
+    }
+
+    void ShadowArena::ensure(size_t nEndBytes)
+    {
+        size_t nNeedChunks = (nEndBytes + m_nChunkBytes - 1) / m_nChunkBytes;
+        while (m_vChunks.size() < nNeedChunks)
+            m_vChunks.emplace_back(new unsigned char[m_nChunkBytes]);
+    }
+
+    void ShadowArena::write(size_t nOffset, const void* pSrc, size_t nBytes)
+    {
+        const unsigned char* pBytes = static_cast<const unsigned char*>(pSrc);
+        forEachSpan(nOffset, nBytes, [&](unsigned char* pData, size_t nRangeOffset, size_t nSpan) {
+            std::memcpy(pData, pBytes + nRangeOffset, nSpan);
+            });
+    }
+
+    void ShadowArena::read(size_t nOffset, void* pDst, size_t nBytes) const
+    {
+        unsigned char* pBytes = static_cast<unsigned char*>(pDst);
+        size_t nDone = 0;
+        while (nDone < nBytes)
+        {
+            size_t nPos = nOffset + nDone;
+            size_t nInChunk = nPos % m_nChunkBytes;
+            size_t nSpan = std::min(nBytes - nDone, m_nChunkBytes - nInChunk);
+            std::memcpy(pBytes + nDone, m_vChunks[nPos / m_nChunkBytes].get() + nInChunk, nSpan);
+            nDone += nSpan;
+        }
+    }
+
+    void ShadowArena::compact(const VboCompactor& moves, size_t nUsedBytes)
+    {
+        if (!isEnabled())
+            return;
+
+        // 区段可能前后交错（图元顺序与布局顺序不同），不能原地移动，拷贝到新块后替换
+        ShadowArena dst;
+        dst.m_nChunkBytes = m_nChunkBytes;
+        dst.ensure(nUsedBytes);
+
+        for (const VboCompactor::CopyRange& range : moves.getRanges())
+        {
+            size_t nSrc = range.nSrcOffset;
+            dst.forEachSpan(range.nDstOffset, range.nSize, [&](unsigned char* pData, size_t nRangeOffset, size_t nSpan) {
+                read(nSrc + nRangeOffset, pData, nSpan);
+                });
+        }
+
+        m_vChunks.swap(dst.m_vChunks);
+    }
+
+    void ShadowArena::clear()
+    {
+        m_vChunks.clear();
+    }
+}
@@ -0,0 +1,436 @@
+#include "DataManager/SpatialIndex.h"
+#include "Common/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace GLRhi
+{
+    namespace
+    {
+        constexpr size_t INSERT_GRAIN = 4096;   // 批量插入时每个区段的图元数
+        constexpr int MAX_GROW = 64;            // 根节点单次最多扩大的次数，超出时图元挂在根节点
+
+        float extentOf(const QuantBox& bounds)
+        {
+            return std::max(bounds.fMaxX - bounds.fMinX, bounds.fMaxY - bounds.fMinY);
+        }
+
+        bool isFiniteBox(const QuantBox& bounds)
+        {
+            return !bounds.isEmpty() &&
+                std::isfinite(bounds.fMinX) && std::isfinite(bounds.fMinY) &&
+                std::isfinite(bounds.fMaxX) && std::isfinite(bounds.fMaxY);
+        }
+
+        // 点到包围盒的距离，点在盒内时为 0
+        float distanceTo(const QuantBox& bounds, float x, float y)
+        {
+            float dx = std::max({ bounds.fMinX - x, 0.0f, x - bounds.fMaxX });
+            float dy = std::max({ bounds.fMinY - y, 0.0f, y - bounds.fMaxY });
+            return std::sqrt(dx * dx + dy * dy);
+        }
+    }
+
+    QuantBox SpatialIndex::Node::looseBounds() const
+    {
+        float fHalf = fSize * 0.5f;
+        QuantBox box;
+        box.fMinX = fMinX - fHalf;
+        box.fMinY = fMinY - fHalf;
+        box.fMaxX = fMinX + fSize + fHalf;
+        box.fMaxY = fMinY + fSize + fHalf;
+        return box;
+    }
+
+    void SpatialIndex::insert(long long id, const QuantBox& bounds)
+    {
+        if (update(id, bounds))
+            return;
+
+        growRoot(bounds);
+        uint32_t nRecord = allocRecord(id, bounds);
+        attach(nRecord, nodeAt(pathOf(bounds)));
+    }
+
+    void SpatialIndex::insert(const std::vector<Entry>& vEntries)
+    {
+        // 已存在的ID按更新处理，新图元先扩大根节点再统一计算落点
+        std::vector<uint32_t> vNew;
+        vNew.reserve(vEntries.size());
+        for (const Entry& entry : vEntries)
+        {
+            if (update(entry.id, entry.bounds))
+                continue;
+
+            // 批内重复的ID只保留第一个
+            if (m_idToRecord.count(entry.id))
+                continue;
+
+            vNew.push_back(allocRecord(entry.id, entry.bounds));
+            growRoot(entry.bounds);
+        }
+
+        if (vNew.empty())
+            return;
+
+        std::vector<Path> vPaths(vNew.size());
+        ThreadPool::global().parallelFor(vNew.size(), INSERT_GRAIN, [&](size_t nBegin, size_t nEnd, size_t) {
+            for (size_t i = nBegin; i < nEnd; ++i)
+                vPaths[i] = pathOf(m_vRecords[vNew[i]].bounds);
+            });
+
+        for (size_t i = 0; i < vNew.size(); ++i)
+            attach(vNew[i], nodeAt(vPaths[i]));
+    }
+
+    bool SpatialIndex::update(long long id, const QuantBox& bounds)
+    {
+        auto it = m_idToRecord.find(id);
+        if (it == m_idToRecord.end())
+            return false;
+
+        uint32_t nRecord = it->second;
+        Record& rec = m_vRecords[nRecord];
+        if (fitsTightly(m_vNodes[rec.nNode], rec.nNode, bounds))
+        {
+            rec.bounds = bounds;
+            return true;
+        }
+
+        detach(nRecord);
+        m_vRecords[nRecord].bounds = bounds;
+        growRoot(bounds);
+        attach(nRecord, nodeAt(pathOf(bounds)));
+        return true;
+    }
+
+    bool SpatialIndex::erase(long long id)
+    {
+        auto it = m_idToRecord.find(id);
+        if (it == m_idToRecord.end())
+            return false;
+
+        uint32_t nRecord = it->second;
+        m_idToRecord.erase(it);
+        detach(nRecord);
+        m_vFreeRecords.push_back(nRecord);
+        return true;
+    }
+
+    void SpatialIndex::clear()
+    {
+        m_vNodes.clear();
+        m_vFreeNodes.clear();
+        m_vRecords.clear();
+        m_vFreeRecords.clear();
+        m_idToRecord.clear();
+        m_nRoot = NO_NODE;
+        m_fMinCell = 0.0f;
+    }
+
+    size_t SpatialIndex::query(const QuantBox& rect, std::vector<long long>& vIds) const
+    {
+        size_t nBefore = vIds.size();
+        query(rect, [&](long long id, const QuantBox&) {
+            vIds.push_back(id);
+            });
+        return vIds.size() - nBefore;
+    }
+
+    bool SpatialIndex::nearest(float x, float y, float fMaxDist, const DistanceFn& fnDist,
+        long long& id, float* pDist) const
+    {
+        if (m_nRoot == NO_NODE || !(fMaxDist >= 0.0f))
+            return false;
+
+        // 候选按下界距离排序；bRecord 为 false 时 nIndex 是节点
+        struct Candidate
+        {
+            float fDist;
+            bool bRecord;
+            uint32_t nIndex;
+            bool operator>(const Candidate& other) const { return fDist > other.fDist; }
+        };
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+        queue.push({ 0.0f, false, m_nRoot });
+
+        float fBest = fMaxDist;
+        bool bFound = false;
+        while (!queue.empty())
+        {
+            Candidate cand = queue.top();
+            queue.pop();
+            if (cand.fDist > fBest)
+                break;
+
+            if (cand.bRecord)
+            {
+                const Record& rec = m_vRecords[cand.nIndex];
+                float fDist = fnDist ? fnDist(rec.id) : cand.fDist;
+                if (fDist <= fBest)
+                {
+                    fBest = fDist;
+                    id = rec.id;
+                    bFound = true;
+                }
+                continue;
+            }
+
+            const Node& node = m_vNodes[cand.nIndex];
+            for (uint32_t nRecord : node.vRecords)
+            {
+                const QuantBox& bounds = m_vRecords[nRecord].bounds;
+                if (bounds.isEmpty())
+                    continue;
+
+                float fDist = distanceTo(bounds, x, y);
+                if (fDist <= fBest)
+                    queue.push({ fDist, true, nRecord });
+            }
+            for (uint32_t nChild : node.vChildren)
+            {
+                if (nChild == NO_NODE || m_vNodes[nChild].nSubtree == 0)
+                    continue;
+
+                float fDist = distanceTo(m_vNodes[nChild].looseBounds(), x, y);
+                if (fDist <= fBest)
+                    queue.push({ fDist, false, nChild });
+            }
+        }
+
+        if (bFound && pDist)
+            *pDist = fBest;
+        return bFound;
+    }
+
+    uint32_t SpatialIndex::allocNode(float fMinX, float fMinY, float fSize, uint32_t nParent)
+    {
+        uint32_t nNode;
+        if (!m_vFreeNodes.empty())
+        {
+            nNode = m_vFreeNodes.back();
+            m_vFreeNodes.pop_back();
+            m_vNodes[nNode] = Node();
+        }
+        else
+        {
+            nNode = static_cast<uint32_t>(m_vNodes.size());
+            m_vNodes.emplace_back();
+        }
+
+        Node& node = m_vNodes[nNode];
+        node.fMinX = fMinX;
+        node.fMinY = fMinY;
+        node.fSize = fSize;
+        node.nParent = nParent;
+        return nNode;
+    }
+
+    uint32_t SpatialIndex::allocRecord(long long id, const QuantBox& bounds)
+    {
+        uint32_t nRecord;
+        if (!m_vFreeRecords.empty())
+        {
+            nRecord = m_vFreeRecords.back();
+            m_vFreeRecords.pop_back();
+        }
+        else
+        {
+            nRecord = static_cast<uint32_t>(m_vRecords.size());
+            m_vRecords.emplace_back();
+        }
+
+        Record& rec = m_vRecords[nRecord];
+        rec.id = id;
+        rec.bounds = bounds;
+        rec.nNode = NO_NODE;
+        rec.nPos = 0;
+        m_idToRecord[id] = nRecord;
+        return nRecord;
+    }
+
+    void SpatialIndex::growRoot(const QuantBox& bounds)
+    {
+        if (!isFiniteBox(bounds))
+        {
+            if (m_nRoot == NO_NODE)
+            {
+                m_nRoot = allocNode(0.0f, 0.0f, 1.0f, NO_NODE);
+                m_fMinCell = std::ldexp(1.0f, -MAX_DEPTH);
+            }
+            return;
+        }
+
+        float cx = (bounds.fMinX + bounds.fMaxX) * 0.5f;
+        float cy = (bounds.fMinY + bounds.fMaxY) * 0.5f;
+        float fExtent = extentOf(bounds);
+
+        if (m_nRoot == NO_NODE)
+        {
+            // 首个图元：根格子取不小于图元尺寸的 2 的幂，最小格子按最大深度推算
+            float fSize = std::exp2(std::ceil(std::log2(std::max(fExtent, 1.0f))));
+            m_nRoot = allocNode(std::floor(cx / fSize) * fSize, std::floor(cy / fSize) * fSize, fSize, NO_NODE);
+            m_fMinCell = std::ldexp(fSize, -MAX_DEPTH);
+            return;
+        }
+
+        for (int i = 0; i < MAX_GROW; ++i)
+        {
+            const Node& root = m_vNodes[m_nRoot];
+            bool bInside = cx >= root.fMinX && cx < root.fMinX + root.fSize &&
+                cy >= root.fMinY && cy < root.fMinY + root.fSize;
+            if (bInside && fExtent <= root.fSize)
+                return;
+
+            // 向图元所在方向扩大一倍，原根节点成为新根的一个象限
+            float fMinX = cx < root.fMinX ? root.fMinX - root.fSize : root.fMinX;
+            float fMinY = cy < root.fMinY ? root.fMinY - root.fSize : root.fMinY;
+            float fSize = root.fSize * 2.0f;
+            int nQuad = (root.fMinX > fMinX ? 1 : 0) | (root.fMinY > fMinY ? 2 : 0);
+            size_t nSubtree = root.nSubtree;
+
+            uint32_t nOld = m_nRoot;
+            m_nRoot = allocNode(fMinX, fMinY, fSize, NO_NODE);
+            m_vNodes[m_nRoot].vChildren[nQuad] = nOld;
+            m_vNodes[m_nRoot].nSubtree = nSubtree;
+            m_vNodes[nOld].nParent = m_nRoot;
+
+            // 原根节点里放不进格子的图元（无效包围盒）随根节点上移
+            Node& oldRoot = m_vNodes[nOld];
+            for (size_t k = 0; k < oldRoot.vRecords.size();)
+            {
+                uint32_t nRecord = oldRoot.vRecords[k];
+                if (fits(oldRoot, NO_NODE, m_vRecords[nRecord].bounds))
+                {
+                    ++k;
+                    continue;
+                }
+                detach(nRecord);
+                attach(nRecord, m_nRoot);
+            }
+        }
+    }
+
+    SpatialIndex::Path SpatialIndex::pathOf(const QuantBox& bounds) const
+    {
+        Path path;
+        if (!isFiniteBox(bounds))
+            return path;
+
+        const Node& root = m_vNodes[m_nRoot];
+        float cx = (bounds.fMinX + bounds.fMaxX) * 0.5f;
+        float cy = (bounds.fMinY + bounds.fMaxY) * 0.5f;
+        float fExtent = extentOf(bounds);
+        if (!fits(root, NO_NODE, bounds))
+            return path;
+
+        float fMinX = root.fMinX;
+        float fMinY = root.fMinY;
+        float fHalf = root.fSize * 0.5f;
+        while (path.nDepth < PATH_LEVELS && fHalf >= fExtent && fHalf >= m_fMinCell)
+        {
+            int nQuad = 0;
+            if (cx >= fMinX + fHalf)
+            {
+                fMinX += fHalf;
+                nQuad |= 1;
+            }
+            if (cy >= fMinY + fHalf)
+            {
+                fMinY += fHalf;
+                nQuad |= 2;
+            }
+            path.nBits = (path.nBits << 2) | static_cast<uint64_t>(nQuad);
+            path.nDepth++;
+            fHalf *= 0.5f;
+        }
+        return path;
+    }
+
+    uint32_t SpatialIndex::nodeAt(const Path& path)
+    {
+        uint32_t nNode = m_nRoot;
+        for (int d = path.nDepth - 1; d >= 0; --d)
+        {
+            int nQuad = static_cast<int>((path.nBits >> (2 * d)) & 3u);
+            uint32_t nChild = m_vNodes[nNode].vChildren[nQuad];
+            if (nChild == NO_NODE)
+            {
+                const Node& node = m_vNodes[nNode];
+                float fHalf = node.fSize * 0.5f;
+                nChild = allocNode(node.fMinX + ((nQuad & 1) ? fHalf : 0.0f),
+                    node.fMinY + ((nQuad & 2) ? fHalf : 0.0f), fHalf, nNode);
+                m_vNodes[nNode].vChildren[nQuad] = nChild;
+            }
+            nNode = nChild;
+        }
+        return nNode;
+    }
+
+    void SpatialIndex::attach(uint32_t nRecord, uint32_t nNode)
+    {
+        Record& rec = m_vRecords[nRecord];
+        Node& node = m_vNodes[nNode];
+        rec.nNode = nNode;
+        rec.nPos = static_cast<uint32_t>(node.vRecords.size());
+        node.vRecords.push_back(nRecord);
+
+        for (uint32_t n = nNode; n != NO_NODE; n = m_vNodes[n].nParent)
+            m_vNodes[n].nSubtree++;
+    }
+
+    void SpatialIndex::detach(uint32_t nRecord)
+    {
+        Record& rec = m_vRecords[nRecord];
+        uint32_t nNode = rec.nNode;
+        Node& node = m_vNodes[nNode];
+
+        uint32_t nLast = node.vRecords.back();
+        node.vRecords[rec.nPos] = nLast;
+        m_vRecords[nLast].nPos = rec.nPos;
+        node.vRecords.pop_back();
+        rec.nNode = NO_NODE;
+
+        for (uint32_t n = nNode; n != NO_NODE; n = m_vNodes[n].nParent)
+            m_vNodes[n].nSubtree--;
+
+        // 回收空节点：子节点已在各自清空时回收，这里只需从父节点摘除
+        while (nNode != m_nRoot && m_vNodes[nNode].nSubtree == 0)
+        {
+            uint32_t nParent = m_vNodes[nNode].nParent;
+            for (uint32_t& nChild : m_vNodes[nParent].vChildren)
+            {
+                if (nChild == nNode)
+                    nChild = NO_NODE;
+            }
+            m_vNodes[nNode].vRecords.clear();
+            m_vNodes[nNode].vRecords.shrink_to_fit();
+            m_vFreeNodes.push_back(nNode);
+            nNode = nParent;
+        }
+    }
+
+    bool SpatialIndex::fits(const Node& node, uint32_t nNode, const QuantBox& bounds) const
+    {
+        if (!isFiniteBox(bounds))
+            return nNode != NO_NODE && nNode == m_nRoot;
+
+        float cx = (bounds.fMinX + bounds.fMaxX) * 0.5f;
+        float cy = (bounds.fMinY + bounds.fMaxY) * 0.5f;
+        return cx >= node.fMinX && cx < node.fMinX + node.fSize &&
+            cy >= node.fMinY && cy < node.fMinY + node.fSize &&
+            extentOf(bounds) <= node.fSize;
+    }
+
+    bool SpatialIndex::fitsTightly(const Node& node, uint32_t nNode, const QuantBox& bounds) const
+    {
+        if (!fits(node, nNode, bounds))
+            return false;
+
+        // 图元缩小到能放进子格子时重新插入，避免大量图元堆在浅层节点
+        float fHalf = node.fSize * 0.5f;
+        return !isFiniteBox(bounds) || extentOf(bounds) > fHalf || fHalf < m_fMinCell;
+    }
+}
@@ -0,0 +1,289 @@
+#include "DataManager/StagingRing.h"
+
+#include <QOpenGLContext>
+#include <QDebug>
+#include <cstring>
+#include <algorithm>
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace GLRhi
+{
+    namespace
+    {
+        // glBufferStorage 不在 3.3 Core 函数表中，需要通过 getProcAddress 获取
+        typedef void (QOPENGLF_APIENTRYP PfnGlBufferStorage)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+        static constexpr GLuint64 FENCE_TIMEOUT_NS = 1'000'000'000; // 单次等待 1 秒
+        static constexpr size_t STAGING_ALIGN = 4;                  // 写入位置按 4 字节对齐（float / uint）
+    }
+
+    bool StagingRing::initialize(QOpenGLContext* context, size_t nCapacity)
+    {
+        if (!context || nCapacity == 0)
+            return false;
+
+        destroy();
+
+        m_gl = context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+        if (!m_gl)
+            return false;
+
+        m_nCapacity = nCapacity;
+        m_gl->glGenBuffers(1, &m_nBuffer);
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, m_nBuffer);
+
+        if (context->hasExtension("GL_ARB_buffer_storage"))
+        {
+            PfnGlBufferStorage glBufferStorage =
+                reinterpret_cast<PfnGlBufferStorage>(context->getProcAddress("glBufferStorage"));
+            if (glBufferStorage)
+            {
+                const GLbitfield nFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                glBufferStorage(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(m_nCapacity), nullptr, nFlags);
+                m_pMapped = static_cast<unsigned char*>(m_gl->glMapBufferRange(GL_COPY_READ_BUFFER,
+                    0, static_cast<GLsizeiptr>(m_nCapacity), nFlags));
+
+                if (!m_pMapped)
+                {
+                    // 不可变存储无法重新指定，换一个缓冲区走 3.3 路径
+                    m_gl->glDeleteBuffers(1, &m_nBuffer);
+                    m_gl->glGenBuffers(1, &m_nBuffer);
+                    m_gl->glBindBuffer(GL_COPY_READ_BUFFER, m_nBuffer);
+                }
+            }
+        }
+
+        if (!m_pMapped)
+        {
+            m_gl->glBufferData(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(m_nCapacity), nullptr, GL_STREAM_DRAW);
+            m_vCpuStaging.resize(m_nCapacity);
+        }
+
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        qDebug() << "[StagingRing] initialize:" << m_nCapacity << "bytes,"
+            << (m_pMapped ? "persistent mapped" : "map range fallback");
+        return true;
+    }
+
+    void StagingRing::destroy()
+    {
+        if (!m_gl)
+            return;
+
+        m_vPending.clear();
+        for (InFlightRegion& region : m_inFlight)
+            m_gl->glDeleteSync(region.fence);
+        m_inFlight.clear();
+
+        if (m_nBuffer)
+        {
+            if (m_pMapped)
+            {
+                m_gl->glBindBuffer(GL_COPY_READ_BUFFER, m_nBuffer);
+                m_gl->glUnmapBuffer(GL_COPY_READ_BUFFER);
+                m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            }
+            m_gl->glDeleteBuffers(1, &m_nBuffer);
+        }
+
+        m_nBuffer = 0;
+        m_pMapped = nullptr;
+        m_vCpuStaging.clear();
+        m_vCpuStaging.shrink_to_fit();
+        m_nCapacity = 0;
+        m_nHead = 0;
+        m_nFrameBegin = 0;
+    }
+
+    void* StagingRing::reserve(unsigned int nDstBuffer, size_t nDstOffset, size_t nSize)
+    {
+        if (!m_nBuffer || nSize == 0 || nSize > m_nCapacity)
+            return nullptr;
+
+        size_t nSrcOffset = allocate(nSize);
+
+        // 与上一次写入在暂存区和目标缓冲区上都首尾相接时合并为一次拷贝
+        if (!m_vPending.empty())
+        {
+            PendingCopy& last = m_vPending.back();
+            if (last.nDstBuffer == nDstBuffer &&
+                last.nSrcOffset + last.nSize == nSrcOffset &&
+                last.nDstOffset + last.nSize == nDstOffset)
+            {
+                last.nSize += nSize;
+                m_stats.nStagedBytes += nSize;
+                return writePointer(nSrcOffset);
+            }
+        }
+
+        m_vPending.push_back({ nDstBuffer, nSrcOffset, nDstOffset, nSize });
+        m_stats.nStagedBytes += nSize;
+        return writePointer(nSrcOffset);
+    }
+
+    void StagingRing::upload(unsigned int nDstBuffer, size_t nDstOffset, const void* pData, size_t nSize)
+    {
+        if (nSize == 0 || !pData)
+            return;
+
+        void* pDst = reserve(nDstBuffer, nDstOffset, nSize);
+        if (pDst)
+        {
+            std::memcpy(pDst, pData, nSize);
+            return;
+        }
+
+        if (!m_gl)
+            return;
+
+        // 超出暂存区容量：先提交之前的写入，保证写入顺序，再直接上传
+        flush();
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, nDstBuffer);
+        m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(nDstOffset),
+            static_cast<GLsizeiptr>(nSize), pData);
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_stats.nDirectBytes += nSize;
+    }
+
+    void StagingRing::flush()
+    {
+        if (m_vPending.empty() || !m_gl)
+            return;
+
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, m_nBuffer);
+
+        // 3.3 路径：本帧的暂存区段一次映射写入
+        if (!m_pMapped && m_nHead > m_nFrameBegin)
+        {
+            GLsizeiptr nLen = static_cast<GLsizeiptr>(m_nHead - m_nFrameBegin);
+            void* pDst = m_gl->glMapBufferRange(GL_COPY_READ_BUFFER,
+                static_cast<GLintptr>(m_nFrameBegin), nLen,
+                GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            if (pDst)
+            {
+                std::memcpy(pDst, m_vCpuStaging.data() + m_nFrameBegin, static_cast<size_t>(nLen));
+                m_gl->glUnmapBuffer(GL_COPY_READ_BUFFER);
+            }
+            else
+            {
+                m_gl->glBufferSubData(GL_COPY_READ_BUFFER, static_cast<GLintptr>(m_nFrameBegin),
+                    nLen, m_vCpuStaging.data() + m_nFrameBegin);
+            }
+        }
+
+        unsigned int nBoundDst = 0;
+        for (const PendingCopy& copy : m_vPending)
+        {
+            if (copy.nDstBuffer != nBoundDst)
+            {
+                m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, copy.nDstBuffer);
+                nBoundDst = copy.nDstBuffer;
+            }
+
+            m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                static_cast<GLintptr>(copy.nSrcOffset),
+                static_cast<GLintptr>(copy.nDstOffset),
+                static_cast<GLsizeiptr>(copy.nSize));
+        }
+
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+        InFlightRegion region;
+        region.nBegin = m_nFrameBegin;
+        region.nEnd = m_nHead;
+        region.fence = m_gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_inFlight.push_back(region);
+
+        m_stats.nCopyCalls += m_vPending.size();
+        m_stats.nFlushCount++;
+
+        m_vPending.clear();
+        m_nFrameBegin = m_nHead;
+
+        retireSignaled();
+    }
+
+    void StagingRing::discard()
+    {
+        // 已写入的暂存空间直接作废，下次从当前位置继续
+        m_vPending.clear();
+        m_nFrameBegin = m_nHead;
+    }
+
+    void StagingRing::discard(unsigned int nDstBuffer)
+    {
+        // 暂存空间不回收，下次 flush() 时随本帧区段一起受栅栏保护
+        m_vPending.erase(std::remove_if(m_vPending.begin(), m_vPending.end(),
+            [nDstBuffer](const PendingCopy& copy) { return copy.nDstBuffer == nDstBuffer; }),
+            m_vPending.end());
+    }
+
+    size_t StagingRing::allocate(size_t nSize)
+    {
+        m_nHead = (m_nHead + STAGING_ALIGN - 1) & ~(STAGING_ALIGN - 1);
+
+        // 不跨越末尾：先提交本帧已暂存的数据，再回绕到起点
+        if (m_nHead + nSize > m_nCapacity)
+        {
+            flush();
+            m_nHead = 0;
+            m_nFrameBegin = 0;
+        }
+
+        waitForRange(m_nHead, m_nHead + nSize);
+
+        size_t nOffset = m_nHead;
+        m_nHead += nSize;
+        return nOffset;
+    }
+
+    void StagingRing::waitForRange(size_t nBegin, size_t nEnd)
+    {
+        // 区段按提交顺序排列，回绕后写入位置单调前进，只需检查最早的区段
+        while (!m_inFlight.empty())
+        {
+            InFlightRegion& region = m_inFlight.front();
+            if (region.nEnd <= nBegin || region.nBegin >= nEnd)
+                break;
+
+            GLenum nResult = m_gl->glClientWaitSync(region.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+            while (nResult == GL_TIMEOUT_EXPIRED)
+                nResult = m_gl->glClientWaitSync(region.fence, 0, FENCE_TIMEOUT_NS);
+
+            if (nResult == GL_WAIT_FAILED)
+                qWarning() << "[StagingRing] glClientWaitSync failed";
+
+            m_gl->glDeleteSync(region.fence);
+            m_inFlight.pop_front();
+            m_stats.nFenceWaits++;
+        }
+    }
+
+    void StagingRing::retireSignaled()
+    {
+        while (!m_inFlight.empty())
+        {
+            InFlightRegion& region = m_inFlight.front();
+            GLenum nResult = m_gl->glClientWaitSync(region.fence, 0, 0);
+            if (nResult != GL_ALREADY_SIGNALED && nResult != GL_CONDITION_SATISFIED)
+                break;
+
+            m_gl->glDeleteSync(region.fence);
+            m_inFlight.pop_front();
+        }
+    }
+
+    unsigned char* StagingRing::writePointer(size_t nOffset)
+    {
+        return m_pMapped ? m_pMapped + nOffset : m_vCpuStaging.data() + nOffset;
+    }
+}
@@ -22,18 +22,18 @@
 #include <chrono>
 #include <QDebug>
 #include <unordered_set>
+#include <limits>
+#include <cmath>
 
 #include "DataManager/TriangleVboManager.h"
+#include "Common/ThreadPool.h"
 
 namespace GLRhi
 {
-    // 类常量定义
     namespace
     {
-        static constexpr size_t INIT_CAPACITY = 100'000; // VBO块的初始容量
-        static constexpr size_t GROW_STEP = 200'000;
-        static constexpr size_t MAX_VERT_PER_BLOCK = 1'500'000;
-        static constexpr float COMPACT_THRESHOLD = 0.70f; // 使用率 < 70% 才压缩
+        static constexpr size_t INGEST_GRAIN = 16384;     // 批量添加时每个并行区段的最少多边形数
+        static constexpr size_t ENCODE_GRAIN = 65536;     // 批量添加时每个编码任务的顶点数
     }
 
     /**
@@ -42,8 +42,11 @@ namespace GLRhi
      * 在构造时尝试获取当前的OpenGL上下文，并初始化相关资源。
      * 注意：在创建此对象时，必须确保OpenGL上下文已经初始化。
      */
-    TriangleVboManager::TriangleVboManager()
+    TriangleVboManager::TriangleVboManager(const VboPolicy& policy)
+        : m_policy(policy)
     {
+        m_triangleCache.setCapacity(m_policy.nCacheBytes);
+
         if (QOpenGLContext::currentContext())
         {
             m_gl = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_3_3_Core>();
@@ -52,6 +55,8 @@ namespace GLRhi
                 qFatal("Failed to get OpenGL 3.3 Core functions");
                 return;
             }
+
+            m_ownStaging.initialize(QOpenGLContext::currentContext());
         }
     }
 
@@ -69,25 +74,48 @@ namespace GLRhi
         stopBackgroundDefrag();
 
         std::unique_lock<std::shared_mutex> lock(m_mutex);
-        for (auto& pair : m_colorBlocksMap)
-        {
-            for (TriangleColorVBOBlock* block : pair.second)
+        m_ownStaging.destroy();
+
+        forEachBlock([this](TriangleColorVBOBlock* block)
             {
+                discardStaged(block);
                 if (m_gl)
                 {
                     m_gl->glDeleteVertexArrays(1, &block->vao);
                     m_gl->glDeleteBuffers(1, &block->vbo);
                     m_gl->glDeleteBuffers(1, &block->ebo);
+                    m_gl->glDeleteBuffers(1, &block->vboSpare);
+                    m_gl->glDeleteBuffers(1, &block->eboSpare);
                 }
                 delete block;
-            }
-        }
+            });
 
         m_colorBlocksMap.clear();
+        m_vSharedBlocks.clear();
         m_IDLocationMap.clear();
         m_IDLocationMap.reserve(0);
-        m_vTriangleCache.clear();
-        m_triangleCacheOrder.clear();
+        m_triangleCache.clear();
+    }
+
+    bool TriangleVboManager::initialize(QOpenGLContext* context)
+    {
+        if (!context)
+        {
+            qWarning() << "[TriangleVboManager] initialize: context is null";
+            return false;
+        }
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_gl = context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+        if (!m_gl)
+        {
+            qWarning() << "[TriangleVboManager] initialize: failed to get OpenGL 3.3 functions";
+            return false;
+        }
+
+        if (m_pStaging == &m_ownStaging && !m_ownStaging.initialize(context))
+            qWarning() << "[TriangleVboManager] initialize: failed to create staging ring";
+        return true;
     }
 
     /**
@@ -112,53 +140,58 @@ namespace GLRhi
             return false;
 
         std::unique_lock<std::shared_mutex> lock(m_mutex);
-        if (m_IDLocationMap.count(id))
+        if (m_IDLocationMap.count(id) || m_ingestingIds.count(id))
             return false;
 
-        TriangleColorVBOBlock* block = getColorBlock(color);
+        return addTriangleLocked(id, vertices, vertexCount, indices, indexCount, color);
+    }
+
+    bool TriangleVboManager::addTriangleLocked(long long id, const float* vertices, size_t vertexCount,
+        const unsigned int* indices, size_t indexCount, const Color& color)
+    {
+        QuantBox bounds = VertexCodec::boundsOf(vertices, vertexCount);
+        TriangleColorVBOBlock* block = getColorBlock(color, vertexCount, indexCount, bounds, tileOf(bounds));
         if (!block)
             return false;
 
-        checkBlockCapacity(block,
-            block->nVertexCount + vertexCount,
-            block->nIndexCount + indexCount);
-
-        GLint nBaseVertex = static_cast<GLint>(block->nVertexCount);
-        size_t nBaseIndex = block->nIndexCount; // 索引在EBO中的起始位置
+        // 优先复用空洞，否则在末尾追加
+        size_t nBaseVertex = 0;
+        size_t nBaseIndex = 0; // 索引在EBO中的起始位置
+        allocRanges(block, vertexCount, indexCount, nBaseVertex, nBaseIndex);
 
         TrianglePrimitiveInfo prim;
         prim.id = id;
         prim.nIndexCount = static_cast<GLsizei>(indexCount);
-        prim.nBaseVertex = nBaseVertex;
+        prim.nBaseVertex = static_cast<GLint>(nBaseVertex);
         prim.nBaseIndex = nBaseIndex;
+        prim.nVertexCount = vertexCount;
+        prim.nIndexSlot = indexCount;
         prim.bValid = true;
+        prim.bounds = bounds;
 
-        size_t nPrimIdx = block->vPrimitives.size();
-        block->vPrimitives.push_back(std::move(prim));
+        size_t nPrimIdx = allocPrimSlot(block);
+        block->vPrimitives[nPrimIdx] = prim;
         block->idToIndexMap[id] = nPrimIdx;
+        syncDrawCmd(block, nPrimIdx);
 
-        block->nVertexCount += vertexCount;
-        block->nIndexCount += indexCount;
-        block->bDirty = true;
-
-        // 将顶点和索引数据复制到缓存中
-        TriangleData& data = m_vTriangleCache[id];
-        data.vertices.assign(vertices, vertices + vertexCount * 3);
-        data.indices.assign(indices, indices + indexCount);
         m_IDLocationMap[id] = { color.toUInt32(), color, block, nPrimIdx };
+        m_spatialIndex.insert(id, prim.bounds);
 
-        uploadSinglePrimitive(block, nPrimIdx); // 增量上传，只传这一个
+        uploadSinglePrimitive(block, nPrimIdx, vertices, vertexCount, indices, indexCount); // 增量上传，只传这一个
+        cacheTriangle(block, id, vertices, vertexCount, indices, indexCount);
         return true;
     }
 
     /**
      * @brief 批量添加多个多边形（三角剖分后的三角形）
      *
-     * 比逐个调用 addTriangle() 快 5~20 倍，专为一次性加载数十万个多边形设计。
-     * 内部会：
-     * - 按颜色自动分组
-     * - 每种颜色只扩容/上传一次
-     * - 最小化锁粒度、OpenGL 调用、内存拷贝
+     * 比逐个调用 addTriangle() 快 5~20 倍，专为一次性加载数百万个多边形设计。分五步：
+     * 1. 读锁下并行：输入按区段切分，每个区段统计各颜色的多边形数、顶点数、索引数和包围盒，并过滤无效数据
+     * 2. 合并各区段的统计，前缀和后并行把多边形下标分到各颜色桶（计数排序，桶内保持输入顺序）
+     * 3. 写锁下只提交元数据：每种颜色一个块、只扩容一次，然后按块并行登记图元信息。
+     *    新多边形的ID记入 m_ingestingIds，暂不公开
+     * 4. 解锁后把各组切成固定顶点数的任务，在线程池上并行编码顶点、打包相对索引
+     * 5. 写锁下在本线程（渲染线程）写入暂存区，公开新多边形的位置
      *
      * @param vTriangleDatas 批量数据：{id, vertices, vertexCount, indices, indexCount, color}
      * @return 添加成功的图元数量（失败的会跳过并打印警告）
@@ -169,147 +202,383 @@ namespace GLRhi
         if (vTriangleDatas.empty() || !m_gl)
             return 0;
 
-        // Step 1: 预处理 — 按颜色分组 + 过滤无效数据 + 预检查ID冲突
-        struct BatchGroup
+        ThreadPool& pool = ThreadPool::global();
+        const size_t nItems = vTriangleDatas.size();
+        const size_t nChunkItems = std::max(INGEST_GRAIN, (nItems + pool.getSlotCount() * 4 - 1) / (pool.getSlotCount() * 4));
+        const size_t nChunks = (nItems + nChunkItems - 1) / nChunkItems;
+        const bool bNeedBounds = VertexCodec::needsBox(m_vertexFormat);
+
+        // 区段内单个颜色的统计
+        struct ChunkBucket
         {
-            Color color;
-            std::vector<size_t> indices; // 在 vTriangleDatas 中的下标
-            size_t totalVerts = 0;
-            size_t totalIndices = 0;
+            size_t nPrims{ 0 };
+            QuantBox bounds;
+            size_t nBucket{ 0 };        // 合并后的全局桶下标
+            size_t nWritePos{ 0 };      // 第 2 步中该区段在桶内的写入位置
         };
 
-        std::unordered_map<uint32_t, BatchGroup> colorGroups;
-        std::vector<bool> validFlags(vTriangleDatas.size(), true);
-        size_t validCount = 0;
+        std::vector<std::unordered_map<uint64_t, ChunkBucket>> vChunks(nChunks);
+        std::vector<uint8_t> vValid(nItems, 0);
+        std::vector<QuantBox> vBounds(nItems);     // 每个多边形的包围盒，登记图元时填入
+
+        // 按瓦片分块时桶键的高 32 位是瓦片键，否则为 NO_TILE
+        std::vector<uint32_t> vTiles;
+        auto keyOf = [&](size_t i) {
+            uint64_t nTile = vTiles.empty() ? TileGrid::NO_TILE : vTiles[i];
+            return (nTile << 32) | std::get<5>(vTriangleDatas[i]).toUInt32();
+            };
 
+        // 第 1 步：并行统计
         {
             std::shared_lock<std::shared_mutex> readLock(m_mutex);
-            for (size_t i = 0; i < vTriangleDatas.size(); ++i)
-            {
-                const auto& [id, verts, vertexCount, indices, indexCount, color] = vTriangleDatas[i];
+            const float fTileSize = m_fTileSize;
+            if (m_blockPlacement == BlockPlacement::ByTile)
+                vTiles.resize(nItems, TileGrid::NO_TILE);
 
-                if (vertexCount < 3 || indexCount < 3 || indexCount % 3 != 0)
+            pool.parallelFor(nChunks, 1, [&](size_t nBegin, size_t nEnd, size_t) {
+                for (size_t c = nBegin; c < nEnd; ++c)
                 {
-                    validFlags[i] = false;
-                    continue;
+                    size_t nFirst = c * nChunkItems;
+                    size_t nLast = std::min(nFirst + nChunkItems, nItems);
+                    for (size_t i = nFirst; i < nLast; ++i)
+                    {
+                        const auto& [id, verts, vertexCount, indices, indexCount, color] = vTriangleDatas[i];
+                        if (!verts || !indices || vertexCount < 3 || indexCount < 3 || indexCount % 3 != 0)
+                            continue;
+                        if (m_IDLocationMap.count(id))
+                            continue;
+
+                        vValid[i] = 1;
+                        vBounds[i] = VertexCodec::boundsOf(verts, vertexCount);
+                        if (!vTiles.empty())
+                            vTiles[i] = TileGrid::keyOf(vBounds[i], fTileSize);
+                        ChunkBucket& bucket = vChunks[c][keyOf(i)];
+                        bucket.nPrims++;
+                        if (bNeedBounds)
+                            bucket.bounds.expand(vBounds[i]);
+                    }
                 }
+                });
+        }
 
-                if (m_IDLocationMap.count(id))
-                {
-                    validFlags[i] = false;
-                    continue;
-                }
+        // 合并：确定全局桶，以及每个（区段, 颜色, 瓦片）在桶内的起始位置
+        struct Bucket
+        {
+            Color color;
+            uint32_t nTile{ TileGrid::NO_TILE };
+            size_t nBegin{ 0 };         // 在 vSorted 中的起始下标
+            size_t nPrims{ 0 };
+            QuantBox bounds;
+        };
+        std::vector<Bucket> vBuckets;
+        std::unordered_map<uint64_t, size_t> keyToBucket;
+        for (auto& chunk : vChunks)
+        {
+            for (auto& [key, cb] : chunk)
+            {
+                auto res = keyToBucket.emplace(key, vBuckets.size());
+                if (res.second)
+                    vBuckets.emplace_back();
+                cb.nBucket = res.first->second;
+                cb.nWritePos = vBuckets[cb.nBucket].nPrims;
+                vBuckets[cb.nBucket].nPrims += cb.nPrims;
+                vBuckets[cb.nBucket].bounds.expand(cb.bounds);
+            }
+        }
 
-                uint32_t key = color.toUInt32();
+        size_t nTotalValid = 0;
+        for (Bucket& bucket : vBuckets)
+        {
+            bucket.nBegin = nTotalValid;
+            nTotalValid += bucket.nPrims;
+        }
+        if (nTotalValid == 0)
+            return 0;
 
-                auto& batchGroup = colorGroups[key];
-                batchGroup.color = color;
+        // 第 2 步：并行分桶，桶内保持输入顺序
+        std::vector<size_t> vSorted(nTotalValid);
+        pool.parallelFor(nChunks, 1, [&](size_t nBegin, size_t nEnd, size_t) {
+            for (size_t c = nBegin; c < nEnd; ++c)
+            {
+                for (auto& entry : vChunks[c])
+                    entry.second.nWritePos += vBuckets[entry.second.nBucket].nBegin;
 
-                batchGroup.indices.push_back(i);
-                batchGroup.totalVerts += vertexCount;
-                batchGroup.totalIndices += indexCount;
-                validCount++;
+                size_t nFirst = c * nChunkItems;
+                size_t nLast = std::min(nFirst + nChunkItems, nItems);
+                for (size_t i = nFirst; i < nLast; ++i)
+                {
+                    if (vValid[i])
+                        vSorted[vChunks[c][keyOf(i)].nWritePos++] = i;
+                }
             }
+            });
+
+        for (Bucket& bucket : vBuckets)
+        {
+            bucket.color = std::get<5>(vTriangleDatas[vSorted[bucket.nBegin]]);
+            if (!vTiles.empty())
+                bucket.nTile = vTiles[vSorted[bucket.nBegin]];
         }
 
-        if (validCount == 0)
-            return 0;
+        // 第 3 步：写锁下提交元数据（装块、扩容、登记图元），不编码顶点
+        std::vector<IngestRun> vRuns;
+        std::vector<Location> vPending(nTotalValid);    // 新多边形的位置，编码完成后才公开
+        size_t nAdd = 0;
 
         std::unique_lock<std::shared_mutex> writeLock(m_mutex);
+        m_ingestingIds.reserve(m_ingestingIds.size() + nTotalValid);
 
-        size_t nAdd = 0;
-
-        for (auto& [key, group] : colorGroups)
+        for (const Bucket& bucket : vBuckets)
         {
-            TriangleColorVBOBlock* block = getColorBlock(group.color);
+            TriangleColorVBOBlock* block = getColorBlock(bucket.color, 0, 0, bucket.bounds, bucket.nTile);
             if (!block)
             {
                 qCritical() << "Failed to create color block for batch add";
                 continue;
             }
 
-            checkBlockCapacity(block,
-                block->nVertexCount + group.totalVerts,
-                block->nIndexCount + group.totalIndices);
+            // 读锁释放后可能有同ID的多边形加入，批内也可能有重复ID，其它批量添加也可能正在写同一ID。
+            // ID 只记入 m_ingestingIds，编码完成后才放进 m_IDLocationMap，其它线程的删除、更新、隐藏在此之前都找不到它；
+            // 保留的多边形原地前移到 vSorted[nAdd...]
+            const uint32_t nKey = bucket.color.toUInt32();
+            IngestRun run;
+            run.block = block;
+            run.nFirst = nAdd;
+            run.color = bucket.color;
+            for (size_t k = bucket.nBegin; k < bucket.nBegin + bucket.nPrims; ++k)
+            {
+                const size_t nItem = vSorted[k];
+                const auto& [id, verts, vertexCount, indices, indexCount, color] = vTriangleDatas[nItem];
+                if (m_IDLocationMap.count(id) || !m_ingestingIds.insert(id).second)
+                    continue;
+
+                vPending[nAdd] = { nKey, bucket.color, block, 0 };
+                vSorted[nAdd++] = nItem;
+                run.nVerts += vertexCount;
+                run.nIndices += indexCount;
+            }
+
+            run.nPrims = nAdd - run.nFirst;
+            if (run.nPrims == 0)
+                continue;
 
-            // 预计算本次批次在块中的起始偏移
-            GLint nBaseVertexStart = static_cast<GLint>(block->nVertexCount);
-            size_t nVertOffset = block->nVertexCount; // 顶点偏移
-            size_t nIdxOffset = block->nIndexCount;   // 索引偏移
+            // 只扩容一次；影子副本的内存也在这里分配，编码时各线程只写不分配
+            checkBlockCapacity(block, block->nVertexCount + run.nVerts, block->nIndexCount + run.nIndices);
+            run.nBaseVertex = block->nVertexCount;
+            run.nBaseIndex = block->nIndexCount;
+            block->nVertexCount += run.nVerts;
+            block->nIndexCount += run.nIndices;
+            if (block->shadowVbo.isEnabled())
+                block->shadowVbo.ensure(block->nVertexCount * VertexCodec::stride(block->format, block->bVertexColor));
+            if (block->shadowEbo.isEnabled())
+                block->shadowEbo.ensure(block->nIndexCount * sizeof(unsigned int));
+
+            vRuns.push_back(std::move(run));
+        }
 
-            // 准备批量上传用的连续缓冲区
-            std::vector<float> vBatchVerts;
-            std::vector<unsigned int> vBatchIndices;
-            vBatchVerts.reserve(group.totalVerts * 3);
-            vBatchIndices.reserve(group.totalIndices);
+        if (vRuns.empty())
+            return 0;
 
-            std::vector<TrianglePrimitiveInfo> vNewPrims;
-            vNewPrims.reserve(group.indices.size());
+        // 各块的图元表、ID表和绘制命令互不相关，按块并行登记（共享块可能承载多种颜色）
+        std::vector<std::vector<size_t>> vBlockRuns;
+        {
+            std::unordered_map<TriangleColorVBOBlock*, size_t> blockToGroup;
+            for (size_t r = 0; r < vRuns.size(); ++r)
+            {
+                auto res = blockToGroup.emplace(vRuns[r].block, vBlockRuns.size());
+                if (res.second)
+                    vBlockRuns.emplace_back();
+                vBlockRuns[res.first->second].push_back(r);
+            }
+        }
 
-            // 遍历该颜色组所有图元
-            for (size_t idx : group.indices)
+        pool.parallelFor(vBlockRuns.size(), 1, [&](size_t nBegin, size_t nEnd, size_t) {
+            for (size_t g = nBegin; g < nEnd; ++g)
             {
-                if (!validFlags[idx])
-                    continue;
+                TriangleColorVBOBlock* block = vRuns[vBlockRuns[g].front()].block;
+                size_t nNewPrims = 0;
+                for (size_t r : vBlockRuns[g])
+                    nNewPrims += vRuns[r].nPrims;
+                block->idToIndexMap.reserve(block->idToIndexMap.size() + nNewPrims);
+                block->vPrimitives.reserve(block->vPrimitives.size() + nNewPrims);
+
+                for (size_t r : vBlockRuns[g])
+                {
+                    const IngestRun& run = vRuns[r];
+                    size_t nVertOffset = run.nBaseVertex;
+                    size_t nIdxOffset = run.nBaseIndex;
+                    for (size_t i = run.nFirst; i < run.nFirst + run.nPrims; ++i)
+                    {
+                        const auto& [id, verts, vertexCount, indices, indexCount, color] = vTriangleDatas[vSorted[i]];
+
+                        TrianglePrimitiveInfo prim;
+                        prim.id = id;
+                        prim.nIndexCount = static_cast<GLsizei>(indexCount);
+                        prim.nBaseVertex = static_cast<GLint>(nVertOffset);
+                        prim.nBaseIndex = nIdxOffset; // 索引在EBO中的起始位置
+                        prim.nVertexCount = vertexCount;
+                        prim.nIndexSlot = indexCount;
+                        prim.bValid = true;
+                        prim.bounds = vBounds[vSorted[i]];
+
+                        size_t nPrimIdx = allocPrimSlot(block);
+                        block->vPrimitives[nPrimIdx] = prim;
+                        block->idToIndexMap[id] = nPrimIdx;
+                        syncDrawCmd(block, nPrimIdx);
+
+                        vPending[i].nPrimIdx = nPrimIdx;
+                        nVertOffset += vertexCount;
+                        nIdxOffset += indexCount;
+                    }
+                }
+            }
+            });
+
+        writeLock.unlock();
+
+        // 第 4 步：不持锁并行编码顶点、打包索引。新区段只有本次添加引用，同步接口只在渲染线程（即本线程）调用，
+        // 新多边形还不在 m_IDLocationMap 中，其它线程不会访问这些区段
+        struct EncodeJob
+        {
+            size_t nRun{ 0 };
+            size_t nFirst{ 0 };         // 第一个多边形在添加顺序中的下标
+            size_t nPrims{ 0 };
+            size_t nVertOffset{ 0 };    // 相对 run.nBaseVertex 的顶点偏移
+            size_t nIdxOffset{ 0 };     // 相对 run.nBaseIndex 的索引偏移
+        };
+        std::vector<EncodeJob> vJobs;
+        for (size_t r = 0; r < vRuns.size(); ++r)
+        {
+            IngestRun& run = vRuns[r];
+            if (!run.block->shadowVbo.isEnabled())
+                run.pEncoded.reset(new unsigned char[run.nVerts * VertexCodec::stride(run.block->format, run.block->bVertexColor)]);
+            if (!run.block->shadowEbo.isEnabled())
+                run.pIndices.reset(new unsigned int[run.nIndices]);
+
+            EncodeJob job;
+            job.nRun = r;
+            job.nFirst = run.nFirst;
+            size_t nJobVerts = 0;
+            size_t nJobIndices = 0;
+            for (size_t i = run.nFirst; i < run.nFirst + run.nPrims; ++i)
+            {
+                job.nPrims++;
+                nJobVerts += std::get<2>(vTriangleDatas[vSorted[i]]);
+                nJobIndices += std::get<4>(vTriangleDatas[vSorted[i]]);
+                if (nJobVerts >= ENCODE_GRAIN || i + 1 == run.nFirst + run.nPrims)
+                {
+                    vJobs.push_back(job);
+                    job.nFirst = i + 1;
+                    job.nPrims = 0;
+                    job.nVertOffset += nJobVerts;
+                    job.nIdxOffset += nJobIndices;
+                    nJobVerts = 0;
+                    nJobIndices = 0;
+                }
+            }
+        }
+
+        pool.parallelFor(vJobs.size(), 1, [&](size_t nBegin, size_t nEnd, size_t) {
+            for (size_t j = nBegin; j < nEnd; ++j)
+            {
+                const EncodeJob& job = vJobs[j];
+                IngestRun& run = vRuns[job.nRun];
+                TriangleColorVBOBlock* block = run.block;
+                const size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+                const size_t nPosStride = VertexCodec::stride(block->format);
+                const uint32_t nRgba = run.color.toUInt32();
+
+                size_t nVertOffset = job.nVertOffset;
+                size_t nIdxOffset = job.nIdxOffset;
+                for (size_t i = job.nFirst; i < job.nFirst + job.nPrims; ++i)
+                {
+                    const auto& item = vTriangleDatas[vSorted[i]];
+                    const float* verts = std::get<1>(item);
+                    const size_t vertexCount = std::get<2>(item);
+                    const unsigned int* indices = std::get<3>(item);
+                    const size_t indexCount = std::get<4>(item);
+
+                    // 影子副本的分段边界可能落在多边形中间
+                    auto encodeTo = [&](unsigned char* pDst, size_t nFirstVert, size_t nCount) {
+                        VertexCodec::encode(block->format, block->quantBox, verts + nFirstVert * 3, nCount, pDst, nStride);
+                        if (block->bVertexColor)
+                            VertexCodec::writeColor(pDst + nPosStride, nStride, nCount, nRgba);
+                        };
+
+                    if (block->shadowVbo.isEnabled())
+                    {
+                        block->shadowVbo.forEachSpan((run.nBaseVertex + nVertOffset) * nStride, vertexCount * nStride,
+                            [&](unsigned char* pSpan, size_t nRangeOffset, size_t nSpan) {
+                                encodeTo(pSpan, nRangeOffset / nStride, nSpan / nStride);
+                            });
+                    }
+                    else
+                    {
+                        encodeTo(run.pEncoded.get() + nVertOffset * nStride, 0, vertexCount);
+                    }
 
-                const auto& [id, verts, vertexCount, indices, indexCount, color] = vTriangleDatas[idx];
-                TrianglePrimitiveInfo prim;
-                prim.id = id;
-                prim.nIndexCount = static_cast<GLsizei>(indexCount);
-                prim.nBaseVertex = static_cast<GLint>(nVertOffset);
-                prim.nBaseIndex = nIdxOffset; // 索引在EBO中的起始位置
-                prim.bValid = true;
-
-                // 记录图元信息
-                size_t nPrimIdxInBlock = block->vPrimitives.size() + vNewPrims.size();
-                vNewPrims.push_back(std::move(prim));
-                block->idToIndexMap[id] = nPrimIdxInBlock;
-
-                // 缓存顶点和索引（用于后续 update / compact）
-                TriangleData& data = m_vTriangleCache[id];
-                data.vertices.assign(verts, verts + vertexCount * 3);
-                data.indices.assign(indices, indices + indexCount);
-                m_IDLocationMap[id] = { key, color, block, nPrimIdxInBlock };
-
-                // 填充批量缓冲区
-                vBatchVerts.insert(vBatchVerts.end(), verts, verts + vertexCount * 3);
-                
-                // 索引需要相对于 baseVertex 进行偏移
-                for (size_t i = 0; i < indexCount; ++i)
-                    vBatchIndices.push_back(static_cast<unsigned int>(nVertOffset + indices[i]));
-
-                nVertOffset += vertexCount;
-                nIdxOffset += indexCount;
-                nAdd++;
+                    // EBO 中保存相对索引，绘制时由 basevertex 加上顶点偏移
+                    if (block->shadowEbo.isEnabled())
+                        block->shadowEbo.write((run.nBaseIndex + nIdxOffset) * sizeof(unsigned int), indices, indexCount * sizeof(unsigned int));
+                    else
+                        std::copy(indices, indices + indexCount, run.pIndices.get() + nIdxOffset);
+
+                    nVertOffset += vertexCount;
+                    nIdxOffset += indexCount;
+                }
             }
+            });
+
+        // 第 5 步：写入暂存区（渲染前统一提交），然后公开新多边形的位置
+        writeLock.lock();
 
-            // 一次性上传
-            if (!vBatchVerts.empty())
+        for (IngestRun& run : vRuns)
+        {
+            TriangleColorVBOBlock* block = run.block;
+            const size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+            const size_t nVboOffset = run.nBaseVertex * nStride;
+            const size_t nEboOffset = run.nBaseIndex * sizeof(unsigned int);
+            block->nEditEpoch++;
+
+            if (block->shadowVbo.isEnabled())
+            {
+                block->shadowVbo.forEachSpan(nVboOffset, run.nVerts * nStride, [&](unsigned char* pSpan, size_t nRangeOffset, size_t nSpan) {
+                    m_pStaging->upload(block->vbo, nVboOffset + nRangeOffset, pSpan, nSpan);
+                    });
+            }
+            else
             {
-                GLsizeiptr vertByteOffset = static_cast<GLsizeiptr>(nBaseVertexStart) * 3 * sizeof(float);
-                GLsizeiptr idxByteOffset = static_cast<GLsizeiptr>(nBaseVertexStart) * sizeof(unsigned int);
-
-                // 上传顶点
-                m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-                m_gl->glBufferSubData(GL_ARRAY_BUFFER, vertByteOffset,
-                    static_cast<GLsizeiptr>(vBatchVerts.size() * sizeof(float)), vBatchVerts.data());
-
-                // 上传索引
-                m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-                m_gl->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, idxByteOffset,
-                    static_cast<GLsizeiptr>(vBatchIndices.size() * sizeof(unsigned int)), vBatchIndices.data());
+                m_pStaging->upload(block->vbo, nVboOffset, run.pEncoded.get(), run.nVerts * nStride);
+                run.pEncoded.reset();
             }
 
-            // 追加图元信息
-            block->vPrimitives.insert(block->vPrimitives.end(),
-                std::make_move_iterator(vNewPrims.begin()),
-                std::make_move_iterator(vNewPrims.end()));
+            if (block->shadowEbo.isEnabled())
+            {
+                block->shadowEbo.forEachSpan(nEboOffset, run.nIndices * sizeof(unsigned int), [&](unsigned char* pSpan, size_t nRangeOffset, size_t nSpan) {
+                    m_pStaging->upload(block->ebo, nEboOffset + nRangeOffset, pSpan, nSpan);
+                    });
+            }
+            else
+            {
+                m_pStaging->upload(block->ebo, nEboOffset, run.pIndices.get(), run.nIndices * sizeof(unsigned int));
+                run.pIndices.reset();
+            }
+        }
 
-            // 更新块统计
-            block->nVertexCount += group.totalVerts;
-            block->nIndexCount += group.totalIndices;
-            block->bDirty = true;
+        std::vector<SpatialIndex::Entry> vIndexed;
+        vIndexed.reserve(nAdd);
+        for (const IngestRun& run : vRuns)
+        {
+            for (size_t i = run.nFirst; i < run.nFirst + run.nPrims; ++i)
+            {
+                const auto& [id, verts, vertexCount, indices, indexCount, color] = vTriangleDatas[vSorted[i]];
+                m_ingestingIds.erase(id);
+                m_IDLocationMap.emplace(id, vPending[i]);
+                vIndexed.push_back({ id, vBounds[vSorted[i]] });
+                cacheTriangle(run.block, id, verts, vertexCount, indices, indexCount);
+            }
         }
+        m_spatialIndex.insert(vIndexed);
 
         return nAdd;
     }
@@ -317,8 +586,8 @@ namespace GLRhi
     /**
      * @brief 从渲染管理器中移除指定ID的多边形
      *
-     * 通过ID查找并移除多边形，标记为无效并触发后续的内存整理。
-     * 实际的内存释放会在碎片整理时进行，以优化性能。
+     * 通过ID查找并移除多边形，顶点和索引区段立即归还给块内的空洞表，供后续新增或更新复用。
+     * 只有空洞占比过高（使用率低于 VboPolicy::fCompactThreshold）时才标记整块压缩。
      *
      * @param id 要移除的多边形的唯一标识符
      * @return true 如果成功移除，false 如果多边形不存在
@@ -326,6 +595,11 @@ namespace GLRhi
     bool TriangleVboManager::removeTriangle(long long id)
     {
         std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return removeTriangleLocked(id);
+    }
+
+    bool TriangleVboManager::removeTriangleLocked(long long id)
+    {
         auto it = m_IDLocationMap.find(id);
         if (it == m_IDLocationMap.end())
             return false;
@@ -334,13 +608,20 @@ namespace GLRhi
         TriangleColorVBOBlock* block = loc.block;
         TrianglePrimitiveInfo& prim = block->vPrimitives[loc.nPrimIdx];
 
+        // 顶点/索引区段归还给空洞表，图元位置留给后续新增复用
+        freeRanges(block, prim);
+        block->vFreePrimSlots.push_back(loc.nPrimIdx);
+
+        prim.id = -1;
         prim.bValid = false;
         prim.nIndexCount = 0;
-        block->bDirty = true;
-        block->bCompact = true;
+        prim.nVertexCount = 0;
+        prim.nIndexSlot = 0;
+        syncDrawCmd(block, loc.nPrimIdx);
 
         m_IDLocationMap.erase(it);
-        m_vTriangleCache.erase(id);
+        m_triangleCache.erase(id);
+        m_spatialIndex.erase(id);
         block->idToIndexMap.erase(id);
 
         return true;
@@ -362,23 +643,8 @@ namespace GLRhi
 
         for (long long id : vIds)
         {
-            auto it = m_IDLocationMap.find(id);
-            if (it == m_IDLocationMap.end())
-                continue;
-
-            const Location& loc = it->second;
-            TriangleColorVBOBlock* block = loc.block;
-            TrianglePrimitiveInfo& prim = block->vPrimitives[loc.nPrimIdx];
-
-            prim.bValid = false;
-            prim.nIndexCount = 0;
-            block->bDirty = true;
-            block->bCompact = true;
-
-            m_IDLocationMap.erase(it);
-            m_vTriangleCache.erase(id);
-            block->idToIndexMap.erase(id);
-            ++nDelCount;
+            if (removeTriangleLocked(id))
+                ++nDelCount;
         }
         return nDelCount;
     }
@@ -387,8 +653,9 @@ namespace GLRhi
      * @brief 更新指定ID的多边形数据
      *
      * 更新现有多边形的顶点和索引数据，根据数据变化采用不同策略：
-     * - 数据变化不大时，直接增量更新
-     * - 数据变化超过50%时，采用删除后重新添加的策略，确保内存使用合理
+     * - 新数据能放进原有的顶点/索引槽位时，直接原地增量更新
+     * - 超出原有槽位时，归还旧区段后在块内重新分配（优先复用空洞），图元记录保持不变
+     * - 新顶点超出量化块的包围盒时，从原块删除后重新添加到能容纳它的块
      *
      * @param id 要更新的多边形的唯一标识符
      * @param vertices 新的顶点数据，格式为[x1,y1,z1,x2,y2,z2,...]
@@ -415,33 +682,43 @@ namespace GLRhi
         size_t nPrimIdx = loc.nPrimIdx;
         TrianglePrimitiveInfo& prim = block->vPrimitives[nPrimIdx];
 
-        size_t nOldVertCount = static_cast<size_t>(prim.nIndexCount); // 旧索引数
-        size_t nOldVertCount_actual = 0;
-        auto cacheIt = m_vTriangleCache.find(id);
-        if (cacheIt != m_vTriangleCache.end())
+        QuantBox bounds = VertexCodec::boundsOf(vertices, vertexCount);
+        const bool bOutOfBox = VertexCodec::needsBox(block->format) && !block->quantBox.contains(bounds);
+        const bool bOutOfTile = block->nTile != TileGrid::NO_TILE &&
+            block->nTile != TileGrid::keyOf(bounds, m_fTileSize);
+        if (bOutOfBox || bOutOfTile)
         {
-            nOldVertCount_actual = cacheIt->second.vertices.size() / 3;
+            // 超出块包围盒或移到了其它瓦片：迁移到合适的块
+            Color color = loc.color;
+            removeTriangleLocked(id);
+            return addTriangleLocked(id, vertices, vertexCount, indices, indexCount, color);
         }
 
-        // 如果新数据明显大于旧数据，采用删除后重新添加的策略
-        if (vertexCount > nOldVertCount_actual * 1.5f || indexCount > nOldVertCount * 1.5f)
+        // 超出原有槽位时：先归还旧区段（会与相邻空洞合并），再在同一块内重新分配，
+        // 可能原地向后扩展，也可能落入其他空洞，只有都放不下时才追加到末尾
+        if (vertexCount > prim.nVertexCount || indexCount > prim.nIndexSlot)
         {
-            Color c = loc.color;
-            lock.unlock();
-            removeTriangle(id);
-            return addTriangle(id, vertices, vertexCount, indices, indexCount, c);
+            freeRanges(block, prim);
+
+            size_t nBaseVertex = 0;
+            size_t nBaseIndex = 0;
+            allocRanges(block, vertexCount, indexCount, nBaseVertex, nBaseIndex);
+
+            prim.nBaseVertex = static_cast<GLint>(nBaseVertex);
+            prim.nBaseIndex = nBaseIndex;
+            prim.nVertexCount = vertexCount;
+            prim.nIndexSlot = indexCount;
         }
 
         prim.nIndexCount = static_cast<GLsizei>(indexCount);
         prim.bValid = true;
+        prim.bounds = bounds;
+        m_spatialIndex.update(id, prim.bounds);
 
-        // 将顶点和索引数据复制到缓存中
-        TriangleData& data = m_vTriangleCache[id];
-        data.vertices.assign(vertices, vertices + vertexCount * 3);
-        data.indices.assign(indices, indices + indexCount);
-        block->bDirty = true;
+        syncDrawCmd(block, nPrimIdx);
 
-        uploadSinglePrimitive(block, nPrimIdx);
+        uploadSinglePrimitive(block, nPrimIdx, vertices, vertexCount, indices, indexCount);
+        cacheTriangle(block, id, vertices, vertexCount, indices, indexCount);
         return true;
     }
 
@@ -463,7 +740,7 @@ namespace GLRhi
 
         Location& loc = it->second;
         loc.block->vPrimitives[loc.nPrimIdx].bValid = bVisible;
-        loc.block->bDirty = true;
+        syncDrawCmd(loc.block, loc.nPrimIdx);
         return true;
     }
 
@@ -480,24 +757,34 @@ namespace GLRhi
     void TriangleVboManager::clearAllPrimitives()
     {
         std::unique_lock<std::shared_mutex> lock(m_mutex);
-        for (auto& pair : m_colorBlocksMap)
+
+        // 整理计划指向的块即将删除
+        m_pActivePlan.reset();
         {
-            for (TriangleColorVBOBlock* block : pair.second)
+            std::lock_guard<std::mutex> planLock(m_defragMutex);
+            m_pPendingPlan.reset();
+        }
+        m_bDefragBusy = false;
+
+        forEachBlock([this](TriangleColorVBOBlock* block)
             {
+                discardStaged(block);
                 if (m_gl)
                 {
                     m_gl->glDeleteVertexArrays(1, &block->vao);
                     m_gl->glDeleteBuffers(1, &block->vbo);
                     m_gl->glDeleteBuffers(1, &block->ebo);
+                    m_gl->glDeleteBuffers(1, &block->vboSpare);
+                    m_gl->glDeleteBuffers(1, &block->eboSpare);
                 }
                 delete block;
-            }
-        }
+            });
         m_colorBlocksMap.clear();
+        m_vSharedBlocks.clear();
         m_IDLocationMap.clear();
         m_IDLocationMap.reserve(0);
-        m_vTriangleCache.clear();
-        m_triangleCacheOrder.clear();
+        m_triangleCache.clear();
+        m_spatialIndex.clear();
     }
 
     // ===================================================================
@@ -522,18 +809,81 @@ namespace GLRhi
      * 6. 压缩需要整理的块
      * 7. 绑定块并执行渲染
      *
-     * @note 此方法应在 OpenGL 渲染上下文中调用
+     * @note 此方法应在 OpenGL 渲染上下文中调用。绘制过程会压缩块、重建绘制命令，因此持有写锁。
      */
     void TriangleVboManager::renderVisiblePrimitives()
     {
         if (!m_gl)
             return;
 
-        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            renderBlocks(false);
+        }
+        dispatchFragAlerts();
+    }
+
+    /**
+     * @brief 渲染所有可见的多边形（使用 glMultiDrawElementsBaseVertex 优化版本）
+     *
+     * 使用 glMultiDrawElementsBaseVertex 进行批量绘制，性能更高。
+     */
+    void TriangleVboManager::renderVisiblePrimitivesEx()
+    {
+        if (!m_gl)
+            return;
+
+        {
+            std::unique_lock<std::shared_mutex> lock(m_mutex);
+            if (!m_colorBlocksMap.empty() || !m_vSharedBlocks.empty())
+                renderBlocks(true);
+        }
+        dispatchFragAlerts();
+    }
+
+    /**
+     * @brief 按块绘制所有可见多边形（调用方已持有锁）
+     *
+     * 先绘制按颜色分组的块（每组一次 glUniform4f），再绘制共享块：
+     * 共享块的颜色来自顶点属性，整块一次多重绘制，与颜色数量无关。
+     *
+     * @param bMultiDraw true 使用 glMultiDrawElementsBaseVertex，false 逐图元绘制
+     */
+    void TriangleVboManager::renderBlocks(bool bMultiDraw)
+    {
+        // 提交本帧暂存的编辑，之后整理拷贝读取的是最新内容
+        m_pStaging->flush();
+        stepDefrag();
 
-        GLint nProg = 0;
-        m_gl->glGetIntegerv(GL_CURRENT_PROGRAM, &nProg);
-        GLint uColorLoc = (nProg > 0) ? m_gl->glGetUniformLocation(nProg, "uColor") : -1;
+        size_t nRebuilds = m_cullStats.nRebuilds;
+        m_cullStats = VboCullStats();
+        m_cullStats.nRebuilds = nRebuilds;
+
+        if (m_culler.isEnabled() && m_nIndexCullEpoch != m_culler.epoch())
+        {
+            size_t nBefore = m_culler.getRebuildCount();
+            cullFromIndex();
+            m_cullStats.nRebuilds += m_culler.getRebuildCount() - nBefore;
+            m_nIndexCullEpoch = m_culler.epoch();
+        }
+
+        // 优先使用预先解析的 uniform 位置，未设置程序时才按当前程序查询
+        ProgramUniforms prog = m_programUniforms;
+        if (prog.isValid())
+        {
+            if (m_stateCache)
+                m_stateCache->addSkipped(4); // glGetIntegerv + 3 次 glGetUniformLocation
+        }
+        else
+        {
+            GLint nProg = 0;
+            m_gl->glGetIntegerv(GL_CURRENT_PROGRAM, &nProg);
+            prog = ProgramUniforms::resolve(m_gl, static_cast<GLuint>(nProg));
+        }
+
+        const GLint uColorLoc = prog.nColorLoc;
+        const GLint uQuantLoc = prog.nQuantBoxLoc;
+        const GLint uVertColorLoc = prog.nUseVertexColorLoc;
 
         for (const auto& pair : m_colorBlocksMap)
         {
@@ -542,121 +892,146 @@ namespace GLRhi
                 continue;
 
             const Color& c = vBlocks[0]->color;
-            if (uColorLoc != -1)
-                m_gl->glUniform4f(uColorLoc, c.r(), c.g(), c.b(), c.a());
+            setUniform4f(uColorLoc, c.r(), c.g(), c.b(), c.a());
 
             for (TriangleColorVBOBlock* block : vBlocks)
-            {
-                if (block->vDrawCounts.empty() && !block->bDirty)
-                    continue;
-
-                if (block->bDirty)
-                    rebuildDrawCmds(block);
-
-                if (block->bCompact)
-                    compactBlock(block);
+                drawBlock(block, uQuantLoc, bMultiDraw);
+        }
 
-                if (block->vDrawCounts.empty())
-                    continue;
+        if (m_vSharedBlocks.empty())
+            return;
 
-                bindBlock(block);
+        setUniform1i(uVertColorLoc, 1);
 
-                // 计算每个图元的索引在EBO中的偏移
-                // 需要从图元信息中获取索引偏移
-                size_t drawIdx = 0;
-                for (const TrianglePrimitiveInfo& prim : block->vPrimitives)
-                {
-                    if (prim.bValid && prim.nIndexCount > 0)
-                    {
-                        m_gl->glDrawElementsBaseVertex(
-                            GL_TRIANGLES,
-                            prim.nIndexCount,
-                            GL_UNSIGNED_INT,
-                            reinterpret_cast<const void*>(prim.nBaseIndex * sizeof(unsigned int)),
-                            prim.nBaseVertex);
-                        drawIdx++;
-                    }
-                }
+        for (TriangleColorVBOBlock* block : m_vSharedBlocks)
+            drawBlock(block, uQuantLoc, bMultiDraw);
 
-                unbindBlock();
-            }
-        }
+        setUniform1i(uVertColorLoc, 0);
     }
 
     /**
-     * @brief 渲染所有可见的多边形（使用 glMultiDrawElementsBaseVertex 优化版本）
+     * @brief 用空间索引生成裁剪列表
      *
-     * 使用 glMultiDrawElementsBaseVertex 进行批量绘制，性能更高。
+     * 一次范围查询取出裁剪范围内的全部多边形，按所属块收集绘制槽位。
+     * 只处理部分可见且绘制命令有效的块，脏块重建后由 ViewCuller::cull() 在块内重新测试。
      */
-    void TriangleVboManager::renderVisiblePrimitivesEx()
+    void TriangleVboManager::cullFromIndex()
     {
-        if (!m_gl || m_colorBlocksMap.empty())
-            return;
-
-        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::unordered_map<TriangleColorVBOBlock*, std::vector<uint32_t>> blockSlots;
+        m_spatialIndex.query(m_culler.getCullRect(), [&](long long id, const QuantBox&) {
+            auto it = m_IDLocationMap.find(id);
+            if (it == m_IDLocationMap.end())
+                return;
 
-        GLint nProg = 0;
-        m_gl->glGetIntegerv(GL_CURRENT_PROGRAM, &nProg);
-        GLint uColorLoc = (nProg > 0) ? m_gl->glGetUniformLocation(nProg, "uColor") : -1;
+            TriangleColorVBOBlock* block = it->second.block;
+            uint32_t nSlot = block->vPrimitives[it->second.nPrimIdx].nDrawSlot;
+            if (nSlot != TrianglePrimitiveInfo::NO_DRAW_SLOT && !block->bDirty)
+                blockSlots[block].push_back(nSlot);
+            });
 
-        for (const auto& pair : m_colorBlocksMap)
-        {
-            const auto& vBlocks = pair.second;
-            if (vBlocks.empty())
-                continue;
+        forEachBlock([&](TriangleColorVBOBlock* block) {
+            if (block->bDirty || block->vDrawCounts.empty() ||
+                m_culler.classify(block->bounds) != ViewCuller::Coverage::Partial)
+                return;
 
-            const Color& c = vBlocks[0]->color;
-            if (uColorLoc != -1)
-                m_gl->glUniform4f(uColorLoc, c.r(), c.g(), c.b(), c.a());
+            m_culler.assign(*block, blockSlots[block]);
+            });
+    }
 
-            for (TriangleColorVBOBlock* block : vBlocks)
-            {
-                if (block->bDirty)
-                    rebuildDrawCmds(block);
+    /**
+     * @brief 绘制单个块
+     *
+     * 需要时先压缩再重建绘制命令（压缩会改变 basevertex / 索引偏移），然后设置反量化参数并绘制。
+     *
+     * @param block 目标块
+     * @param uQuantLoc uQuantBox 的 uniform 位置
+     * @param bMultiDraw 是否使用多重绘制
+     */
+    void TriangleVboManager::drawBlock(TriangleColorVBOBlock* block, GLint uQuantLoc, bool bMultiDraw)
+    {
+        // 分帧整理启动后由 stepDefrag() 按预算压缩，这里不再整块同步压缩
+        if (block->bCompact && !m_bDefragEnabled.load(std::memory_order_relaxed))
+            compactBlock(block);
 
-                if (block->bCompact)
-                    compactBlock(block);
+        if (block->bDirty)
+            rebuildDrawCmds(block);
 
-                if (block->vDrawCounts.empty())
-                    continue;
+        if (block->vDrawCounts.empty())
+            return;
 
-                bindBlock(block);
+        // 绘制命令数组由 rebuildDrawCmds / syncDrawCmd 维护，这里不做任何分配；
+        // 视口裁剪时整块不可见则跳过，部分可见时使用缓存的裁剪列表
+        const GLsizei* pCounts = block->vDrawCounts.data();
+        const GLint* pBaseVertices = block->vBaseVertices.data();
+        const void* const* pIndexOffsets = block->vIndexOffsets.data();
+        GLsizei nPrimCount = static_cast<GLsizei>(block->vDrawCounts.size());
+        m_cullStats.nPrimsTotal += block->vDrawCounts.size();
 
-                // 收集有效的图元信息
-                std::vector<GLsizei> drawCounts;
-                std::vector<GLint> baseVertices;
-                std::vector<const void*> indexOffsets;
-                
-                for (const TrianglePrimitiveInfo& prim : block->vPrimitives)
-                {
-                    if (prim.bValid && prim.nIndexCount > 0)
-                    {
-                        drawCounts.push_back(prim.nIndexCount);
-                        baseVertices.push_back(prim.nBaseVertex);
-                        indexOffsets.push_back(reinterpret_cast<const void*>(prim.nBaseIndex * sizeof(unsigned int)));
-                    }
-                }
+        if (m_culler.isEnabled())
+        {
+            switch (m_culler.classify(block->bounds))
+            {
+            case ViewCuller::Coverage::Outside:
+                m_cullStats.nBlocksSkipped++;
+                return;
+            case ViewCuller::Coverage::Inside:
+                m_cullStats.nBlocksFull++;
+                break;
+            case ViewCuller::Coverage::Partial:
+            {
+                size_t nRebuilds = m_culler.getRebuildCount();
+                const CulledDraws& culled = m_culler.cull(*block);
+                m_cullStats.nRebuilds += m_culler.getRebuildCount() - nRebuilds;
+                m_cullStats.nBlocksCulled++;
+                m_cullStats.nPrimsLod += culled.nLodDropped;
+                if (culled.vDrawCounts.empty())
+                    return;
+
+                pCounts = culled.vDrawCounts.data();
+                pBaseVertices = culled.vBaseVertices.data();
+                pIndexOffsets = culled.vIndexOffsets.data();
+                nPrimCount = static_cast<GLsizei>(culled.vDrawCounts.size());
+                break;
+            }
+            }
+        }
+        m_cullStats.nPrimsDrawn += static_cast<size_t>(nPrimCount);
 
-                if (drawCounts.empty())
-                {
-                    unbindBlock();
-                    continue;
-                }
+        if (uQuantLoc != -1)
+        {
+            float vQuant[4];
+            VertexCodec::dequantParams(block->format, block->quantBox, vQuant);
+            setUniform4f(uQuantLoc, vQuant[0], vQuant[1], vQuant[2], vQuant[3]);
+        }
 
-                GLsizei nPrimCount = static_cast<GLsizei>(drawCounts.size());
+        bindBlock(block);
 
-                m_gl->glMultiDrawElementsBaseVertex(
+        if (!bMultiDraw)
+        {
+            for (GLsizei i = 0; i < nPrimCount; ++i)
+            {
+                m_gl->glDrawElementsBaseVertex(
                     GL_TRIANGLES,
-                    drawCounts.data(),      // nCount[]
+                    pCounts[i],
                     GL_UNSIGNED_INT,
-                    indexOffsets.data(),    // 每个图元的索引在EBO中的偏移
-                    nPrimCount,             // draw command 数量
-                    baseVertices.data()     // basevertex[]
-                );
-
-                unbindBlock();
+                    pIndexOffsets[i],
+                    pBaseVertices[i]);
             }
+
+            unbindBlock();
+            return;
         }
+
+        m_gl->glMultiDrawElementsBaseVertex(
+            GL_TRIANGLES,
+            pCounts,                        // nCount[]
+            GL_UNSIGNED_INT,
+            pIndexOffsets,                  // 每个图元的索引在EBO中的偏移
+            nPrimCount,                     // draw command 数量
+            pBaseVertices                   // basevertex[]
+        );
+
+        unbindBlock();
     }
 
     // ===================================================================
@@ -670,20 +1045,59 @@ namespace GLRhi
      * 这是实现颜色分组渲染优化的关键方法。
      *
      * @param color 要查找的颜色
+     * @param nNeedVerts 需要的顶点数
+     * @param nNeedIdx 需要的索引数
+     * @param bounds 需要容纳的范围（仅 Half2 / Int16Quant 块检查）
+     * @param nTile 瓦片键，只在该瓦片的块中查找；TileGrid::NO_TILE 表示按颜色分块
      * @return 指向TriangleColorVBOBlock的指针，如果无法创建则返回nullptr
      */
-    TriangleColorVBOBlock* TriangleVboManager::getColorBlock(const Color& color)
+    TriangleColorVBOBlock* TriangleVboManager::getColorBlock(const Color& color, size_t nNeedVerts, size_t nNeedIdx,
+        const QuantBox& bounds, uint32_t nTile)
     {
-        uint32_t nKey = color.toUInt32();
-        auto& vBlocks = m_colorBlocksMap[nKey];
+        // 共享块模式下不区分颜色；块列表按瓦片键有序，只看同一瓦片的块
+        auto& vBlocks = (m_colorStorage == ColorStorage::PerVertex) ?
+            m_vSharedBlocks : m_colorBlocksMap[color.toUInt32()];
+        auto range = std::equal_range(vBlocks.begin(), vBlocks.end(), nTile, TileGrid::BlockOrder());
+
+        // 先找能直接放进空洞的块，不增加高水位线
+        if (nNeedVerts > 0 && nNeedIdx > 0)
+        {
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                TriangleColorVBOBlock* b = *it;
+                if (blockAccepts(b, bounds) &&
+                    b->vertAllocator.getLargestHole() >= nNeedVerts &&
+                    b->idxAllocator.getLargestHole() >= nNeedIdx)
+                    return b;
+            }
+        }
 
-        for (TriangleColorVBOBlock* b : vBlocks)
+        // 块大小按字节限制，紧凑格式的块能容纳更多顶点
+        for (auto it = range.first; it != range.second; ++it)
         {
-            if (b->nVertexCount + 5000 < MAX_VERT_PER_BLOCK)
+            TriangleColorVBOBlock* b = *it;
+            size_t nMaxVerts = m_policy.maxBytesPerBlock() / VertexCodec::stride(b->format, b->bVertexColor);
+            if (blockAccepts(b, bounds) && b->nVertexCount + 5000 < nMaxVerts)
                 return b;
         }
 
-        return createNewColorBlock(color);
+        return createNewColorBlock(color, bounds, nTile);
+    }
+
+    bool TriangleVboManager::blockAccepts(const TriangleColorVBOBlock* block, const QuantBox& bounds) const
+    {
+        if (block->format != m_vertexFormat)
+            return false;
+
+        return !VertexCodec::needsBox(block->format) || block->quantBox.contains(bounds);
+    }
+
+    uint32_t TriangleVboManager::tileOf(const QuantBox& bounds) const
+    {
+        if (m_blockPlacement != BlockPlacement::ByTile)
+            return TileGrid::NO_TILE;
+
+        return TileGrid::keyOf(bounds, m_fTileSize);
     }
 
     /**
@@ -691,43 +1105,54 @@ namespace GLRhi
      *
      * 分配并初始化一个新的TriangleColorVBOBlock对象，包括：
      * - 创建OpenGL缓冲区对象（VAO、VBO、EBO）
-     * - 设置初始容量
+     * - 设置初始容量和顶点格式（Half2 / Int16Quant 同时确定块包围盒）
      * - 配置顶点属性指针
      * - 将新块添加到颜色映射中
      *
      * @param color 该块的颜色
+     * @param bounds 需要容纳的范围
+     * @param nTile 块所属的瓦片键，块按它有序插入块列表
      * @return 指向新创建的TriangleColorVBOBlock的指针
      */
-    TriangleColorVBOBlock* TriangleVboManager::createNewColorBlock(const Color& color)
+    TriangleColorVBOBlock* TriangleVboManager::createNewColorBlock(const Color& color, const QuantBox& bounds,
+        uint32_t nTile)
     {
         TriangleColorVBOBlock* block = new TriangleColorVBOBlock();
+        block->nSerial = m_nNextBlockSerial++;
         block->color = color;
+        block->nTile = nTile;
+        block->format = m_vertexFormat;
+        block->bVertexColor = (m_colorStorage == ColorStorage::PerVertex);
+        if (VertexCodec::needsBox(block->format))
+            block->quantBox = VertexCodec::makeBlockBox(bounds, m_fQuantExtent);
+        if (m_policy.bShadowArena)
+        {
+            block->shadowVbo.init(VertexCodec::stride(block->format, block->bVertexColor));
+            block->shadowEbo.init(sizeof(unsigned int));
+        }
 
         m_gl->glGenVertexArrays(1, &block->vao);
         m_gl->glGenBuffers(1, &block->vbo);
         m_gl->glGenBuffers(1, &block->ebo);
 
-        block->nVertexCapacity = INIT_CAPACITY;
-        block->nIndexCapacity = INIT_CAPACITY;
-
-        m_gl->glBindVertexArray(block->vao);
+        block->nVertexCapacity = m_policy.nInitCapacity;
+        block->nIndexCapacity = m_policy.nInitCapacity;
 
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
         m_gl->glBufferData(GL_ARRAY_BUFFER,
-            static_cast<GLsizeiptr>(INIT_CAPACITY * 3 * sizeof(float)),
+            static_cast<GLsizeiptr>(m_policy.nInitCapacity * VertexCodec::stride(block->format, block->bVertexColor)),
             nullptr, GL_DYNAMIC_DRAW);
 
-        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-        m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-            static_cast<GLsizeiptr>(INIT_CAPACITY * sizeof(unsigned int)),
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, block->ebo);
+        m_gl->glBufferData(GL_COPY_WRITE_BUFFER,
+            static_cast<GLsizeiptr>(m_policy.nInitCapacity * sizeof(unsigned int)),
             nullptr, GL_DYNAMIC_DRAW);
 
-        m_gl->glEnableVertexAttribArray(0);
-        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+        setupBlockVao(block);
 
-        m_gl->glBindVertexArray(0);
-
-        m_colorBlocksMap[color.toUInt32()].push_back(block);
+        // 同一瓦片的块按创建顺序排在一起；按颜色分块时瓦片键都是 NO_TILE，等同于追加到末尾
+        auto& vBlocks = block->bVertexColor ? m_vSharedBlocks : m_colorBlocksMap[color.toUInt32()];
+        vBlocks.insert(std::upper_bound(vBlocks.begin(), vBlocks.end(), nTile, TileGrid::BlockOrder()), block);
         return block;
     }
 
@@ -735,7 +1160,7 @@ namespace GLRhi
      * @brief 确保VBO块有足够的容量
      *
      * 检查并在必要时扩容指定的VBO块，以容纳所需的顶点和索引数量。
-     * 如果块空间不足，将重新分配更大的缓冲区并复制现有数据。
+     * 扩容为无损操作：旧内容通过 glCopyBufferSubData 在GPU端拷贝到新缓冲区。
      *
      * @param block 要检查容量的VBO块
      * @param nNeedV 需要的顶点数量
@@ -743,86 +1168,291 @@ namespace GLRhi
      */
     void TriangleVboManager::checkBlockCapacity(TriangleColorVBOBlock* block, size_t nNeedV, size_t nNeedI)
     {
+        // 批量添加直接在高水位线之后追加，也经过这里
+        block->nEditEpoch++;
         if (nNeedV <= block->nVertexCapacity && nNeedI <= block->nIndexCapacity)
             return;
 
-        size_t nNewCap = block->nVertexCapacity * 2;
-        if (nNewCap < nNeedV)
-            nNewCap = nNeedV + GROW_STEP;
+        auto tStart = std::chrono::steady_clock::now();
 
-        size_t nNewIdxCap = block->nIndexCapacity * 2;
-        if (nNewIdxCap < nNeedI)
-            nNewIdxCap = nNeedI + GROW_STEP;
+        // 暂存的写入指向旧缓冲区，必须在替换前提交
+        m_pStaging->flush();
+
+        size_t nNewCap = block->nVertexCapacity;
+        if (nNewCap < nNeedV)
+        {
+            nNewCap = block->nVertexCapacity * 2;
+            if (nNewCap < nNeedV)
+                nNewCap = nNeedV + m_policy.nGrowStep;
+        }
+
+        size_t nNewIdxCap = block->nIndexCapacity;
+        if (nNewIdxCap < nNeedI)
+        {
+            nNewIdxCap = block->nIndexCapacity * 2;
+            if (nNewIdxCap < nNeedI)
+                nNewIdxCap = nNeedI + m_policy.nGrowStep;
+        }
+
+        size_t nMoved = 0;
+        if (nNewCap != block->nVertexCapacity)
+        {
+            size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+            size_t nUsedBytes = block->nVertexCount * nStride;
+            growBuffer(block->vbo, nUsedBytes, nNewCap * nStride);
+            nMoved += nUsedBytes;
+        }
+
+        if (nNewIdxCap != block->nIndexCapacity)
+        {
+            size_t nUsedBytes = block->nIndexCount * sizeof(unsigned int);
+            growBuffer(block->ebo, nUsedBytes, nNewIdxCap * sizeof(unsigned int));
+            nMoved += nUsedBytes;
+        }
 
         block->nVertexCapacity = nNewCap;
         block->nIndexCapacity = nNewIdxCap;
 
-        // Orphaning：只重新分配，不拷贝旧数据
+        // 缓冲区对象已替换，VAO 需要重新指向新的 VBO/EBO
+        setupBlockVao(block);
+
+        std::chrono::duration<double, std::milli> dElapsed = std::chrono::steady_clock::now() - tStart;
+        m_growStats.nGrowCount++;
+        m_growStats.nBytesMoved += nMoved;
+        m_growStats.dStallMs += dElapsed.count();
+    }
+
+    /**
+     * @brief 无损扩容单个缓冲区
+     *
+     * @param buffer 要扩容的缓冲区，完成后被替换为新缓冲区
+     * @param nUsedBytes 需要保留的旧数据字节数
+     * @param nNewBytes 新缓冲区的字节数
+     */
+    void TriangleVboManager::growBuffer(unsigned int& buffer, size_t nUsedBytes, size_t nNewBytes)
+    {
+        unsigned int nNewBuffer = 0;
+        m_gl->glGenBuffers(1, &nNewBuffer);
+
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, nNewBuffer);
+        m_gl->glBufferData(GL_COPY_WRITE_BUFFER,
+            static_cast<GLsizeiptr>(nNewBytes), nullptr, GL_DYNAMIC_DRAW);
+
+        if (nUsedBytes > 0)
+        {
+            m_gl->glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                0, 0, static_cast<GLsizeiptr>(nUsedBytes));
+            m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+
+        m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        m_gl->glDeleteBuffers(1, &buffer);
+        buffer = nNewBuffer;
+    }
+
+    /**
+     * @brief 配置块的VAO
+     *
+     * @param block 目标块
+     */
+    void TriangleVboManager::setupBlockVao(TriangleColorVBOBlock* block)
+    {
+        m_gl->glBindVertexArray(block->vao);
+
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-        m_gl->glBufferData(GL_ARRAY_BUFFER,
-            nNewCap * 3 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        VertexCodec::setupAttrib(m_gl, block->format, block->bVertexColor);
 
         m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-        m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-            nNewIdxCap * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
 
-        // 旧数据全丢！因为我们有 m_vTriangleCache 缓存，下次 compact 时会重建
-        block->bCompact = true;  // 强制下次 compact 时重建
+        m_gl->glBindVertexArray(0);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (m_stateCache)
+            m_stateCache->assumeVertexArray(0);
+    }
+
+    /**
+     * @brief 在块内分配顶点区段和索引区段
+     *
+     * 顶点和索引各自有独立的空洞表和高水位线，互不影响。
+     *
+     * @param block 目标块
+     * @param nVertCount 顶点数
+     * @param nIdxCount 索引数
+     * @param nBaseVertex 输出：区段起始顶点
+     * @param nBaseIndex 输出：区段起始索引
+     */
+    void TriangleVboManager::allocRanges(TriangleColorVBOBlock* block, size_t nVertCount, size_t nIdxCount,
+        size_t& nBaseVertex, size_t& nBaseIndex)
+    {
+        block->nEditEpoch++;
+        nBaseVertex = block->vertAllocator.allocate(nVertCount);
+        nBaseIndex = block->idxAllocator.allocate(nIdxCount);
+
+        size_t nNeedV = (nBaseVertex == RangeAllocator::INVALID_OFFSET) ? block->nVertexCount + nVertCount : 0;
+        size_t nNeedI = (nBaseIndex == RangeAllocator::INVALID_OFFSET) ? block->nIndexCount + nIdxCount : 0;
+        if (nNeedV > 0 || nNeedI > 0)
+            checkBlockCapacity(block, nNeedV, nNeedI);
+
+        if (nBaseVertex == RangeAllocator::INVALID_OFFSET)
+        {
+            nBaseVertex = block->nVertexCount;
+            block->nVertexCount += nVertCount;
+        }
+
+        if (nBaseIndex == RangeAllocator::INVALID_OFFSET)
+        {
+            nBaseIndex = block->nIndexCount;
+            block->nIndexCount += nIdxCount;
+        }
+    }
+
+    /**
+     * @brief 归还图元占用的顶点区段和索引区段
+     *
+     * @param block 目标块
+     * @param prim 图元信息
+     */
+    void TriangleVboManager::freeRanges(TriangleColorVBOBlock* block, const TrianglePrimitiveInfo& prim)
+    {
+        block->nEditEpoch++;
+        block->vertAllocator.free(static_cast<size_t>(prim.nBaseVertex), prim.nVertexCount);
+        block->idxAllocator.free(prim.nBaseIndex, prim.nIndexSlot);
+        block->vertAllocator.trimTail(block->nVertexCount);
+        block->idxAllocator.trimTail(block->nIndexCount);
+
+        // 空洞能被后续新增复用，只有使用率过低时才需要整块压缩
+        size_t nFree = block->vertAllocator.getFreeUnits();
+        block->bCompact = block->nVertexCount > 0 &&
+            double(block->nVertexCount - nFree) / block->nVertexCount < m_policy.fCompactThreshold;
+        checkFragmentation(block);
+    }
+
+    size_t TriangleVboManager::allocPrimSlot(TriangleColorVBOBlock* block)
+    {
+        if (!block->vFreePrimSlots.empty())
+        {
+            size_t nPrimIdx = block->vFreePrimSlots.back();
+            block->vFreePrimSlots.pop_back();
+            return nPrimIdx;
+        }
+
+        block->vPrimitives.emplace_back();
+        return block->vPrimitives.size() - 1;
     }
 
     /**
      * @brief 上传单个多边形到VBO块
      *
-     * 将多边形数据（顶点和索引）上传到指定的VBO块中，包括：
+     * 将多边形数据（顶点和索引）写入暂存区，渲染前由 StagingRing::flush() 合并拷贝到VBO块：
      * - 计算顶点和索引的偏移量
-     * - 使用glBufferSubData更新VBO和EBO
-     * - 计算相对索引值（索引需要相对于baseVertex偏移）
-     * - 更新渲染相关状态
+     * - 调用方传入的顶点和相对索引拷贝到暂存区（绘制时由 basevertex 偏移）
      *
      * @param block 目标VBO块
      * @param nPrimIdx 要上传的多边形在块中的索引
+     * @param vertices 顶点数据，格式为[x1,y1,z1,...]
+     * @param vertexCount 顶点数
+     * @param indices 相对索引
+     * @param indexCount 索引数
      */
-    void TriangleVboManager::uploadSinglePrimitive(TriangleColorVBOBlock* block, size_t nPrimIdx)
+    void TriangleVboManager::uploadSinglePrimitive(TriangleColorVBOBlock* block, size_t nPrimIdx,
+        const float* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
     {
         const TrianglePrimitiveInfo& prim = block->vPrimitives[nPrimIdx];
         if (!prim.bValid)
             return;
 
-        auto it = m_vTriangleCache.find(prim.id);
-        if (it == m_vTriangleCache.end())
-            return;
+        // 共享块的颜色写入顶点属性，需要取图元自己的颜色
+        Color color = block->color;
+        if (block->bVertexColor)
+        {
+            auto locIt = m_IDLocationMap.find(prim.id);
+            if (locIt != m_IDLocationMap.end())
+                color = locIt->second.color;
+        }
 
-        const TriangleData& data = it->second;
-        size_t nVertCount = data.vertices.size() / 3;
-        size_t nIdxCount = data.indices.size();
+        // 顶点（按块格式编码）
+        uploadVertices(block, static_cast<size_t>(prim.nBaseVertex), vertices, vertexCount, color);
 
-        GLsizeiptr nVertOffset = static_cast<GLsizeiptr>(prim.nBaseVertex) * 3 * sizeof(float);
-        GLsizeiptr nIdxOffset = static_cast<GLsizeiptr>(prim.nBaseIndex) * sizeof(unsigned int);
+        // 索引（相对索引，绘制时由 basevertex 偏移）
+        uploadIndices(block, prim.nBaseIndex, indices, indexCount);
+    }
 
-        // 顶点
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-        m_gl->glBufferSubData(GL_ARRAY_BUFFER, nVertOffset,
-            static_cast<GLsizeiptr>(data.vertices.size() * sizeof(float)), data.vertices.data());
+    /**
+     * @brief 将顶点按块的格式编码后写入暂存区
+     *
+     * 块有影子副本时编码到影子副本，再从影子副本拷贝到暂存区；
+     * 否则直接编码到暂存区预留的内存中，超出暂存区容量时先编码到临时数组再上传。
+     * 共享块在每个顶点的位置之后写入 RGBA8 颜色。
+     *
+     * @param block 目标块
+     * @param nBaseVertex 起始顶点
+     * @param pXyz 顶点数据，格式为[x1,y1,z1,...]
+     * @param nVertCount 顶点数
+     * @param color 多边形颜色（仅共享块使用）
+     */
+    void TriangleVboManager::uploadVertices(TriangleColorVBOBlock* block, size_t nBaseVertex,
+        const float* pXyz, size_t nVertCount, const Color& color)
+    {
+        // 索引总是与顶点一同写入，这里同时覆盖两者
+        block->nEditEpoch++;
 
-        // 索引（需要相对于baseVertex进行偏移）
-        std::vector<unsigned int> vIndices(nIdxCount);
-        for (size_t i = 0; i < nIdxCount; ++i)
-            vIndices[i] = static_cast<unsigned int>(prim.nBaseVertex + data.indices[i]);
+        size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+        size_t nBytes = nVertCount * nStride;
+        size_t nOffset = nBaseVertex * nStride;
 
-        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-        m_gl->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, nIdxOffset,
-            static_cast<GLsizeiptr>(vIndices.size() * sizeof(unsigned int)), vIndices.data());
+        auto encodeTo = [&](unsigned char* pDst) {
+            VertexCodec::encode(block->format, block->quantBox, pXyz, nVertCount, pDst, nStride);
+            if (block->bVertexColor)
+                VertexCodec::writeColor(pDst + VertexCodec::stride(block->format), nStride, nVertCount, color.toUInt32());
+            };
+
+        if (block->shadowVbo.isEnabled())
+        {
+            block->shadowVbo.forEachSpan(nOffset, nBytes, [&](unsigned char* pSpan, size_t nRangeOffset, size_t nSpan) {
+                size_t nFirst = nRangeOffset / nStride;
+                size_t nCount = nSpan / nStride;
+                VertexCodec::encode(block->format, block->quantBox, pXyz + nFirst * 3, nCount, pSpan, nStride);
+                if (block->bVertexColor)
+                    VertexCodec::writeColor(pSpan + VertexCodec::stride(block->format), nStride, nCount, color.toUInt32());
+                m_pStaging->upload(block->vbo, nOffset + nRangeOffset, pSpan, nSpan);
+                });
+            return;
+        }
+
+        void* pDst = m_pStaging->reserve(block->vbo, nOffset, nBytes);
+        if (pDst)
+        {
+            encodeTo(static_cast<unsigned char*>(pDst));
+            return;
+        }
+
+        std::vector<unsigned char> vEncoded(nBytes);
+        encodeTo(vEncoded.data());
+        m_pStaging->upload(block->vbo, nOffset, vEncoded.data(), nBytes);
+    }
+
+    void TriangleVboManager::uploadIndices(TriangleColorVBOBlock* block, size_t nBaseIndex,
+        const unsigned int* pIndices, size_t nIdxCount)
+    {
+        size_t nOffset = nBaseIndex * sizeof(unsigned int);
+        size_t nBytes = nIdxCount * sizeof(unsigned int);
+
+        if (block->shadowEbo.isEnabled())
+            block->shadowEbo.write(nOffset, pIndices, nBytes);
+        m_pStaging->upload(block->ebo, nOffset, pIndices, nBytes);
     }
 
     /**
      * @brief 压缩VBO块，整理内存碎片
      *
      * 当块中存在被删除的多边形时，此方法负责：
-     * - 移除无效的多边形数据
-     * - 重新组织顶点和索引数据以消除空洞
-     * - 更新所有受影响的多边形的基础顶点偏移
-     * - 重置缓冲区大小为实际使用大小
-     * - 重新生成绘制命令
+     * - 在CPU端规划存活多边形的顶点区段和索引区段（只涉及图元元数据）
+     * - 用 glCopyBufferSubData 把存活数据批量拷贝到备用缓冲区，然后交换（乒乓）
+     * - 更新所有受影响的多边形的基础顶点/索引偏移，移除已删除图元的记录
+     *
+     * EBO 中存储的是相对索引，搬运后无需改写索引值；隐藏的多边形同样保留。
      *
      * @param block 要压缩的VBO块
      */
@@ -831,78 +1461,111 @@ namespace GLRhi
         if (!block->bCompact || block->nVertexCount == 0)
             return;
 
-        std::vector<float> newVerts;
-        std::vector<unsigned int> newIndices;
-        newVerts.reserve(block->nVertexCount * 3 * 3 / 4);  // 预估 75% 存活
-        newIndices.reserve(block->nIndexCount * 3 / 4);
+        // 暂存的写入指向旧缓冲区，必须在搬运前提交
+        m_pStaging->flush();
+
+        DefragPlan plan;
+        buildCompactPlan(block, plan);
+
+        size_t nMoved = plan.vertMoves.compactBuffer(m_gl, block->vbo, block->vboSpare, plan.nVertexBytes);
+        nMoved += plan.idxMoves.compactBuffer(m_gl, block->ebo, block->eboSpare, plan.nIndexBytes);
+        setupBlockVao(block);
+
+        m_compactStats.nCompactCount++;
+        m_compactStats.nCopyCalls += plan.vertMoves.getRangeCount() + plan.idxMoves.getRangeCount();
+        m_compactStats.nBytesMoved += nMoved;
+        block->nCompactBytes += nMoved;
+
+        applyCompactPlan(block, plan);
+    }
+
+    /**
+     * @brief 生成块的压缩计划
+     *
+     * 存活多边形按 vPrimitives 的顺序依次紧密排列顶点区段和索引区段。
+     * 只读取图元元数据，可以在后台线程持有读锁时调用。
+     *
+     * @param block 目标块
+     * @param plan 输出的计划
+     */
+    void TriangleVboManager::buildCompactPlan(const TriangleColorVBOBlock* block, DefragPlan& plan) const
+    {
+        const size_t nVertStride = VertexCodec::stride(block->format, block->bVertexColor);
+        constexpr size_t nIdxStride = sizeof(unsigned int);
 
-        size_t currentBase = 0;
+        plan.nBlockSerial = block->nSerial;
+        plan.nEditEpoch = block->nEditEpoch;
+        plan.vRelocations.reserve(block->vPrimitives.size() - block->vFreePrimSlots.size());
 
-        for (TrianglePrimitiveInfo& prim : block->vPrimitives)
+        size_t nCurrentBase = 0;
+        size_t nCurrentIndex = 0;
+        for (size_t i = 0; i < block->vPrimitives.size(); ++i)
         {
-            if (!prim.bValid || prim.nIndexCount <= 0)
+            const TrianglePrimitiveInfo& prim = block->vPrimitives[i];
+            if (prim.nIndexCount <= 0)
                 continue;
 
-            // Step 1: 先尝试从缓存拿（最快）
-            auto cacheIt = m_vTriangleCache.find(prim.id);
-            const TriangleData* dataPtr = nullptr;
-            TriangleData tempData;
+            size_t nIdxCount = static_cast<size_t>(prim.nIndexCount);
+            plan.vertMoves.addRange(static_cast<size_t>(prim.nBaseVertex) * nVertStride,
+                nCurrentBase * nVertStride, prim.nVertexCount * nVertStride);
+            plan.idxMoves.addRange(prim.nBaseIndex * nIdxStride,
+                nCurrentIndex * nIdxStride, nIdxCount * nIdxStride);
+            plan.vRelocations.push_back({ i, nCurrentBase, nCurrentIndex });
 
-            if (cacheIt != m_vTriangleCache.end())
-            {
-                dataPtr = &cacheIt->second;
-            }
-            else
-            {
-                // Step 2: 缓存没了？从当前 VBO 里把旧数据读回来！（关键兜底！）
-                size_t oldVertOffset = static_cast<size_t>(prim.nBaseVertex);
-                size_t vertCount = 0;
-                size_t idxCount = static_cast<size_t>(prim.nIndexCount);
-
-                // 需要从索引中推断顶点数量，或者从其他图元信息中获取
-                // 这里简化处理：假设我们知道顶点数量
-                // 实际上应该从索引的最大值+1来推断
-                // 为了简化，我们从缓存中读取，如果缓存没有，我们需要一个更好的方法
-                // 暂时跳过这种情况，或者需要存储顶点数量信息
-                continue; // 跳过没有缓存的数据
-            }
+            nCurrentBase += prim.nVertexCount;
+            nCurrentIndex += nIdxCount;
+        }
+
+        plan.nVertexCount = nCurrentBase;
+        plan.nIndexCount = nCurrentIndex;
+        plan.nVertexBytes = block->nVertexCapacity * nVertStride;
+        plan.nIndexBytes = block->nIndexCapacity * nIdxStride;
+    }
 
-            const auto& data = *dataPtr;
-            size_t nVertCount = data.vertices.size() / 3;
-            size_t nIdxCount = data.indices.size();
+    /**
+     * @brief 按重定位表改写块的图元信息
+     *
+     * 缓冲区已经交换为压缩后的内容。EBO 中存储的是相对索引，搬运后无需改写索引值。
+     *
+     * @param block 目标块
+     * @param plan 已执行的计划
+     */
+    void TriangleVboManager::applyCompactPlan(TriangleColorVBOBlock* block, const DefragPlan& plan)
+    {
+        // 影子副本按相同的区段在CPU端重排
+        block->shadowVbo.compact(plan.vertMoves,
+            plan.nVertexCount * VertexCodec::stride(block->format, block->bVertexColor));
+        block->shadowEbo.compact(plan.idxMoves, plan.nIndexCount * sizeof(unsigned int));
 
-            // 写入新缓冲区
-            newVerts.insert(newVerts.end(), data.vertices.begin(), data.vertices.end());
-            
-            // 记录索引的起始位置
-            size_t indexStart = newIndices.size();
-            
-            // 索引需要相对于新的 baseVertex 进行偏移
-            for (size_t i = 0; i < nIdxCount; ++i)
-                newIndices.push_back(static_cast<unsigned int>(currentBase + data.indices[i]));
+        std::vector<TrianglePrimitiveInfo> vLivePrims;
+        vLivePrims.reserve(plan.vRelocations.size());
+        block->idToIndexMap.clear();
 
-            // 更新 base vertex 和 base index
-            prim.nBaseVertex = static_cast<GLint>(currentBase);
-            prim.nBaseIndex = indexStart; // 更新索引偏移
-            currentBase += nVertCount;
+        for (const DefragRelocation& reloc : plan.vRelocations)
+        {
+            size_t nNewIdx = vLivePrims.size();
+            vLivePrims.push_back(block->vPrimitives[reloc.nPrimIdx]);
+            TrianglePrimitiveInfo& prim = vLivePrims.back();
+            prim.nBaseVertex = static_cast<GLint>(reloc.nNewBaseVertex);
+            prim.nBaseIndex = reloc.nNewBaseIndex;
+            prim.nIndexSlot = static_cast<size_t>(prim.nIndexCount);
+
+            block->idToIndexMap[prim.id] = nNewIdx;
+            auto locIt = m_IDLocationMap.find(prim.id);
+            if (locIt != m_IDLocationMap.end())
+                locIt->second.nPrimIdx = nNewIdx;
         }
 
-        // 一次性上传新数据
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, block->vbo);
-        m_gl->glBufferData(GL_ARRAY_BUFFER,
-            block->nVertexCapacity * 3 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
-        m_gl->glBufferSubData(GL_ARRAY_BUFFER, 0,
-            newVerts.size() * sizeof(float), newVerts.data());
-
-        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block->ebo);
-        m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-            block->nIndexCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
-        m_gl->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
-            newIndices.size() * sizeof(unsigned int), newIndices.data());
-
-        // 更新统计
-        block->nVertexCount = currentBase;
-        block->nIndexCount = newIndices.size();
+        // 压缩后没有空洞
+        block->vPrimitives.swap(vLivePrims);
+        block->vFreePrimSlots.clear();
+        block->vertAllocator.reset();
+        block->idxAllocator.reset();
+        block->nVertexCount = plan.nVertexCount;
+        block->nIndexCount = plan.nIndexCount;
+        block->nEditEpoch++;
+        block->nCompactCount++;
+        block->bFragAlerted = false;
         block->bCompact = false;
         block->bDirty = true;
     }
@@ -911,41 +1574,123 @@ namespace GLRhi
      * @brief 重建绘制命令
      *
      * 根据块中的图元数据重新生成批量绘制命令。
+     * 命令数组按可见图元数精确定长，容量在多次重建之间保留，稳定状态下不再分配内存。
      *
      * @param block 要重建命令的块
      */
     void TriangleVboManager::rebuildDrawCmds(TriangleColorVBOBlock* block)
     {
-        block->vDrawCounts.clear();
-        block->vBaseVertices.clear();
-
+        size_t nDrawCount = 0;
         for (const TrianglePrimitiveInfo& prim : block->vPrimitives)
         {
             if (prim.bValid && prim.nIndexCount > 0)
+                nDrawCount++;
+        }
+
+        block->vDrawCounts.resize(nDrawCount);
+        block->vBaseVertices.resize(nDrawCount);
+        block->vIndexOffsets.resize(nDrawCount);
+        block->vDrawPrims.resize(nDrawCount);
+        block->bounds = QuantBox();
+        block->nDrawEpoch++;
+
+        uint32_t nSlot = 0;
+        for (size_t i = 0; i < block->vPrimitives.size(); ++i)
+        {
+            TrianglePrimitiveInfo& prim = block->vPrimitives[i];
+            if (!prim.bValid || prim.nIndexCount <= 0)
             {
-                block->vDrawCounts.push_back(prim.nIndexCount);
-                block->vBaseVertices.push_back(prim.nBaseVertex);
+                prim.nDrawSlot = TrianglePrimitiveInfo::NO_DRAW_SLOT;
+                continue;
             }
+
+            block->vDrawCounts[nSlot] = prim.nIndexCount;
+            block->vBaseVertices[nSlot] = prim.nBaseVertex;
+            block->vIndexOffsets[nSlot] = reinterpret_cast<const void*>(prim.nBaseIndex * sizeof(unsigned int));
+            block->vDrawPrims[nSlot] = static_cast<uint32_t>(i);
+            block->bounds.expand(prim.bounds);
+            prim.nDrawSlot = nSlot++;
         }
 
         block->bDirty = false;
     }
 
     /**
-     * @brief 更新缓存访问顺序（LRU）
+     * @brief 增量维护单个图元的绘制命令
      *
-     * @param id 多边形ID
+     * 命令顺序不影响绘制结果，删除时把最后一条命令搬到空出的位置，
+     * 通过 vDrawPrims 反向索引修正被搬动图元的 nDrawSlot，显隐切换和删除都是 O(1)。
+     * 块包围盒只增不减，删除后偏大只会让裁剪少跳过一些块。
+     *
+     * @param block 目标块
+     * @param nPrimIdx 图元在块中的索引
      */
-    void TriangleVboManager::touchCache(long long id)
+    void TriangleVboManager::syncDrawCmd(TriangleColorVBOBlock* block, size_t nPrimIdx)
     {
-        m_triangleCacheOrder.remove(id);
-        m_triangleCacheOrder.push_front(id);
-        if (m_triangleCacheOrder.size() > MAX_CACHE_SIZE)
+        if (block->bDirty)
+            return;
+
+        TrianglePrimitiveInfo& prim = block->vPrimitives[nPrimIdx];
+        const bool bDraw = prim.bValid && prim.nIndexCount > 0;
+        const void* pIndexOffset = reinterpret_cast<const void*>(prim.nBaseIndex * sizeof(unsigned int));
+
+        block->nDrawEpoch++;
+        if (bDraw)
+            block->bounds.expand(prim.bounds);
+
+        if (bDraw && prim.nDrawSlot != TrianglePrimitiveInfo::NO_DRAW_SLOT)
         {
-            long long old = m_triangleCacheOrder.back();
-            m_triangleCacheOrder.pop_back();
-            m_vTriangleCache.erase(old);
+            // 原地改写（更新后索引数或位置变化）
+            block->vDrawCounts[prim.nDrawSlot] = prim.nIndexCount;
+            block->vBaseVertices[prim.nDrawSlot] = prim.nBaseVertex;
+            block->vIndexOffsets[prim.nDrawSlot] = pIndexOffset;
+            return;
         }
+
+        if (bDraw)
+        {
+            prim.nDrawSlot = static_cast<uint32_t>(block->vDrawCounts.size());
+            block->vDrawCounts.push_back(prim.nIndexCount);
+            block->vBaseVertices.push_back(prim.nBaseVertex);
+            block->vIndexOffsets.push_back(pIndexOffset);
+            block->vDrawPrims.push_back(static_cast<uint32_t>(nPrimIdx));
+            return;
+        }
+
+        if (prim.nDrawSlot == TrianglePrimitiveInfo::NO_DRAW_SLOT)
+            return;
+
+        // swap-remove：最后一条命令填到空位
+        uint32_t nSlot = prim.nDrawSlot;
+        uint32_t nLast = static_cast<uint32_t>(block->vDrawCounts.size() - 1);
+        if (nSlot != nLast)
+        {
+            block->vDrawCounts[nSlot] = block->vDrawCounts[nLast];
+            block->vBaseVertices[nSlot] = block->vBaseVertices[nLast];
+            block->vIndexOffsets[nSlot] = block->vIndexOffsets[nLast];
+            block->vDrawPrims[nSlot] = block->vDrawPrims[nLast];
+            block->vPrimitives[block->vDrawPrims[nSlot]].nDrawSlot = nSlot;
+        }
+
+        block->vDrawCounts.pop_back();
+        block->vBaseVertices.pop_back();
+        block->vIndexOffsets.pop_back();
+        block->vDrawPrims.pop_back();
+
+        prim.nDrawSlot = TrianglePrimitiveInfo::NO_DRAW_SLOT;
+    }
+
+    void TriangleVboManager::cacheTriangle(const TriangleColorVBOBlock* block, long long id,
+        const float* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+    {
+        if (block->shadowVbo.isEnabled())
+            return;
+
+        TriangleData data;
+        data.vertices.assign(vertices, vertices + vertexCount * 3);
+        data.indices.assign(indices, indices + indexCount);
+        m_triangleCache.put(id, std::move(data),
+            vertexCount * 3 * sizeof(float) + indexCount * sizeof(unsigned int));
     }
 
     /**
@@ -955,7 +1700,10 @@ namespace GLRhi
      */
     void TriangleVboManager::bindBlock(TriangleColorVBOBlock* block) const
     {
-        m_gl->glBindVertexArray(block->vao);
+        if (m_stateCache)
+            m_stateCache->bindVertexArray(block->vao);
+        else
+            m_gl->glBindVertexArray(block->vao);
     }
 
     /**
@@ -963,48 +1711,606 @@ namespace GLRhi
      */
     void TriangleVboManager::unbindBlock() const
     {
-        m_gl->glBindVertexArray(0);
+        if (!m_stateCache)
+            m_gl->glBindVertexArray(0);
+    }
+
+    void TriangleVboManager::setUniform4f(GLint nLoc, GLfloat x, GLfloat y, GLfloat z, GLfloat w) const
+    {
+        if (nLoc < 0)
+            return;
+
+        if (m_stateCache)
+            m_stateCache->uniform4f(nLoc, x, y, z, w);
+        else
+            m_gl->glUniform4f(nLoc, x, y, z, w);
+    }
+
+    void TriangleVboManager::setUniform1i(GLint nLoc, GLint v) const
+    {
+        if (nLoc < 0)
+            return;
+
+        if (m_stateCache)
+            m_stateCache->uniform1i(nLoc, v);
+        else
+            m_gl->glUniform1i(nLoc, v);
+    }
+
+    void TriangleVboManager::setVertexFormat(VertexFormat format)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_vertexFormat = format;
+    }
+
+    VertexFormat TriangleVboManager::getVertexFormat() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_vertexFormat;
+    }
+
+    void TriangleVboManager::setColorStorage(ColorStorage storage)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_colorStorage = storage;
+    }
+
+    ColorStorage TriangleVboManager::getColorStorage() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_colorStorage;
+    }
+
+    void TriangleVboManager::setBlockPlacement(BlockPlacement placement)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_blockPlacement = placement;
+    }
+
+    BlockPlacement TriangleVboManager::getBlockPlacement() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_blockPlacement;
+    }
+
+    void TriangleVboManager::setTileSize(float fTileSize)
+    {
+        if (fTileSize <= 0.0f)
+            return;
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_fTileSize = fTileSize;
+    }
+
+    float TriangleVboManager::getTileSize() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_fTileSize;
+    }
+
+    void TriangleVboManager::setProgram(const ProgramUniforms& prog)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_programUniforms = prog;
+    }
+
+    void TriangleVboManager::setStateCache(GLStateCache* cache)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_stateCache = cache;
+    }
+
+    void TriangleVboManager::discardStaged(const TriangleColorVBOBlock* block)
+    {
+        m_pStaging->discard(block->vbo);
+        m_pStaging->discard(block->ebo);
+        m_pStaging->discard(block->vboSpare);
+        m_pStaging->discard(block->eboSpare);
+    }
+
+    void TriangleVboManager::setStagingRing(StagingRing* pRing)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        StagingRing* pNext = pRing ? pRing : &m_ownStaging;
+        if (pNext == m_pStaging)
+            return;
+
+        // 已暂存的写入先提交，之后不会再经由原暂存区提交
+        m_pStaging->flush();
+        if (m_pStaging == &m_ownStaging)
+            m_ownStaging.destroy();
+        else if (pNext == &m_ownStaging && QOpenGLContext::currentContext())
+            m_ownStaging.initialize(QOpenGLContext::currentContext());
+        m_pStaging = pNext;
+    }
+
+    void TriangleVboManager::setViewRect(const QuantBox& viewRect)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_culler.setViewRect(viewRect);
+    }
+
+    void TriangleVboManager::setCullMargin(float fMargin)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_culler.setMargin(fMargin);
+    }
+
+    void TriangleVboManager::setLod(ViewCuller::LodMode mode, float fMinPixels)
+    {
+        // 合并后的代表图元只画第一个三角形（3 个索引）
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_culler.setLod(mode, fMinPixels, 3);
+    }
+
+    ViewCuller::LodMode TriangleVboManager::getLodMode() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_culler.getLodMode();
+    }
+
+    void TriangleVboManager::setPixelSize(float fWorldPerPixel)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_culler.setPixelSize(fWorldPerPixel);
+    }
+
+    VboCullStats TriangleVboManager::getCullStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_cullStats;
+    }
+
+    void TriangleVboManager::setQuantExtent(float fExtent)
+    {
+        if (fExtent <= 0.0f)
+            return;
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_fQuantExtent = fExtent;
+    }
+
+    VboGrowStats TriangleVboManager::getGrowStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_growStats;
+    }
+
+    void TriangleVboManager::resetGrowStats()
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_growStats = VboGrowStats{};
+    }
+
+    VboCompactStats TriangleVboManager::getCompactStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_compactStats;
+    }
+
+    StagingStats TriangleVboManager::getStagingStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_pStaging->getStats();
     }
 
     /**
-     * @brief 启动后台碎片整理线程
+     * @brief 读取多边形的顶点和索引
      *
-     * 启动一个单独的线程进行内存碎片整理，定期检查并压缩需要整理的块。
+     * 块有影子副本时直接从影子副本读取并解码，不涉及GPU。
+     * 否则先查缓存，未命中时提交暂存区，再用 glGetBufferSubData 回读，结果放回缓存。
+     * 回读会让CPU等待GPU，次数记录在 VboCacheStats::nReadbacks，需要在渲染线程调用。
+     * 两种方式都先读索引，按最大索引确定实际使用的顶点数后再读顶点区段。
+     */
+    bool TriangleVboManager::getTriangle(long long id, std::vector<float>& vVerts, std::vector<unsigned int>& vIndices)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return readTriangleLocked(id, vVerts, vIndices);
+    }
+
+    bool TriangleVboManager::readTriangleLocked(long long id, std::vector<float>& vVerts, std::vector<unsigned int>& vIndices)
+    {
+        auto it = m_IDLocationMap.find(id);
+        if (it == m_IDLocationMap.end())
+            return false;
+
+        const TriangleColorVBOBlock* block = it->second.block;
+        const TrianglePrimitiveInfo& prim = block->vPrimitives[it->second.nPrimIdx];
+        const bool bShadow = block->shadowVbo.isEnabled();
+
+        if (!bShadow)
+        {
+            if (const TriangleData* pCached = m_triangleCache.find(id))
+            {
+                vVerts = pCached->vertices;
+                vIndices = pCached->indices;
+                return true;
+            }
+
+            if (!m_gl)
+                return false;
+
+            // 该多边形可能还有未提交的写入
+            m_pStaging->flush();
+        }
+
+        // 从影子副本或GPU读取一段数据
+        auto readRange = [&](const ShadowArena& shadow, unsigned int nBuffer, size_t nOffset, size_t nBytes, void* pDst) {
+            if (bShadow)
+            {
+                shadow.read(nOffset, pDst, nBytes);
+                return;
+            }
+            m_gl->glBindBuffer(GL_COPY_READ_BUFFER, nBuffer);
+            m_gl->glGetBufferSubData(GL_COPY_READ_BUFFER,
+                static_cast<GLintptr>(nOffset), static_cast<GLsizeiptr>(nBytes), pDst);
+            m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            };
+
+        size_t nIdxCount = static_cast<size_t>(prim.nIndexCount);
+        vIndices.resize(nIdxCount);
+        readRange(block->shadowEbo, block->ebo, prim.nBaseIndex * sizeof(unsigned int),
+            nIdxCount * sizeof(unsigned int), vIndices.data());
+
+        // 缩小后的图元仍占着原槽位，只读取索引实际引用到的顶点
+        size_t nVertCount = 0;
+        for (unsigned int nIdx : vIndices)
+            nVertCount = std::max(nVertCount, static_cast<size_t>(nIdx) + 1);
+        nVertCount = std::min(nVertCount, prim.nVertexCount);
+
+        size_t nStride = VertexCodec::stride(block->format, block->bVertexColor);
+        std::vector<unsigned char> vEncoded(nVertCount * nStride);
+        readRange(block->shadowVbo, block->vbo, static_cast<size_t>(prim.nBaseVertex) * nStride,
+            vEncoded.size(), vEncoded.data());
+
+        vVerts.resize(nVertCount * 3);
+        VertexCodec::decode(block->format, block->quantBox, vEncoded.data(), nVertCount, vVerts.data(), nStride);
+
+        if (!bShadow)
+        {
+            m_nReadbacks++;
+            m_nReadbackBytes += vEncoded.size() + nIdxCount * sizeof(unsigned int);
+            cacheTriangle(block, id, vVerts.data(), nVertCount, vIndices.data(), nIdxCount);
+        }
+        return true;
+    }
+
+    size_t TriangleVboManager::queryTriangles(const QuantBox& rect, std::vector<long long>& vIds) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_spatialIndex.query(rect, vIds);
+    }
+
+    /**
+     * @brief 拾取最近的可见多边形
+     *
+     * 空间索引按包围盒距离由近到远给出候选，只有包围盒距离小于当前最优值的多边形才读取数据：
+     * 点落在任一三角形内时距离为 0，否则取点到各三角形边的最短距离。
+     */
+    bool TriangleVboManager::pickTriangle(float x, float y, float fMaxDist, long long& id, float* pDist)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+
+        std::vector<float> vVerts;
+        std::vector<unsigned int> vIndices;
+        auto fnDist = [&](long long nCandidate) {
+            auto it = m_IDLocationMap.find(nCandidate);
+            if (it == m_IDLocationMap.end() ||
+                !it->second.block->vPrimitives[it->second.nPrimIdx].bValid ||
+                !readTriangleLocked(nCandidate, vVerts, vIndices))
+                return std::numeric_limits<float>::infinity();
+
+            const size_t nVerts = vVerts.size() / 3;
+            float fBest2 = std::numeric_limits<float>::infinity();
+            for (size_t t = 0; t + 2 < vIndices.size(); t += 3)
+            {
+                if (vIndices[t] >= nVerts || vIndices[t + 1] >= nVerts || vIndices[t + 2] >= nVerts)
+                    continue;
+
+                const float* p[3] = { &vVerts[vIndices[t] * 3], &vVerts[vIndices[t + 1] * 3], &vVerts[vIndices[t + 2] * 3] };
+                float vCross[3];
+                for (int e = 0; e < 3; ++e)
+                {
+                    const float* a = p[e];
+                    const float* b = p[(e + 1) % 3];
+                    float dx = b[0] - a[0], dy = b[1] - a[1];
+                    vCross[e] = dx * (y - a[1]) - dy * (x - a[0]);
+
+                    float fLen2 = dx * dx + dy * dy;
+                    float s = fLen2 > 0.0f ? std::clamp(((x - a[0]) * dx + (y - a[1]) * dy) / fLen2, 0.0f, 1.0f) : 0.0f;
+                    float ex = a[0] + s * dx - x, ey = a[1] + s * dy - y;
+                    fBest2 = std::min(fBest2, ex * ex + ey * ey);
+                }
+
+                // 三条边的叉积同号：点在三角形内
+                if ((vCross[0] >= 0.0f && vCross[1] >= 0.0f && vCross[2] >= 0.0f) ||
+                    (vCross[0] <= 0.0f && vCross[1] <= 0.0f && vCross[2] <= 0.0f))
+                    return 0.0f;
+            }
+            return std::sqrt(fBest2);
+            };
+
+        return m_spatialIndex.nearest(x, y, fMaxDist, fnDist, id, pDist);
+    }
+
+    VboCacheStats TriangleVboManager::getCacheStats() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        VboCacheStats stats = m_triangleCache.getStats();
+        stats.nReadbacks = m_nReadbacks;
+        stats.nReadbackBytes = m_nReadbackBytes;
+        return stats;
+    }
+
+    /**
+     * @brief 启动后台碎片整理
+     *
+     * 压缩需要调用 GL，只能在渲染线程执行，因此整理拆成两部分：
+     * - 后台线程：定期在读锁下为碎片最严重的块生成计划（纯CPU），交给渲染线程
+     * - 渲染线程：stepDefrag() 每帧在预算内执行拷贝，完成后交换缓冲区
+     * 同一时刻最多只有一个计划，执行完或作废后才规划下一个。
      */
     void TriangleVboManager::startBackgroundDefrag()
     {
+        if (m_defragThread.joinable())
+            return;
+
         m_bStopDefrag = false;
+        m_bDefragEnabled = true;
         m_defragThread = std::thread([this] {
+            int nIntervalMs = 0;
+            {
+                std::shared_lock<std::shared_mutex> lock(m_mutex);
+                nIntervalMs = m_policy.defragIntervalMs();
+            }
+
             while (!m_bStopDefrag)
             {
-                for (int i = 0; i < 30 && !m_bStopDefrag.load(); ++i)
-                {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(300));
-                    if (m_bStopDefrag)
-                        return;
-                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(nIntervalMs));
+                if (m_bStopDefrag)
+                    return;
 
-                std::shared_lock lock(m_mutex);
-                for (auto& pair : m_colorBlocksMap)
+                if (m_bDefragBusy.load())
+                    continue;
+
+                std::unique_ptr<DefragPlan> pPlan;
                 {
-                    for (TriangleColorVBOBlock* block : pair.second)
-                    {
-                        // 只有使用率 < 70% 才值得整理
-                        if (block->bCompact && block->nVertexCount > 0)
-                        {
-                            double dUsage = double(block->nVertexCount) / block->nVertexCapacity;
-                            if (dUsage < COMPACT_THRESHOLD)
-                            {
-                                lock.unlock();
-                                std::unique_lock writeLock(m_mutex);
-                                compactBlock(block);
-                                break;
-                            }
-                        }
-                    }
+                    std::shared_lock<std::shared_mutex> lock(m_mutex);
+                    nIntervalMs = m_policy.defragIntervalMs();
+                    pPlan = planDefrag();
                 }
+                if (!pPlan)
+                    continue;
+
+                // 先置忙再提交，渲染线程接收前不会再规划
+                m_bDefragBusy = true;
+                std::lock_guard<std::mutex> planLock(m_defragMutex);
+                m_pPendingPlan = std::move(pPlan);
+            }
+            });
+    }
+
+    /**
+     * @brief 选择碎片最严重的块并生成整理计划
+     *
+     * 评分为空闲顶点占已用范围的比例，只有使用率低于 VboPolicy::fCompactThreshold 的块才是候选。
+     * 调用方已持有读锁，整个过程不调用GL。
+     *
+     * @return 没有需要整理的块时为空
+     */
+    std::unique_ptr<DefragPlan> TriangleVboManager::planDefrag() const
+    {
+        const TriangleColorVBOBlock* victim = nullptr;
+        double dBestScore = 1.0 - m_policy.fCompactThreshold;
+
+        auto score = [&](const TriangleColorVBOBlock* block) {
+            double dScore = DefragPlan::fragmentation(block->nVertexCount, block->vertAllocator.getFreeUnits());
+            if (dScore > dBestScore)
+            {
+                dBestScore = dScore;
+                victim = block;
+            }
+            };
+        for (const auto& pair : m_colorBlocksMap)
+            for (const TriangleColorVBOBlock* block : pair.second)
+                score(block);
+        for (const TriangleColorVBOBlock* block : m_vSharedBlocks)
+            score(block);
+
+        if (!victim)
+            return nullptr;
+
+        auto pPlan = std::make_unique<DefragPlan>();
+        pPlan->dScore = dBestScore;
+        buildCompactPlan(victim, *pPlan);
+        return pPlan;
+    }
+
+    /**
+     * @brief 在预算内推进整理计划
+     *
+     * 目标块被删除、在规划之后被编辑或整理已停止时，计划作废并释放备用缓冲区的存储；
+     * 后台线程随后按块的最新状态重新规划。
+     */
+    void TriangleVboManager::stepDefrag()
+    {
+        if (!m_pActivePlan)
+        {
+            if (!m_bDefragBusy.load())
+                return;
+
+            std::lock_guard<std::mutex> planLock(m_defragMutex);
+            m_pActivePlan = std::move(m_pPendingPlan);
+            if (!m_pActivePlan)
+                return;
+            m_compactStats.nPlanned++;
+        }
+
+        DefragPlan& plan = *m_pActivePlan;
+        TriangleColorVBOBlock* block = findBlockBySerial(plan.nBlockSerial);
+        if (!block || block->nEditEpoch != plan.nEditEpoch || !m_bDefragEnabled.load())
+        {
+            if (block && plan.bStarted)
+            {
+                VboCompactor::releaseStorage(m_gl, block->vboSpare);
+                VboCompactor::releaseStorage(m_gl, block->eboSpare);
             }
+            m_compactStats.nAborted++;
+            m_pActivePlan.reset();
+            m_bDefragBusy = false;
+            return;
+        }
+
+        auto tStart = std::chrono::steady_clock::now();
+        size_t nMoved = plan.step(m_gl, block->vbo, block->vboSpare, block->ebo, block->eboSpare, m_defragBudget);
+        double dStepMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+
+        m_compactStats.nBytesMoved += nMoved;
+        block->nCompactBytes += nMoved;
+        m_compactStats.nStepFrames++;
+        m_compactStats.dMaxStepMs = std::max(m_compactStats.dMaxStepMs, dStepMs);
+
+        if (!plan.isFinished())
+            return;
+
+        // 拷贝全部提交：交换缓冲区，旧缓冲区只保留对象名
+        std::swap(block->vbo, block->vboSpare);
+        std::swap(block->ebo, block->eboSpare);
+        VboCompactor::releaseStorage(m_gl, block->vboSpare);
+        VboCompactor::releaseStorage(m_gl, block->eboSpare);
+        setupBlockVao(block);
+
+        m_compactStats.nCompactCount++;
+        m_compactStats.nIncremental++;
+        m_compactStats.nCopyCalls += plan.vertMoves.getRangeCount() + plan.idxMoves.getRangeCount();
+
+        applyCompactPlan(block, plan);
+
+        m_pActivePlan.reset();
+        m_bDefragBusy = false;
+    }
+
+    TriangleColorVBOBlock* TriangleVboManager::findBlockBySerial(uint64_t nSerial)
+    {
+        TriangleColorVBOBlock* found = nullptr;
+        forEachBlock([&](TriangleColorVBOBlock* block) {
+            if (block->nSerial == nSerial)
+                found = block;
             });
+        return found;
+    }
+
+    void TriangleVboManager::setPolicy(const VboPolicy& policy)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_policy = policy;
+        m_triangleCache.setCapacity(m_policy.nCacheBytes);
+    }
+
+    VboPolicy TriangleVboManager::getPolicy() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_policy;
+    }
+
+    void TriangleVboManager::setFragmentationAlert(FragmentationAlert callback)
+    {
+        std::lock_guard<std::mutex> alertLock(m_alertMutex);
+        m_fragAlert = std::move(callback);
+    }
+
+    std::vector<VboBlockTelemetry> TriangleVboManager::getBlockTelemetry() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::vector<VboBlockTelemetry> vTelemetry;
+        forEachBlock([&](const TriangleColorVBOBlock* block) {
+            vTelemetry.push_back(makeTelemetry(block));
+            });
+        return vTelemetry;
+    }
+
+    VboBlockTelemetry TriangleVboManager::makeTelemetry(const TriangleColorVBOBlock* block) const
+    {
+        VboBlockTelemetry tel;
+        tel.nSerial = block->nSerial;
+        tel.bShared = block->bVertexColor;
+        tel.nColorKey = block->bVertexColor ? 0 : block->color.toUInt32();
+        tel.nVertexStride = VertexCodec::stride(block->format, block->bVertexColor);
+
+        tel.nCapacity = block->nVertexCapacity;
+        tel.nDeadVerts = std::min(block->nVertexCount, block->vertAllocator.getFreeUnits());
+        tel.nLiveVerts = block->nVertexCount - tel.nDeadVerts;
+        tel.nHoleCount = block->vertAllocator.getHoleCount();
+        tel.nLargestHole = block->vertAllocator.getLargestHole();
+        tel.nPrimCount = block->idToIndexMap.size();
+        tel.dFragmentation = DefragPlan::fragmentation(block->nVertexCount, tel.nDeadVerts);
+        tel.nIndexCapacity = block->nIndexCapacity;
+        tel.nLiveIndices = block->nIndexCount - std::min(block->nIndexCount, block->idxAllocator.getFreeUnits());
+
+        tel.nCompactCount = block->nCompactCount;
+        tel.nBytesMoved = block->nCompactBytes;
+        tel.nShadowBytes = block->shadowVbo.memoryBytes() + block->shadowEbo.memoryBytes();
+        return tel;
+    }
+
+    /**
+     * @brief 检查块的碎片率
+     *
+     * 碎片率首次超过 VboPolicy::fFragAlertThreshold 时记录一条告警，之后不再重复告警，直到块被压缩。
+     * 这里持有写锁，回调可能再调用管理器的接口，因此只记录，由 dispatchFragAlerts() 在锁外调用。
+     *
+     * @param block 目标块
+     */
+    void TriangleVboManager::checkFragmentation(TriangleColorVBOBlock* block)
+    {
+        if (block->bFragAlerted || m_policy.fFragAlertThreshold <= 0.0f)
+            return;
+
+        double dFrag = DefragPlan::fragmentation(block->nVertexCount, block->vertAllocator.getFreeUnits());
+        if (dFrag <= m_policy.fFragAlertThreshold)
+            return;
+
+        block->bFragAlerted = true;
+        std::lock_guard<std::mutex> alertLock(m_alertMutex);
+        m_vFragAlerts.push_back(makeTelemetry(block));
+    }
+
+    /**
+     * @brief 调用已记录的碎片率告警
+     *
+     * 在渲染线程绘制结束、释放写锁之后调用。未设置回调时输出警告。
+     */
+    void TriangleVboManager::dispatchFragAlerts()
+    {
+        std::vector<VboBlockTelemetry> vAlerts;
+        FragmentationAlert fnAlert;
+        {
+            std::lock_guard<std::mutex> alertLock(m_alertMutex);
+            if (m_vFragAlerts.empty())
+                return;
+            vAlerts.swap(m_vFragAlerts);
+            fnAlert = m_fragAlert;
+        }
+
+        for (const VboBlockTelemetry& tel : vAlerts)
+        {
+            if (fnAlert)
+            {
+                fnAlert(tel);
+                continue;
+            }
+
+            qWarning() << "[TriangleVboManager] block" << tel.nSerial << "fragmentation" << tel.dFragmentation
+                << "live" << tel.nLiveVerts << "dead" << tel.nDeadVerts
+                << "holes" << tel.nHoleCount << "largestHole" << tel.nLargestHole
+                << "capacity" << tel.nCapacity;
+        }
+    }
+
+    void TriangleVboManager::setDefragBudget(const DefragBudget& budget)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_defragBudget = budget;
     }
 
     /**
@@ -1012,11 +2318,10 @@ namespace GLRhi
      */
     void TriangleVboManager::stopBackgroundDefrag()
     {
+        // 未完成的计划在下一帧作废，之后绘制时恢复同步压缩
+        m_bDefragEnabled = false;
         m_bStopDefrag = true;
         if (m_defragThread.joinable())
-        {
-            m_bStopDefrag = true;
             m_defragThread.join();
-        }
     }
 } // namespace GLRhi
@@ -0,0 +1,128 @@
+#include "DataManager/VboCompactor.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace GLRhi
+{
+    void VboCompactor::addRange(size_t nSrcOffset, size_t nDstOffset, size_t nSize)
+    {
+        if (nSize == 0)
+            return;
+
+        m_nTotalBytes += nSize;
+
+        if (!m_vRanges.empty())
+        {
+            CopyRange& last = m_vRanges.back();
+            if (last.nSrcOffset + last.nSize == nSrcOffset && last.nDstOffset + last.nSize == nDstOffset)
+            {
+                last.nSize += nSize;
+                return;
+            }
+        }
+
+        m_vRanges.push_back({ nSrcOffset, nDstOffset, nSize });
+    }
+
+    void VboCompactor::clear()
+    {
+        m_vRanges.clear();
+        m_nTotalBytes = 0;
+    }
+
+    size_t VboCompactor::execute(QOpenGLFunctions_3_3_Core* gl, unsigned int nSrcBuffer, unsigned int nDstBuffer) const
+    {
+        if (!gl || m_vRanges.empty())
+            return 0;
+
+        // 使用 COPY_READ / COPY_WRITE 绑定点，不影响 VAO 记录的 ELEMENT_ARRAY_BUFFER
+        gl->glBindBuffer(GL_COPY_READ_BUFFER, nSrcBuffer);
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, nDstBuffer);
+
+        for (const CopyRange& range : m_vRanges)
+        {
+            gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                static_cast<GLintptr>(range.nSrcOffset),
+                static_cast<GLintptr>(range.nDstOffset),
+                static_cast<GLsizeiptr>(range.nSize));
+        }
+
+        gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return m_nTotalBytes;
+    }
+
+    size_t VboCompactor::compactBuffer(QOpenGLFunctions_3_3_Core* gl,
+        unsigned int& nBuffer, unsigned int& nSpare, size_t nCapacityBytes) const
+    {
+        if (!gl)
+            return 0;
+
+        allocStorage(gl, nSpare, nCapacityBytes);
+
+        size_t nMoved = execute(gl, nBuffer, nSpare);
+        std::swap(nBuffer, nSpare);
+
+        // 旧缓冲区只保留对象名，存储交给驱动回收
+        releaseStorage(gl, nSpare);
+        return nMoved;
+    }
+
+    size_t VboCompactor::executePartial(QOpenGLFunctions_3_3_Core* gl, unsigned int nSrcBuffer, unsigned int nDstBuffer,
+        Cursor& cursor, size_t nMaxBytes) const
+    {
+        if (!gl || nMaxBytes == 0 || isFinished(cursor))
+            return 0;
+
+        gl->glBindBuffer(GL_COPY_READ_BUFFER, nSrcBuffer);
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, nDstBuffer);
+
+        size_t nCopied = 0;
+        while (nCopied < nMaxBytes && !isFinished(cursor))
+        {
+            const CopyRange& range = m_vRanges[cursor.nRange];
+            size_t nSize = std::min(range.nSize - cursor.nOffset, nMaxBytes - nCopied);
+
+            gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                static_cast<GLintptr>(range.nSrcOffset + cursor.nOffset),
+                static_cast<GLintptr>(range.nDstOffset + cursor.nOffset),
+                static_cast<GLsizeiptr>(nSize));
+
+            nCopied += nSize;
+            cursor.nOffset += nSize;
+            if (cursor.nOffset == range.nSize)
+            {
+                cursor.nRange++;
+                cursor.nOffset = 0;
+            }
+        }
+
+        gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return nCopied;
+    }
+
+    void VboCompactor::allocStorage(QOpenGLFunctions_3_3_Core* gl, unsigned int& nBuffer, size_t nBytes)
+    {
+        if (!gl)
+            return;
+
+        if (nBuffer == 0)
+            gl->glGenBuffers(1, &nBuffer);
+
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, nBuffer);
+        gl->glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(nBytes), nullptr, GL_DYNAMIC_DRAW);
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    void VboCompactor::releaseStorage(QOpenGLFunctions_3_3_Core* gl, unsigned int nBuffer)
+    {
+        if (!gl || nBuffer == 0)
+            return;
+
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, nBuffer);
+        gl->glBufferData(GL_COPY_WRITE_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
+        gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+}
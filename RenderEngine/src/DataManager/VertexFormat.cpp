@@ -0,0 +1,408 @@
+#include "DataManager/VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GLRHI_BOUNDS_SSE2 1
+#endif
+
+namespace GLRhi
+{
+    namespace
+    {
+        static constexpr float INT16_MAX_F = 32767.0f;
+
+        // 包围盒的中心和半边长，退化方向的半边长取 1，避免除零
+        void boxCenterHalf(const QuantBox& box, float& cx, float& cy, float& hx, float& hy)
+        {
+            cx = (box.fMinX + box.fMaxX) * 0.5f;
+            cy = (box.fMinY + box.fMaxY) * 0.5f;
+            hx = (box.fMaxX - box.fMinX) * 0.5f;
+            hy = (box.fMaxY - box.fMinY) * 0.5f;
+            if (hx <= 0.0f)
+                hx = 1.0f;
+            if (hy <= 0.0f)
+                hy = 1.0f;
+        }
+
+        int16_t quantize(float v, float c, float h)
+        {
+            float t = std::clamp((v - c) / h, -1.0f, 1.0f);
+            return static_cast<int16_t>(std::lround(t * INT16_MAX_F));
+        }
+    }
+
+    void QuantBox::expand(float x, float y)
+    {
+        if (isEmpty())
+        {
+            fMinX = fMaxX = x;
+            fMinY = fMaxY = y;
+            return;
+        }
+
+        fMinX = std::min(fMinX, x);
+        fMinY = std::min(fMinY, y);
+        fMaxX = std::max(fMaxX, x);
+        fMaxY = std::max(fMaxY, y);
+    }
+
+    void QuantBox::expand(const QuantBox& other)
+    {
+        if (other.isEmpty())
+            return;
+
+        expand(other.fMinX, other.fMinY);
+        expand(other.fMaxX, other.fMaxY);
+    }
+
+    bool QuantBox::contains(const QuantBox& other) const
+    {
+        if (isEmpty() || other.isEmpty())
+            return false;
+
+        return other.fMinX >= fMinX && other.fMaxX <= fMaxX &&
+            other.fMinY >= fMinY && other.fMaxY <= fMaxY;
+    }
+
+    bool QuantBox::intersects(const QuantBox& other) const
+    {
+        if (isEmpty() || other.isEmpty())
+            return false;
+
+        return other.fMinX <= fMaxX && other.fMaxX >= fMinX &&
+            other.fMinY <= fMaxY && other.fMaxY >= fMinY;
+    }
+
+    size_t VertexCodec::stride(VertexFormat format, bool bVertexColor)
+    {
+        size_t nColor = bVertexColor ? COLOR_BYTES : 0;
+        switch (format)
+        {
+        case VertexFormat::Float2:
+            return 2 * sizeof(float) + nColor;
+        case VertexFormat::Half2:
+        case VertexFormat::Int16Quant:
+            return 2 * sizeof(uint16_t) + nColor;
+        case VertexFormat::Float3:
+        default:
+            return 3 * sizeof(float) + nColor;
+        }
+    }
+
+    bool VertexCodec::needsBox(VertexFormat format)
+    {
+        return format == VertexFormat::Half2 || format == VertexFormat::Int16Quant;
+    }
+
+    QuantBox VertexCodec::boundsOf(const float* pXyz, size_t nVertCount)
+    {
+        QuantBox box;
+        if (nVertCount == 0)
+            return box;
+
+        float fMinX = pXyz[0], fMinY = pXyz[1];
+        float fMaxX = fMinX, fMaxY = fMinY;
+        size_t i = 0;
+
+#ifdef GLRHI_BOUNDS_SSE2
+        if (nVertCount >= 4)
+        {
+            // 4 个顶点正好是 12 个 float、3 个寄存器，x / y 所在的通道固定：
+            // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+            // 循环内按通道取 min / max，结束后再从对应通道归并
+            __m128 vMinA = _mm_loadu_ps(pXyz);
+            __m128 vMinB = _mm_loadu_ps(pXyz + 4);
+            __m128 vMinC = _mm_loadu_ps(pXyz + 8);
+            __m128 vMaxA = vMinA, vMaxB = vMinB, vMaxC = vMinC;
+
+            for (i = 4; i + 4 <= nVertCount; i += 4)
+            {
+                const float* p = pXyz + i * 3;
+                __m128 a = _mm_loadu_ps(p);
+                __m128 b = _mm_loadu_ps(p + 4);
+                __m128 c = _mm_loadu_ps(p + 8);
+                vMinA = _mm_min_ps(vMinA, a);
+                vMaxA = _mm_max_ps(vMaxA, a);
+                vMinB = _mm_min_ps(vMinB, b);
+                vMaxB = _mm_max_ps(vMaxB, b);
+                vMinC = _mm_min_ps(vMinC, c);
+                vMaxC = _mm_max_ps(vMaxC, c);
+            }
+
+            float mnA[4], mnB[4], mnC[4], mxA[4], mxB[4], mxC[4];
+            _mm_storeu_ps(mnA, vMinA);
+            _mm_storeu_ps(mnB, vMinB);
+            _mm_storeu_ps(mnC, vMinC);
+            _mm_storeu_ps(mxA, vMaxA);
+            _mm_storeu_ps(mxB, vMaxB);
+            _mm_storeu_ps(mxC, vMaxC);
+
+            fMinX = std::min({ mnA[0], mnA[3], mnB[2], mnC[1] });
+            fMinY = std::min({ mnA[1], mnB[0], mnB[3], mnC[2] });
+            fMaxX = std::max({ mxA[0], mxA[3], mxB[2], mxC[1] });
+            fMaxY = std::max({ mxA[1], mxB[0], mxB[3], mxC[2] });
+        }
+#endif
+
+        for (; i < nVertCount; ++i)
+        {
+            fMinX = std::min(fMinX, pXyz[i * 3]);
+            fMinY = std::min(fMinY, pXyz[i * 3 + 1]);
+            fMaxX = std::max(fMaxX, pXyz[i * 3]);
+            fMaxY = std::max(fMaxY, pXyz[i * 3 + 1]);
+        }
+
+        box.fMinX = fMinX;
+        box.fMinY = fMinY;
+        box.fMaxX = fMaxX;
+        box.fMaxY = fMaxY;
+        return box;
+    }
+
+    QuantBox VertexCodec::makeBlockBox(const QuantBox& need, float fMinExtent)
+    {
+        float cx = (need.fMinX + need.fMaxX) * 0.5f;
+        float cy = (need.fMinY + need.fMaxY) * 0.5f;
+        float hx = std::max((need.fMaxX - need.fMinX) * 0.5f, fMinExtent * 0.5f);
+        float hy = std::max((need.fMaxY - need.fMinY) * 0.5f, fMinExtent * 0.5f);
+
+        QuantBox box;
+        box.fMinX = cx - hx;
+        box.fMinY = cy - hy;
+        box.fMaxX = cx + hx;
+        box.fMaxY = cy + hy;
+        return box;
+    }
+
+    void VertexCodec::encode(VertexFormat format, const QuantBox& box,
+        const float* pXyz, size_t nVertCount, void* pDst, size_t nDstStride)
+    {
+        const size_t nPacked = stride(format);
+        if (nDstStride == 0)
+            nDstStride = nPacked;
+
+        unsigned char* pBytes = static_cast<unsigned char*>(pDst);
+
+        if (format == VertexFormat::Float3 && nDstStride == nPacked)
+        {
+            std::memcpy(pDst, pXyz, nVertCount * nPacked);
+            return;
+        }
+
+        if (format == VertexFormat::Float3 || format == VertexFormat::Float2)
+        {
+            // 逐顶点拷贝前 2 或 3 个分量
+            for (size_t i = 0; i < nVertCount; ++i)
+                std::memcpy(pBytes + i * nDstStride, pXyz + i * 3, nPacked);
+            return;
+        }
+
+        float cx, cy, hx, hy;
+        boxCenterHalf(box, cx, cy, hx, hy);
+
+        for (size_t i = 0; i < nVertCount; ++i)
+        {
+            uint16_t v[2];
+            if (format == VertexFormat::Half2)
+            {
+                v[0] = floatToHalf(pXyz[i * 3] - cx);
+                v[1] = floatToHalf(pXyz[i * 3 + 1] - cy);
+            }
+            else
+            {
+                v[0] = static_cast<uint16_t>(quantize(pXyz[i * 3], cx, hx));
+                v[1] = static_cast<uint16_t>(quantize(pXyz[i * 3 + 1], cy, hy));
+            }
+            std::memcpy(pBytes + i * nDstStride, v, sizeof(v));
+        }
+    }
+
+    void VertexCodec::decode(VertexFormat format, const QuantBox& box,
+        const void* pSrc, size_t nVertCount, float* pXyz, size_t nSrcStride)
+    {
+        const size_t nPacked = stride(format);
+        if (nSrcStride == 0)
+            nSrcStride = nPacked;
+
+        const unsigned char* pBytes = static_cast<const unsigned char*>(pSrc);
+
+        if (format == VertexFormat::Float3 && nSrcStride == nPacked)
+        {
+            std::memcpy(pXyz, pSrc, nVertCount * nPacked);
+            return;
+        }
+
+        if (format == VertexFormat::Float3 || format == VertexFormat::Float2)
+        {
+            for (size_t i = 0; i < nVertCount; ++i)
+            {
+                pXyz[i * 3 + 2] = 0.0f;
+                std::memcpy(pXyz + i * 3, pBytes + i * nSrcStride, nPacked);
+            }
+            return;
+        }
+
+        float cx, cy, hx, hy;
+        boxCenterHalf(box, cx, cy, hx, hy);
+
+        for (size_t i = 0; i < nVertCount; ++i)
+        {
+            uint16_t v[2];
+            std::memcpy(v, pBytes + i * nSrcStride, sizeof(v));
+            if (format == VertexFormat::Half2)
+            {
+                pXyz[i * 3] = halfToFloat(v[0]) + cx;
+                pXyz[i * 3 + 1] = halfToFloat(v[1]) + cy;
+            }
+            else
+            {
+                pXyz[i * 3] = static_cast<int16_t>(v[0]) / INT16_MAX_F * hx + cx;
+                pXyz[i * 3 + 1] = static_cast<int16_t>(v[1]) / INT16_MAX_F * hy + cy;
+            }
+            pXyz[i * 3 + 2] = 0.0f;
+        }
+    }
+
+    void VertexCodec::writeColor(void* pDst, size_t nDstStride, size_t nVertCount, uint32_t nRgba)
+    {
+        unsigned char* pBytes = static_cast<unsigned char*>(pDst);
+        for (size_t i = 0; i < nVertCount; ++i)
+            std::memcpy(pBytes + i * nDstStride, &nRgba, COLOR_BYTES);
+    }
+
+    void VertexCodec::setupAttrib(QOpenGLFunctions_3_3_Core* gl, VertexFormat format, bool bVertexColor)
+    {
+        const GLsizei nStride = static_cast<GLsizei>(stride(format, bVertexColor));
+
+        if (bVertexColor)
+        {
+            // 颜色紧跟在位置之后
+            gl->glEnableVertexAttribArray(1);
+            gl->glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, nStride,
+                reinterpret_cast<const void*>(stride(format)));
+        }
+        else
+        {
+            gl->glDisableVertexAttribArray(1);
+        }
+
+        gl->glEnableVertexAttribArray(0);
+        switch (format)
+        {
+        case VertexFormat::Float2:
+            gl->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, nStride, nullptr);
+            break;
+        case VertexFormat::Half2:
+            gl->glVertexAttribPointer(0, 2, GL_HALF_FLOAT, GL_FALSE, nStride, nullptr);
+            break;
+        case VertexFormat::Int16Quant:
+            gl->glVertexAttribPointer(0, 2, GL_SHORT, GL_TRUE, nStride, nullptr);
+            break;
+        case VertexFormat::Float3:
+        default:
+            gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, nStride, nullptr);
+            break;
+        }
+    }
+
+    void VertexCodec::dequantParams(VertexFormat format, const QuantBox& box, float out[4])
+    {
+        out[0] = 1.0f;
+        out[1] = 1.0f;
+        out[2] = 0.0f;
+        out[3] = 0.0f;
+
+        if (!needsBox(format))
+            return;
+
+        float cx, cy, hx, hy;
+        boxCenterHalf(box, cx, cy, hx, hy);
+
+        // Half2 存储的是相对中心的偏移；Int16Quant 归一化到 [-1, 1]，再乘半边长
+        if (format == VertexFormat::Int16Quant)
+        {
+            out[0] = hx;
+            out[1] = hy;
+        }
+        out[2] = cx;
+        out[3] = cy;
+    }
+
+    uint16_t VertexCodec::floatToHalf(float f)
+    {
+        uint32_t x = 0;
+        std::memcpy(&x, &f, sizeof(x));
+
+        uint16_t nSign = static_cast<uint16_t>((x >> 16) & 0x8000u);
+        int nExp = static_cast<int>((x >> 23) & 0xFFu) - 127 + 15;
+        uint32_t nMant = x & 0x7FFFFFu;
+
+        if (((x >> 23) & 0xFFu) == 0xFFu)       // Inf / NaN
+            return static_cast<uint16_t>(nSign | 0x7C00u | (nMant ? 0x200u : 0u));
+
+        if (nExp >= 31)                         // 溢出，截断为最大有限值
+            return static_cast<uint16_t>(nSign | 0x7BFFu);
+
+        if (nExp <= 0)                          // 非规格化数或下溢为0
+        {
+            if (nExp < -10)
+                return nSign;
+
+            nMant |= 0x800000u;
+            int nShift = 14 - nExp;
+            uint32_t nHalfMant = nMant >> nShift;
+            uint32_t nRound = (nMant >> (nShift - 1)) & 1u;
+            return static_cast<uint16_t>(nSign | (nHalfMant + nRound));
+        }
+
+        // 规格化数，舍入到最近（尾数进位会自然进到指数位）
+        uint32_t nHalf = (static_cast<uint32_t>(nExp) << 10) | (nMant >> 13);
+        if (nMant & 0x1000u)
+            ++nHalf;
+        if (nHalf > 0x7BFFu)
+            nHalf = 0x7BFFu;
+        return static_cast<uint16_t>(nSign | nHalf);
+    }
+
+    float VertexCodec::halfToFloat(uint16_t h)
+    {
+        uint32_t nSign = static_cast<uint32_t>(h & 0x8000u) << 16;
+        uint32_t nExp = (h >> 10) & 0x1Fu;
+        uint32_t nMant = h & 0x3FFu;
+        uint32_t x = 0;
+
+        if (nExp == 0x1Fu)                      // Inf / NaN
+        {
+            x = nSign | 0x7F800000u | (nMant << 13);
+        }
+        else if (nExp == 0)
+        {
+            if (nMant == 0)                     // ±0
+            {
+                x = nSign;
+            }
+            else                                // 非规格化数，规格化后转换
+            {
+                int nE = -1;
+                do
+                {
+                    ++nE;
+                    nMant <<= 1;
+                } while ((nMant & 0x400u) == 0);
+                x = nSign | (static_cast<uint32_t>(127 - 15 - nE) << 23) | ((nMant & 0x3FFu) << 13);
+            }
+        }
+        else
+        {
+            x = nSign | ((nExp + 127 - 15) << 23) | (nMant << 13);
+        }
+
+        float f = 0.0f;
+        std::memcpy(&f, &x, sizeof(f));
+        return f;
+    }
+}
@@ -0,0 +1,163 @@
+#include "DataManager/ViewCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace GLRhi
+{
+    bool ViewCuller::setViewRect(const QuantBox& viewRect)
+    {
+        if (viewRect.isEmpty())
+        {
+            if (m_cullRect.isEmpty())
+                return false;
+
+            m_cullRect = QuantBox();
+            m_nEpoch++;
+            return true;
+        }
+
+        float fW = viewRect.fMaxX - viewRect.fMinX;
+        float fH = viewRect.fMaxY - viewRect.fMinY;
+
+        if (m_cullRect.contains(viewRect))
+        {
+            // 外扩后的宽高是可见范围的 (1 + 2 * margin) 倍，放大超过一倍时缓存的列表过于保守
+            float fLimit = 2.0f * (1.0f + 2.0f * m_fMargin);
+            if (fW * fLimit >= m_cullRect.fMaxX - m_cullRect.fMinX &&
+                fH * fLimit >= m_cullRect.fMaxY - m_cullRect.fMinY)
+                return false;
+        }
+
+        m_cullRect.fMinX = viewRect.fMinX - fW * m_fMargin;
+        m_cullRect.fMinY = viewRect.fMinY - fH * m_fMargin;
+        m_cullRect.fMaxX = viewRect.fMaxX + fW * m_fMargin;
+        m_cullRect.fMaxY = viewRect.fMaxY + fH * m_fMargin;
+        m_nEpoch++;
+        return true;
+    }
+
+    void ViewCuller::setMargin(float fMargin)
+    {
+        m_fMargin = std::max(fMargin, 0.0f);
+    }
+
+    bool ViewCuller::setLod(LodMode mode, float fMinPixels, GLsizei nCollapsedCount)
+    {
+        nCollapsedCount = std::max<GLsizei>(nCollapsedCount, 1);
+        bool bChanged = m_lodMode != mode || (mode == LodMode::Coverage && m_nCollapsedCount != nCollapsedCount);
+        m_lodMode = mode;
+        m_nCollapsedCount = nCollapsedCount;
+        m_fMinPixels = std::max(fMinPixels, 0.0f);
+        if (updateLodSize())
+            return true;
+
+        if (bChanged)
+            m_nEpoch++;
+        return bChanged;
+    }
+
+    bool ViewCuller::setPixelSize(float fWorldPerPixel)
+    {
+        m_fPixelSize = std::max(fWorldPerPixel, 0.0f);
+        bool bLevel = updatePixelLevel();
+        return updateLodSize() || bLevel;
+    }
+
+    void ViewCuller::setPixelLevels(bool bEnable)
+    {
+        if (m_bPixelLevels == bEnable)
+            return;
+
+        m_bPixelLevels = bEnable;
+        m_nEpoch++;
+    }
+
+    bool ViewCuller::updatePixelLevel()
+    {
+        float fLevel = 0.0f;
+        if (m_fPixelSize > 0.0f && std::isfinite(m_fPixelSize))
+        {
+            int nExp = 0;
+            std::frexp(m_fPixelSize, &nExp);
+            fLevel = std::ldexp(0.5f, nExp);
+        }
+
+        if (fLevel == m_fPixelLevel)
+            return false;
+
+        m_fPixelLevel = fLevel;
+        if (m_bPixelLevels)
+            m_nEpoch++;
+        return m_bPixelLevels;
+    }
+
+    bool ViewCuller::updateLodSize()
+    {
+        // 向下取到 2 的整数次幂：缩放在同一档内时阈值不变，已缓存的裁剪列表继续使用
+        float fLodSize = 0.0f;
+        float fSize = m_fMinPixels * m_fPixelSize;
+        if (m_lodMode != LodMode::Off && fSize > 0.0f && std::isfinite(fSize))
+        {
+            int nExp = 0;
+            std::frexp(fSize, &nExp);
+            fLodSize = std::ldexp(0.5f, nExp);
+        }
+
+        if (fLodSize == m_fLodSize)
+            return false;
+
+        m_fLodSize = fLodSize;
+        if (m_lodMode != LodMode::Off)
+            m_nEpoch++;
+        return true;
+    }
+
+    ViewCuller::Coverage ViewCuller::classify(const QuantBox& bounds) const
+    {
+        if (!m_cullRect.intersects(bounds))
+            return Coverage::Outside;
+
+        if (m_lodMode != LodMode::Off && m_fLodSize > 0.0f)
+        {
+            // 整块都小于阈值时块内每个图元都过小；否则块内可能有需要过滤的图元，不能直接用完整列表
+            float fExtent = std::max(bounds.fMaxX - bounds.fMinX, bounds.fMaxY - bounds.fMinY);
+            if (fExtent < m_fLodSize && m_lodMode == LodMode::Skip)
+                return Coverage::Outside;
+            return Coverage::Partial;
+        }
+
+        if (m_cullRect.contains(bounds))
+            return Coverage::Inside;
+        return Coverage::Partial;
+    }
+
+    void ViewCuller::beginList(CulledDraws& out)
+    {
+        out.vDrawCounts.clear();
+        out.vBaseVertices.clear();
+        out.vIndexOffsets.clear();
+        out.nLodDropped = 0;
+        out.nSimplified = 0;
+        m_cells.clear();
+    }
+
+    ViewCuller::Detail ViewCuller::detailOf(const QuantBox& bounds)
+    {
+        if (m_lodMode == LodMode::Off || m_fLodSize <= 0.0f)
+            return Detail::Keep;
+
+        float fExtent = std::max(bounds.fMaxX - bounds.fMinX, bounds.fMaxY - bounds.fMinY);
+        if (fExtent >= m_fLodSize)
+            return Detail::Keep;
+        if (m_lodMode == LodMode::Skip)
+            return Detail::Drop;
+
+        // 按中心所在格子合并，格子边长等于阈值：同一格子里只保留块内第一个图元
+        double dX = std::floor(0.5 * (double(bounds.fMinX) + bounds.fMaxX) / m_fLodSize);
+        double dY = std::floor(0.5 * (double(bounds.fMinY) + bounds.fMaxY) / m_fLodSize);
+        uint64_t nKey = (static_cast<uint64_t>(static_cast<int64_t>(dX)) << 32) ^
+            static_cast<uint32_t>(static_cast<int64_t>(dY));
+        return m_cells.insert(nKey).second ? Detail::Collapse : Detail::Drop;
+    }
+}
@@ -41,7 +41,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
         m_uCellSizeLoc = m_program->uniformLocation("uCellSize");
         m_uLightColorLoc = m_program->uniformLocation("uLightColor");
         m_uDarkColorLoc = m_program->uniformLocation("uDarkColor");
@@ -54,7 +54,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->release();
+        releaseProgram();
 
         float verts[] = {
             -1.0f, -1.0f,
@@ -63,7 +63,7 @@ namespace GLRhi
         };
         m_gl->glGenVertexArrays(1, &m_nVao);
         m_gl->glGenBuffers(1, &m_nVbo);
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVbo);
         m_gl->glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
         m_gl->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
@@ -77,7 +77,7 @@ namespace GLRhi
             return false;
         }
 
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
 
         return true;
     }
@@ -88,7 +88,7 @@ namespace GLRhi
             return;
 
         m_gl->glDisable(GL_DEPTH_TEST); // 棋盘格在最底层
-        m_program->bind();
+        useProgram();
 
         const QVector3D lightColor(m_colorA.r(), m_colorA.g(), m_colorA.b());
         const QVector3D darkColor(m_colorB.r(), m_colorB.g(), m_colorB.b());
@@ -100,11 +100,11 @@ namespace GLRhi
         if (m_uDarkColorLoc >= 0)
             m_program->setUniformValue(m_uDarkColorLoc, darkColor);
 
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
         m_gl->glDrawArrays(GL_TRIANGLES, 0, 3);
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
 
-        m_program->release();
+        releaseProgram();
         m_gl->glEnable(GL_DEPTH_TEST);
     }
 
@@ -26,7 +26,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
         m_uCameraMatLoc = m_program->uniformLocation("uCameraMat");
         m_uColorLoc = m_program->uniformLocation("uColor");
         m_uDepthLoc = m_program->uniformLocation("uDepth");
@@ -39,7 +39,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->release();
+        releaseProgram();
 
         GLenum error = m_gl->glGetError();
         if (error != GL_NO_ERROR)
@@ -57,7 +57,7 @@ namespace GLRhi
         if (!m_gl || !m_program || m_vIndices.empty() || m_vPlineInfos.empty())
             return;
 
-        m_program->bind();
+        useProgram();
 
         if (m_uCameraMatLoc >= 0 && matMVP)
         {
@@ -73,7 +73,7 @@ namespace GLRhi
         m_gl->glEnable(GL_PRIMITIVE_RESTART);
         m_gl->glPrimitiveRestartIndex(0xFFFFFFFF);
 
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
         size_t indexOffset = 0;
         const size_t maxIndices = m_vIndices.size();
 
@@ -118,9 +118,9 @@ namespace GLRhi
         }
 
         m_gl->glDisable(GL_PRIMITIVE_RESTART);
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
 
-        m_program->release();
+        releaseProgram();
     }
 
     void ColorLineRenderer::cleanup()
@@ -128,7 +128,7 @@ namespace GLRhi
         if (!m_gl)
             return;
 
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
         m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
@@ -148,7 +148,7 @@ namespace GLRhi
         if (!m_gl || polylines.empty())
             return;
 
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
         m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
@@ -188,7 +188,7 @@ namespace GLRhi
         }
 
         m_gl->glGenVertexArrays(1, &m_nVao);
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
 
         m_gl->glGenBuffers(1, &m_nVbo);
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVbo);
@@ -201,7 +201,7 @@ namespace GLRhi
         m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_nEbo);
         m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_vIndices.size() * sizeof(GLuint), m_vIndices.data(), GL_STATIC_DRAW);
 
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 }
\ No newline at end of file
@@ -29,7 +29,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
         m_uCameraMatLoc = m_program->uniformLocation("cameraMat");
         m_uDepthLoc = m_program->uniformLocation("depth");
 
@@ -49,7 +49,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->release();
+        releaseProgram();
         return true;
     }
 
@@ -58,7 +58,7 @@ namespace GLRhi
         if (!m_gl || !m_program || m_vTriDatas.empty())
             return;
 
-        m_program->bind();
+        useProgram();
         if (m_uCameraMatLoc >= 0 && matMVP)
             m_program->setUniformValue(m_uCameraMatLoc, QMatrix4x4(matMVP));
 
@@ -79,11 +79,11 @@ namespace GLRhi
             //m_program->setUniformValue("color", QVector4D(
             //    data.brush.r(), data.brush.g(), data.brush.b(), 1.0f));
 
-            //m_gl->glBindVertexArray(data.vao);
+            //bindVao(data.vao);
             //m_gl->glDrawArrays(GL_TRIANGLES, 0, data.count);
-            //m_gl->glBindVertexArray(0);
+            //bindVao(0);
         }
-        m_program->release();
+        releaseProgram();
     }
 
     void ColorTriangleRenderer::cleanup()
@@ -110,7 +110,7 @@ namespace GLRhi
 
         //m_gl->glGenVertexArrays(1, &triData.vao);
         //m_gl->glGenBuffers(1, &triData.vbo);
-        //m_gl->glBindVertexArray(triData.vao);
+        //bindVao(triData.vao);
         //m_gl->glBindBuffer(GL_ARRAY_BUFFER, triData.vbo);
         //m_gl->glBufferData(GL_ARRAY_BUFFER, triData.verts.size() * sizeof(float),
         //    triData.verts.data(), GL_STATIC_DRAW);
@@ -122,7 +122,7 @@ namespace GLRhi
         //m_gl->glEnableVertexAttribArray(1);
 
         //m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
-        //m_gl->glBindVertexArray(0);
+        //bindVao(0);
 
         //m_vTriDatas.push_back(std::move(triData));
     }
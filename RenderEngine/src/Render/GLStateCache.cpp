@@ -0,0 +1,131 @@
+#include "Render/GLStateCache.h"
+
+#include <cstring>
+
+namespace GLRhi
+{
+    ProgramUniforms ProgramUniforms::resolve(QOpenGLFunctions_3_3_Core* gl, GLuint nProgram)
+    {
+        ProgramUniforms prog;
+        if (!gl || nProgram == 0)
+            return prog;
+
+        prog.nProgram = nProgram;
+        prog.nColorLoc = gl->glGetUniformLocation(nProgram, "uColor");
+        prog.nQuantBoxLoc = gl->glGetUniformLocation(nProgram, "uQuantBox");
+        prog.nUseVertexColorLoc = gl->glGetUniformLocation(nProgram, "uUseVertexColor");
+        return prog;
+    }
+
+    void GLStateCache::initialize(QOpenGLFunctions_3_3_Core* gl)
+    {
+        m_gl = gl;
+        invalidate();
+        m_frameStats = GLStateStats();
+        m_lastFrameStats = GLStateStats();
+    }
+
+    void GLStateCache::beginFrame()
+    {
+        m_lastFrameStats = m_frameStats;
+        m_frameStats = GLStateStats();
+        invalidate();
+    }
+
+    void GLStateCache::endFrame()
+    {
+        bindVertexArray(0);
+        useProgram(0);
+    }
+
+    void GLStateCache::invalidate()
+    {
+        m_nProgram = UNKNOWN;
+        m_nVao = UNKNOWN;
+        m_uniforms.clear();
+    }
+
+    void GLStateCache::useProgram(GLuint nProgram)
+    {
+        if (nProgram == m_nProgram)
+        {
+            m_frameStats.nSkipped++;
+            return;
+        }
+
+        m_gl->glUseProgram(nProgram);
+        m_nProgram = nProgram;
+        m_frameStats.nIssued++;
+    }
+
+    void GLStateCache::bindVertexArray(GLuint nVao)
+    {
+        if (nVao == m_nVao)
+        {
+            m_frameStats.nSkipped++;
+            return;
+        }
+
+        m_gl->glBindVertexArray(nVao);
+        m_nVao = nVao;
+        m_frameStats.nIssued++;
+    }
+
+    void GLStateCache::uniform1i(GLint nLoc, GLint v)
+    {
+        // 按位存放，比较时与 float 值一样处理
+        GLfloat vBits[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        std::memcpy(&vBits[0], &v, sizeof(v));
+        if (!updateUniform(nLoc, vBits))
+            return;
+
+        m_gl->glUniform1i(nLoc, v);
+    }
+
+    void GLStateCache::uniform1f(GLint nLoc, GLfloat v)
+    {
+        GLfloat vVals[4] = { v, 0.0f, 0.0f, 0.0f };
+        if (!updateUniform(nLoc, vVals))
+            return;
+
+        m_gl->glUniform1f(nLoc, v);
+    }
+
+    void GLStateCache::uniform4f(GLint nLoc, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+    {
+        GLfloat vVals[4] = { x, y, z, w };
+        if (!updateUniform(nLoc, vVals))
+            return;
+
+        m_gl->glUniform4f(nLoc, x, y, z, w);
+    }
+
+    bool GLStateCache::updateUniform(GLint nLoc, const GLfloat v[4])
+    {
+        if (nLoc < 0)
+            return false;
+
+        // 程序未知时无法判断 uniform 属于哪个程序，直接发出
+        if (m_nProgram == UNKNOWN)
+        {
+            m_frameStats.nIssued++;
+            return true;
+        }
+
+        std::vector<UniformValue>& vValues = m_uniforms[m_nProgram];
+        if (static_cast<size_t>(nLoc) >= vValues.size())
+            vValues.resize(static_cast<size_t>(nLoc) + 1);
+
+        UniformValue& cached = vValues[static_cast<size_t>(nLoc)];
+        if (cached.bSet && std::memcmp(cached.v, v, sizeof(cached.v)) == 0)
+        {
+            m_frameStats.nSkipped++;
+            return false;
+        }
+
+        cached.bSet = true;
+        std::memcpy(cached.v, v, sizeof(cached.v));
+        m_frameStats.nIssued++;
+        return true;
+    }
+}
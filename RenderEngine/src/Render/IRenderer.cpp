@@ -26,9 +26,36 @@ namespace GLRhi
         return ebo;
     }
 
+    void IRenderer::setStateCache(GLStateCache* cache)
+    {
+        m_stateCache = cache;
+    }
+
+    void IRenderer::useProgram()
+    {
+        if (!m_program)
+            return;
+
+        if (m_stateCache)
+            m_stateCache->useProgram(m_program->programId());
+        else
+            m_program->bind();
+    }
+
+    void IRenderer::releaseProgram()
+    {
+        // 有状态缓存时保留当前程序，下一个渲染器切换程序时再替换，帧末由 endFrame() 解绑
+        if (m_stateCache || !m_program)
+            return;
+
+        m_program->release();
+    }
+
     void IRenderer::bindVao(GLuint vao)
     {
-        if (m_gl)
+        if (m_stateCache)
+            m_stateCache->bindVertexArray(vao);
+        else if (m_gl)
             m_gl->glBindVertexArray(vao);
     }
 
@@ -75,7 +102,7 @@ namespace GLRhi
     {
         if (m_gl)
         {
-            m_gl->glBindVertexArray(0);
+            bindVao(0);
             m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
             m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
         }
@@ -112,6 +139,10 @@ namespace GLRhi
     {
         if (program)
         {
+            // 程序名会被 GL 复用，删除当前程序后缓存的状态不再可信
+            if (m_stateCache && m_stateCache->currentProgram() == program->programId())
+                m_stateCache->invalidate();
+
             delete program;
             program = nullptr;
         }
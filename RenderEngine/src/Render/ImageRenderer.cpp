@@ -26,7 +26,7 @@ namespace GLRhi
         m_gl->glGenVertexArrays(1, &m_nVao);
         m_gl->glGenBuffers(1, &m_nVbo);
 
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVbo);
 
         m_gl->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), nullptr);
@@ -36,7 +36,7 @@ namespace GLRhi
         m_gl->glEnableVertexAttribArray(1);
 
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
 
         m_program = new QOpenGLShaderProgram;
         if (!m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, chImageVS) ||
@@ -48,7 +48,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
         m_uCameraMatLoc = m_program->uniformLocation("uCameraMat");
         m_uTextureLoc = m_program->uniformLocation("uTex");
         m_uDepthLoc = m_program->uniformLocation("uDepth");
@@ -64,7 +64,7 @@ namespace GLRhi
         if (m_uTextureLoc >= 0)
             m_program->setUniformValue(m_uTextureLoc, 0);
 
-        m_program->release();
+        releaseProgram();
 
         GLenum error = m_gl->glGetError();
         if (error != GL_NO_ERROR)
@@ -83,12 +83,12 @@ namespace GLRhi
             return;
 
         m_gl->glDisable(GL_CULL_FACE);
-        m_program->bind();
+        useProgram();
 
         if (m_uCameraMatLoc >= 0)
             m_program->setUniformValue(m_uCameraMatLoc, QMatrix3x3(matMVP));
 
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
 
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVbo);
 
@@ -110,9 +110,9 @@ namespace GLRhi
             m_gl->glBindTexture(GL_TEXTURE_2D, 0);
         }
 
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
-        m_program->release();
+        releaseProgram();
         m_gl->glEnable(GL_CULL_FACE);
     }
 
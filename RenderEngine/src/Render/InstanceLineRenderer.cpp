@@ -34,7 +34,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
         m_uCameraMatLoc = m_program->uniformLocation("uCameraMat");
 
         bool bUniformError = (m_uCameraMatLoc < 0);
@@ -45,7 +45,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->release();
+        releaseProgram();
 
         m_gl->glGenVertexArrays(1, &m_nVao);
         m_gl->glGenBuffers(1, &m_nVertexVbo);
@@ -59,7 +59,7 @@ namespace GLRhi
             1.0f, 1.0f, 0.0f    // 第二个点的上侧
         };
 
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
 
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVertexVbo);
         m_gl->glBufferData(GL_ARRAY_BUFFER, sizeof(baseLineVertices), baseLineVertices, GL_STATIC_DRAW);
@@ -97,7 +97,7 @@ namespace GLRhi
             return false;
         }
 
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
 
         return true;
     }
@@ -130,8 +130,8 @@ namespace GLRhi
         if (!m_gl || !m_program || !m_nVao || m_nInstanceCount == 0)
             return;
 
-        m_program->bind();
-        m_gl->glBindVertexArray(m_nVao);
+        useProgram();
+        bindVao(m_nVao);
 
         // 设置相机矩阵
         if (m_uCameraMatLoc >= 0 && matMVP)
@@ -150,8 +150,8 @@ namespace GLRhi
         m_gl->glDisable(GL_BLEND);
         m_gl->glDisable(GL_LINE_SMOOTH);
 
-        m_gl->glBindVertexArray(0);
-        m_program->release();
+        bindVao(0);
+        releaseProgram();
     }
 
     void InstanceLineRenderer::cleanup()
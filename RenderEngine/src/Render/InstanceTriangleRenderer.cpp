@@ -34,7 +34,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
         m_uCameraMatLoc = m_program->uniformLocation("uCameraMat");
 
         bool bUniformError = (m_uCameraMatLoc < 0);
@@ -44,7 +44,7 @@ namespace GLRhi
             assert(false && "InstanceTriangleRenderer: Failed to get uniform locations");
             return false;
         }
-        m_program->release();
+        releaseProgram();
 
         // 创建VAO和VBO
         m_gl->glGenVertexArrays(1, &m_nVao);
@@ -58,7 +58,7 @@ namespace GLRhi
              0.0f,  1.155f, 0.0f  // 顶点
         };
 
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
 
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVertexVbo);
         m_gl->glBufferData(GL_ARRAY_BUFFER, sizeof(baseTriangleVertices), baseTriangleVertices, GL_STATIC_DRAW);
@@ -96,7 +96,7 @@ namespace GLRhi
             return false;
         }
 
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
 
         return true;
     }
@@ -128,8 +128,8 @@ namespace GLRhi
         if (!m_gl || !m_program || !m_nVao || m_nInstanceCount == 0)
             return;
 
-        m_program->bind();
-        m_gl->glBindVertexArray(m_nVao);
+        useProgram();
+        bindVao(m_nVao);
         m_gl->glEnable(GL_DEPTH_TEST);
 
         if (m_bBlend)
@@ -157,8 +157,8 @@ namespace GLRhi
         if (m_bBlend)
             m_gl->glDisable(GL_BLEND);
 
-        m_gl->glBindVertexArray(0);
-        m_program->release();
+        bindVao(0);
+        releaseProgram();
     }
 
     void InstanceTriangleRenderer::cleanup()
@@ -33,7 +33,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
         m_uCameraMatLoc = m_program->uniformLocation("uCameraMat");
         m_uTexArrayLoc = m_program->uniformLocation("uTexArray");
 
@@ -44,7 +44,7 @@ namespace GLRhi
             assert(false && "InstanceTextureRenderer: Failed to get uniform locations");
             return false;
         }
-        m_program->release();
+        releaseProgram();
 
         m_gl->glGenVertexArrays(1, &m_nVao);
         m_gl->glGenBuffers(1, &m_nVbo);
@@ -66,7 +66,7 @@ namespace GLRhi
             return false;
         }
 
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
 
         // m_nQuadVbo
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nQuadVbo);
@@ -111,7 +111,7 @@ namespace GLRhi
             return false;
         }
 
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
 
         return true;
     }
@@ -158,8 +158,8 @@ namespace GLRhi
         if (!m_gl || !m_program || m_nInstCount == 0 || m_texArray == 0)
             return;
 
-        m_program->bind();
-        m_gl->glBindVertexArray(m_nVao);
+        useProgram();
+        bindVao(m_nVao);
 
         //m_gl->glEnable(GL_BLEND);
         //m_gl->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -183,8 +183,8 @@ namespace GLRhi
 
         m_gl->glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, 4, static_cast<GLsizei>(m_nInstCount));
 
-        m_gl->glBindVertexArray(0);
-        m_program->release();
+        bindVao(0);
+        releaseProgram();
     }
 
     void InstanceTextureRenderer::cleanup()
@@ -35,7 +35,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
         m_uCameraMatLoc = m_program->uniformLocation("uCameraMat");
         m_uColorLoc = m_program->uniformLocation("uColor");
         m_uLineTypeLoc = m_program->uniformLocation("uLineType");
@@ -61,7 +61,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->release();
+        releaseProgram();
         return true;
     }
 
@@ -70,7 +70,7 @@ namespace GLRhi
         if (!m_gl || !m_program)
             return;
 
-        m_program->bind();
+        useProgram();
         if (m_uCameraMatLoc >= 0 && matMVP)
             m_program->setUniformValue(m_uCameraMatLoc, QMatrix4x4(matMVP));
 
@@ -86,13 +86,13 @@ namespace GLRhi
                 m_program->setUniformValue(m_uThicknessLoc, lineBInfo.thickness);
                 m_program->setUniformValue(m_uDepthLoc, lineBInfo.color.d());
 
-                m_gl->glBindVertexArray(lineBInfo.vao);
+                bindVao(lineBInfo.vao);
                 m_gl->glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(lineBInfo.count));
-                m_gl->glBindVertexArray(0);
+                bindVao(0);
             }
         }
 
-        m_program->release();
+        releaseProgram();
     }
 
     void LineBRenderer::cleanup()
@@ -131,12 +131,12 @@ namespace GLRhi
 
         m_gl->glGenVertexArrays(1, &lineBInfo.vao);
         m_gl->glGenBuffers(1, &lineBInfo.vbo);
-        m_gl->glBindVertexArray(lineBInfo.vao);
+        bindVao(lineBInfo.vao);
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, lineBInfo.vbo);
         m_gl->glBufferData(GL_ARRAY_BUFFER, count * sizeof(float), lineBInfo.verts.data(), GL_STATIC_DRAW);
         m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
         m_gl->glEnableVertexAttribArray(0);
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
 
         m_lineBInfos.push_back(lineBInfo);
     }
@@ -60,6 +60,10 @@ namespace GLRhi
             return false;
         }
 
+        // uniform 位置只解析一次，渲染时管理器不再查询当前程序
+        m_lineBuffer.setProgram(ProgramUniforms::resolve(m_gl, m_program->programId()));
+        m_lineBuffer.setStateCache(m_stateCache);
+
         GLenum error = m_gl->glGetError();
         if (error != GL_NO_ERROR)
         {
@@ -76,15 +80,13 @@ namespace GLRhi
         if (!m_program)
             return;
 
-        m_program->bind();
-
-        m_program->bind();
+        useProgram();
 
         if (m_uCameraMatLoc >= 0)
             m_program->setUniformValue(m_uCameraMatLoc, QMatrix4x4(matMVP));
 
         m_lineBuffer.renderVisiblePrimitivesEx();
-        m_program->release();
+        releaseProgram();
 
         if (0)
         {
@@ -109,7 +111,7 @@ namespace GLRhi
 
             m_lineBuffer.renderVisiblePrimitivesEx();
         }
-        m_program->release();
+        releaseProgram();
 
         // qDebug() << "[LineRenderer] render() completed";
 
@@ -139,4 +141,128 @@ namespace GLRhi
         m_lineBuffer.addPolylines(vPolylineDatas);
         return;
     }
-}
\ No newline at end of file
+
+    void LineRenderer::setDrawMode(PolylineDrawMode mode)
+    {
+        m_lineBuffer.setDrawMode(mode);
+    }
+
+    PolylineDrawMode LineRenderer::getDrawMode() const
+    {
+        return m_lineBuffer.getDrawMode();
+    }
+
+    void LineRenderer::setVertexFormat(VertexFormat format)
+    {
+        m_lineBuffer.setVertexFormat(format);
+    }
+
+    VertexFormat LineRenderer::getVertexFormat() const
+    {
+        return m_lineBuffer.getVertexFormat();
+    }
+
+    void LineRenderer::setQuantExtent(float fExtent)
+    {
+        m_lineBuffer.setQuantExtent(fExtent);
+    }
+
+    void LineRenderer::setColorStorage(ColorStorage storage)
+    {
+        m_lineBuffer.setColorStorage(storage);
+    }
+
+    ColorStorage LineRenderer::getColorStorage() const
+    {
+        return m_lineBuffer.getColorStorage();
+    }
+
+    void LineRenderer::setBlockPlacement(BlockPlacement placement)
+    {
+        m_lineBuffer.setBlockPlacement(placement);
+    }
+
+    BlockPlacement LineRenderer::getBlockPlacement() const
+    {
+        return m_lineBuffer.getBlockPlacement();
+    }
+
+    void LineRenderer::setTileSize(float fTileSize)
+    {
+        m_lineBuffer.setTileSize(fTileSize);
+    }
+
+    float LineRenderer::getTileSize() const
+    {
+        return m_lineBuffer.getTileSize();
+    }
+
+    void LineRenderer::setVboPolicy(const VboPolicy& policy)
+    {
+        m_lineBuffer.setPolicy(policy);
+    }
+
+    std::vector<VboBlockTelemetry> LineRenderer::getBlockTelemetry() const
+    {
+        return m_lineBuffer.getBlockTelemetry();
+    }
+
+    VboCacheStats LineRenderer::getCacheStats() const
+    {
+        return m_lineBuffer.getCacheStats();
+    }
+
+    void LineRenderer::setViewRect(const QRectF& rect)
+    {
+        QuantBox box;
+        if (!rect.isEmpty())
+        {
+            QRectF r = rect.normalized();
+            box.fMinX = static_cast<float>(r.left());
+            box.fMinY = static_cast<float>(r.top());
+            box.fMaxX = static_cast<float>(r.right());
+            box.fMaxY = static_cast<float>(r.bottom());
+        }
+        m_lineBuffer.setViewRect(box);
+    }
+
+    VboCullStats LineRenderer::getCullStats() const
+    {
+        return m_lineBuffer.getCullStats();
+    }
+
+    void LineRenderer::setLod(ViewCuller::LodMode mode, float fMinPixels)
+    {
+        m_lineBuffer.setLod(mode, fMinPixels);
+    }
+
+    ViewCuller::LodMode LineRenderer::getLodMode() const
+    {
+        return m_lineBuffer.getLodMode();
+    }
+
+    void LineRenderer::setPixelSize(float fWorldPerPixel)
+    {
+        m_lineBuffer.setPixelSize(fWorldPerPixel);
+    }
+
+    void LineRenderer::setSimplification(bool bEnable, float fPixelTolerance)
+    {
+        m_lineBuffer.setSimplification(bEnable, fPixelTolerance);
+    }
+
+    bool LineRenderer::getSimplification() const
+    {
+        return m_lineBuffer.getSimplification();
+    }
+
+    PolylinesVboManager* LineRenderer::getVboManager()
+    {
+        return &m_lineBuffer;
+    }
+
+    void LineRenderer::setStagingRing(StagingRing* pRing)
+    {
+        m_lineBuffer.setStagingRing(pRing);
+    }
+}
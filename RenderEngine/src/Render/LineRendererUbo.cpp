@@ -39,7 +39,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
         m_uCameraMatLoc = m_program->uniformLocation("uCameraMat");
 
         bool bUniformError = (m_uCameraMatLoc < 0);
@@ -60,7 +60,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->release();
+        releaseProgram();
         return true;
     }
 
@@ -90,8 +90,8 @@ namespace GLRhi
         if (!m_nVao || !m_totalIndexCount || !m_program)
             return;
 
-        m_program->bind();
-        m_gl->glBindVertexArray(m_nVao);
+        useProgram();
+        bindVao(m_nVao);
 
         GLuint m_uUboLoc = m_gl->glGetUniformBlockIndex(m_program->programId(), "uLineDataUBO");
         if (m_uUboLoc != GL_INVALID_INDEX)
@@ -112,8 +112,8 @@ namespace GLRhi
         m_gl->glDrawElements(GL_LINE_STRIP, m_totalIndexCount, GL_UNSIGNED_INT, nullptr);
         m_gl->glDisable(GL_PRIMITIVE_RESTART);
 
-        m_gl->glBindVertexArray(0);
-        m_program->release();
+        bindVao(0);
+        releaseProgram();
     }
 
     void LineRendererUbo::updateData(const std::vector<PolylineData>& polylines)
@@ -224,7 +224,7 @@ namespace GLRhi
         m_gl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
         m_gl->glGenVertexArrays(1, &m_nVao);
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
 
         m_gl->glGenBuffers(1, &m_nVbo);
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVbo);
@@ -240,7 +240,7 @@ namespace GLRhi
         m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_nEbo);
         m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(GLuint), indexData.data(), GL_STATIC_DRAW);
 
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
         m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
@@ -80,7 +80,7 @@ namespace GLRhi
         if (m_nVao == 0)
             return;
 
-        m_program->bind();
+        useProgram();
 
         // 设置相机变换矩阵
         if (m_uCameraMatLoc >= 0 && matMVP)
@@ -98,7 +98,7 @@ namespace GLRhi
             m_program->setUniformValue(m_uDepthLoc, 0.0f);
         }
 
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
         // EBO is already bound in the VAO, no need to bind it separately
         
         // 禁用深度测试，确保线条总是可见
@@ -142,8 +142,8 @@ namespace GLRhi
         // m_gl->glEnable(GL_DEPTH_TEST);
         // m_gl->glDepthMask(GL_TRUE);
 
-        m_gl->glBindVertexArray(0);
-        m_program->release();
+        bindVao(0);
+        releaseProgram();
     }
 
     void LineTestRenderer::uploadDataToGPU()
@@ -222,7 +222,7 @@ namespace GLRhi
             qWarning() << "[LineTestRenderer] uploadDataToGPU: Failed to create VAO";
             return;
         }
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
 
         // 创建VBO并上传顶点数据
         m_gl->glGenBuffers(1, &m_nVbo);
@@ -0,0 +1,152 @@
+#include "Render/RenderBatch.h"
+
+namespace GLRhi
+{
+    namespace
+    {
+        bool fail(std::string* pError, const std::string& strMsg)
+        {
+            if (pError)
+                *pError = strMsg;
+            return false;
+        }
+
+        bool validIndices(const std::vector<unsigned int>& vIndices, size_t nVerts)
+        {
+            if (vIndices.size() % 3 != 0)
+                return false;
+            for (unsigned int nIdx : vIndices)
+            {
+                if (nIdx >= nVerts)
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    void RenderBatch::addLines(const PolylineData& lines)
+    {
+        m_vLineEdits.push_back({ BatchOp::Add, lines });
+    }
+
+    void RenderBatch::modifyLines(const PolylineData& lines)
+    {
+        m_vLineEdits.push_back({ BatchOp::Modify, lines });
+    }
+
+    void RenderBatch::removeLines(const std::vector<long long>& vIds)
+    {
+        PolylineData data;
+        data.vId = vIds;
+        m_vLineEdits.push_back({ BatchOp::Remove, std::move(data) });
+    }
+
+    void RenderBatch::addTriangle(const TriangleData& triangle)
+    {
+        m_vTriangleEdits.push_back({ BatchOp::Add, triangle });
+    }
+
+    void RenderBatch::modifyTriangle(const TriangleData& triangle)
+    {
+        m_vTriangleEdits.push_back({ BatchOp::Modify, triangle });
+    }
+
+    void RenderBatch::removeTriangles(const std::vector<long long>& vIds)
+    {
+        for (long long id : vIds)
+        {
+            TriangleData data;
+            data.id = id;
+            m_vTriangleEdits.push_back({ BatchOp::Remove, std::move(data) });
+        }
+    }
+
+    void RenderBatch::addTexture(const TextureData& texture)
+    {
+        m_vTextureEdits.push_back({ BatchOp::Add, texture });
+    }
+
+    void RenderBatch::modifyTexture(const TextureData& texture)
+    {
+        m_vTextureEdits.push_back({ BatchOp::Modify, texture });
+    }
+
+    void RenderBatch::removeTextures(const std::vector<long long>& vIds)
+    {
+        for (long long id : vIds)
+        {
+            TextureData data;
+            data.id = id;
+            data.tex = 0;
+            m_vTextureEdits.push_back({ BatchOp::Remove, std::move(data) });
+        }
+    }
+
+    bool RenderBatch::validate(std::string* pError) const
+    {
+        for (const auto& edit : m_vLineEdits)
+        {
+            if (edit.op == BatchOp::Remove)
+                continue;
+
+            const PolylineData& data = edit.data;
+            if (data.vVerts.size() % 3 != 0)
+                return fail(pError, "polyline vertices are not xyz triples");
+
+            if (data.vCount.empty())
+            {
+                if (data.vId.empty())
+                    return fail(pError, "polyline without id");
+                continue;
+            }
+
+            if (data.vId.size() != data.vCount.size())
+                return fail(pError, "polyline vId / vCount size mismatch");
+
+            size_t nTotal = 0;
+            for (size_t nCount : data.vCount)
+                nTotal += nCount;
+            if (nTotal * 3 != data.vVerts.size())
+                return fail(pError, "polyline vCount does not match vVerts");
+        }
+
+        for (const auto& edit : m_vTriangleEdits)
+        {
+            if (edit.op == BatchOp::Remove)
+                continue;
+
+            const TriangleData& data = edit.data;
+            if (data.vVerts.size() % 3 != 0 || !validIndices(data.vIndices, data.vVerts.size() / 3))
+                return fail(pError, "triangle " + std::to_string(data.id) + " has invalid vertices or indices");
+        }
+
+        for (const auto& edit : m_vTextureEdits)
+        {
+            if (edit.op == BatchOp::Remove)
+                continue;
+
+            const TextureData& data = edit.data;
+            if (data.vVerts.size() % 4 != 0 || !validIndices(data.vIndices, data.vVerts.size() / 4))
+                return fail(pError, "texture " + std::to_string(data.id) + " has invalid vertices or indices");
+        }
+
+        return true;
+    }
+
+    bool RenderBatch::empty() const
+    {
+        return m_vLineEdits.empty() && m_vTriangleEdits.empty() && m_vTextureEdits.empty();
+    }
+
+    size_t RenderBatch::size() const
+    {
+        return m_vLineEdits.size() + m_vTriangleEdits.size() + m_vTextureEdits.size();
+    }
+
+    void RenderBatch::clear()
+    {
+        m_vLineEdits.clear();
+        m_vTriangleEdits.clear();
+        m_vTextureEdits.clear();
+    }
+}
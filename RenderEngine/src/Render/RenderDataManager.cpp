@@ -1,25 +1,364 @@
 #include "Render/RenderDataManager.h"
+#include "Render/RenderBatch.h"
 #include "DataManager/PolylinesVboManager.h"
+#include "DataManager/TriangleVboManager.h"
+#include "Render/TextureRenderer.h"
+#include "DataManager/SlotMap.h"
+#include "DataManager/ChangeJournal.h"
 
 #include <vector>
+#include <tuple>
 #include <algorithm>
 #include <random>
-#include <cstdlib>
 #include <QDebug>
 
 namespace GLRhi
 {
+    namespace
+    {
+        // 单条折线，PolylineData 按 vId / vCount 拆开后的一段
+        struct LineRecord
+        {
+            std::vector<float> vVerts;  // x, y, len
+            Brush brush;
+        };
+
+        /**
+         * @brief 按 vId / vCount 逐条遍历 PolylineData，fn(id, pVerts, nVertCount)
+         * vCount 为空时整组视为一条折线；顶点不足的折线忽略
+         */
+        template <typename Fn>
+        void forEachLine(const PolylineData& data, Fn&& fn)
+        {
+            if (data.vCount.empty())
+            {
+                if (!data.vId.empty() && data.vVerts.size() >= 6)
+                    fn(data.vId.front(), data.vVerts.data(), data.vVerts.size() / 3);
+                return;
+            }
+
+            size_t nOffset = 0;
+            size_t nLines = std::min(data.vId.size(), data.vCount.size());
+            for (size_t i = 0; i < nLines; ++i)
+            {
+                size_t nVerts = data.vCount[i];
+                if (nOffset + nVerts * 3 > data.vVerts.size())
+                    break;
+                if (nVerts >= 2)
+                    fn(data.vId[i], data.vVerts.data() + nOffset, nVerts);
+                nOffset += nVerts * 3;
+            }
+        }
+
+        template <typename T>
+        void eraseAll(SlotMap<T>& map, const std::vector<long long>& vIds)
+        {
+            for (long long id : vIds)
+                map.erase(id);
+        }
+    }
+
     class Impl
     {
     public:
-        std::vector<PolylineData> m_lines;              // 线段
-        std::vector<TriangleData> m_triangles;          // 三角形
-        std::vector<TextureData> m_textures;            // 纹理
-        std::vector<PolylineData> m_instanceLines;      // 实例化线段
-        std::vector<TriangleData> m_instanceTriangles;  // 实例化三角形
-        std::vector<TextureData> m_instanceTextures;    // 实例化纹理
+        SlotMap<LineRecord> m_lines;                    // 线段，按折线ID
+        SlotMap<TriangleData> m_triangles;              // 三角形
+        SlotMap<TextureData> m_textures;                // 纹理
+        SlotMap<LineRecord> m_instanceLines;            // 实例化线段，按折线ID
+        SlotMap<TriangleData> m_instanceTriangles;      // 实例化三角形
+        SlotMap<TextureData> m_instanceTextures;        // 实例化纹理
+        SlotMap<InstanceTexData> m_instanceTexDatas;    // 实例纹理数据
+
+        // 没有ID的实例数据，只整体替换
+        std::vector<InstanceLineData> m_vInstanceLineDatas;
+        std::vector<InstanceTriangleData> m_vInstanceTriangleDatas;
+
+        PolylinesVboManager* m_pLineManager{ nullptr };     // 提交目标，可为空
+        TriangleVboManager* m_pTriangleManager{ nullptr };
+        TextureRenderer* m_pTextureRenderer{ nullptr };
+
+        // 自上次提交以来的变化，只在关联了提交目标时记录
+        ChangeJournal m_lineJournal;
+        ChangeJournal m_triangleJournal;
+        ChangeJournal m_textureJournal;
+
+        long long m_nNextLineId{ 0 };   // setLineDatasCRUD 生成新折线的ID
+
+    public:
+        void upsertLines(const std::vector<PolylineData>& vDatas, bool bAllowAdd);
+        void upsertLineGroup(const PolylineData& data, bool bAllowAdd);
+        void updateLine(long long id, LineRecord* pOld, LineRecord record);
+        void eraseLines(const std::vector<long long>& vIds);
+        void clearLines();
+        void ingestLines(const std::vector<long long>& vIds);
+        void flushLines();
+
+        void upsertTriangles(const std::vector<TriangleData>& vDatas, bool bAllowAdd);
+        void upsertTriangle(const TriangleData& data, bool bAllowAdd);
+        void eraseTriangles(const std::vector<long long>& vIds);
+        void clearTriangles();
+        void ingestTriangles(const std::vector<long long>& vIds);
+        void flushTriangles();
+
+        void upsertTexture(const TextureData& data, bool bAllowAdd);
+        void eraseTextures(const std::vector<long long>& vIds);
+        void clearTextures();
+        void flushTextures();
     };
 
+    /**
+     * @brief 按ID写入折线；bAllowAdd 为 false 时只修改已存在的折线
+     */
+    void Impl::upsertLines(const std::vector<PolylineData>& vDatas, bool bAllowAdd)
+    {
+        for (const auto& data : vDatas)
+            upsertLineGroup(data, bAllowAdd);
+    }
+
+    void Impl::upsertLineGroup(const PolylineData& data, bool bAllowAdd)
+    {
+        forEachLine(data, [&](long long id, const float* pVerts, size_t nVerts) {
+            LineRecord record{ std::vector<float>(pVerts, pVerts + nVerts * 3), data.brush };
+            if (LineRecord* pOld = m_lines.find(id))
+            {
+                updateLine(id, pOld, std::move(record));
+                return;
+            }
+
+            if (!bAllowAdd)
+                return;
+
+            m_lines.insert(id, std::move(record));
+            m_nNextLineId = std::max(m_nNextLineId, id + 1);
+            if (m_pLineManager)
+                m_lineJournal.record(id, ChangeKind::Added);
+        });
+    }
+
+    // 覆盖已有折线，颜色不变记为几何变化，颜色变化记为样式变化
+    void Impl::updateLine(long long id, LineRecord* pOld, LineRecord record)
+    {
+        if (m_pLineManager)
+        {
+            bool bRecolor = Color(pOld->brush.getColor()) != Color(record.brush.getColor());
+            m_lineJournal.record(id, bRecolor ? ChangeKind::Style : ChangeKind::Geometry);
+        }
+        *pOld = std::move(record);
+    }
+
+    void Impl::eraseLines(const std::vector<long long>& vIds)
+    {
+        for (long long id : vIds)
+        {
+            if (m_lines.erase(id) && m_pLineManager)
+                m_lineJournal.record(id, ChangeKind::Removed);
+        }
+    }
+
+    void Impl::clearLines()
+    {
+        if (m_pLineManager)
+        {
+            for (long long id : m_lines.ids())
+                m_lineJournal.record(id, ChangeKind::Removed);
+        }
+        m_lines.clear();
+    }
+
+    // 顶点指针直接指向槽位表中的记录，导入不再拷贝一次
+    void Impl::ingestLines(const std::vector<long long>& vIds)
+    {
+        std::vector<size_t> vCounts;
+        std::vector<const float*> vPtrs;
+        std::vector<Color> vColors;
+        vCounts.reserve(vIds.size());
+        vPtrs.reserve(vIds.size());
+        vColors.reserve(vIds.size());
+
+        for (long long id : vIds)
+        {
+            const LineRecord* pRecord = m_lines.find(id);
+            vCounts.push_back(pRecord->vVerts.size() / 3);
+            vPtrs.push_back(pRecord->vVerts.data());
+            vColors.push_back(Color(pRecord->brush.getColor()));
+        }
+
+        PolylineBatchView view;
+        view.pIds = vIds.data();
+        view.pVertCounts = vCounts.data();
+        view.pVertPtrs = vPtrs.data();
+        view.pColors = vColors.data();
+        view.nCount = vIds.size();
+        m_pLineManager->ingestPolylines(view);
+    }
+
+    // 按日志提交：一次批量删除，逐条原地更新顶点，一次批量导入
+    void Impl::flushLines()
+    {
+        if (!m_pLineManager || m_lineJournal.empty())
+            return;
+
+        std::vector<long long> vRemove, vUpdate, vAdd;
+        m_lineJournal.split(vRemove, vUpdate, vAdd);
+        m_lineJournal.clear();
+
+        if (!vRemove.empty())
+            m_pLineManager->removePolylines(vRemove);
+
+        for (long long id : vUpdate)
+        {
+            LineRecord* pRecord = m_lines.find(id);
+            // 折线管理器的单条接口以浮点数计数
+            m_pLineManager->updatePolyline(id, pRecord->vVerts.data(), pRecord->vVerts.size());
+        }
+
+        if (!vAdd.empty())
+            ingestLines(vAdd);
+    }
+
+    void Impl::upsertTriangles(const std::vector<TriangleData>& vDatas, bool bAllowAdd)
+    {
+        for (const auto& data : vDatas)
+            upsertTriangle(data, bAllowAdd);
+    }
+
+    void Impl::upsertTriangle(const TriangleData& data, bool bAllowAdd)
+    {
+        if (TriangleData* pOld = m_triangles.find(data.id))
+        {
+            if (m_pTriangleManager)
+            {
+                bool bRecolor = Color(pOld->brush.getColor()) != Color(data.brush.getColor());
+                m_triangleJournal.record(data.id, bRecolor ? ChangeKind::Style : ChangeKind::Geometry);
+            }
+            *pOld = data;
+            return;
+        }
+
+        if (!bAllowAdd)
+            return;
+
+        m_triangles.insert(data.id, data);
+        if (m_pTriangleManager)
+            m_triangleJournal.record(data.id, ChangeKind::Added);
+    }
+
+    void Impl::eraseTriangles(const std::vector<long long>& vIds)
+    {
+        for (long long id : vIds)
+        {
+            if (m_triangles.erase(id) && m_pTriangleManager)
+                m_triangleJournal.record(id, ChangeKind::Removed);
+        }
+    }
+
+    void Impl::clearTriangles()
+    {
+        if (m_pTriangleManager)
+        {
+            for (long long id : m_triangles.ids())
+                m_triangleJournal.record(id, ChangeKind::Removed);
+        }
+        m_triangles.clear();
+    }
+
+    void Impl::ingestTriangles(const std::vector<long long>& vIds)
+    {
+        std::vector<std::tuple<long long, float*, size_t, unsigned int*, size_t, Color>> vBatch;
+        vBatch.reserve(vIds.size());
+        for (long long id : vIds)
+        {
+            TriangleData* pData = m_triangles.find(id);
+            vBatch.emplace_back(id, pData->vVerts.data(), pData->vVerts.size() / 3,
+                pData->vIndices.data(), pData->vIndices.size(), Color(pData->brush.getColor()));
+        }
+        m_pTriangleManager->addTriangles(vBatch);
+    }
+
+    void Impl::flushTriangles()
+    {
+        if (!m_pTriangleManager || m_triangleJournal.empty())
+            return;
+
+        std::vector<long long> vRemove, vUpdate, vAdd;
+        m_triangleJournal.split(vRemove, vUpdate, vAdd);
+        m_triangleJournal.clear();
+
+        if (!vRemove.empty())
+            m_pTriangleManager->removeTriangles(vRemove);
+
+        for (long long id : vUpdate)
+        {
+            TriangleData* pData = m_triangles.find(id);
+            m_pTriangleManager->updateTriangle(id, pData->vVerts.data(), pData->vVerts.size() / 3,
+                pData->vIndices.data(), pData->vIndices.size());
+        }
+
+        if (!vAdd.empty())
+            ingestTriangles(vAdd);
+    }
+
+    // 纹理的样式（纹理对象、画刷）随顶点一起原地更新，修改都记为几何变化
+    void Impl::upsertTexture(const TextureData& data, bool bAllowAdd)
+    {
+        if (TextureData* pOld = m_textures.find(data.id))
+        {
+            if (m_pTextureRenderer)
+                m_textureJournal.record(data.id, ChangeKind::Geometry);
+            *pOld = data;
+            return;
+        }
+
+        if (!bAllowAdd)
+            return;
+
+        m_textures.insert(data.id, data);
+        if (m_pTextureRenderer)
+            m_textureJournal.record(data.id, ChangeKind::Added);
+    }
+
+    void Impl::eraseTextures(const std::vector<long long>& vIds)
+    {
+        for (long long id : vIds)
+        {
+            if (m_textures.erase(id) && m_pTextureRenderer)
+                m_textureJournal.record(id, ChangeKind::Removed);
+        }
+    }
+
+    void Impl::clearTextures()
+    {
+        if (m_pTextureRenderer)
+        {
+            for (long long id : m_textures.ids())
+                m_textureJournal.record(id, ChangeKind::Removed);
+        }
+        m_textures.clear();
+    }
+
+    // 按日志提交：删除、原地更新、添加在渲染器中一次上传
+    void Impl::flushTextures()
+    {
+        if (!m_pTextureRenderer || m_textureJournal.empty())
+            return;
+
+        std::vector<long long> vRemove, vUpdate, vAdd;
+        m_textureJournal.split(vRemove, vUpdate, vAdd);
+        m_textureJournal.clear();
+
+        std::vector<const TextureData*> vUpdateDatas, vAddDatas;
+        vUpdateDatas.reserve(vUpdate.size());
+        vAddDatas.reserve(vAdd.size());
+        for (long long id : vUpdate)
+            vUpdateDatas.push_back(m_textures.find(id));
+        for (long long id : vAdd)
+            vAddDatas.push_back(m_textures.find(id));
+
+        m_pTextureRenderer->applyEdits(vRemove, vUpdateDatas, vAddDatas);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+
     RenderDataManager::RenderDataManager()
         : m_impl(new Impl())
     {
@@ -30,62 +369,133 @@ namespace GLRhi
         delete m_impl;
     }
 
-    void RenderDataManager::setPolylineDatas(std::vector<PolylineData>& datas)
+    void RenderDataManager::attachLineManager(PolylinesVboManager* manager)
     {
-        m_vPolylineDatas = std::move(datas);
+        // 整体导入已包含全部变化，之前的日志作废
+        m_impl->m_pLineManager = manager;
+        m_impl->m_lineJournal.clear();
+        if (manager && !m_impl->m_lines.empty())
+            m_impl->ingestLines(m_impl->m_lines.ids());
     }
 
-    void RenderDataManager::setLineDatasCRUD()
+    void RenderDataManager::attachTriangleManager(TriangleVboManager* manager)
     {
-        if (m_vPolylineDatas.empty())
-            return;
+        m_impl->m_pTriangleManager = manager;
+        m_impl->m_triangleJournal.clear();
+        if (manager && !m_impl->m_triangles.empty())
+            m_impl->ingestTriangles(m_impl->m_triangles.ids());
+    }
 
-        // 随机删除图元
-        size_t removeCount = static_cast<size_t>(m_vPolylineDatas.size() * 0.2f);
-        if (removeCount > 0)
+    void RenderDataManager::attachTextureRenderer(TextureRenderer* renderer)
+    {
+        m_impl->m_pTextureRenderer = renderer;
+        m_impl->m_textureJournal.clear();
+        if (renderer && !m_impl->m_textures.empty())
+            renderer->updateData(m_impl->m_textures.values());
+    }
+
+    void RenderDataManager::flush()
+    {
+        m_impl->flushLines();
+        m_impl->flushTriangles();
+        m_impl->flushTextures();
+    }
+
+    void RenderDataManager::applyBatch(const RenderBatch& batch)
+    {
+        for (const auto& edit : batch.getLineEdits())
+        {
+            if (edit.op == BatchOp::Remove)
+                m_impl->eraseLines(edit.data.vId);
+            else
+                m_impl->upsertLineGroup(edit.data, edit.op == BatchOp::Add);
+        }
+
+        for (const auto& edit : batch.getTriangleEdits())
         {
-            std::vector<size_t> indices(m_vPolylineDatas.size());
-            for (size_t i = 0; i < m_vPolylineDatas.size(); ++i)
-                indices[i] = i;
+            if (edit.op == BatchOp::Remove)
+                m_impl->eraseTriangles({ edit.data.id });
+            else
+                m_impl->upsertTriangle(edit.data, edit.op == BatchOp::Add);
+        }
+
+        for (const auto& edit : batch.getTextureEdits())
+        {
+            if (edit.op == BatchOp::Remove)
+                m_impl->eraseTextures({ edit.data.id });
+            else
+                m_impl->upsertTexture(edit.data, edit.op == BatchOp::Add);
+        }
+    }
+
+    const std::vector<TriangleData>& RenderDataManager::getTriangles() const
+    {
+        return m_impl->m_triangles.values();
+    }
 
-            std::shuffle(indices.begin(), indices.end(), std::default_random_engine(std::rand()));
+    const std::vector<TextureData>& RenderDataManager::getTextures() const
+    {
+        return m_impl->m_textures.values();
+    }
 
-            std::vector<PolylineData> newPolylineDatas;
-            newPolylineDatas.reserve(m_vPolylineDatas.size() - removeCount);
+    size_t RenderDataManager::getPendingChangeCount() const
+    {
+        return m_impl->m_lineJournal.size() + m_impl->m_triangleJournal.size() + m_impl->m_textureJournal.size();
+    }
 
-            for (size_t i = removeCount; i < indices.size(); ++i)
-                newPolylineDatas.push_back(m_vPolylineDatas[indices[i]]);
+    void RenderDataManager::setPolylineDatas(std::vector<PolylineData>& datas)
+    {
+        m_impl->clearLines();
+        m_impl->upsertLines(datas, true);
+        datas.clear();
+    }
 
-            m_vPolylineDatas = std::move(newPolylineDatas);
+    void RenderDataManager::setLineDatasCRUD()
+    {
+        SlotMap<LineRecord>& lines = m_impl->m_lines;
+        if (lines.empty())
+            return;
+
+        std::random_device rd;
+        std::mt19937 gen(rd());
+
+        // 随机删除图元，按紧密数组下标随机抽取，代价与删除数量成正比
+        size_t removeCount = static_cast<size_t>(lines.size() * 0.2f);
+        if (removeCount > 0)
+        {
+            std::uniform_int_distribution<size_t> indexDist(0, lines.size() - 1);
+            std::vector<long long> vIds;
+            vIds.reserve(removeCount);
+            for (size_t i = 0; i < removeCount; ++i)
+                vIds.push_back(lines.ids()[indexDist(gen)]);
+
+            std::sort(vIds.begin(), vIds.end());
+            vIds.erase(std::unique(vIds.begin(), vIds.end()), vIds.end());
+            m_impl->eraseLines(vIds);
         }
 
         // 修改图元数据
-        size_t modifyCount = static_cast<size_t>(m_vPolylineDatas.size() * 0.15f);
+        size_t modifyCount = static_cast<size_t>(lines.size() * 0.15f);
         if (modifyCount > 0)
         {
-            std::vector<size_t> indices(m_vPolylineDatas.size());
-            for (size_t i = 0; i < m_vPolylineDatas.size(); ++i)
-                indices[i] = i;
-
-            std::shuffle(indices.begin(), indices.end(), std::default_random_engine(std::rand()));
+            std::uniform_int_distribution<size_t> indexDist(0, lines.size() - 1);
+            std::uniform_real_distribution<float> offsetDist(-0.05f, 0.05f);
+            std::uniform_real_distribution<float> colorDist(0.0f, 1.0f);
 
-            for (size_t i = 0; i < modifyCount && i < indices.size(); ++i)
+            for (size_t i = 0; i < modifyCount; ++i)
             {
-                size_t idx = indices[i];
+                size_t idx = indexDist(gen);
+                long long id = lines.ids()[idx];
 
-                for (size_t j = 0; j < m_vPolylineDatas[idx].vVerts.size(); j += 3)
+                LineRecord record = lines.values()[idx];
+                for (size_t j = 0; j + 1 < record.vVerts.size(); j += 3)
                 {
-                    float offsetX = (static_cast<float>(std::rand()) / RAND_MAX - 0.5f) * 0.1f;
-                    float offsetY = (static_cast<float>(std::rand()) / RAND_MAX - 0.5f) * 0.1f;
-                    m_vPolylineDatas[idx].vVerts[j] += offsetX;
-                    m_vPolylineDatas[idx].vVerts[j + 1] += offsetY;
+                    record.vVerts[j] += offsetDist(gen);
+                    record.vVerts[j + 1] += offsetDist(gen);
                 }
+                record.brush.setRgb(colorDist(gen), colorDist(gen), colorDist(gen));
 
-                float r = static_cast<float>(std::rand()) / RAND_MAX;
-                float g = static_cast<float>(std::rand()) / RAND_MAX;
-                float b = static_cast<float>(std::rand()) / RAND_MAX;
-
-                m_vPolylineDatas[idx].brush.setRgb(r, g, b);
+                m_impl->updateLine(id, &lines.values()[idx], std::move(record));
             }
         }
 
@@ -93,42 +503,33 @@ namespace GLRhi
 
         const size_t MAX_COUNT = 5000000;
 
-        size_t currentCount = m_vPolylineDatas.size();
+        size_t currentCount = lines.size();
         size_t availableSlots = MAX_COUNT > currentCount ? MAX_COUNT - currentCount : 0;
 
         if (availableSlots > 0)
         {
-            // 简单的随机线段生成，替代FakeDataProvider
-            std::random_device rd;
-            std::mt19937 gen(rd());
             std::uniform_real_distribution<float> posDist(-1.0f, 1.0f);
             std::uniform_real_distribution<float> colorDist(0.0f, 1.0f);
             std::uniform_int_distribution<int> pointCountDist(2, 10);
-            std::uniform_real_distribution<float> lineWidthDist(1.0f, 5.0f); // 随机线宽分布
 
-            // 生成少量随机线段
+            // 生成少量随机线段，每条使用新的ID
             size_t newLineCount = std::min(availableSlots, static_cast<size_t>(10));
+            PolylineData data;
+            data.brush.set(colorDist(gen), colorDist(gen), colorDist(gen), 1.0f);
             for (size_t i = 0; i < newLineCount; ++i)
             {
-                PolylineData line;
-
-                // 随机生成线段的点
                 int pointCount = pointCountDist(gen);
                 for (int j = 0; j < pointCount; ++j)
                 {
-                    line.vVerts.push_back(posDist(gen)); // x
-                    line.vVerts.push_back(posDist(gen)); // y
-                    line.vVerts.push_back(0.0f);          // z
+                    data.vVerts.push_back(posDist(gen)); // x
+                    data.vVerts.push_back(posDist(gen)); // y
+                    data.vVerts.push_back(0.0f);          // z
                 }
-
-                // 随机颜色
-                line.brush.set(colorDist(gen), colorDist(gen), colorDist(gen), 1.0f);
-
-                // 线宽已经在PolylinesVboManager中处理，不再需要在这里设置
-
-                // 添加到数据中
-                m_vPolylineDatas.push_back(line);
+                data.vId.push_back(m_impl->m_nNextLineId++);
+                data.vCount.push_back(static_cast<size_t>(pointCount));
             }
+
+            m_impl->upsertLines({ data }, true);
         }
         else
         {
@@ -138,357 +539,287 @@ namespace GLRhi
 
     void RenderDataManager::setTriangleDatas(std::vector<TriangleData>& datas)
     {
-        m_vTriangleDatas = std::move(datas);
+        m_impl->clearTriangles();
+        m_impl->upsertTriangles(datas, true);
+        datas.clear();
     }
 
     void RenderDataManager::setTextureDatas(std::vector<TextureData>& datas)
     {
-        m_vTextureDatas = std::move(datas);
+        m_impl->clearTextures();
+        m_impl->m_textures.reserve(datas.size());
+        for (const auto& data : datas)
+            m_impl->upsertTexture(data, true);
+        datas.clear();
     }
 
     void RenderDataManager::setInstanceTextureDatas(std::vector<InstanceTexData>& datas)
     {
-        m_vInstanceTextureDatas = std::move(datas);
+        m_impl->m_instanceTexDatas.clear();
+        m_impl->m_instanceTexDatas.reserve(datas.size());
+        for (const auto& data : datas)
+            m_impl->m_instanceTexDatas.insert(data.id, data);
+        datas.clear();
     }
 
     void RenderDataManager::setInstanceLineDatas(std::vector<InstanceLineData>& datas)
     {
-        m_vInstanceLineDatas = std::move(datas);
+        m_impl->m_vInstanceLineDatas = std::move(datas);
     }
 
     void RenderDataManager::setInstanceTriangleDatas(std::vector<InstanceTriangleData>& datas)
     {
-        m_vInstanceTriangleDatas = std::move(datas);
+        m_impl->m_vInstanceTriangleDatas = std::move(datas);
     }
 
     void RenderDataManager::addLine(const PolylineData& line)
     {
-        m_impl->m_lines.push_back(line);
+        m_impl->upsertLines({ line }, true);
     }
 
     void RenderDataManager::addLines(const std::vector<PolylineData>& lines)
     {
-        m_impl->m_lines.insert(m_impl->m_lines.end(), lines.begin(), lines.end());
+        m_impl->upsertLines(lines, true);
     }
 
     void RenderDataManager::modifyLine(const PolylineData& line)
     {
-        for (auto& existingLine : m_impl->m_lines)
-        {
-            if (existingLine.vVerts == line.vVerts &&
-                existingLine.vCount == line.vCount &&
-                existingLine.brush == line.brush)
-            {
-                existingLine = line;
-                break;
-            }
-        }
+        m_impl->upsertLines({ line }, false);
     }
 
     void RenderDataManager::modifyLines(const std::vector<PolylineData>& lines)
     {
-        for (const auto& line : lines)
-        {
-            modifyLine(line);
-        }
+        m_impl->upsertLines(lines, false);
     }
 
     void RenderDataManager::removeLine(const PolylineData& line)
     {
-        for (auto it = m_impl->m_lines.begin(); it != m_impl->m_lines.end(); ++it)
-        {
-            if (it->vVerts == line.vVerts &&
-                it->vCount == line.vCount &&
-                it->brush == line.brush)
-            {
-                m_impl->m_lines.erase(it);
-                break;
-            }
-        }
+        m_impl->eraseLines(line.vId);
     }
 
     void RenderDataManager::removeLines(const std::vector<PolylineData>& lines)
     {
+        std::vector<long long> vIds;
         for (const auto& line : lines)
-        {
-            removeLine(line);
-        }
+            vIds.insert(vIds.end(), line.vId.begin(), line.vId.end());
+        m_impl->eraseLines(vIds);
     }
 
     void RenderDataManager::addTriangle(const TriangleData& triangle)
     {
-        m_impl->m_triangles.push_back(triangle);
+        m_impl->upsertTriangles({ triangle }, true);
     }
 
     void RenderDataManager::addTriangles(const std::vector<TriangleData>& triangles)
     {
-        m_impl->m_triangles.insert(m_impl->m_triangles.end(), triangles.begin(), triangles.end());
+        m_impl->upsertTriangles(triangles, true);
     }
 
     void RenderDataManager::modifyTriangle(const TriangleData& triangle)
     {
-        for (auto& existingTriangle : m_impl->m_triangles)
-        {
-            if (existingTriangle.vVerts == triangle.vVerts &&
-                existingTriangle.vIndices == triangle.vIndices &&
-                existingTriangle.brush == triangle.brush)
-            {
-                existingTriangle = triangle;
-                break;
-            }
-        }
+        m_impl->upsertTriangles({ triangle }, false);
     }
 
     void RenderDataManager::modifyTriangles(const std::vector<TriangleData>& triangles)
     {
-        for (const auto& triangle : triangles)
-        {
-            modifyTriangle(triangle);
-        }
+        m_impl->upsertTriangles(triangles, false);
     }
 
     void RenderDataManager::removeTriangle(const TriangleData& triangle)
     {
-        for (auto it = m_impl->m_triangles.begin(); it != m_impl->m_triangles.end(); ++it)
-        {
-            if (it->vVerts == triangle.vVerts &&
-                it->vIndices == triangle.vIndices &&
-                it->brush == triangle.brush)
-            {
-                m_impl->m_triangles.erase(it);
-                break;
-            }
-        }
+        m_impl->eraseTriangles({ triangle.id });
     }
 
     void RenderDataManager::removeTriangles(const std::vector<TriangleData>& triangles)
     {
+        std::vector<long long> vIds;
+        vIds.reserve(triangles.size());
         for (const auto& triangle : triangles)
-        {
-            removeTriangle(triangle);
-        }
+            vIds.push_back(triangle.id);
+        m_impl->eraseTriangles(vIds);
     }
 
     void RenderDataManager::addTexture(const TextureData& texture)
     {
-        m_impl->m_textures.push_back(texture);
+        m_impl->upsertTexture(texture, true);
     }
 
     void RenderDataManager::addTextures(const std::vector<TextureData>& textures)
     {
-        m_impl->m_textures.insert(m_impl->m_textures.end(), textures.begin(), textures.end());
+        for (const auto& texture : textures)
+            m_impl->upsertTexture(texture, true);
     }
 
     void RenderDataManager::modifyTexture(const TextureData& texture)
     {
-        for (auto& existingTexture : m_impl->m_textures)
-        {
-            if (existingTexture.vVerts == texture.vVerts &&
-                existingTexture.vIndices == texture.vIndices &&
-                existingTexture.tex == texture.tex &&
-                existingTexture.brush == texture.brush)
-            {
-                existingTexture = texture;
-                break;
-            }
-        }
+        m_impl->upsertTexture(texture, false);
     }
 
     void RenderDataManager::removeTexture(const TextureData& texture)
     {
-        for (auto it = m_impl->m_textures.begin(); it != m_impl->m_textures.end(); ++it)
-        {
-            if (it->vVerts == texture.vVerts &&
-                it->vIndices == texture.vIndices &&
-                it->tex == texture.tex &&
-                it->brush == texture.brush)
-            {
-                m_impl->m_textures.erase(it);
-                break;
-            }
-        }
+        m_impl->eraseTextures({ texture.id });
     }
 
     void RenderDataManager::removeTextures(const std::vector<TextureData>& textures)
     {
+        std::vector<long long> vIds;
+        vIds.reserve(textures.size());
         for (const auto& texture : textures)
-        {
-            removeTexture(texture);
-        }
+            vIds.push_back(texture.id);
+        m_impl->eraseTextures(vIds);
     }
 
     void RenderDataManager::addInstanceLine(const PolylineData& instanceLine)
     {
-        m_impl->m_instanceLines.push_back(instanceLine);
+        addInstanceLines({ instanceLine });
     }
 
     void RenderDataManager::addInstanceLines(const std::vector<PolylineData>& instanceLines)
     {
-        m_impl->m_instanceLines.insert(m_impl->m_instanceLines.end(), instanceLines.begin(), instanceLines.end());
+        for (const auto& data : instanceLines)
+        {
+            forEachLine(data, [&](long long id, const float* pVerts, size_t nVerts) {
+                m_impl->m_instanceLines.insert(id, { std::vector<float>(pVerts, pVerts + nVerts * 3), data.brush });
+            });
+        }
     }
 
     void RenderDataManager::modifyInstanceLine(const PolylineData& instanceLine)
     {
-        for (auto& existingLine : m_impl->m_instanceLines)
-        {
-            if (existingLine.vVerts == instanceLine.vVerts &&
-                existingLine.vCount == instanceLine.vCount &&
-                existingLine.brush == instanceLine.brush)
-            {
-                existingLine = instanceLine;
-                break;
-            }
-        }
+        modifyInstanceLines({ instanceLine });
     }
 
     void RenderDataManager::modifyInstanceLines(const std::vector<PolylineData>& instanceLines)
     {
-        for (const auto& line : instanceLines)
+        for (const auto& data : instanceLines)
         {
-            modifyInstanceLine(line);
+            forEachLine(data, [&](long long id, const float* pVerts, size_t nVerts) {
+                if (LineRecord* pOld = m_impl->m_instanceLines.find(id))
+                    *pOld = { std::vector<float>(pVerts, pVerts + nVerts * 3), data.brush };
+            });
         }
     }
 
     void RenderDataManager::removeInstanceLine(const PolylineData& instanceLine)
     {
-        for (auto it = m_impl->m_instanceLines.begin(); it != m_impl->m_instanceLines.end(); ++it)
-        {
-            if (it->vVerts == instanceLine.vVerts &&
-                it->vCount == instanceLine.vCount &&
-                it->brush == instanceLine.brush)
-            {
-                m_impl->m_instanceLines.erase(it);
-                break;
-            }
-        }
+        eraseAll(m_impl->m_instanceLines, instanceLine.vId);
     }
 
     void RenderDataManager::removeInstanceLines(const std::vector<PolylineData>& instanceLines)
     {
         for (const auto& line : instanceLines)
-        {
-            removeInstanceLine(line);
-        }
+            eraseAll(m_impl->m_instanceLines, line.vId);
     }
 
     void RenderDataManager::addInstanceTriangle(const TriangleData& instanceTriangle)
     {
-        m_impl->m_instanceTriangles.push_back(instanceTriangle);
+        m_impl->m_instanceTriangles.insert(instanceTriangle.id, instanceTriangle);
     }
 
     void RenderDataManager::addInstanceTriangles(const std::vector<TriangleData>& instanceTriangles)
     {
-        m_impl->m_instanceTriangles.insert(m_impl->m_instanceTriangles.end(), instanceTriangles.begin(), instanceTriangles.end());
+        for (const auto& triangle : instanceTriangles)
+            m_impl->m_instanceTriangles.insert(triangle.id, triangle);
     }
 
     void RenderDataManager::modifyInstanceTriangle(const TriangleData& instanceTriangle)
     {
-        for (auto& existingTriangle : m_impl->m_instanceTriangles)
-        {
-            if (existingTriangle.vVerts == instanceTriangle.vVerts &&
-                existingTriangle.vIndices == instanceTriangle.vIndices &&
-                existingTriangle.brush == instanceTriangle.brush)
-            {
-                existingTriangle = instanceTriangle;
-                break;
-            }
-        }
+        if (TriangleData* pOld = m_impl->m_instanceTriangles.find(instanceTriangle.id))
+            *pOld = instanceTriangle;
     }
 
     void RenderDataManager::modifyInstanceTriangles(const std::vector<TriangleData>& instanceTriangles)
     {
         for (const auto& triangle : instanceTriangles)
-        {
             modifyInstanceTriangle(triangle);
-        }
     }
 
     void RenderDataManager::removeInstanceTriangle(const TriangleData& instanceTriangle)
     {
-        for (auto it = m_impl->m_instanceTriangles.begin(); it != m_impl->m_instanceTriangles.end(); ++it)
-        {
-            if (it->vVerts == instanceTriangle.vVerts &&
-                it->vIndices == instanceTriangle.vIndices &&
-                it->brush == instanceTriangle.brush)
-            {
-                m_impl->m_instanceTriangles.erase(it);
-                break;
-            }
-        }
+        m_impl->m_instanceTriangles.erase(instanceTriangle.id);
     }
 
     void RenderDataManager::removeInstanceTriangles(const std::vector<TriangleData>& instanceTriangles)
     {
         for (const auto& triangle : instanceTriangles)
-        {
-            removeInstanceTriangle(triangle);
-        }
+            m_impl->m_instanceTriangles.erase(triangle.id);
     }
 
     void RenderDataManager::addInstanceTexture(const TextureData& instanceTexture)
     {
-        m_impl->m_instanceTextures.push_back(instanceTexture);
+        m_impl->m_instanceTextures.insert(instanceTexture.id, instanceTexture);
     }
 
     void RenderDataManager::addInstanceTextures(const std::vector<TextureData>& instanceTextures)
     {
-        m_impl->m_instanceTextures.insert(m_impl->m_instanceTextures.end(), instanceTextures.begin(), instanceTextures.end());
+        for (const auto& texture : instanceTextures)
+            m_impl->m_instanceTextures.insert(texture.id, texture);
     }
 
     void RenderDataManager::modifyInstanceTexture(const TextureData& instanceTexture)
     {
-        for (auto& existingTexture : m_impl->m_instanceTextures)
-        {
-            if (existingTexture.vVerts == instanceTexture.vVerts &&
-                existingTexture.vIndices == instanceTexture.vIndices &&
-                existingTexture.tex == instanceTexture.tex &&
-                existingTexture.brush == instanceTexture.brush)
-            {
-                existingTexture = instanceTexture;
-                break;
-            }
-        }
+        if (TextureData* pOld = m_impl->m_instanceTextures.find(instanceTexture.id))
+            *pOld = instanceTexture;
     }
 
     void RenderDataManager::modifyInstanceTextures(const std::vector<TextureData>& instanceTextures)
     {
         for (const auto& texture : instanceTextures)
-        {
             modifyInstanceTexture(texture);
-        }
     }
 
     void RenderDataManager::removeInstanceTexture(const TextureData& instanceTexture)
     {
-        for (auto it = m_impl->m_instanceTextures.begin(); it != m_impl->m_instanceTextures.end(); ++it)
-        {
-            if (it->vVerts == instanceTexture.vVerts &&
-                it->vIndices == instanceTexture.vIndices &&
-                it->tex == instanceTexture.tex &&
-                it->brush == instanceTexture.brush)
-            {
-                m_impl->m_instanceTextures.erase(it);
-                break;
-            }
-        }
+        m_impl->m_instanceTextures.erase(instanceTexture.id);
     }
 
     void RenderDataManager::removeInstanceTextures(const std::vector<TextureData>& instanceTextures)
     {
         for (const auto& texture : instanceTextures)
-        {
-            removeInstanceTexture(texture);
-        }
+            m_impl->m_instanceTextures.erase(texture.id);
+    }
+
+    void RenderDataManager::removeLines(const std::vector<long long>& vIds)
+    {
+        m_impl->eraseLines(vIds);
+    }
+
+    void RenderDataManager::removeTriangles(const std::vector<long long>& vIds)
+    {
+        m_impl->eraseTriangles(vIds);
+    }
+
+    void RenderDataManager::removeTextures(const std::vector<long long>& vIds)
+    {
+        m_impl->eraseTextures(vIds);
+    }
+
+    size_t RenderDataManager::getLineCount() const
+    {
+        return m_impl->m_lines.size();
+    }
+
+    size_t RenderDataManager::getTriangleCount() const
+    {
+        return m_impl->m_triangles.size();
+    }
+
+    size_t RenderDataManager::getTextureCount() const
+    {
+        return m_impl->m_textures.size();
     }
 
     // 清理所有数据
     void RenderDataManager::deleteAll()
     {
-        m_impl->m_lines.clear();
-        m_impl->m_triangles.clear();
-        m_impl->m_textures.clear();
+        m_impl->clearLines();
+        m_impl->clearTriangles();
+        m_impl->clearTextures();
         m_impl->m_instanceLines.clear();
         m_impl->m_instanceTriangles.clear();
         m_impl->m_instanceTextures.clear();
+        m_impl->m_instanceTexDatas.clear();
+        m_impl->m_vInstanceLineDatas.clear();
+        m_impl->m_vInstanceTriangleDatas.clear();
     }
-}
\ No newline at end of file
+}
@@ -47,6 +47,30 @@ namespace GLRhi
         m_instanceLineRenderer = std::make_unique<InstanceLineRenderer>();
         m_instanceTriangleRenderer = std::make_unique<InstanceTriangleRenderer>();
 
+        // 状态缓存需在 initialize 之前设置，渲染器初始化时会把它交给顶点管理器
+        m_stateCache.initialize(m_gl);
+        m_boardRenderer->setStateCache(&m_stateCache);
+        m_lineRenderer->setStateCache(&m_stateCache);
+        m_lineUBORenderer->setStateCache(&m_stateCache);
+        m_lineBRenderer->setStateCache(&m_stateCache);
+        m_triRenderer->setStateCache(&m_stateCache);
+        m_imageRenderer->setStateCache(&m_stateCache);
+        m_texRenderer->setStateCache(&m_stateCache);
+        m_instancTexRenderer->setStateCache(&m_stateCache);
+        m_instanceLineRenderer->setStateCache(&m_stateCache);
+        m_instanceTriangleRenderer->setStateCache(&m_stateCache);
+
+        // 折线和三角形的上传经由同一个暂存区，每帧合并提交；创建失败时各自使用自有的暂存区
+        if (m_stagingRing.initialize(context))
+        {
+            static_cast<LineRenderer*>(m_lineRenderer.get())->setStagingRing(&m_stagingRing);
+            static_cast<TriangleRenderer*>(m_triRenderer.get())->setStagingRing(&m_stagingRing);
+        }
+        else
+        {
+            qWarning() << "RenderManager::initialize: Failed to create shared staging ring";
+        }
+
         // 初始化伪数据生成器
         // m_instanceLineFakeData = std::make_unique<InstanceLineFakeData>();
         // m_instanceTriangleFakeData = std::make_unique<InstanceTriangleFakeData>();
@@ -69,6 +93,11 @@ namespace GLRhi
             return false;
         }
 
+        // 数据管理器的折线、三角形、纹理编辑按ID增量转发到对应的渲染器
+        m_dataManager.attachLineManager(static_cast<LineRenderer*>(m_lineRenderer.get())->getVboManager());
+        m_dataManager.attachTriangleManager(static_cast<TriangleRenderer*>(m_triRenderer.get())->getVboManager());
+        m_dataManager.attachTextureRenderer(static_cast<TextureRenderer*>(m_texRenderer.get()));
+
         // genFakeData();
 
         return true;
@@ -76,10 +105,16 @@ namespace GLRhi
 
     void RenderManager::render(const float* matMVP)
     {
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
         if (!m_gl)
             return;
 
+        // 帧之间 Qt 和数据上传可能改动了 GL 状态，每帧从未知状态开始
+        m_stateCache.beginFrame();
+
+        // 应用已提交的批次，再把两帧之间累积的数据变化按ID一次提交给渲染器
+        applyCommittedBatches();
+        m_dataManager.flush();
+
         m_gl->glClearColor(m_bgColor.r(), m_bgColor.g(), m_bgColor.b(), m_bgColor.a());
         m_gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -106,14 +141,18 @@ namespace GLRhi
         m_instancTexRenderer->render(mat);
         m_instanceLineRenderer->render(mat);
         m_instanceTriangleRenderer->render(mat);
+
+        m_stateCache.endFrame();
     }
 
     void RenderManager::cleanup()
     {
-        //if(!m_context)
-
-        m_gl = m_context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+        if (!m_gl)
+            return;
 
+        m_dataManager.attachLineManager(nullptr);
+        m_dataManager.attachTriangleManager(nullptr);
+        m_dataManager.attachTextureRenderer(nullptr);
         m_boardRenderer->cleanup();
         m_lineRenderer->cleanup();
         m_lineUBORenderer->cleanup();
@@ -125,6 +164,9 @@ namespace GLRhi
         m_instanceLineRenderer->cleanup();
         m_instanceTriangleRenderer->cleanup();
 
+        // 顶点管理器已清空，写往其缓冲区的暂存写入已丢弃
+        m_stagingRing.destroy();
+
         // if (m_instanceLineFakeData)
         // {
         //     m_instanceLineFakeData->clear();
@@ -151,6 +193,22 @@ namespace GLRhi
         return m_boardRenderer.get();
     }
 
+    void RenderManager::setViewRect(const QRectF& rect)
+    {
+        if (m_lineRenderer)
+            static_cast<LineRenderer*>(m_lineRenderer.get())->setViewRect(rect);
+        if (m_triRenderer)
+            static_cast<TriangleRenderer*>(m_triRenderer.get())->setViewRect(rect);
+    }
+
+    void RenderManager::setPixelSize(float fWorldPerPixel)
+    {
+        if (m_lineRenderer)
+            static_cast<LineRenderer*>(m_lineRenderer.get())->setPixelSize(fWorldPerPixel);
+        if (m_triRenderer)
+            static_cast<TriangleRenderer*>(m_triRenderer.get())->setPixelSize(fWorldPerPixel);
+    }
+
     IRenderer* RenderManager::getLineRenderer()
     {
         return m_lineRenderer.get();
@@ -287,6 +345,61 @@ namespace GLRhi
     //     }
     // }
 
+    const GLStateStats& RenderManager::getStateStats() const
+    {
+        return m_stateCache.getLastFrameStats();
+    }
+
+    RenderBatch RenderManager::beginBatch() const
+    {
+        return RenderBatch();
+    }
+
+    bool RenderManager::commit(RenderBatch batch)
+    {
+        std::string strError;
+        if (!batch.validate(&strError))
+        {
+            qWarning() << "RenderManager::commit: batch rejected," << strError.c_str();
+            return false;
+        }
+
+        if (batch.empty())
+            return true;
+
+        std::lock_guard<std::mutex> lock(m_batchMutex);
+        m_vCommittedBatches.push_back(std::move(batch));
+        return true;
+    }
+
+    void RenderManager::applyCommittedBatches()
+    {
+        std::vector<RenderBatch> vBatches;
+        {
+            std::lock_guard<std::mutex> lock(m_batchMutex);
+            vBatches.swap(m_vCommittedBatches);
+        }
+
+        for (const auto& batch : vBatches)
+            m_dataManager.applyBatch(batch);
+    }
+
+    void RenderManager::setPolylineDatas(std::vector<PolylineData>& datas)
+    {
+        // 编辑记入数据管理器的日志，下一帧由 flush() 增量提交给渲染器
+        m_dataManager.setPolylineDatas(datas);
+    }
+
+    void RenderManager::setTriangleDatas(std::vector<TriangleData>& datas)
+    {
+        m_dataManager.setTriangleDatas(datas);
+    }
+
+    void RenderManager::setTextureDatas(std::vector<TextureData>& datas)
+    {
+        m_dataManager.setTextureDatas(datas);
+    }
+
     void RenderManager::dataCRUD()
     {
         m_dataManager.setLineDatasCRUD();
@@ -1,6 +1,8 @@
 #include "Render/TextureRenderer.h"
 #include "Shader/TextureShader.h"
 #include <QDebug>
+#include <cassert>
+#include <algorithm>
 
 namespace GLRhi
 {
@@ -33,7 +35,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
         m_uCameraMatLoc = m_program->uniformLocation("uCameraMat");
         m_uDepthLoc = m_program->uniformLocation("uDepth");
         m_uTexLoc = m_program->uniformLocation("uTex");
@@ -47,7 +49,7 @@ namespace GLRhi
         //     return false;
         // }
 
-        m_program->release();
+        releaseProgram();
 
         m_gl->glGenVertexArrays(1, &m_nVao);
         m_gl->glGenBuffers(1, &m_nVbo);
@@ -60,7 +62,7 @@ namespace GLRhi
             return false;
         }
 
-        m_gl->glBindVertexArray(m_nVao);
+        bindVao(m_nVao);
 
         m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVbo);
         m_gl->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
@@ -80,72 +82,236 @@ namespace GLRhi
             return false;
         }
 
-        m_gl->glBindVertexArray(0);
+        bindVao(0);
 
         return true;
     }
 
     void TextureRenderer::updateData(const std::vector<TextureData>& vTexDatas)
     {
-        if (!m_gl || !m_nVao)
+        // 旧图元的纹理先释放引用，新数据中仍在使用的纹理在编辑结束时不会被删除
+        for (const auto& batch : m_vBatches)
+            releaseTexture(batch.tex);
+
+        m_vBatches.clear();
+        m_idToBatch.clear();
+        m_vVerts.clear();
+        m_vIndices.clear();
+        m_nDeadVerts = 0;
+        m_nDeadIndices = 0;
+        m_bRealloc = true;
+
+        std::vector<const TextureData*> vAdd;
+        vAdd.reserve(vTexDatas.size());
+        for (const auto& texData : vTexDatas)
+            vAdd.push_back(&texData);
+        applyEdits({}, {}, vAdd);
+    }
+
+    void TextureRenderer::applyEdits(const std::vector<long long>& vRemove,
+        const std::vector<const TextureData*>& vUpdate,
+        const std::vector<const TextureData*>& vAdd)
+    {
+        for (long long id : vRemove)
+            removeBatch(id);
+
+        for (const auto* vEdits : { &vUpdate, &vAdd })
+        {
+            for (const TextureData* pData : *vEdits)
+            {
+                auto it = m_idToBatch.find(pData->id);
+                if (it != m_idToBatch.end())
+                    writeBatch(m_vBatches[it->second], *pData);
+                else
+                    appendBatch(*pData);
+            }
+        }
+
+        // 空洞超过一半时整体重建，避免缓冲区只增不减
+        if (m_nDeadVerts * 4 * 2 > m_vVerts.size() || m_nDeadIndices * 2 > m_vIndices.size())
+            compact();
+
+        upload();
+
+        // 纹理在所有编辑应用之后仍无引用才删除：删除后再添加的图元可以继续使用原纹理
+        for (GLuint tex : m_vReleasedTex)
+        {
+            auto it = m_texRefs.find(tex);
+            if (it == m_texRefs.end() || it->second > 0)
+                continue;
+            m_texRefs.erase(it);
+            if (m_gl)
+                m_gl->glDeleteTextures(1, &tex);
+        }
+        m_vReleasedTex.clear();
+    }
+
+    void TextureRenderer::removeBatch(long long id)
+    {
+        auto it = m_idToBatch.find(id);
+        if (it == m_idToBatch.end())
             return;
 
-        for (GLuint texId : m_vTextureIds)
+        size_t nIndex = it->second;
+        m_idToBatch.erase(it);
+
+        Batch& batch = m_vBatches[nIndex];
+        m_nDeadVerts += batch.vertexSlot;
+        m_nDeadIndices += batch.indexSlot;
+        releaseTexture(batch.tex);
+
+        // 末尾的图元移到空出的位置
+        if (nIndex + 1 != m_vBatches.size())
         {
-            if (texId > 0)
-                m_gl->glDeleteTextures(1, &texId);
+            batch = m_vBatches.back();
+            m_idToBatch[batch.id] = nIndex;
         }
+        m_vBatches.pop_back();
+    }
 
-        m_vBatches.clear();
-        m_vTextureIds.clear();
-        size_t totalVertices = 0, totalIndices = 0;
+    void TextureRenderer::writeBatch(Batch& batch, const TextureData& texData)
+    {
+        size_t nVerts = texData.vVerts.size() / 4;
+        size_t nIndices = texData.vIndices.size();
 
-        for (const auto& texData : vTexDatas)
+        if (nVerts > batch.vertexSlot || nIndices > batch.indexSlot)
         {
-            Batch batch;
-            batch.indexOffset = static_cast<unsigned int>(totalIndices);
-            batch.indexCount = static_cast<unsigned int>(texData.vIndices.size());
+            // 原区段放不下，留作空洞，在末尾重新分配
+            m_nDeadVerts += batch.vertexSlot;
+            m_nDeadIndices += batch.indexSlot;
+            batch.vertexOffset = static_cast<unsigned int>(m_vVerts.size() / 4);
+            batch.vertexSlot = static_cast<unsigned int>(nVerts);
+            batch.indexOffset = static_cast<unsigned int>(m_vIndices.size());
+            batch.indexSlot = static_cast<unsigned int>(nIndices);
+            m_vVerts.resize(m_vVerts.size() + nVerts * 4);
+            m_vIndices.resize(m_vIndices.size() + nIndices);
+        }
+
+        std::copy(texData.vVerts.begin(), texData.vVerts.begin() + nVerts * 4,
+            m_vVerts.begin() + batch.vertexOffset * 4);
+        for (size_t i = 0; i < nIndices; ++i)
+            m_vIndices[batch.indexOffset + i] = texData.vIndices[i] + batch.vertexOffset;
+        batch.indexCount = static_cast<unsigned int>(nIndices);
+
+        if (batch.tex != texData.tex)
+        {
+            retainTexture(texData.tex);
+            releaseTexture(batch.tex);
             batch.tex = texData.tex;
-            batch.brush = texData.brush;
-            m_vBatches.push_back(batch);
+        }
+        batch.brush = texData.brush;
+
+        markDirty(batch.vertexOffset * 4, (batch.vertexOffset + nVerts) * 4,
+            batch.indexOffset, batch.indexOffset + nIndices);
+    }
+
+    void TextureRenderer::appendBatch(const TextureData& texData)
+    {
+        Batch batch{ texData.id, 0, 0, 0, 0, 0, 0, Brush() };
+        writeBatch(batch, texData);
+        m_idToBatch[texData.id] = m_vBatches.size();
+        m_vBatches.push_back(batch);
+    }
+
+    void TextureRenderer::retainTexture(GLuint tex)
+    {
+        if (tex > 0)
+            ++m_texRefs[tex];
+    }
+
+    void TextureRenderer::releaseTexture(GLuint tex)
+    {
+        auto it = m_texRefs.find(tex);
+        if (it != m_texRefs.end() && --it->second == 0)
+            m_vReleasedTex.push_back(tex);
+    }
+
+    void TextureRenderer::compact()
+    {
+        std::vector<float> vVerts;
+        std::vector<unsigned int> vIndices;
+        vVerts.reserve(m_vVerts.size() - m_nDeadVerts * 4);
+        vIndices.reserve(m_vIndices.size() - m_nDeadIndices);
 
-            m_vTextureIds.push_back(texData.tex);
+        for (auto& batch : m_vBatches)
+        {
+            unsigned int nVertexOffset = static_cast<unsigned int>(vVerts.size() / 4);
+            unsigned int nIndexOffset = static_cast<unsigned int>(vIndices.size());
+
+            auto itVert = m_vVerts.begin() + batch.vertexOffset * 4;
+            vVerts.insert(vVerts.end(), itVert, itVert + batch.vertexSlot * 4);
+            for (unsigned int i = 0; i < batch.indexCount; ++i)
+                vIndices.push_back(m_vIndices[batch.indexOffset + i] - batch.vertexOffset + nVertexOffset);
 
-            totalVertices += texData.vVerts.size() / 4;
-            totalIndices += texData.vIndices.size();
+            batch.vertexOffset = nVertexOffset;
+            batch.indexOffset = nIndexOffset;
+            batch.indexSlot = batch.indexCount;
         }
 
-        std::vector<float> allVertices;
-        allVertices.reserve(totalVertices * 4);
-        for (const auto& texData : vTexDatas)
+        m_vVerts.swap(vVerts);
+        m_vIndices.swap(vIndices);
+        m_nDeadVerts = 0;
+        m_nDeadIndices = 0;
+        m_bRealloc = true;
+    }
+
+    void TextureRenderer::markDirty(size_t nVertBegin, size_t nVertEnd, size_t nIdxBegin, size_t nIdxEnd)
+    {
+        if (nVertBegin < nVertEnd)
+        {
+            bool bEmpty = m_nDirtyVertBegin >= m_nDirtyVertEnd;
+            m_nDirtyVertBegin = bEmpty ? nVertBegin : std::min(m_nDirtyVertBegin, nVertBegin);
+            m_nDirtyVertEnd = bEmpty ? nVertEnd : std::max(m_nDirtyVertEnd, nVertEnd);
+        }
+        if (nIdxBegin < nIdxEnd)
         {
-            allVertices.insert(allVertices.end(),
-                texData.vVerts.begin(), texData.vVerts.end());
+            bool bEmpty = m_nDirtyIdxBegin >= m_nDirtyIdxEnd;
+            m_nDirtyIdxBegin = bEmpty ? nIdxBegin : std::min(m_nDirtyIdxBegin, nIdxBegin);
+            m_nDirtyIdxEnd = bEmpty ? nIdxEnd : std::max(m_nDirtyIdxEnd, nIdxEnd);
         }
+    }
 
-        std::vector<unsigned int> allIndices;
-        allIndices.reserve(totalIndices);
+    void TextureRenderer::upload()
+    {
+        if (!m_gl || !m_nVao)
+            return;
 
-        unsigned int vertexOffset = 0;
-        for (const auto& texData : vTexDatas)
+        if (m_vVerts.size() > m_nVboCapacity || m_vIndices.size() > m_nEboCapacity)
+            m_bRealloc = true;
+
+        bindVao(m_nVao);
+        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVbo);
+        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_nEbo);
+
+        if (m_bRealloc)
+        {
+            // 预留一半余量，之后的追加在容量内只上传变化的范围
+            m_nVboCapacity = m_vVerts.size() + m_vVerts.size() / 2;
+            m_nEboCapacity = m_vIndices.size() + m_vIndices.size() / 2;
+            m_gl->glBufferData(GL_ARRAY_BUFFER, m_nVboCapacity * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+            m_gl->glBufferSubData(GL_ARRAY_BUFFER, 0, m_vVerts.size() * sizeof(float), m_vVerts.data());
+            m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_nEboCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+            m_gl->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, m_vIndices.size() * sizeof(unsigned int), m_vIndices.data());
+        }
+        else
         {
-            for (unsigned int idx : texData.vIndices)
+            if (m_nDirtyVertBegin < m_nDirtyVertEnd)
+            {
+                m_gl->glBufferSubData(GL_ARRAY_BUFFER, m_nDirtyVertBegin * sizeof(float),
+                    (m_nDirtyVertEnd - m_nDirtyVertBegin) * sizeof(float), m_vVerts.data() + m_nDirtyVertBegin);
+            }
+            if (m_nDirtyIdxBegin < m_nDirtyIdxEnd)
             {
-                allIndices.push_back(idx + vertexOffset);
+                m_gl->glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, m_nDirtyIdxBegin * sizeof(unsigned int),
+                    (m_nDirtyIdxEnd - m_nDirtyIdxBegin) * sizeof(unsigned int), m_vIndices.data() + m_nDirtyIdxBegin);
             }
-            vertexOffset += static_cast<unsigned int>(texData.vVerts.size() / 4);
         }
 
-        m_gl->glBindVertexArray(m_nVao);
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVbo);
-        m_gl->glBufferData(GL_ARRAY_BUFFER, allVertices.size() * sizeof(float),
-            allVertices.data(), GL_STATIC_DRAW);
+        bindVao(0);
 
-        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_nEbo);
-        m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, allIndices.size() * sizeof(unsigned int),
-            allIndices.data(), GL_STATIC_DRAW);
-
-        m_gl->glBindVertexArray(0);
+        m_bRealloc = false;
+        m_nDirtyVertBegin = m_nDirtyVertEnd = 0;
+        m_nDirtyIdxBegin = m_nDirtyIdxEnd = 0;
     }
 
     void TextureRenderer::render(const float* matMVP)
@@ -153,8 +319,8 @@ namespace GLRhi
         if (!m_gl || !m_program || m_vBatches.empty())
             return;
 
-        m_program->bind();
-        m_gl->glBindVertexArray(m_nVao);
+        useProgram();
+        bindVao(m_nVao);
 
         m_gl->glEnable(GL_BLEND);
         m_gl->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -167,6 +333,9 @@ namespace GLRhi
 
         for (const auto& batch : m_vBatches)
         {
+            if (batch.indexCount == 0)
+                continue;
+
             m_gl->glBindTexture(GL_TEXTURE_2D, batch.tex);
 
             if (m_uAlphaLoc >= 0)
@@ -179,8 +348,8 @@ namespace GLRhi
                 (void*)(batch.indexOffset * sizeof(unsigned int)));
         }
 
-        m_gl->glBindVertexArray(0);
-        m_program->release();
+        bindVao(0);
+        releaseProgram();
     }
 
     void TextureRenderer::cleanup()
@@ -188,14 +357,19 @@ namespace GLRhi
         if (!m_gl)
             return;
 
-        for (GLuint texId : m_vTextureIds)
-        {
-            if (texId > 0)
-                m_gl->glDeleteTextures(1, &texId);
-        }
+        for (const auto& texRef : m_texRefs)
+            m_gl->glDeleteTextures(1, &texRef.first);
 
-        m_vTextureIds.clear();
+        m_texRefs.clear();
+        m_vReleasedTex.clear();
         m_vBatches.clear();
+        m_idToBatch.clear();
+        m_vVerts.clear();
+        m_vIndices.clear();
+        m_nDeadVerts = 0;
+        m_nDeadIndices = 0;
+        m_nVboCapacity = 0;
+        m_nEboCapacity = 0;
 
         deleteEbo(m_nEbo);
         deleteVaoVbo(m_nVao, m_nVbo);
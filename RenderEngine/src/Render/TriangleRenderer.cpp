@@ -30,7 +30,7 @@ namespace GLRhi
             return false;
         }
 
-        m_program->bind();
+        useProgram();
 
         m_uCameraMatLoc = m_program->uniformLocation("uCameraMat");
         m_uDepthLoc = m_program->uniformLocation("uDepth");
@@ -44,18 +44,18 @@ namespace GLRhi
             return false;
         }
 
-        m_program->release();
+        releaseProgram();
 
-        m_gl->glGenVertexArrays(1, &m_nVao);
-        m_gl->glGenBuffers(1, &m_nVbo);
-        m_gl->glGenBuffers(1, &m_nEbo);
-
-        m_gl->glBindVertexArray(m_nVao);
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVbo);
-        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        m_gl->glEnableVertexAttribArray(0);
+        if (!m_triBuffer.initialize(context))
+        {
+            cleanup();
+            assert(false && "TriangleRenderer: Failed to initialize TriangleVboManager");
+            return false;
+        }
 
-        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_nEbo);
+        // uniform 位置只解析一次，渲染时管理器不再查询当前程序
+        m_triBuffer.setProgram(ProgramUniforms::resolve(m_gl, m_program->programId()));
+        m_triBuffer.setStateCache(m_stateCache);
 
         GLenum error = m_gl->glGetError();
         if (error != GL_NO_ERROR)
@@ -65,77 +65,31 @@ namespace GLRhi
             return false;
         }
 
-        m_gl->glBindVertexArray(0);
-
         return true;
     }
 
     void TriangleRenderer::updateData(const std::vector<TriangleData>& vTriDatas)
     {
-        if (!m_gl || !m_nVao)
-            return;
-
-        //std::sort(vTriDatas.begin(), vTriDatas.end(), [](const TriangleData& a, const TriangleData& b) {
-        //    if (a.brush.d() != b.brush.d())
-        //        return a.brush.d() < b.brush.d();
-
-        //    return a.brush.a() >= 1.0f && b.brush.a() < 1.0f; }
-        //);
-
-        size_t nTotalVertices = 0;
-        size_t nTotalIndices = 0;
-        m_vecBatches.clear();
-        m_vecBatches.reserve(vTriDatas.size());
-
+        std::vector<std::tuple<long long, float*, size_t, unsigned int*, size_t, Color>> vBatch;
+        vBatch.reserve(vTriDatas.size());
         for (const auto& triData : vTriDatas)
         {
-            Batch batch;
-            batch.indexOffset = static_cast<unsigned int>(nTotalIndices);
-            batch.indexCount = static_cast<unsigned int>(triData.vIndices.size());
-            batch.brush = triData.brush;
-            m_vecBatches.emplace_back(batch);
-
-            nTotalVertices += triData.vVerts.size() / 3;
-            nTotalIndices += triData.vIndices.size();
+            // 管理器只读取顶点和索引，不会修改
+            vBatch.emplace_back(triData.id, const_cast<float*>(triData.vVerts.data()), triData.vVerts.size() / 3,
+                const_cast<unsigned int*>(triData.vIndices.data()), triData.vIndices.size(),
+                Color(triData.brush.getColor()));
         }
 
-        std::vector<float> allVertices;
-        allVertices.reserve(nTotalVertices * 3);
-        for (const auto& triData : vTriDatas)
-            allVertices.insert(allVertices.end(), triData.vVerts.begin(), triData.vVerts.end());
-
-        std::vector<unsigned int> allIndices;
-        allIndices.reserve(nTotalIndices);
-
-        unsigned int vertexOffset = 0;
-        for (const auto& triData : vTriDatas)
-        {
-            for (unsigned int index : triData.vIndices)
-                allIndices.push_back(index + vertexOffset);
-
-            vertexOffset += static_cast<unsigned int>(triData.vVerts.size()) / 3;
-        }
-
-        m_gl->glBindVertexArray(m_nVao);
-
-        m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_nVbo);
-        m_gl->glBufferData(GL_ARRAY_BUFFER, allVertices.size() * sizeof(float),
-            allVertices.data(), GL_STATIC_DRAW);
-
-        m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_nEbo);
-        m_gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, allIndices.size() * sizeof(unsigned int),
-            allIndices.data(), GL_STATIC_DRAW);
-
-        m_gl->glBindVertexArray(0);
+        m_triBuffer.clearAllPrimitives();
+        m_triBuffer.addTriangles(vBatch);
     }
 
     void TriangleRenderer::render(const float* matMVP)
     {
-        if (!m_gl || !m_program || m_vecBatches.empty())
+        if (!m_gl || !m_program)
             return;
 
-        m_program->bind();
-        m_gl->glBindVertexArray(m_nVao);
+        useProgram();
         m_gl->glEnable(GL_DEPTH_TEST);
 
         if (m_bBlend)
@@ -152,28 +106,11 @@ namespace GLRhi
         if (m_uCameraMatLoc >= 0 && matMVP)
             m_program->setUniformValue(m_uCameraMatLoc, QMatrix4x4(matMVP));
 
-        for (const auto& batch : m_vecBatches)
-        {
-            const auto& b = batch.brush;
-            m_program->setUniformValue(m_uDepthLoc, b.d());
-
-            if (m_bBlend)
-            {
-                m_program->setUniformValue(m_uColorLoc,
-                    QVector4D(b.r(), b.g(), b.b(), b.a()));
-            }
-            else
-            {
-                m_program->setUniformValue(m_uColorLoc,
-                    QVector4D(b.r(), b.g(), b.b(), 1.0f));
-            }
-
-            m_gl->glDrawElements(GL_TRIANGLES, batch.indexCount, GL_UNSIGNED_INT,
-                (void*)(batch.indexOffset * sizeof(unsigned int)));
-        }
+        // 管理器按颜色分块绘制，不区分多边形的深度，所有三角形画在同一深度
+        m_program->setUniformValue(m_uDepthLoc, 0.0f);
 
-        m_gl->glBindVertexArray(0);
-        m_program->release();
+        m_triBuffer.renderVisiblePrimitivesEx();
+        releaseProgram();
     }
 
     void TriangleRenderer::cleanup()
@@ -181,13 +118,17 @@ namespace GLRhi
         if (!m_gl)
             return;
 
-        deleteVaoVbo(m_nVao, m_nVbo);
-        deleteEbo(m_nEbo);
+        clearData();
         deleteProgram(m_program);
 
         m_gl = nullptr;
     }
 
+    void TriangleRenderer::clearData()
+    {
+        m_triBuffer.clearAllPrimitives();
+    }
+
     void TriangleRenderer::setBlendEnabled(bool enabled)
     {
         m_bBlend = enabled;
@@ -197,4 +138,33 @@ namespace GLRhi
     {
         return m_bBlend;
     }
+
+    void TriangleRenderer::setViewRect(const QRectF& rect)
+    {
+        QuantBox box;
+        if (!rect.isEmpty())
+        {
+            QRectF r = rect.normalized();
+            box.fMinX = static_cast<float>(r.left());
+            box.fMinY = static_cast<float>(r.top());
+            box.fMaxX = static_cast<float>(r.right());
+            box.fMaxY = static_cast<float>(r.bottom());
+        }
+        m_triBuffer.setViewRect(box);
+    }
+
+    void TriangleRenderer::setPixelSize(float fWorldPerPixel)
+    {
+        m_triBuffer.setPixelSize(fWorldPerPixel);
+    }
+
+    TriangleVboManager* TriangleRenderer::getVboManager()
+    {
+        return &m_triBuffer;
+    }
+
+    void TriangleRenderer::setStagingRing(StagingRing* pRing)
+    {
+        m_triBuffer.setStagingRing(pRing);
+    }
 }
\ No newline at end of file
@@ -4,13 +4,21 @@ const char* baseLineVS = R"(
 #version 330 core
 
 layout(location = 0) in vec3 aPos;
+// 共享块的顶点颜色（RGBA8 归一化），按颜色分块时该属性未启用
+layout(location = 1) in vec4 aColor;
 
 uniform mat4 uCameraMat;
 uniform float uDepth = 0.0f;
+// 紧凑顶点格式的反量化参数：xy 缩放，zw 偏移（Float3/Float2 为单位变换）
+uniform vec4 uQuantBox = vec4(1.0, 1.0, 0.0, 0.0);
+
+out vec4 vColor;
 
 void main()
 {
-    gl_Position = vec4(aPos.xy, uDepth, 1.0) * uCameraMat;
+    vColor = aColor;
+    vec2 pos = aPos.xy * uQuantBox.xy + uQuantBox.zw;
+    gl_Position = vec4(pos, uDepth, 1.0) * uCameraMat;
 }
 
 )";
@@ -19,10 +27,13 @@ const char* baseLineFS = R"(
 #version 330 core
 
 uniform vec4 uColor;
+uniform bool uUseVertexColor = false;
+
+in vec4 vColor;
 out vec4 FragColor;
 
 void main()
 {
-    FragColor = uColor;
+    FragColor = uUseVertexColor ? vColor : uColor;
 }
 )";
\ No newline at end of file
@@ -3,13 +3,21 @@
 const char* baseTriangleVS = R"(
 #version 330 core
 layout(location = 0) in vec3 aPosition;
+// 共享块的顶点颜色（RGBA8 归一化），按颜色分块时该属性未启用
+layout(location = 1) in vec4 aColor;
 
 uniform mat4 uCameraMat;
 uniform float uDepth;
+// 紧凑顶点格式的反量化参数：xy 缩放，zw 偏移（Float3/Float2 为单位变换）
+uniform vec4 uQuantBox = vec4(1.0, 1.0, 0.0, 0.0);
+
+out vec4 vColor;
 
 void main()
 {
-    gl_Position = vec4(aPosition.xy, (1 - uDepth) / 2.0f, 1.0) * uCameraMat;
+    vColor = aColor;
+    vec2 pos = aPosition.xy * uQuantBox.xy + uQuantBox.zw;
+    gl_Position = vec4(pos, (1 - uDepth) / 2.0f, 1.0) * uCameraMat;
 }
 )";
 
@@ -17,11 +25,13 @@ const char* baseTriangleFS = R"(
 #version 330 core
 
 uniform vec4 uColor;
+uniform bool uUseVertexColor = false;
 
+in vec4 vColor;
 out vec4 fragColor;
 
 void main()
 {
-    fragColor = uColor;
+    fragColor = uUseVertexColor ? vColor : uColor;
 }
 )";
\ No newline at end of file